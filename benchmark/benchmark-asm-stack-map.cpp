@@ -0,0 +1,72 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/project.h>
+#include <cppstacksize/synthetic.h>
+#include <cppstacksize/x86-64-decoder.h>
+#include <optional>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_analyze_x86_64_stack_map_synthetic(benchmark::State& state) {
+  std::vector<U8> code =
+      make_synthetic_x86_64_code(narrow_cast<U64>(state.range(0)));
+  for (auto _ : state) {
+    Stack_Map map = analyze_x86_64_stack_map(code);
+    benchmark::DoNotOptimize(map.touches.data());
+  }
+  state.SetBytesProcessed(narrow_cast<S64>(state.iterations() * code.size()));
+}
+BENCHMARK(benchmark_analyze_x86_64_stack_map_synthetic)->Range(1, 1 << 12);
+
+void benchmark_decode_x86_64_instruction_fast_synthetic(
+    benchmark::State& state) {
+  std::vector<U8> code =
+      make_synthetic_x86_64_code(narrow_cast<U64>(state.range(0)));
+  X86_64_Instruction instruction;
+  for (auto _ : state) {
+    U64 offset = 0;
+    while (offset < code.size()) {
+      if (!decode_x86_64_instruction_fast(std::span(code).subspan(offset),
+                                          offset, instruction)) {
+        break;
+      }
+      benchmark::DoNotOptimize(instruction.operands);
+      offset += instruction.byte_size;
+    }
+  }
+  state.SetBytesProcessed(narrow_cast<S64>(state.iterations() * code.size()));
+}
+BENCHMARK(benchmark_decode_x86_64_instruction_fast_synthetic)
+    ->Range(1, 1 << 12);
+
+void benchmark_analyze_x86_64_stack_map_example(benchmark::State& state) {
+  Project project;
+  project.add_file("temporary.pdb",
+                   Example_File("pdb-pe/temporary.pdb").loaded_file());
+  project.add_file("temporary.dll",
+                   Example_File("pdb-pe/temporary.dll").loaded_file());
+  std::vector<std::vector<U8>> function_codes;
+  U64 total_size = 0;
+  for (const CodeView_Function& function : project.get_all_functions()) {
+    std::optional<Sub_File_Reader<Span_Reader>> reader =
+        function.get_instruction_bytes_reader();
+    if (!reader.has_value()) continue;
+    std::vector<U8>& code = function_codes.emplace_back(reader->size());
+    reader->copy_bytes_into(code, 0);
+    total_size += code.size();
+  }
+
+  for (auto _ : state) {
+    for (const std::vector<U8>& code : function_codes) {
+      Stack_Map map = analyze_x86_64_stack_map(code);
+      benchmark::DoNotOptimize(map.touches.data());
+    }
+  }
+  state.SetBytesProcessed(narrow_cast<S64>(state.iterations() * total_size));
+}
+BENCHMARK(benchmark_analyze_x86_64_stack_map_example);
+}
+}
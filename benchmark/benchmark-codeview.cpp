@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/synthetic.h>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_parse_codeview_types_without_header(benchmark::State& state) {
+  U64 type_count = narrow_cast<U64>(state.range(0));
+  std::vector<U8> types = make_synthetic_codeview_types(type_count);
+  Span_Reader reader(types);
+  Sub_File_Reader<Span_Reader> type_reader(&reader, 0);
+  for (auto _ : state) {
+    CodeView_Type_Table table =
+        parse_codeview_types_without_header(&type_reader);
+    benchmark::DoNotOptimize(table.type_entry_offsets_.data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * type_count));
+}
+BENCHMARK(benchmark_parse_codeview_types_without_header)
+    ->Range(1 << 6, 1 << 18);
+
+void benchmark_codeview_type_table_get_type(benchmark::State& state) {
+  U64 type_count = narrow_cast<U64>(state.range(0));
+  std::vector<U8> types = make_synthetic_codeview_types(type_count);
+  Span_Reader reader(types);
+  Sub_File_Reader<Span_Reader> type_reader(&reader, 0);
+  CodeView_Type_Table table = parse_codeview_types_without_header(&type_reader);
+  for (auto _ : state) {
+    for (U64 i = 0; i < type_count; ++i) {
+      std::optional<CodeView_Type> type =
+          table.get_type(narrow_cast<U32>(0x1000 + i));
+      benchmark::DoNotOptimize(type);
+    }
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * type_count));
+}
+BENCHMARK(benchmark_codeview_type_table_get_type)->Range(1 << 6, 1 << 16);
+
+void benchmark_find_all_codeview_functions_2_synthetic(
+    benchmark::State& state) {
+  U64 function_count = narrow_cast<U64>(state.range(0));
+  std::vector<U8> streams[] = {
+      make_synthetic_codeview_symbols(
+          function_count, /*locals_per_function=*/4,
+          /*first_func_id_type_id=*/0x1000, /*first_code_offset=*/0,
+          /*function_code_size=*/0x40),
+  };
+  Synthetic_PDB pdb(streams);
+  PDB_Blocks_Reader<Span_Reader>& symbols_reader = pdb.stream(0);
+  for (auto _ : state) {
+    std::vector<CodeView_Function> functions =
+        find_all_codeview_functions_2(&symbols_reader);
+    benchmark::DoNotOptimize(functions.data());
+  }
+  state.SetItemsProcessed(
+      narrow_cast<S64>(state.iterations() * function_count));
+}
+BENCHMARK(benchmark_find_all_codeview_functions_2_synthetic)
+    ->Range(1 << 6, 1 << 16);
+
+void benchmark_find_all_codeview_functions_2_example(benchmark::State& state) {
+  Example_File file("pdb-pe/multi-obj.pdb");
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+  PDB_DBI dbi = parse_pdb_dbi_stream(streams.at(3));
+  // The linker module has a malformed record. Don't spam the console.
+  Null_Logger logger;
+  for (auto _ : state) {
+    std::vector<CodeView_Function> functions;
+    for (const PDB_DBI_Module& module : dbi.modules) {
+      if (module.debug_info_stream_index >= streams.size()) continue;
+      find_all_codeview_functions_2(&streams[module.debug_info_stream_index],
+                                    functions, logger);
+    }
+    benchmark::DoNotOptimize(functions.data());
+  }
+}
+BENCHMARK(benchmark_find_all_codeview_functions_2_example);
+
+void benchmark_codeview_function_get_locals(benchmark::State& state) {
+  U64 locals_per_function = narrow_cast<U64>(state.range(0));
+  std::vector<U8> streams[] = {
+      make_synthetic_codeview_symbols(
+          /*function_count=*/64, locals_per_function,
+          /*first_func_id_type_id=*/0x1000, /*first_code_offset=*/0,
+          /*function_code_size=*/0x40),
+  };
+  Synthetic_PDB pdb(streams);
+  std::vector<CodeView_Function> functions =
+      find_all_codeview_functions_2(&pdb.stream(0));
+  for (auto _ : state) {
+    for (const CodeView_Function& function : functions) {
+      std::vector<CodeView_Function_Local> locals =
+          function.get_locals(function.byte_offset);
+      benchmark::DoNotOptimize(locals.data());
+    }
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() *
+                                           functions.size() *
+                                           locals_per_function));
+}
+BENCHMARK(benchmark_codeview_function_get_locals)->Range(1, 1 << 10);
+}
+}
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/function-name-index.h>
+#include <string>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+// Returns a name which looks like a C++ member function, e.g.
+// "namespace_12::Class_345::method_6789".
+std::u8string make_function_name(U64 i) {
+  std::string name = "namespace_" + std::to_string(i % 97) + "::Class_" +
+                     std::to_string(i % 4093) + "::method_" +
+                     std::to_string(i);
+  return std::u8string(name.begin(), name.end());
+}
+
+Function_Name_Index make_index(U64 name_count) {
+  Function_Name_Index index;
+  for (U64 i = 0; i < name_count; ++i) {
+    index.add_name(make_function_name(i));
+  }
+  index.build();
+  return index;
+}
+
+void benchmark_function_name_index_build(benchmark::State& state) {
+  U64 name_count = narrow_cast<U64>(state.range(0));
+  std::vector<std::u8string> names;
+  for (U64 i = 0; i < name_count; ++i) {
+    names.push_back(make_function_name(i));
+  }
+  for (auto _ : state) {
+    Function_Name_Index index;
+    for (const std::u8string& name : names) {
+      index.add_name(name);
+    }
+    index.build();
+    benchmark::DoNotOptimize(index.size());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * name_count));
+}
+BENCHMARK(benchmark_function_name_index_build)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMillisecond);
+
+void benchmark_function_name_index_find_substring(benchmark::State& state) {
+  U64 name_count = narrow_cast<U64>(state.range(0));
+  Function_Name_Index index = make_index(name_count);
+  std::vector<U32> matches;
+  for (auto _ : state) {
+    index.find_matching(u8"class_409::method_1", matches);
+    benchmark::DoNotOptimize(matches.data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations()));
+}
+BENCHMARK(benchmark_function_name_index_find_substring)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+void benchmark_function_name_index_find_short_substring(
+    benchmark::State& state) {
+  U64 name_count = narrow_cast<U64>(state.range(0));
+  Function_Name_Index index = make_index(name_count);
+  std::vector<U32> matches;
+  for (auto _ : state) {
+    index.find_matching(u8"_7", matches);
+    benchmark::DoNotOptimize(matches.data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations()));
+}
+BENCHMARK(benchmark_function_name_index_find_short_substring)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+
+void benchmark_function_name_index_find_glob(benchmark::State& state) {
+  U64 name_count = narrow_cast<U64>(state.range(0));
+  Function_Name_Index index = make_index(name_count);
+  std::vector<U32> matches;
+  for (auto _ : state) {
+    index.find_matching(u8"namespace_1?::*::method_12*", matches);
+    benchmark::DoNotOptimize(matches.data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations()));
+}
+BENCHMARK(benchmark_function_name_index_find_glob)
+    ->Range(1 << 10, 1 << 20)
+    ->Unit(benchmark::kMicrosecond);
+}
+}
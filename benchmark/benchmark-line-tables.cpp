@@ -0,0 +1,60 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/synthetic.h>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_line_tables_source_info_for_offset_synthetic(
+    benchmark::State& state) {
+  U64 function_count = narrow_cast<U64>(state.range(0));
+  constexpr U32 function_size = 0x100;
+  std::vector<U8> streams[] = {
+      make_synthetic_c13_lines(function_count, /*first_code_offset=*/0,
+                               function_size, /*line_count=*/16),
+  };
+  Synthetic_PDB pdb(streams);
+  Line_Tables line_tables;
+  Line_Tables::Handle handle = line_tables.add_module_line_tables(
+      Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>(&pdb.stream(0), 0));
+
+  // Look up one instruction in each function, in a scattered order.
+  constexpr U64 lookup_count = 256;
+  for (auto _ : state) {
+    for (U64 i = 0; i < lookup_count; ++i) {
+      U64 function_index = (i * 7919) % function_count;
+      Line_Source_Info info = line_tables.source_info_for_offset(
+          handle, /*code_section_index=*/0,
+          narrow_cast<U32>(function_index * function_size + 0x42));
+      benchmark::DoNotOptimize(info);
+    }
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * lookup_count));
+}
+BENCHMARK(benchmark_line_tables_source_info_for_offset_synthetic)
+    ->Range(1 << 4, 1 << 14);
+
+void benchmark_line_tables_source_info_for_offset_example(
+    benchmark::State& state) {
+  Example_File file("pdb-pe/line-numbers.pdb");
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+  PDB_DBI dbi = parse_pdb_dbi_stream(streams.at(3));
+  Line_Tables line_tables;
+  Line_Tables::Handle handle =
+      line_tables.add_module_line_tables(dbi.modules.at(0), streams);
+  for (auto _ : state) {
+    // Function foo: 0x10 through 0x2d.
+    for (U32 offset = 0x10; offset < 0x2d; ++offset) {
+      Line_Source_Info info = line_tables.source_info_for_offset(
+          handle, /*code_section_index=*/0, offset);
+      benchmark::DoNotOptimize(info);
+    }
+  }
+}
+BENCHMARK(benchmark_line_tables_source_info_for_offset_example);
+}
+}
@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/synthetic.h>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_parse_pdb_stream_directory_synthetic(benchmark::State& state) {
+  // Many small streams, like a PDB with many modules.
+  std::vector<std::vector<U8>> streams(narrow_cast<U64>(state.range(0)),
+                                       std::vector<U8>(4096 * 3));
+  Synthetic_PDB pdb(streams);
+  PDB_Super_Block super_block = parse_pdb_header(pdb.reader());
+  for (auto _ : state) {
+    std::vector<PDB_Blocks_Reader<Span_Reader>> parsed_streams =
+        parse_pdb_stream_directory(&pdb.reader(), super_block);
+    benchmark::DoNotOptimize(parsed_streams.data());
+  }
+  state.SetItemsProcessed(
+      narrow_cast<S64>(state.iterations() * streams.size()));
+}
+BENCHMARK(benchmark_parse_pdb_stream_directory_synthetic)
+    ->Range(1 << 4, 1 << 14);
+
+void benchmark_parse_pdb_stream_directory_example(benchmark::State& state) {
+  Example_File file("pdb/example.pdb");
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  for (auto _ : state) {
+    std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+        parse_pdb_stream_directory(&file.reader(), super_block);
+    benchmark::DoNotOptimize(streams.data());
+  }
+}
+BENCHMARK(benchmark_parse_pdb_stream_directory_example);
+
+void benchmark_parse_pdb_dbi_stream_synthetic(benchmark::State& state) {
+  U64 module_count = narrow_cast<U64>(state.range(0));
+  Synthetic_PDB pdb(make_synthetic_pdb(Synthetic_PDB_Options{
+      .block_layout = Synthetic_MSF_Block_Layout::shuffled,
+      .module_count = module_count,
+  }));
+  for (auto _ : state) {
+    PDB_DBI dbi = parse_pdb_dbi_stream(pdb.stream(3));
+    benchmark::DoNotOptimize(dbi.modules.data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * module_count));
+}
+BENCHMARK(benchmark_parse_pdb_dbi_stream_synthetic)->Range(1 << 4, 1 << 15);
+
+void benchmark_parse_pdb_dbi_stream_example(benchmark::State& state) {
+  Example_File file("pdb-pe/multi-obj.pdb");
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+  for (auto _ : state) {
+    PDB_DBI dbi = parse_pdb_dbi_stream(streams.at(3));
+    benchmark::DoNotOptimize(dbi.modules.data());
+  }
+}
+BENCHMARK(benchmark_parse_pdb_dbi_stream_example);
+}
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/file.h>
+#include <cppstacksize/project.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <cppstacksize/synthetic.h>
+#include <optional>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_project_load_functions_synthetic(benchmark::State& state) {
+  U64 module_count = narrow_cast<U64>(state.range(0));
+  Synthetic_PDB_Options options = {
+      .block_layout = Synthetic_MSF_Block_Layout::interleaved,
+      .module_count = module_count,
+      .functions_per_module = 64,
+      .locals_per_function = 4,
+      .lines_per_function = 8,
+      .extra_type_count = 1024,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  U64 function_count = 0;
+  for (auto _ : state) {
+    Project project;
+    project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+    function_count = project.get_all_functions().size();
+    benchmark::DoNotOptimize(project.get_type_table());
+    benchmark::DoNotOptimize(project.get_type_index_table());
+  }
+  state.SetItemsProcessed(
+      narrow_cast<S64>(state.iterations() * function_count));
+}
+BENCHMARK(benchmark_project_load_functions_synthetic)->Range(1 << 2, 1 << 10);
+
+void benchmark_project_load_functions_synthetic_global_symbols(
+    benchmark::State& state) {
+  bool use_global_symbols = state.range(0) != 0;
+  Synthetic_PDB_Options options = {
+      .module_count = 256,
+      .functions_per_module = 64,
+      .locals_per_function = 16,
+      .lines_per_function = 8,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  U64 function_count = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::optional<Project> project(std::in_place);
+    project->set_use_pdb_global_symbols(use_global_symbols);
+    project->add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+    state.ResumeTiming();
+
+    function_count = project->get_all_functions().size();
+
+    // Exclude waiting for Project's background work.
+    state.PauseTiming();
+    project.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(
+      narrow_cast<S64>(state.iterations() * function_count));
+}
+BENCHMARK(benchmark_project_load_functions_synthetic_global_symbols)
+    ->ArgName("global_symbols")
+    ->Arg(0)
+    ->Arg(1);
+
+void benchmark_project_find_function_by_address(benchmark::State& state) {
+  U64 module_count = narrow_cast<U64>(state.range(0));
+  Synthetic_PDB_Options options = {
+      .module_count = module_count,
+      .functions_per_module = 256,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  U64 function_count = project.get_all_functions().size();
+  project.get_function_address_index();
+
+  // See make_synthetic_pdb: each function is 0x40 bytes.
+  U32 code_size = narrow_cast<U32>(function_count * 0x40);
+  U32 code_offset = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        project.find_function_by_address("synthetic.pdb", 0, code_offset));
+    // Visit addresses in a scattered order.
+    code_offset = (code_offset + 0x9e3779b1) % code_size;
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations()));
+}
+BENCHMARK(benchmark_project_find_function_by_address)->Range(1 << 2, 1 << 8);
+
+// Measures a scan which needs only one field of each function, such as sorting
+// the function table by size.
+void benchmark_project_scan_self_stack_sizes(benchmark::State& state) {
+  U64 module_count = narrow_cast<U64>(state.range(0));
+  Synthetic_PDB_Options options = {
+      .module_count = module_count,
+      .functions_per_module = 256,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  const CodeView_Function_Table& functions = project.get_all_functions();
+
+  for (auto _ : state) {
+    U64 max_self_stack_size = 0;
+    for (U64 i = 0; i < functions.size(); ++i) {
+      max_self_stack_size =
+          std::max(max_self_stack_size, U64{functions.self_stack_size(i)});
+    }
+    benchmark::DoNotOptimize(max_self_stack_size);
+  }
+  state.SetItemsProcessed(
+      narrow_cast<S64>(state.iterations() * functions.size()));
+}
+BENCHMARK(benchmark_project_scan_self_stack_sizes)->Range(1 << 2, 1 << 8);
+
+// Measures opening a PDB and looking up one function, as when jumping to a
+// crash address.
+void benchmark_project_first_find_function_by_address(benchmark::State& state) {
+  bool lazy = state.range(0) != 0;
+  Synthetic_PDB_Options options = {
+      .module_count = 1024,
+      .functions_per_module = 64,
+      .locals_per_function = 4,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  // See make_synthetic_pdb: each function is 0x40 bytes.
+  U32 code_offset = 777 * 64 * 0x40 + 0x10;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::optional<Project> project(std::in_place);
+    project->add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+    state.ResumeTiming();
+
+    if (lazy) {
+      benchmark::DoNotOptimize(
+          project->find_pdb_function_by_address(0, code_offset));
+    } else {
+      benchmark::DoNotOptimize(
+          project->find_function_by_address("synthetic.pdb", 0, code_offset));
+    }
+
+    // Exclude waiting for Project's background work.
+    state.PauseTiming();
+    project.reset();
+    state.ResumeTiming();
+  }
+}
+BENCHMARK(benchmark_project_first_find_function_by_address)
+    ->ArgName("lazy")
+    ->Arg(0)
+    ->Arg(1);
+}
+}
@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/extent-reader.h>
+#include <cppstacksize/pdb-reader.h>
+#include <cppstacksize/reader.h>
+#include <cppstacksize/synthetic.h>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+std::vector<U8> make_data(U64 size) {
+  std::vector<U8> data(size);
+  for (U64 i = 0; i < size; ++i) {
+    data[i] = static_cast<U8>(i * 7);
+  }
+  return data;
+}
+
+void benchmark_span_reader_u32(benchmark::State& state) {
+  std::vector<U8> data = make_data(narrow_cast<U64>(state.range(0)));
+  Span_Reader reader(data);
+  for (auto _ : state) {
+    U32 sum = 0;
+    for (U64 offset = 0; offset + 4 <= reader.size(); offset += 4) {
+      sum += reader.u32(offset);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(narrow_cast<S64>(state.iterations() * data.size()));
+}
+BENCHMARK(benchmark_span_reader_u32)->Range(1 << 12, 1 << 24);
+
+void benchmark_pdb_blocks_reader_u32(benchmark::State& state) {
+  std::vector<U8> streams[] = {make_data(narrow_cast<U64>(state.range(0)))};
+  Synthetic_PDB pdb(streams);
+  PDB_Blocks_Reader<Span_Reader>& reader = pdb.stream(0);
+  for (auto _ : state) {
+    U32 sum = 0;
+    for (U64 offset = 0; offset + 4 <= reader.size(); offset += 4) {
+      sum += reader.u32(offset);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(
+      narrow_cast<S64>(state.iterations() * reader.size()));
+}
+BENCHMARK(benchmark_pdb_blocks_reader_u32)->Range(1 << 12, 1 << 24);
+
+void benchmark_extent_reader_pdb_blocks_u32(benchmark::State& state) {
+  std::vector<U8> streams[] = {make_data(narrow_cast<U64>(state.range(0)))};
+  Synthetic_PDB pdb(streams);
+  Extent_Reader reader = pdb.stream(0);
+  for (auto _ : state) {
+    U32 sum = 0;
+    for (U64 offset = 0; offset + 4 <= reader.size(); offset += 4) {
+      sum += reader.u32(offset);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(
+      narrow_cast<S64>(state.iterations() * reader.size()));
+}
+BENCHMARK(benchmark_extent_reader_pdb_blocks_u32)->Range(1 << 12, 1 << 24);
+
+void benchmark_pdb_blocks_reader_copy_bytes_into(benchmark::State& state) {
+  std::vector<U8> streams[] = {make_data(narrow_cast<U64>(state.range(0)))};
+  Synthetic_PDB pdb(streams);
+  PDB_Blocks_Reader<Span_Reader>& reader = pdb.stream(0);
+  std::vector<U8> out(reader.size());
+  for (auto _ : state) {
+    reader.copy_bytes_into(out, 0);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(
+      narrow_cast<S64>(state.iterations() * reader.size()));
+}
+BENCHMARK(benchmark_pdb_blocks_reader_copy_bytes_into)->Range(1 << 12, 1 << 24);
+
+void benchmark_pdb_blocks_reader_utf_8_c_string(benchmark::State& state) {
+  // Strings of 14 characters plus a null terminator. Some strings straddle
+  // blocks.
+  std::vector<U8> stream(narrow_cast<U64>(state.range(0)), 'x');
+  for (U64 i = 14; i < stream.size(); i += 15) {
+    stream[i] = 0;
+  }
+  std::vector<U8> streams[] = {std::move(stream)};
+  Synthetic_PDB pdb(streams);
+  PDB_Blocks_Reader<Span_Reader>& reader = pdb.stream(0);
+  for (auto _ : state) {
+    U64 total_size = 0;
+    for (U64 offset = 0; offset + 15 <= reader.size(); offset += 15) {
+      total_size += reader.utf_8_c_string(offset).size();
+    }
+    benchmark::DoNotOptimize(total_size);
+  }
+  state.SetBytesProcessed(
+      narrow_cast<S64>(state.iterations() * reader.size()));
+}
+BENCHMARK(benchmark_pdb_blocks_reader_utf_8_c_string)
+    ->Range(1 << 12, 1 << 22);
+}
+}
@@ -0,0 +1,32 @@
+#include <benchmark/benchmark.h>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/stack-map-touch-group.h>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+void benchmark_stack_map_touch_groups_set_touches(benchmark::State& state) {
+  U64 touch_count = narrow_cast<U64>(state.range(0));
+  std::vector<Stack_Map_Touch> touches;
+  std::vector<Stack_Map_Touch_Location> locations;
+  for (U64 i = 0; i < touch_count; ++i) {
+    U32 offset = narrow_cast<U32>(i * 4);
+    S64 address = narrow_cast<S64>((i * 40) % 0x400);
+    touches.push_back(i % 3 == 0 ? Stack_Map_Touch::write(offset, address, 8)
+                                 : Stack_Map_Touch::read(offset, address, 8));
+    locations.push_back(Stack_Map_Touch_Location{
+        .line_source_info =
+            Line_Source_Info{.line_number = narrow_cast<U32>(i / 8)},
+    });
+  }
+
+  for (auto _ : state) {
+    Stack_Map_Touch_Groups groups;
+    groups.set_touches(touches, locations);
+    benchmark::DoNotOptimize(groups.raw_groups().data());
+  }
+  state.SetItemsProcessed(narrow_cast<S64>(state.iterations() * touch_count));
+}
+BENCHMARK(benchmark_stack_map_touch_groups_set_touches)->Range(1 << 4, 1 << 14);
+}
+}
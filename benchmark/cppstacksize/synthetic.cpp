@@ -0,0 +1,39 @@
+#include <cppstacksize/base.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <cppstacksize/synthetic.h>
+#include <utility>
+#include <vector>
+
+namespace cppstacksize {
+std::vector<U8> make_synthetic_x86_64_code(U64 group_count) {
+  static constexpr U8 group[] = {
+      0x48, 0x83, 0xec, 0x28,                          // sub $0x28, %rsp
+      0x48, 0x89, 0x44, 0x24, 0x20,                    // mov %rax, 0x20(%rsp)
+      0x48, 0x89, 0x5c, 0x24, 0x18,                    // mov %rbx, 0x18(%rsp)
+      0x48, 0x8b, 0x44, 0x24, 0x20,                    // mov 0x20(%rsp), %rax
+      0x48, 0x8d, 0x4c, 0x24, 0x10,                    // lea 0x10(%rsp), %rcx
+      0xc7, 0x44, 0x24, 0x08, 0x2a, 0x00, 0x00, 0x00,  // movl $42, 8(%rsp)
+      0xe8, 0x00, 0x00, 0x00, 0x00,                    // call .+5
+      0x48, 0x83, 0xc4, 0x28,                          // add $0x28, %rsp
+  };
+  Byte_Buffer out;
+  for (U64 i = 0; i < group_count; ++i) {
+    out.append_bytes(group);
+  }
+  out.append_u8(0xc3);  // ret
+  return std::move(out).data();
+}
+
+Synthetic_PDB::Synthetic_PDB(std::span<const std::vector<U8>> streams,
+                             U32 block_size,
+                             Synthetic_MSF_Block_Layout block_layout)
+    : Synthetic_PDB(
+          make_synthetic_msf(streams, block_size, block_layout, /*seed=*/42)) {}
+
+Synthetic_PDB::Synthetic_PDB(std::vector<U8> data)
+    : data_(std::move(data)), reader_(this->data_) {
+  PDB_Super_Block super_block = parse_pdb_header(this->reader_);
+  this->streams_ = parse_pdb_stream_directory(&this->reader_, super_block);
+}
+}
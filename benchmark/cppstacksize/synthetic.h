@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/pdb-reader.h>
+#include <cppstacksize/reader.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <span>
+#include <vector>
+
+namespace cppstacksize {
+// Discards log messages. Used to keep benchmark output readable when parsing
+// files which trigger warnings.
+class Null_Logger : public Logger {
+ public:
+  void log(std::string_view, const Location&) override {}
+};
+
+// Returns x86-64 machine code which repeatedly spills to and reloads from the
+// stack and calls functions with pointers to stack variables.
+std::vector<U8> make_synthetic_x86_64_code(U64 group_count);
+
+// An in-memory MSF (PDB) file parsed by parse_pdb_stream_directory.
+class Synthetic_PDB {
+ public:
+  // Builds the file with make_synthetic_msf.
+  explicit Synthetic_PDB(std::span<const std::vector<U8>> streams,
+                         U32 block_size = 4096,
+                         Synthetic_MSF_Block_Layout block_layout =
+                             Synthetic_MSF_Block_Layout::shuffled);
+  explicit Synthetic_PDB(std::vector<U8> data);
+
+  Synthetic_PDB(const Synthetic_PDB&) = delete;
+  Synthetic_PDB& operator=(const Synthetic_PDB&) = delete;
+
+  std::span<const U8> data() const { return this->data_; }
+
+  const Span_Reader& reader() const { return this->reader_; }
+
+  PDB_Blocks_Reader<Span_Reader>& stream(U64 index) {
+    return this->streams_.at(index);
+  }
+
+ private:
+  std::vector<U8> data_;
+  Span_Reader reader_;
+  std::vector<PDB_Blocks_Reader<Span_Reader>> streams_;
+};
+}
@@ -27,4 +27,13 @@ std::ostream& operator<<(std::ostream& out, const Stack_Map_Touch& touch) {
       << ", access_kind=" << touch.access_kind << "}";
   return out;
 }
+
+std::ostream& operator<<(std::ostream& out,
+                         const Stack_Map_Dynamic_Allocation& allocation) {
+  out << "Stack_Map_Dynamic_Allocation{offset=" << allocation.offset
+      << ", min_byte_count=" << allocation.min_byte_count
+      << ", max_byte_count=" << allocation.max_byte_count
+      << ", is_probed=" << allocation.is_probed << "}";
+  return out;
+}
 }
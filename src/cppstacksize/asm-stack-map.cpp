@@ -1,12 +1,13 @@
-#include <capstone/capstone.h>
+#include <algorithm>
 #include <cppstacksize/asm-stack-map.h>
 #include <cppstacksize/register.h>
+#include <cppstacksize/x86-64-decoder.h>
 #include <optional>
 #include <unordered_map>
 
 namespace cppstacksize {
 namespace {
-Stack_Access_Kind stack_access_kind_from_capstone(/*::cs_ac_type*/ U8 access);
+Stack_Access_Kind stack_access_kind_from_operand(const X86_64_Operand&);
 }
 
 bool is_read(Stack_Access_Kind sak) {
@@ -32,60 +33,136 @@ bool is_write(Stack_Access_Kind sak) {
 }
 
 Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
-  ::csh handle;
-  if (::cs_open(::CS_ARCH_X86, ::CS_MODE_64, &handle) != ::CS_ERR_OK) {
-    // TODO(strager): Log an error.
-    return Stack_Map();
-  }
-  ::cs_option(handle, ::CS_OPT_DETAIL, ::CS_OPT_ON);
-
-  ::cs_insn* instructions;
-  U64 base_address = 0;
-  U64 instruction_count = ::cs_disasm(handle, code.data(), code.size(),
-                                      base_address, 0, &instructions);
+  X86_64_Decoder decoder;
 
   Stack_Map map;
   map.registers.values[Register_Name::rsp] =
       Register_Value::make_entry_rsp_relative(0, 0);
   auto get_rsp_adjustment_from_value = [](const Register_Value& value) -> S64 {
-    if (value.kind != Register_Value_Kind::entry_rsp_relative) {
-      // TODO(strager)
-      return 0xcccccccc;
+    switch (value.kind) {
+      case Register_Value_Kind::entry_rsp_relative:
+        return value.entry_rsp_relative_offset;
+      case Register_Value_Kind::entry_rsp_relative_range:
+        return value.entry_rsp_relative_range.min;
+      default:
+        // TODO(strager)
+        return 0xcccccccc;
     }
-    return value.entry_rsp_relative_offset;
   };
-  auto get_rsp_adjustment = [&map, &get_rsp_adjustment_from_value]() -> S64 {
-    Register_Value& rsp_value = map.registers.values[Register_Name::rsp];
-    return get_rsp_adjustment_from_value(rsp_value);
+  // Records a touch if address is relative to the entry stack pointer.
+  auto touch_address = [&map](U32 offset, const Register_Value& address,
+                              U32 byte_count,
+                              Stack_Access_Kind access_kind) -> void {
+    switch (address.kind) {
+      case Register_Value_Kind::entry_rsp_relative:
+        map.touches.push_back(Stack_Map_Touch{
+            .offset = offset,
+            .entry_rsp_relative_address =
+                static_cast<S64>(address.entry_rsp_relative_offset),
+            .byte_count = byte_count,
+            .access_kind = access_kind,
+        });
+        break;
+
+      case Register_Value_Kind::entry_rsp_relative_range: {
+        // NOTE(strager): Conservatively assume that every address in the
+        // range is touched.
+        const Register_Value_Range& range = address.entry_rsp_relative_range;
+        U64 range_byte_count = range.max - range.min + byte_count;
+        map.touches.push_back(Stack_Map_Touch{
+            .offset = offset,
+            .entry_rsp_relative_address = static_cast<S64>(range.min),
+            .byte_count = range_byte_count < (U32)-1 ? U32(range_byte_count)
+                                                     : (U32)-1,
+            .access_kind = access_kind,
+        });
+        break;
+      }
+
+      default:
+        // NOTE(strager): After an unbounded dynamic allocation (such as
+        // alloca), %rsp is unknown. Instructions addressing memory relative
+        // to a frame pointer (such as %rbp) are still tracked.
+        // TODO(strager): Record touches with unknown addresses.
+        break;
+    }
   };
 
   // Byte offset of the most recently-encountered call instruction.
   U32 last_call_offset = 0;
+  bool previous_instruction_is_call = false;
 
-  for (::cs_insn& instruction : std::span(instructions, instruction_count)) {
-    U32 current_offset = narrow_cast<U32>(instruction.address);
-    ::cs_detail* details = instruction.detail;
-
-    switch (instruction.id) {
-      case ::X86_INS_MOV:
-      case ::X86_INS_MOVABS: {
-        CSS_ASSERT(details->x86.op_count == 2);
-        ::cs_x86_op* src = &details->x86.operands[1];
-        ::cs_x86_op* dest = &details->x86.operands[0];
-        if (dest->type == ::X86_OP_REG) {
+  constexpr X86_64_Register rsp = X86_64_Register::full(Register_Name::rsp);
+  constexpr X86_64_Register rdi = X86_64_Register::full(Register_Name::rdi);
+  constexpr X86_64_Register rsi = X86_64_Register::full(Register_Name::rsi);
+
+  X86_64_Instruction instruction;
+  U64 next_offset = 0;
+  while (next_offset < code.size()) {
+    U32 current_offset = narrow_cast<U32>(next_offset);
+    if (!decoder.decode(code.subspan(current_offset), current_offset,
+                        instruction)) {
+      // TODO(strager): Log an error.
+      break;
+    }
+    next_offset += instruction.byte_size;
+
+    switch (instruction.mnemonic) {
+      case X86_64_Mnemonic::mov: {
+        CSS_ASSERT(instruction.operand_count == 2);
+        const X86_64_Operand* src = &instruction.operands[1];
+        const X86_64_Operand* dest = &instruction.operands[0];
+        if (dest->kind == X86_64_Operand_Kind::register_) {
           map.registers.store(dest->reg, *src, current_offset);
         }
         break;
       }
 
-      case ::X86_INS_ADD:
-      case ::X86_INS_SUB: {
-        bool add = instruction.id == ::X86_INS_ADD;
-        CSS_ASSERT(details->x86.op_count == 2);
-        ::cs_x86_op* src = &details->x86.operands[1];
-        ::cs_x86_op* dest = &details->x86.operands[0];
-        if (dest->type == ::X86_OP_REG && dest->reg == ::X86_REG_RSP) {
+      case X86_64_Mnemonic::add:
+      case X86_64_Mnemonic::sub: {
+        bool add = instruction.mnemonic == X86_64_Mnemonic::add;
+        CSS_ASSERT(instruction.operand_count == 2);
+        const X86_64_Operand* src = &instruction.operands[1];
+        const X86_64_Operand* dest = &instruction.operands[0];
+        if (dest->kind == X86_64_Operand_Kind::register_ && dest->reg == rsp) {
           Register_Value src_value = map.registers.load(*src);
+          if (!add && src->kind == X86_64_Operand_Kind::register_) {
+            // Examples:
+            // mov $0x50, %eax; sub %rax, %rsp       (alloca(69))
+            // call __chkstk; sub %rax, %rsp         (alloca(n))
+            //
+            // NOTE(strager): A fixed-size frame is usually allocated with
+            // an immediate (sub $0x28, %rsp). MSVC allocates large frames
+            // with call __chkstk; sub %rax, %rsp, but before setting up the
+            // frame pointer (if any). Treat other register-sized
+            // allocations as dynamic.
+            // TODO(strager): Use the frame register from unwind
+            // information instead of assuming %rbp.
+            Register_Value_Kind rbp_kind =
+                map.registers.values[Register_Name::rbp].kind;
+            bool has_frame_pointer =
+                rbp_kind == Register_Value_Kind::entry_rsp_relative ||
+                rbp_kind == Register_Value_Kind::entry_rsp_relative_range;
+            if (src_value.kind != Register_Value_Kind::literal ||
+                has_frame_pointer) {
+              Stack_Map_Dynamic_Allocation allocation = {
+                  .offset = current_offset,
+                  .min_byte_count = 0,
+                  .max_byte_count = (U64)-1,
+                  .is_probed = previous_instruction_is_call,
+              };
+              std::optional<Register_Value_Range> byte_count =
+                  get_literal_range(src_value);
+              // NOTE(strager): No thread has a 4 GiB stack, so treat huge
+              // allocations as unbounded.
+              if (byte_count.has_value() && byte_count->max <= 0xffffffff) {
+                allocation.min_byte_count = byte_count->min;
+                allocation.max_byte_count = byte_count->max;
+              }
+              map.dynamic_allocations.push_back(allocation);
+            }
+          }
+
           if (src_value.kind == Register_Value_Kind::literal) {
             S64 increment = src_value.literal;
             // TODO(strager): Checked addition/subtraction.
@@ -94,66 +171,86 @@ Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
             } else {
               map.registers.add(dest->reg, -increment, current_offset);
             }
+          } else if (!add) {
+            map.registers.subtract(dest->reg, src_value, current_offset);
           }
         }
         break;
       }
 
-      case ::X86_INS_POP: {
-        CSS_ASSERT(details->x86.op_count == 1);
-        ::cs_x86_op* src = &details->x86.operands[0];
-        map.touches.push_back(Stack_Map_Touch{
-            .offset = current_offset,
-            .entry_rsp_relative_address = get_rsp_adjustment(),
-            .byte_count = src->size,
-            .access_kind = Stack_Access_Kind::read_only,
-        });
-        map.registers.add(::X86_REG_RSP, src->size, current_offset);
+      case X86_64_Mnemonic::and_: {
+        CSS_ASSERT(instruction.operand_count == 2);
+        const X86_64_Operand* src = &instruction.operands[1];
+        const X86_64_Operand* dest = &instruction.operands[0];
+        // NOTE(strager): Ignore stack realignment (e.g. and $-0x20, %rsp).
+        // TODO(strager): Track realigned stack pointers.
+        if (dest->kind == X86_64_Operand_Kind::register_ &&
+            dest->reg.name != Register_Name::rsp) {
+          map.registers.bitwise_and(dest->reg, map.registers.load(*src),
+                                    current_offset);
+        }
         break;
       }
 
-      case ::X86_INS_RET:
-        map.touches.push_back(Stack_Map_Touch{
-            .offset = current_offset,
-            .entry_rsp_relative_address = get_rsp_adjustment(),
-            .byte_count = 8,
-            .access_kind = Stack_Access_Kind::read_only,
-        });
-        map.registers.add(::X86_REG_RSP, 8, current_offset);
+      case X86_64_Mnemonic::movzx: {
+        // Examples:
+        // movzbl (%rdi), %ecx
+        // movzwl %ax, %eax
+        CSS_ASSERT(instruction.operand_count == 2);
+        const X86_64_Operand* src = &instruction.operands[1];
+        const X86_64_Operand* dest = &instruction.operands[0];
+        U64 src_max = (U64(1) << (src->byte_size * 8)) - 1;
+        map.registers.store(
+            dest->reg,
+            Register_Value::make_literal_range(0, src_max, current_offset),
+            current_offset);
         break;
+      }
 
-      case ::X86_INS_PUSH: {
-        CSS_ASSERT(details->x86.op_count == 1);
-        ::cs_x86_op* src = &details->x86.operands[0];
-        map.registers.add(::X86_REG_RSP, -src->size, current_offset);
-        map.touches.push_back(Stack_Map_Touch{
-            .offset = current_offset,
-            .entry_rsp_relative_address = get_rsp_adjustment(),
-            .byte_count = src->size,
-            .access_kind = Stack_Access_Kind::write_only,
-        });
+      case X86_64_Mnemonic::pop: {
+        CSS_ASSERT(instruction.operand_count == 1);
+        const X86_64_Operand* src = &instruction.operands[0];
+        touch_address(current_offset, map.registers.load(rsp), src->byte_size,
+                      Stack_Access_Kind::read_only);
+        map.registers.add(rsp, src->byte_size, current_offset);
+        break;
+      }
+
+      case X86_64_Mnemonic::ret:
+        touch_address(current_offset, map.registers.load(rsp), 8,
+                      Stack_Access_Kind::read_only);
+        map.registers.add(rsp, 8, current_offset);
+        break;
+
+      case X86_64_Mnemonic::push: {
+        CSS_ASSERT(instruction.operand_count == 1);
+        const X86_64_Operand* src = &instruction.operands[0];
+        map.registers.add(rsp, -src->byte_size, current_offset);
+        touch_address(current_offset, map.registers.load(rsp), src->byte_size,
+                      Stack_Access_Kind::write_only);
         break;
       }
+
+      default:
+        break;
     }
 
-    switch (instruction.id) {
-      case ::X86_INS_LEA: {
+    switch (instruction.mnemonic) {
+      case X86_64_Mnemonic::lea: {
         // Examples:
         // lea src, %rsp
         // lea 0x30(%rsp), %eax
-        CSS_ASSERT(details->x86.op_count == 2);
-        ::cs_x86_op* src = &details->x86.operands[1];
-        CSS_ASSERT(src->type == ::X86_OP_MEM);
-        ::cs_x86_op* dest = &details->x86.operands[0];
+        CSS_ASSERT(instruction.operand_count == 2);
+        const X86_64_Operand* src = &instruction.operands[1];
+        CSS_ASSERT(src->kind == X86_64_Operand_Kind::memory);
+        const X86_64_Operand* dest = &instruction.operands[0];
 
-        // TODO(strager): What if index is present?
-        map.registers.store(dest->reg, map.registers.load(src->mem.base),
+        map.registers.store(dest->reg, map.registers.load_address(src->memory),
                             current_offset);
-        map.registers.add(dest->reg, src->mem.disp, current_offset);
         break;
       }
 
-      case ::X86_INS_CALL: {
+      case X86_64_Mnemonic::call: {
         // Key: entry_rsp_relative_address
         // Value: instruction_offset
         std::unordered_map<S64, U32> address_to_instruction_offset;
@@ -164,7 +261,10 @@ Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
           Register_Value& value = map.registers.values[reg];
           bool is_register_likely_updated_for_this_function_call =
               value.last_update_offset >= last_call_offset;
-          if (value.kind == Register_Value_Kind::entry_rsp_relative &&
+          bool is_entry_rsp_relative =
+              value.kind == Register_Value_Kind::entry_rsp_relative ||
+              value.kind == Register_Value_Kind::entry_rsp_relative_range;
+          if (is_entry_rsp_relative &&
               is_register_likely_updated_for_this_function_call) {
             // NOTE(strager): Using std::unordered_map<>::operator[] is fine
             // because it returns 0 if an entry is missing and
@@ -188,28 +288,30 @@ Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
           });
         }
 
+        if (instruction.operand_count >= 1 &&
+            instruction.operands[0].kind == X86_64_Operand_Kind::immediate) {
+          map.direct_call_targets.push_back(instruction.operands[0].immediate);
+        }
+
         last_call_offset = current_offset;
         break;
       }
 
-      case ::X86_INS_STOSB:
-      case ::X86_INS_STOSD:
-      case ::X86_INS_STOSQ:
-      case ::X86_INS_STOSW: {
+      case X86_64_Mnemonic::stos: {
         // Examples:
         // stos %eax, (%rdi)
         // rep stos %rax, (%rdi)
         Register_Value dest = map.registers.values[Register_Name::rdi];
-        ::cs_x86_op* dest_operand = &details->x86.operands[1];
+        const X86_64_Operand* dest_operand = &instruction.operands[1];
 
         std::optional<U32> byte_count;
-        if (instruction.detail->x86.prefix[0] == ::X86_PREFIX_REP) {
+        if (instruction.has_rep_prefix) {
           Register_Value count = map.registers.values[Register_Name::rcx];
           if (count.kind == Register_Value_Kind::literal) {
-            byte_count = count.literal * dest_operand->size;
+            byte_count = count.literal * dest_operand->byte_size;
           }
         } else {
-          byte_count = dest_operand->size;
+          byte_count = dest_operand->byte_size;
         }
 
         if (dest.kind == Register_Value_Kind::entry_rsp_relative) {
@@ -222,34 +324,31 @@ Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
         }
 
         if (byte_count.has_value()) {
-          map.registers.add(::X86_REG_RDI, *byte_count, current_offset);
+          map.registers.add(rdi, *byte_count, current_offset);
         } else {
-          map.registers.store(::X86_REG_RDI,
-                              Register_Value::make_unknown(current_offset),
-                              current_offset);
+          map.registers.store(
+              rdi, Register_Value::make_unknown(current_offset),
+              current_offset);
         }
         break;
       }
 
-      case ::X86_INS_MOVSB:
-      case ::X86_INS_MOVSD:
-      case ::X86_INS_MOVSQ:
-      case ::X86_INS_MOVSW: {
+      case X86_64_Mnemonic::movs: {
         // Examples:
         // movs %eax, (%rdi)
         // rep movs %rax, (%rdi)
         Register_Value src = map.registers.values[Register_Name::rsi];
         Register_Value dest = map.registers.values[Register_Name::rdi];
-        ::cs_x86_op* dest_operand = &details->x86.operands[1];
+        const X86_64_Operand* dest_operand = &instruction.operands[1];
 
         std::optional<U32> byte_count;
-        if (instruction.detail->x86.prefix[0] == ::X86_PREFIX_REP) {
+        if (instruction.has_rep_prefix) {
           Register_Value count = map.registers.values[Register_Name::rcx];
           if (count.kind == Register_Value_Kind::literal) {
-            byte_count = count.literal * dest_operand->size;
+            byte_count = count.literal * dest_operand->byte_size;
           }
         } else {
-          byte_count = dest_operand->size;
+          byte_count = dest_operand->byte_size;
         }
 
         if (src.kind == Register_Value_Kind::entry_rsp_relative) {
@@ -270,59 +369,87 @@ Stack_Map analyze_x86_64_stack_map(std::span<const U8> code) {
         }
 
         if (byte_count.has_value()) {
-          map.registers.add(::X86_REG_RDI, *byte_count, current_offset);
-          map.registers.add(::X86_REG_RSI, *byte_count, current_offset);
+          map.registers.add(rdi, *byte_count, current_offset);
+          map.registers.add(rsi, *byte_count, current_offset);
         } else {
-          map.registers.store(::X86_REG_RDI,
-                              Register_Value::make_unknown(current_offset),
-                              current_offset);
-          map.registers.store(::X86_REG_RSI,
-                              Register_Value::make_unknown(current_offset),
-                              current_offset);
+          map.registers.store(
+              rdi, Register_Value::make_unknown(current_offset),
+              current_offset);
+          map.registers.store(
+              rsi, Register_Value::make_unknown(current_offset),
+              current_offset);
         }
         break;
       }
 
+      case X86_64_Mnemonic::nop:
+        break;
+
+      // Handled by the previous switch.
+      // TODO(strager): Handle push and pop with memory operands, such as
+      // push 0x10(%rsp).
+      case X86_64_Mnemonic::pop:
+      case X86_64_Mnemonic::push:
+      case X86_64_Mnemonic::ret:
+        break;
+
       default:
-        if (details->x86.op_count == 2) {
-          for (U8 operand_index = 0; operand_index < 2; ++operand_index) {
-            ::cs_x86_op* operand = &details->x86.operands[operand_index];
-            if (operand->type == ::X86_OP_MEM) {
-              Register_Value base_address =
-                  map.registers.load(operand->mem.base);
-              if (base_address.kind ==
-                  Register_Value_Kind::entry_rsp_relative) {
-                // Examples:
-                // mov other_operand, (%rsp)
-                // mov (%rsp), other_operand
-                // mov -0x10(%rbp), other_operand
-                // movzbl (%rsp), other_operand
-                map.touches.push_back(Stack_Map_Touch{
-                    .offset = current_offset,
-                    .entry_rsp_relative_address =
-                        get_rsp_adjustment_from_value(base_address) +
-                        operand->mem.disp,
-                    .byte_count = operand->size,
-                    .access_kind =
-                        stack_access_kind_from_capstone(operand->access),
-                });
-              }
-            }
-          }
+        for (U8 operand_index = 0; operand_index < instruction.operand_count;
+             ++operand_index) {
+          const X86_64_Operand* operand = &instruction.operands[operand_index];
+          if (operand->kind != X86_64_Operand_Kind::memory) continue;
+          // Examples:
+          // mov other_operand, (%rsp)
+          // mov (%rsp), other_operand
+          // mov -0x10(%rbp), other_operand
+          // movzbl (%rsp), other_operand
+          // movups %xmm0, 0x20(%rsp)
+          // vpxor 0x20(%rsp), %ymm1, %ymm0
+          // mov other_operand, 0x10(%rsp,%rcx,4)  (if %rcx is a literal_range)
+          touch_address(current_offset,
+                        map.registers.load_address(operand->memory),
+                        operand->byte_size,
+                        stack_access_kind_from_operand(*operand));
         }
         break;
     }
+
+    previous_instruction_is_call =
+        instruction.mnemonic == X86_64_Mnemonic::call;
   }
-  ::cs_free(instructions, instruction_count);
-  ::cs_close(&handle);
   return map;
 }
 
+U64 Stack_Map::dynamic_allocation_bound() const {
+  U64 bound = 0;
+  for (const Stack_Map_Dynamic_Allocation& allocation :
+       this->dynamic_allocations) {
+    if (!allocation.is_bounded() ||
+        allocation.max_byte_count > (U64)-1 - bound) {
+      return (U64)-1;
+    }
+    bound += allocation.max_byte_count;
+  }
+  return bound;
+}
+
+U64 Stack_Map::touched_stack_size() const {
+  U64 size = 0;
+  for (const Stack_Map_Touch& touch : this->touches) {
+    if (touch.entry_rsp_relative_address < 0) {
+      size = std::max(size,
+                      static_cast<U64>(-touch.entry_rsp_relative_address));
+    }
+  }
+  return size;
+}
+
 namespace {
-Stack_Access_Kind stack_access_kind_from_capstone(/*::cs_ac_type*/ U8 access) {
-  if (access == (::CS_AC_READ | ::CS_AC_WRITE)) {
+Stack_Access_Kind stack_access_kind_from_operand(
+    const X86_64_Operand& operand) {
+  if (operand.is_read && operand.is_written) {
     return Stack_Access_Kind::read_and_write;
-  } else if (access == ::CS_AC_WRITE) {
+  } else if (operand.is_written) {
     return Stack_Access_Kind::write_only;
   } else {
     return Stack_Access_Kind::read_only;
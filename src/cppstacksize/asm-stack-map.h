@@ -74,15 +74,56 @@ struct Stack_Map_Touch {
   Stack_Access_Kind access_kind;
 };
 
+// An adjustment of %rsp which is not part of the function's fixed-size frame,
+// such as alloca or a variable-length array.
+struct Stack_Map_Dynamic_Allocation {
+  // Offset of the instruction which adjusts %rsp (such as sub %rax, %rsp).
+  U32 offset;
+  // Inclusive bounds of the number of bytes allocated. If the allocation is
+  // unbounded, max_byte_count is (U64)-1.
+  U64 min_byte_count;
+  U64 max_byte_count;
+  // If true, the preceding instruction called a stack probe function (such as
+  // __chkstk or __alloca_probe).
+  bool is_probed;
+
+  bool is_bounded() const { return this->max_byte_count != (U64)-1; }
+
+  friend bool operator==(const Stack_Map_Dynamic_Allocation&,
+                         const Stack_Map_Dynamic_Allocation&) = default;
+};
+
 struct Stack_Map {
   Register_File registers;
   std::vector<Stack_Map_Touch> touches;
+  std::vector<Stack_Map_Dynamic_Allocation> dynamic_allocations;
+  // Targets of direct calls (such as call 0x1234). Relative to the first byte
+  // of the analyzed code, so targets outside the analyzed code are negative or
+  // at least the code's size.
+  std::vector<S64> direct_call_targets;
 
   void clear() { *this = Stack_Map(); }
+
+  // Like Stack_Usage_Entry::is_dynamic.
+  bool is_dynamic() const { return !this->dynamic_allocations.empty(); }
+
+  // Upper bound of the total number of bytes allocated by dynamic_allocations,
+  // or (U64)-1 if any allocation is unbounded.
+  //
+  // NOTE(strager): Control flow is ignored, so an allocation in a loop is
+  // counted once.
+  U64 dynamic_allocation_bound() const;
+
+  // Number of bytes between the stack pointer on function entry and the
+  // lowest address of any touch, or 0 if no touch is below the stack pointer
+  // on function entry.
+  U64 touched_stack_size() const;
 };
 
 Stack_Map analyze_x86_64_stack_map(std::span<const U8> code);
 
 std::ostream& operator<<(std::ostream& out, Stack_Access_Kind);
 std::ostream& operator<<(std::ostream& out, const Stack_Map_Touch&);
+std::ostream& operator<<(std::ostream& out,
+                         const Stack_Map_Dynamic_Allocation&);
 }
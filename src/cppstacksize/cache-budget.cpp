@@ -0,0 +1,190 @@
+#include <cppstacksize/base.h>
+#include <cppstacksize/cache-budget.h>
+#include <utility>
+
+namespace cppstacksize {
+Cache_Budget::Cache_Budget(U64 max_bytes) : max_bytes_(max_bytes) {}
+
+Cache_Budget::Cache_ID Cache_Budget::add_cache(std::string name,
+                                               Evict_Function evict) {
+  Cache_ID cache_id = narrow_cast<Cache_ID>(this->caches_.size());
+  this->caches_.push_back(Cache{
+      .name = std::move(name),
+      .evict = std::move(evict),
+  });
+  return cache_id;
+}
+
+void Cache_Budget::remove_cache(Cache_ID cache_id) {
+  this->remove_all_entries(cache_id);
+  Cache& cache = this->caches_.at(cache_id);
+  cache.evict = nullptr;
+  cache.is_removed = true;
+}
+
+void Cache_Budget::set_max_bytes(U64 max_bytes) {
+  this->max_bytes_ = max_bytes;
+  this->evict_until_within_budget(null_entry_index);
+}
+
+void Cache_Budget::add_entry(Cache_ID cache_id, U64 key, U64 byte_size) {
+  // NOTE(strager): Evict functions must not add entries. Otherwise, the LRU
+  // list could change under evict_until_within_budget.
+  CSS_ASSERT(!this->is_evicting_);
+  Cache& cache = this->caches_.at(cache_id);
+  CSS_ASSERT(!cache.is_removed);
+
+  U32 entry_index;
+  if (this->free_entry_index_ != null_entry_index) {
+    entry_index = this->free_entry_index_;
+    this->free_entry_index_ = this->entries_[entry_index].less_recent;
+  } else {
+    entry_index = narrow_cast<U32>(this->entries_.size());
+    this->entries_.emplace_back();
+  }
+  this->entries_[entry_index] = Entry{
+      .cache_id = cache_id,
+      .key = key,
+      .byte_size = byte_size,
+      .less_recent = null_entry_index,
+      .more_recent = null_entry_index,
+  };
+  bool inserted =
+      this->entry_indexes_
+          .emplace(Entry_Key{.cache_id = cache_id, .key = key}, entry_index)
+          .second;
+  CSS_ASSERT(inserted);
+  this->link_most_recent(entry_index);
+  cache.entry_count += 1;
+  cache.byte_size += byte_size;
+  this->total_byte_size_ += byte_size;
+
+  this->evict_until_within_budget(entry_index);
+}
+
+void Cache_Budget::touch_entry(Cache_ID cache_id, U64 key) {
+  U32 entry_index = this->find_entry_index(cache_id, key);
+  if (entry_index == null_entry_index ||
+      entry_index == this->most_recent_entry_index_) {
+    return;
+  }
+  this->unlink(entry_index);
+  this->link_most_recent(entry_index);
+}
+
+void Cache_Budget::remove_entry(Cache_ID cache_id, U64 key) {
+  U32 entry_index = this->find_entry_index(cache_id, key);
+  if (entry_index != null_entry_index) {
+    this->free_entry(entry_index);
+  }
+}
+
+void Cache_Budget::remove_all_entries(Cache_ID cache_id) {
+  if (this->caches_.at(cache_id).entry_count == 0) {
+    return;
+  }
+  U32 entry_index = this->least_recent_entry_index_;
+  while (entry_index != null_entry_index) {
+    U32 next_entry_index = this->entries_[entry_index].more_recent;
+    if (this->entries_[entry_index].cache_id == cache_id) {
+      this->free_entry(entry_index);
+    }
+    entry_index = next_entry_index;
+  }
+}
+
+bool Cache_Budget::contains_entry(Cache_ID cache_id, U64 key) const {
+  return this->find_entry_index(cache_id, key) != null_entry_index;
+}
+
+U64 Cache_Budget::cache_byte_size(Cache_ID cache_id) const {
+  return this->caches_.at(cache_id).byte_size;
+}
+
+std::vector<Cache_Budget::Cache_Stats> Cache_Budget::get_stats() const {
+  std::vector<Cache_Stats> stats;
+  for (const Cache& cache : this->caches_) {
+    if (cache.is_removed) continue;
+    stats.push_back(Cache_Stats{
+        .name = cache.name,
+        .entry_count = cache.entry_count,
+        .byte_size = cache.byte_size,
+        .eviction_count = cache.eviction_count,
+    });
+  }
+  return stats;
+}
+
+U32 Cache_Budget::find_entry_index(Cache_ID cache_id, U64 key) const {
+  auto it =
+      this->entry_indexes_.find(Entry_Key{.cache_id = cache_id, .key = key});
+  if (it == this->entry_indexes_.end()) {
+    return null_entry_index;
+  }
+  return it->second;
+}
+
+void Cache_Budget::link_most_recent(U32 entry_index) {
+  Entry& entry = this->entries_[entry_index];
+  entry.less_recent = this->most_recent_entry_index_;
+  entry.more_recent = null_entry_index;
+  if (this->most_recent_entry_index_ != null_entry_index) {
+    this->entries_[this->most_recent_entry_index_].more_recent = entry_index;
+  } else {
+    this->least_recent_entry_index_ = entry_index;
+  }
+  this->most_recent_entry_index_ = entry_index;
+}
+
+void Cache_Budget::unlink(U32 entry_index) {
+  Entry& entry = this->entries_[entry_index];
+  if (entry.less_recent != null_entry_index) {
+    this->entries_[entry.less_recent].more_recent = entry.more_recent;
+  } else {
+    this->least_recent_entry_index_ = entry.more_recent;
+  }
+  if (entry.more_recent != null_entry_index) {
+    this->entries_[entry.more_recent].less_recent = entry.less_recent;
+  } else {
+    this->most_recent_entry_index_ = entry.less_recent;
+  }
+}
+
+void Cache_Budget::free_entry(U32 entry_index) {
+  this->unlink(entry_index);
+  Entry& entry = this->entries_[entry_index];
+  Cache& cache = this->caches_[entry.cache_id];
+  cache.entry_count -= 1;
+  cache.byte_size -= entry.byte_size;
+  this->total_byte_size_ -= entry.byte_size;
+  this->entry_indexes_.erase(
+      Entry_Key{.cache_id = entry.cache_id, .key = entry.key});
+  entry.less_recent = this->free_entry_index_;
+  this->free_entry_index_ = entry_index;
+}
+
+void Cache_Budget::evict_until_within_budget(U32 keep_entry_index) {
+  if (this->is_evicting_) {
+    return;
+  }
+  this->is_evicting_ = true;
+  while (this->total_byte_size_ > this->max_bytes_) {
+    // NOTE(strager): Start from the least recent entry each time because
+    // evict functions may remove other entries.
+    U32 entry_index = this->least_recent_entry_index_;
+    if (entry_index == keep_entry_index && entry_index != null_entry_index) {
+      entry_index = this->entries_[entry_index].more_recent;
+    }
+    if (entry_index == null_entry_index) {
+      break;
+    }
+    Cache_ID cache_id = this->entries_[entry_index].cache_id;
+    U64 key = this->entries_[entry_index].key;
+    this->free_entry(entry_index);
+    Cache& cache = this->caches_[cache_id];
+    cache.eviction_count += 1;
+    cache.evict(key);
+  }
+  this->is_evicting_ = false;
+}
+}
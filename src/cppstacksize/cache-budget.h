@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cppstacksize {
+// Limits the memory used by several caches of recomputable data.
+//
+// Each cache tells the budget when it creates an entry and how many bytes the
+// entry uses. When the total exceeds the budget, the least recently used
+// entries (across all caches) are evicted by calling their cache's evict
+// function.
+class Cache_Budget {
+ public:
+  using Cache_ID = U32;
+  // Frees the entry with the given key. The entry has already been removed
+  // from the budget.
+  using Evict_Function = std::function<void(U64 key)>;
+
+  static constexpr U64 unlimited = static_cast<U64>(-1);
+
+  struct Cache_Stats {
+    std::string name;
+    U64 entry_count;
+    U64 byte_size;
+    U64 eviction_count;
+  };
+
+  explicit Cache_Budget(U64 max_bytes = unlimited);
+
+  Cache_Budget(const Cache_Budget&) = delete;
+  Cache_Budget& operator=(const Cache_Budget&) = delete;
+
+  // name is used only for get_stats.
+  Cache_ID add_cache(std::string name, Evict_Function evict);
+  // Forgets the cache's entries without evicting them.
+  void remove_cache(Cache_ID);
+
+  U64 max_bytes() const { return this->max_bytes_; }
+  // Evicts entries if the new budget is exceeded.
+  void set_max_bytes(U64 max_bytes);
+
+  // Records a new entry as most recently used, then evicts entries of any
+  // cache (except the new entry) until the total fits within the budget.
+  //
+  // The entry must not already exist.
+  void add_entry(Cache_ID, U64 key, U64 byte_size);
+
+  // Marks the entry as most recently used. Does nothing if the entry does not
+  // exist.
+  void touch_entry(Cache_ID, U64 key);
+
+  // Forgets an entry which the cache freed by itself. Does nothing if the
+  // entry does not exist.
+  void remove_entry(Cache_ID, U64 key);
+  // Forgets all of the cache's entries, for example after the cache was
+  // cleared.
+  void remove_all_entries(Cache_ID);
+
+  bool contains_entry(Cache_ID, U64 key) const;
+
+  U64 total_byte_size() const { return this->total_byte_size_; }
+  U64 cache_byte_size(Cache_ID) const;
+
+  std::vector<Cache_Stats> get_stats() const;
+
+ private:
+  static constexpr U32 null_entry_index = static_cast<U32>(-1);
+
+  struct Cache {
+    std::string name;
+    Evict_Function evict;
+    U64 entry_count = 0;
+    U64 byte_size = 0;
+    U64 eviction_count = 0;
+    bool is_removed = false;
+  };
+
+  struct Entry {
+    Cache_ID cache_id;
+    U64 key;
+    U64 byte_size;
+    // Doubly-linked LRU list through entries_. Also used for free_entry_index_
+    // (next only).
+    U32 less_recent;
+    U32 more_recent;
+  };
+
+  struct Entry_Key {
+    Cache_ID cache_id;
+    U64 key;
+
+    friend bool operator==(const Entry_Key&, const Entry_Key&) = default;
+  };
+  struct Entry_Key_Hash {
+    std::size_t operator()(const Entry_Key& k) const noexcept {
+      return std::hash<U64>()(k.key * 0x9e3779b97f4a7c15ULL ^ k.cache_id);
+    }
+  };
+
+  U32 find_entry_index(Cache_ID, U64 key) const;
+  void link_most_recent(U32 entry_index);
+  void unlink(U32 entry_index);
+  // Unlinks the entry and returns it to the free list.
+  void free_entry(U32 entry_index);
+  void evict_until_within_budget(U32 keep_entry_index);
+
+  U64 max_bytes_;
+  U64 total_byte_size_ = 0;
+  std::vector<Cache> caches_;
+
+  std::vector<Entry> entries_;
+  std::unordered_map<Entry_Key, U32, Entry_Key_Hash> entry_indexes_;
+  U32 least_recent_entry_index_ = null_entry_index;
+  U32 most_recent_entry_index_ = null_entry_index;
+  U32 free_entry_index_ = null_entry_index;
+  bool is_evicting_ = false;
+};
+}
@@ -26,6 +26,69 @@ enum {
   CV_LINES_HAVE_COLUMNS = 0x0001,
 };
 
+// S_FRAMEPROC flags:
+enum : U32 {
+  CV_FRAMEPROC_HAS_ALLOCA = 1 << 0,
+  CV_FRAMEPROC_HAS_SETJMP = 1 << 1,
+  CV_FRAMEPROC_HAS_LONGJMP = 1 << 2,
+  CV_FRAMEPROC_HAS_INLINE_ASM = 1 << 3,
+  CV_FRAMEPROC_HAS_EH = 1 << 4,
+  CV_FRAMEPROC_INLINE_SPEC = 1 << 5,
+  CV_FRAMEPROC_HAS_SEH = 1 << 6,
+  CV_FRAMEPROC_NAKED = 1 << 7,
+  CV_FRAMEPROC_SECURITY_CHECKS = 1 << 8,
+  CV_FRAMEPROC_ASYNC_EH = 1 << 9,
+  CV_FRAMEPROC_GS_NO_STACK_ORDERING = 1 << 10,
+  CV_FRAMEPROC_WAS_INLINED = 1 << 11,
+  CV_FRAMEPROC_GS_CHECK = 1 << 12,
+  CV_FRAMEPROC_SAFE_BUFFERS = 1 << 13,
+  // Two bits. See CV_FRAMEPROC_BASE_POINTER_*.
+  CV_FRAMEPROC_LOCAL_BASE_POINTER_SHIFT = 14,
+  // Two bits. See CV_FRAMEPROC_BASE_POINTER_*.
+  CV_FRAMEPROC_PARAM_BASE_POINTER_SHIFT = 16,
+  CV_FRAMEPROC_POGO_ON = 1 << 18,
+  CV_FRAMEPROC_VALID_COUNTS = 1 << 19,
+  CV_FRAMEPROC_OPT_SPEED = 1 << 20,
+  CV_FRAMEPROC_GUARD_CF = 1 << 21,
+  CV_FRAMEPROC_GUARD_CFW = 1 << 22,
+};
+
+// S_FRAMEPROC encoded base pointers (x64):
+enum : U8 {
+  CV_FRAMEPROC_BASE_POINTER_NONE = 0,
+  CV_FRAMEPROC_BASE_POINTER_RSP = 1,
+  CV_FRAMEPROC_BASE_POINTER_RBP = 2,
+  CV_FRAMEPROC_BASE_POINTER_R13 = 3,
+};
+
+// CodeView registers (x64):
+enum : U16 {
+  CV_AMD64_RSP = 335,
+};
+
+// S_INLINESITE binary annotation opcodes:
+enum : U32 {
+  BA_OP_INVALID = 0,
+  BA_OP_CODE_OFFSET = 1,
+  BA_OP_CHANGE_CODE_OFFSET_BASE = 2,
+  BA_OP_CHANGE_CODE_OFFSET = 3,
+  BA_OP_CHANGE_CODE_LENGTH = 4,
+  BA_OP_CHANGE_FILE = 5,
+  BA_OP_CHANGE_LINE_OFFSET = 6,
+  BA_OP_CHANGE_LINE_END_DELTA = 7,
+  BA_OP_CHANGE_RANGE_KIND = 8,
+  BA_OP_CHANGE_COLUMN_START = 9,
+  BA_OP_CHANGE_COLUMN_END_DELTA = 10,
+  BA_OP_CHANGE_CODE_OFFSET_AND_LINE_OFFSET = 11,
+  BA_OP_CHANGE_CODE_LENGTH_AND_CODE_OFFSET = 12,
+  BA_OP_CHANGE_COLUMN_END = 13,
+};
+
+// S_LOCAL flags:
+enum : U16 {
+  CV_LOCAL_IS_PARAM = 1 << 0,
+};
+
 // Pointer types:
 enum {
   CV_PTR_64 = 0xc,
@@ -37,6 +100,9 @@ enum {
   LF_POINTER = 0x1002,
   LF_PROCEDURE = 0x1008,
   LF_MFUNCTION = 0x1009,
+  LF_ARGLIST = 0x1201,
+  LF_FIELDLIST = 0x1203,
+  LF_BITFIELD = 0x1205,
   LF_ARRAY = 0x1503,
   LF_CLASS = 0x1504,
   LF_STRUCTURE = 0x1505,
@@ -47,15 +113,68 @@ enum {
   LF_MFUNC_ID = 0x1602,
 };
 
+// LF_FIELDLIST member types:
+enum {
+  LF_BCLASS = 0x1400,
+  LF_VBCLASS = 0x1401,
+  LF_IVBCLASS = 0x1402,
+  LF_INDEX = 0x1404,
+  LF_VFUNCTAB = 0x1409,
+  LF_ENUMERATE = 0x1502,
+  LF_MEMBER = 0x150d,
+  LF_STMEMBER = 0x150e,
+  LF_METHOD = 0x150f,
+  LF_NESTTYPE = 0x1510,
+  LF_ONEMETHOD = 0x1511,
+  // Padding bytes between members are LF_PAD0 through LF_PAD15. The low 4 bits
+  // are the number of bytes to skip (including the padding byte itself).
+  LF_PAD0 = 0xf0,
+};
+
+// Method properties (bits 2 through 4 of a method's attributes):
+enum {
+  CV_MTINTRO = 4,
+  CV_MTPUREINTRO = 6,
+};
+
+// Numeric leaves:
+enum {
+  // Values less than LF_NUMERIC are stored directly as a U16.
+  LF_NUMERIC = 0x8000,
+  LF_CHAR = 0x8000,
+  LF_SHORT = 0x8001,
+  LF_USHORT = 0x8002,
+  LF_LONG = 0x8003,
+  LF_ULONG = 0x8004,
+  LF_REAL32 = 0x8005,
+  LF_REAL64 = 0x8006,
+  LF_REAL80 = 0x8007,
+  LF_REAL128 = 0x8008,
+  LF_QUADWORD = 0x8009,
+  LF_UQUADWORD = 0x800a,
+};
+
 // Symbol types:
 enum {
   S_END = 0x0006,
   S_BLOCK32 = 0x1103,
   S_FRAMEPROC = 0x1012,
   S_REGREL32 = 0x1111,
+  S_LPROC32 = 0x110f,
   S_GPROC32 = 0x1110,
   S_PROC_ID_END = 0x114f,
+  S_LPROC32_ID = 0x1146,
   S_GPROC32_ID = 0x1147,
+  S_PROCREF = 0x1125,
+  S_LOCAL = 0x113e,
+  S_DEFRANGE_REGISTER = 0x1141,
+  S_DEFRANGE_FRAMEPOINTER_REL = 0x1142,
+  S_DEFRANGE_SUBFIELD_REGISTER = 0x1143,
+  S_DEFRANGE_FRAMEPOINTER_REL_FULL_SCOPE = 0x1144,
+  S_DEFRANGE_REGISTER_REL = 0x1145,
+  S_INLINESITE = 0x114d,
+  S_INLINESITE_END = 0x114e,
+  S_INLINESITE2 = 0x115d,
 };
 
 // Special types:
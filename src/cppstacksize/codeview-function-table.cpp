@@ -0,0 +1,183 @@
+#include <cppstacksize/codeview-function-table.h>
+#include <functional>
+
+namespace cppstacksize {
+void CodeView_Function_Table::clear() {
+  this->names_.clear();
+  this->name_offsets_.assign(1, 0);
+  this->byte_offsets_.clear();
+  this->self_stack_sizes_.clear();
+  this->stack_sizes_.clear();
+  this->code_section_indexes_.clear();
+  this->code_offsets_.clear();
+  this->code_sizes_.clear();
+  this->type_ids_.clear();
+  this->has_func_id_types_.clear();
+  this->uses_frame_pointers_.clear();
+  this->module_indexes_.clear();
+  this->modules_.clear();
+  this->module_index_by_key_.clear();
+}
+
+void CodeView_Function_Table::push_back(const CodeView_Function& func) {
+  this->names_.append(func.name);
+  this->names_.push_back(u8'\0');
+  this->name_offsets_.push_back(narrow_cast<U32>(this->names_.size()));
+  CSS_ASSERT(func.byte_offset <= U64{static_cast<U32>(-1)});
+  this->byte_offsets_.push_back(narrow_cast<U32>(func.byte_offset));
+  this->self_stack_sizes_.push_back(func.self_stack_size);
+  this->stack_sizes_.push_back(func.stack_size);
+  this->code_section_indexes_.push_back(func.code_section_index);
+  this->code_offsets_.push_back(func.code_offset);
+  this->code_sizes_.push_back(func.code_size);
+  this->type_ids_.push_back(func.type_id);
+  this->has_func_id_types_.push_back(func.has_func_id_type);
+  this->uses_frame_pointers_.push_back(func.uses_frame_pointer);
+  this->module_indexes_.push_back(this->find_or_add_module(Module_Fields{
+      .reader = func.reader,
+      .pe_file = func.pe_file,
+      .elf_file = func.elf_file,
+      .line_tables_handle = func.line_tables_handle,
+  }));
+}
+
+void CodeView_Function_Table::append(
+    std::span<const CodeView_Function> functions) {
+  for (const CodeView_Function& func : functions) {
+    this->push_back(func);
+  }
+}
+
+void CodeView_Function_Table::append(const CodeView_Function_Table& other,
+                                     U64 begin_index, U64 end_index) {
+  CSS_ASSERT(begin_index <= end_index);
+  CSS_ASSERT(end_index <= other.size());
+  if (begin_index == end_index) {
+    return;
+  }
+
+  U32 other_names_begin = other.name_offsets_[begin_index];
+  U32 other_names_end = other.name_offsets_[end_index];
+  U64 names_shift = this->names_.size();
+  this->names_.append(other.names_, other_names_begin,
+                      other_names_end - other_names_begin);
+  for (U64 i = begin_index; i < end_index; ++i) {
+    this->name_offsets_.push_back(narrow_cast<U32>(
+        other.name_offsets_[i + 1] - other_names_begin + names_shift));
+  }
+
+  auto append_column = [&](auto& column, const auto& other_column) -> void {
+    column.insert(column.end(), other_column.begin() + begin_index,
+                  other_column.begin() + end_index);
+  };
+  append_column(this->byte_offsets_, other.byte_offsets_);
+  append_column(this->self_stack_sizes_, other.self_stack_sizes_);
+  append_column(this->stack_sizes_, other.stack_sizes_);
+  append_column(this->code_section_indexes_, other.code_section_indexes_);
+  append_column(this->code_offsets_, other.code_offsets_);
+  append_column(this->code_sizes_, other.code_sizes_);
+  append_column(this->type_ids_, other.type_ids_);
+  append_column(this->has_func_id_types_, other.has_func_id_types_);
+  append_column(this->uses_frame_pointers_, other.uses_frame_pointers_);
+
+  std::unordered_map<U32, U32> new_module_indexes;
+  for (U64 i = begin_index; i < end_index; ++i) {
+    U32 other_module_index = other.module_indexes_[i];
+    auto [it, inserted] = new_module_indexes.try_emplace(other_module_index);
+    if (inserted) {
+      it->second = this->find_or_add_module(other.modules_[other_module_index]);
+    }
+    this->module_indexes_.push_back(it->second);
+  }
+}
+
+CodeView_Function CodeView_Function_Table::operator[](U64 index) const {
+  CSS_ASSERT(index < this->size());
+  const Module_Fields& module = this->module_fields(index);
+  return CodeView_Function{
+      .name = std::u8string(this->name(index)),
+      .reader = module.reader,
+      .byte_offset = this->byte_offsets_[index],
+      .self_stack_size = this->self_stack_sizes_[index],
+      .stack_size = this->stack_sizes_[index],
+      .code_section_index = this->code_section_indexes_[index],
+      .code_offset = this->code_offsets_[index],
+      .code_size = this->code_sizes_[index],
+      .pe_file = module.pe_file,
+      .elf_file = module.elf_file,
+      .line_tables_handle = module.line_tables_handle,
+      .has_func_id_type = this->has_func_id_types_[index],
+      .type_id = this->type_ids_[index],
+      .uses_frame_pointer = this->uses_frame_pointers_[index],
+  };
+}
+
+std::optional<CodeView_Code_Location>
+CodeView_Function_Table::get_code_location(U64 index, Logger& logger) const {
+  const Module_Fields& module = this->module_fields(index);
+  // NOTE(strager): Keep in sync with CodeView_Function::get_code_location.
+  if (module.pe_file == nullptr || module.pe_file->symbol_count == 0 ||
+      !module.reader.is_contiguous() ||
+      module.reader.base_reader() != module.pe_file->reader) {
+    return CodeView_Code_Location{
+        .section_index = this->code_section_indexes_[index],
+        .offset = this->code_offsets_[index],
+    };
+  }
+  return (*this)[index].get_code_location(logger);
+}
+
+U64 CodeView_Function_Table::byte_size() const {
+  return this->names_.capacity() +
+         this->name_offsets_.capacity() * sizeof(U32) +
+         this->byte_offsets_.capacity() * sizeof(U32) +
+         this->self_stack_sizes_.capacity() * sizeof(U32) +
+         this->stack_sizes_.capacity() * sizeof(U32) +
+         this->code_section_indexes_.capacity() * sizeof(U32) +
+         this->code_offsets_.capacity() * sizeof(U32) +
+         this->code_sizes_.capacity() * sizeof(U32) +
+         this->type_ids_.capacity() * sizeof(U32) +
+         this->has_func_id_types_.capacity() / 8 +
+         this->uses_frame_pointers_.capacity() / 8 +
+         this->module_indexes_.capacity() * sizeof(U32) +
+         this->modules_.capacity() * sizeof(Module_Fields) +
+         this->module_index_by_key_.size() *
+             (sizeof(Module_Key) + sizeof(U32) + sizeof(void*) * 2);
+}
+
+std::size_t CodeView_Function_Table::Module_Key_Hash::operator()(
+    const Module_Key& key) const noexcept {
+  std::size_t hash = std::hash<const void*>()(key.base_reader);
+  auto mix = [&](U64 value) -> void {
+    hash ^= std::hash<U64>()(value) + 0x9e3779b97f4a7c15ULL + (hash << 6) +
+            (hash >> 2);
+  };
+  mix(key.sub_file_offset);
+  mix(key.sub_file_size);
+  mix(reinterpret_cast<std::uintptr_t>(key.pe_file));
+  mix(reinterpret_cast<std::uintptr_t>(key.elf_file));
+  mix(key.line_tables_module_index);
+  return hash;
+}
+
+CodeView_Function_Table::Module_Key CodeView_Function_Table::make_module_key(
+    const Module_Fields& fields) {
+  return Module_Key{
+      .base_reader = fields.reader.base_reader(),
+      .sub_file_offset = fields.reader.sub_file_offset(),
+      .sub_file_size = fields.reader.size(),
+      .pe_file = fields.pe_file,
+      .elf_file = fields.elf_file,
+      .line_tables_module_index = fields.line_tables_handle.module_index,
+  };
+}
+
+U32 CodeView_Function_Table::find_or_add_module(const Module_Fields& fields) {
+  auto [it, inserted] = this->module_index_by_key_.try_emplace(
+      make_module_key(fields), narrow_cast<U32>(this->modules_.size()));
+  if (inserted) {
+    this->modules_.push_back(fields);
+  }
+  return it->second;
+}
+}
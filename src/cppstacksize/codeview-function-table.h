@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/elf.h>
+#include <cppstacksize/extent-reader.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/pe.h>
+#include <cppstacksize/reader.h>
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cppstacksize {
+// Stores many CodeView_Function-s compactly.
+//
+// Each field is stored in its own array (column), so code which looks at only
+// a few fields of every function (such as building an index or sorting by
+// name) does not touch the other fields. Names are stored in one string pool.
+// Fields which are usually the same for every function in a module (see
+// Module_Fields) are stored once per module.
+//
+// Use operator[] to get a copy of a function as a CodeView_Function.
+class CodeView_Function_Table {
+ public:
+  // Fields which are usually the same for every function in a module.
+  struct Module_Fields {
+    Extent_Reader reader;
+    PE_File<Span_Reader>* pe_file;
+    ELF_File<Span_Reader>* elf_file;
+    Line_Tables::Handle line_tables_handle;
+  };
+
+  // Yields copies of functions.
+  class Iterator {
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = CodeView_Function;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = CodeView_Function;
+
+    explicit Iterator() = default;
+    explicit Iterator(const CodeView_Function_Table* table, U64 index)
+        : table_(table), index_(index) {}
+
+    CodeView_Function operator*() const {
+      return (*this->table_)[this->index_];
+    }
+
+    Iterator& operator++() {
+      this->index_ += 1;
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator old = *this;
+      this->index_ += 1;
+      return old;
+    }
+
+    friend bool operator==(const Iterator&, const Iterator&) = default;
+
+   private:
+    const CodeView_Function_Table* table_ = nullptr;
+    U64 index_ = 0;
+  };
+
+  U64 size() const { return this->code_offsets_.size(); }
+  bool empty() const { return this->size() == 0; }
+
+  void clear();
+
+  // Copies the function.
+  void push_back(const CodeView_Function&);
+  void append(std::span<const CodeView_Function>);
+  // Copies functions [begin_index, end_index) of other.
+  void append(const CodeView_Function_Table& other, U64 begin_index,
+              U64 end_index);
+
+  CodeView_Function operator[](U64 index) const;
+
+  Iterator begin() const { return Iterator(this, 0); }
+  Iterator end() const { return Iterator(this, this->size()); }
+
+  std::u8string_view name(U64 index) const {
+    CSS_ASSERT(index < this->size());
+    U32 begin = this->name_offsets_[index];
+    U32 end = this->name_offsets_[index + 1] - 1;  // Exclude null terminator.
+    return std::u8string_view(this->names_).substr(begin, end - begin);
+  }
+
+  U64 byte_offset(U64 index) const { return this->byte_offsets_[index]; }
+  U32 self_stack_size(U64 index) const {
+    return this->self_stack_sizes_[index];
+  }
+  U32 stack_size(U64 index) const { return this->stack_sizes_[index]; }
+  U32 code_section_index(U64 index) const {
+    return this->code_section_indexes_[index];
+  }
+  U32 code_offset(U64 index) const { return this->code_offsets_[index]; }
+  U32 code_size(U64 index) const { return this->code_sizes_[index]; }
+  bool has_func_id_type(U64 index) const {
+    return this->has_func_id_types_[index];
+  }
+  U32 type_id(U64 index) const { return this->type_ids_[index]; }
+  bool uses_frame_pointer(U64 index) const {
+    return this->uses_frame_pointers_[index];
+  }
+
+  const Module_Fields& module_fields(U64 index) const {
+    return this->modules_[this->module_indexes_[index]];
+  }
+
+  // See CodeView_Function::code_file.
+  const void* code_file(U64 index) const {
+    const Module_Fields& module = this->module_fields(index);
+    if (module.pe_file != nullptr) {
+      return module.pe_file->reader->data().data();
+    }
+    return module.reader.file_data();
+  }
+
+  // Like CodeView_Function::get_code_location, but does not copy the
+  // function unless relocations need to be applied.
+  std::optional<CodeView_Code_Location> get_code_location(
+      U64 index, Logger& logger = fallback_logger) const;
+
+  // Calls update(fields) on a copy of the Module_Fields of each function in
+  // [begin_index, end_index), then makes the function use the updated copy.
+  // Functions outside the range are not changed.
+  //
+  // update is called once per distinct Module_Fields, not once per function.
+  template <class Update>
+  void update_module_fields(U64 begin_index, U64 end_index, Update&& update) {
+    CSS_ASSERT(begin_index <= end_index);
+    CSS_ASSERT(end_index <= this->size());
+    // NOTE(strager): If every function is updated, the old Module_Fields
+    // become unused, so drop them instead of keeping them forever.
+    std::vector<Module_Fields> old_modules;
+    const std::vector<Module_Fields>* old_modules_ptr = &this->modules_;
+    if (begin_index == 0 && end_index == this->size()) {
+      old_modules = std::move(this->modules_);
+      old_modules_ptr = &old_modules;
+      this->modules_.clear();
+      this->module_index_by_key_.clear();
+    }
+    std::unordered_map<U32, U32> new_module_indexes;
+    for (U64 i = begin_index; i < end_index; ++i) {
+      U32 old_module_index = this->module_indexes_[i];
+      auto [it, inserted] = new_module_indexes.try_emplace(old_module_index);
+      if (inserted) {
+        Module_Fields fields = (*old_modules_ptr)[old_module_index];
+        update(fields);
+        it->second = this->find_or_add_module(fields);
+      }
+      this->module_indexes_[i] = it->second;
+    }
+  }
+
+  // Approximate number of bytes used by this table.
+  U64 byte_size() const;
+
+ private:
+  struct Module_Key {
+    const void* base_reader;
+    U64 sub_file_offset;
+    U64 sub_file_size;
+    PE_File<Span_Reader>* pe_file;
+    ELF_File<Span_Reader>* elf_file;
+    U64 line_tables_module_index;
+
+    friend bool operator==(const Module_Key&, const Module_Key&) = default;
+  };
+  struct Module_Key_Hash {
+    std::size_t operator()(const Module_Key&) const noexcept;
+  };
+
+  static Module_Key make_module_key(const Module_Fields&);
+
+  U32 find_or_add_module(const Module_Fields&);
+
+  // Each name followed by a null terminator.
+  std::u8string names_;
+  // Offset into names_ of each name, followed by names_.size(). Has size() + 1
+  // entries.
+  std::vector<U32> name_offsets_ = {0};
+
+  std::vector<U32> byte_offsets_;
+  std::vector<U32> self_stack_sizes_;
+  std::vector<U32> stack_sizes_;
+  std::vector<U32> code_section_indexes_;
+  std::vector<U32> code_offsets_;
+  std::vector<U32> code_sizes_;
+  std::vector<U32> type_ids_;
+  std::vector<bool> has_func_id_types_;
+  std::vector<bool> uses_frame_pointers_;
+  // Index into modules_.
+  std::vector<U32> module_indexes_;
+
+  std::vector<Module_Fields> modules_;
+  std::unordered_map<Module_Key, U32, Module_Key_Hash> module_index_by_key_;
+};
+}
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/codeview-constants.h>
+#include <cppstacksize/codeview-inline-site.h>
+#include <span>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+// Reads a number compressed with CVCompressData, advancing p.
+//
+// Returns false if the number is malformed or cut off.
+bool read_compressed_u32(const U8*& p, const U8* end, U32& out) {
+  if (p == end) {
+    return false;
+  }
+  U8 b0 = p[0];
+  if ((b0 & 0x80) == 0x00) {
+    out = b0;
+    p += 1;
+    return true;
+  }
+  if ((b0 & 0xc0) == 0x80) {
+    if (end - p < 2) {
+      return false;
+    }
+    out = (U32{b0 & 0x3fu} << 8) | p[1];
+    p += 2;
+    return true;
+  }
+  if ((b0 & 0xe0) == 0xc0) {
+    if (end - p < 4) {
+      return false;
+    }
+    out = (U32{b0 & 0x1fu} << 24) | (U32{p[1]} << 16) | (U32{p[2]} << 8) |
+          p[3];
+    p += 4;
+    return true;
+  }
+  return false;
+}
+}
+
+bool decode_codeview_inline_site_code_ranges(
+    std::span<const U8> annotations,
+    std::vector<CodeView_Code_Range>& out_ranges) {
+  std::size_t first_range_index = out_ranges.size();
+  auto add_range = [&](U32 begin, U32 end) -> void {
+    if (begin >= end) {
+      return;
+    }
+    if (out_ranges.size() > first_range_index &&
+        out_ranges.back().end == begin) {
+      out_ranges.back().end = end;
+      return;
+    }
+    out_ranges.push_back(CodeView_Code_Range{.begin = begin, .end = end});
+  };
+
+  // NOTE(strager): Compilers emit one ChangeCodeOffset-like annotation per
+  // line (opening or extending a range) and a ChangeCodeLength-like annotation
+  // when the inlined code is interrupted (closing the range).
+  U32 code_offset = 0;
+  bool have_open_range = false;
+  U32 open_range_begin = 0;
+  auto change_code_offset = [&](U32 delta) -> void {
+    code_offset += delta;
+    if (!have_open_range) {
+      have_open_range = true;
+      open_range_begin = code_offset;
+    }
+  };
+  auto change_code_length = [&](U32 length) -> void {
+    add_range(have_open_range ? open_range_begin : code_offset,
+              code_offset + length);
+    code_offset += length;
+    have_open_range = false;
+  };
+
+  const U8* p = annotations.data();
+  const U8* end = p + annotations.size();
+  bool ok = true;
+  while (p != end) {
+    U32 opcode;
+    if (!read_compressed_u32(p, end, opcode)) {
+      ok = false;
+      break;
+    }
+    if (opcode == BA_OP_INVALID) {
+      // Padding after the last annotation.
+      break;
+    }
+    U32 operand;
+    if (!read_compressed_u32(p, end, operand)) {
+      ok = false;
+      break;
+    }
+    switch (opcode) {
+      case BA_OP_CODE_OFFSET:
+        code_offset = operand;
+        break;
+      case BA_OP_CHANGE_CODE_OFFSET:
+        change_code_offset(operand);
+        break;
+      case BA_OP_CHANGE_CODE_OFFSET_AND_LINE_OFFSET:
+        // The low 4 bits are the code offset delta. The other bits are the line
+        // offset delta.
+        change_code_offset(operand & 0xf);
+        break;
+      case BA_OP_CHANGE_CODE_LENGTH:
+        change_code_length(operand);
+        break;
+      case BA_OP_CHANGE_CODE_LENGTH_AND_CODE_OFFSET: {
+        U32 code_offset_delta;
+        if (!read_compressed_u32(p, end, code_offset_delta)) {
+          ok = false;
+          goto done;
+        }
+        change_code_offset(code_offset_delta);
+        change_code_length(operand);
+        break;
+      }
+      case BA_OP_CHANGE_CODE_OFFSET_BASE:
+      case BA_OP_CHANGE_FILE:
+      case BA_OP_CHANGE_LINE_OFFSET:
+      case BA_OP_CHANGE_LINE_END_DELTA:
+      case BA_OP_CHANGE_RANGE_KIND:
+      case BA_OP_CHANGE_COLUMN_START:
+      case BA_OP_CHANGE_COLUMN_END_DELTA:
+      case BA_OP_CHANGE_COLUMN_END:
+        break;
+      default:
+        ok = false;
+        goto done;
+    }
+  }
+done:
+  if (have_open_range) {
+    // The range's length is unknown. Assume it ends at its last line.
+    add_range(open_range_begin, code_offset);
+  }
+  return ok;
+}
+
+std::vector<U32> CodeView_Inline_Site_Tree::attribute_touches(
+    std::span<const Stack_Map_Touch> touches) const {
+  // Split the code into segments at every range boundary, then paint each
+  // site's ranges onto the segments. Sites are in record order, so a nested
+  // site paints over its parent.
+  //
+  // Segment i is [boundaries[i], boundaries[i + 1]).
+  std::vector<U32> boundaries;
+  boundaries.reserve(this->code_ranges.size() * 2);
+  for (const CodeView_Code_Range& range : this->code_ranges) {
+    boundaries.push_back(range.begin);
+    boundaries.push_back(range.end);
+  }
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+                   boundaries.end());
+
+  std::vector<U32> segment_sites(boundaries.size(),
+                                 CodeView_Inline_Site::no_parent);
+  for (U32 site_index = 0; site_index < this->sites.size(); ++site_index) {
+    for (const CodeView_Code_Range& range : this->get_code_ranges(site_index)) {
+      std::size_t i = static_cast<std::size_t>(
+          std::lower_bound(boundaries.begin(), boundaries.end(), range.begin) -
+          boundaries.begin());
+      for (; boundaries[i] < range.end; ++i) {
+        segment_sites[i] = site_index;
+      }
+    }
+  }
+
+  std::vector<U32> touch_sites;
+  touch_sites.reserve(touches.size());
+  for (const Stack_Map_Touch& touch : touches) {
+    auto it =
+        std::upper_bound(boundaries.begin(), boundaries.end(), touch.offset);
+    if (it == boundaries.begin()) {
+      touch_sites.push_back(CodeView_Inline_Site::no_parent);
+    } else {
+      touch_sites.push_back(
+          segment_sites[static_cast<std::size_t>(it - boundaries.begin()) - 1]);
+    }
+  }
+  return touch_sites;
+}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/reader.h>
+#include <span>
+#include <vector>
+
+namespace cppstacksize {
+struct Stack_Map_Touch;
+
+// [begin, end), relative to the start of the function's machine code.
+struct CodeView_Code_Range {
+  U32 begin;
+  U32 end;
+
+  friend bool operator==(const CodeView_Code_Range&,
+                         const CodeView_Code_Range&) = default;
+};
+
+// Decodes the binary annotations of an S_INLINESITE or S_INLINESITE2 record
+// and appends the code ranges they describe to out_ranges. Adjacent ranges are
+// merged.
+//
+// Annotations which do not affect code ranges (such as line number changes)
+// are skipped.
+//
+// Returns false if the annotations are malformed. Ranges decoded before the
+// malformed annotation are kept.
+bool decode_codeview_inline_site_code_ranges(
+    std::span<const U8> annotations,
+    std::vector<CodeView_Code_Range>& out_ranges);
+
+// A function call inlined by the compiler, described by an S_INLINESITE or
+// S_INLINESITE2 record.
+struct CodeView_Inline_Site {
+  static constexpr U32 no_parent = static_cast<U32>(-1);
+
+  // LF_FUNC_ID or LF_MFUNC_ID of the inlined function. For PDB files, this
+  // refers to the IPI stream.
+  U32 inlinee_id;
+  // Index of the inline site which this site was inlined into, or no_parent if
+  // this site was inlined directly into the function.
+  U32 parent_index;
+  // This site's code ranges are code_ranges[first_code_range_index] through
+  // code_ranges[first_code_range_index + code_range_count - 1] in
+  // CodeView_Inline_Site_Tree.
+  U32 first_code_range_index;
+  U32 code_range_count;
+  Location location;
+};
+
+// The inline sites of one function.
+struct CodeView_Inline_Site_Tree {
+  // In record order, so a site's parent comes before the site.
+  std::vector<CodeView_Inline_Site> sites;
+  std::vector<CodeView_Code_Range> code_ranges;
+
+  std::span<const CodeView_Code_Range> get_code_ranges(U32 site_index) const {
+    const CodeView_Inline_Site& site = this->sites[site_index];
+    return std::span<const CodeView_Code_Range>(this->code_ranges)
+        .subspan(site.first_code_range_index, site.code_range_count);
+  }
+
+  // For each touch, finds the innermost inline site whose code contains the
+  // touching instruction.
+  //
+  // Returns one site index per touch, or CodeView_Inline_Site::no_parent for
+  // touches made by the function's own code.
+  std::vector<U32> attribute_touches(
+      std::span<const Stack_Map_Touch> touches) const;
+};
+}
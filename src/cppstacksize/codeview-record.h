@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cppstacksize/base.h>
+#include <cppstacksize/extent-reader.h>
+#include <cppstacksize/reader.h>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace cppstacksize {
+// A CodeView symbol record (such as S_GPROC32) or type record (such as
+// LF_POINTER).
+struct CodeView_Record {
+  // Offset of the record's length field in the reader given to
+  // CodeView_Record_Cursor.
+  U64 offset;
+  // Value of the record's length field. Excludes the length field itself.
+  U16 length;
+  // The record's bytes, starting with the length field, so field offsets
+  // match the CodeView documentation. Shorter than length + 2 if the record is
+  // cut off by the end of the reader.
+  Span_Reader bytes;
+
+  // Returns the record's kind, such as S_GPROC32 or LF_POINTER.
+  U16 kind() const { return this->bytes.u16(2); }
+};
+
+// Yields consecutive CodeView records.
+//
+// A record's bytes usually point into the file. If a record straddles PDB
+// blocks, it is copied into a buffer owned by the cursor; the copy is valid
+// until the next call to next().
+class CodeView_Record_Cursor {
+ public:
+  explicit CodeView_Record_Cursor(const Extent_Reader& reader, U64 offset = 0)
+      : reader_(reader), offset_(offset) {}
+
+  // Offset of the record which next() will return.
+  U64 offset() const { return this->offset_; }
+
+  // Returns null after the last record.
+  std::optional<CodeView_Record> next() {
+    U64 offset = this->offset_;
+    if (offset >= this->reader_.size()) {
+      return std::nullopt;
+    }
+    std::span<const U8> bytes = this->reader_.contiguous_bytes(offset);
+    U16 length = bytes.size() >= 2
+                     ? narrow_cast<U16>(bytes[0] | (bytes[1] << 8))
+                     : this->reader_.u16(offset);
+    U64 record_size =
+        std::min(U64{length} + 2, this->reader_.size() - offset);
+    if (bytes.size() >= record_size) {
+      bytes = bytes.first(record_size);
+    } else {
+      this->straddling_record_.resize(record_size);
+      this->reader_.copy_bytes_into(this->straddling_record_, offset);
+      bytes = this->straddling_record_;
+    }
+    this->offset_ = offset + U64{length} + 2;
+    return CodeView_Record{
+        .offset = offset,
+        .length = length,
+        .bytes = Span_Reader(bytes),
+    };
+  }
+
+ private:
+  Extent_Reader reader_;
+  U64 offset_;
+  std::vector<U8> straddling_record_;
+};
+}
@@ -1,16 +1,26 @@
 #pragma once
 
+#include <cppstacksize/asm-stack-map.h>
 #include <cppstacksize/base.h>
+#include <cppstacksize/cache-budget.h>
 #include <cppstacksize/codeview-constants.h>
+#include <cppstacksize/codeview-inline-site.h>
+#include <cppstacksize/codeview-record.h>
+#include <cppstacksize/elf.h>
+#include <cppstacksize/extent-reader.h>
 #include <cppstacksize/line-tables.h>
 #include <cppstacksize/logger.h>
 #include <cppstacksize/pdb-reader.h>
 #include <cppstacksize/pe.h>
 #include <cppstacksize/util.h>
+#include <algorithm>
+#include <cstddef>
 #include <exception>
+#include <optional>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <utility>
-#include <variant>
 #include <vector>
 
 // TODO(strager): Switch to <format>.
@@ -42,10 +52,80 @@ struct CodeView_Type {
   std::u8string name;
 };
 
+// A data member, base class, or hidden pointer (vfptr or vbptr) of a struct,
+// class, or union.
+struct CodeView_Type_Member {
+  std::u8string name;
+  U32 type_id;
+  // Relative to the start of the containing type.
+  U64 byte_offset;
+  // -1 if the member's type is unknown.
+  U64 byte_size;
+  bool is_base_class;
+};
+
+// An integer encoded as a numeric leaf, such as the size in an LF_STRUCTURE
+// record.
+struct CodeView_Numeric_Leaf {
+  // Sign-extended if the leaf is signed.
+  U64 value;
+  bool is_negative;
+  // Number of bytes of the encoded leaf, including its kind. Data after the
+  // leaf (such as a name) starts at the leaf's offset plus encoded_size.
+  U64 encoded_size;
+};
+
+// Reads the numeric leaf at the given offset.
+//
+// Returns null if the leaf is not an integer (such as LF_REAL32).
+template <class Reader>
+std::optional<CodeView_Numeric_Leaf> read_codeview_numeric_leaf(
+    const Reader& reader, U64 offset) {
+  U16 leaf = reader.u16(offset);
+  auto signed_leaf = [](S64 value, U64 encoded_size) -> CodeView_Numeric_Leaf {
+    return CodeView_Numeric_Leaf{
+        .value = static_cast<U64>(value),
+        .is_negative = value < 0,
+        .encoded_size = encoded_size,
+    };
+  };
+  auto unsigned_leaf = [](U64 value,
+                          U64 encoded_size) -> CodeView_Numeric_Leaf {
+    return CodeView_Numeric_Leaf{
+        .value = value,
+        .is_negative = false,
+        .encoded_size = encoded_size,
+    };
+  };
+  if (leaf < LF_NUMERIC) {
+    return unsigned_leaf(leaf, 2);
+  }
+  switch (leaf) {
+    case LF_CHAR:
+      return signed_leaf(static_cast<S8>(reader.u8(offset + 2)), 3);
+    case LF_SHORT:
+      return signed_leaf(static_cast<S16>(reader.u16(offset + 2)), 4);
+    case LF_USHORT:
+      return unsigned_leaf(reader.u16(offset + 2), 4);
+    case LF_LONG:
+      return signed_leaf(static_cast<S32>(reader.u32(offset + 2)), 6);
+    case LF_ULONG:
+      return unsigned_leaf(reader.u32(offset + 2), 6);
+    case LF_QUADWORD:
+      return signed_leaf(static_cast<S64>(reader.u64(offset + 2)), 10);
+    case LF_UQUADWORD:
+      return unsigned_leaf(reader.u64(offset + 2), 10);
+    default:
+      return std::nullopt;
+  }
+}
+
 class CodeView_Type_Table {
  public:
-  template <class Reader>
-  explicit CodeView_Type_Table(const Reader* reader, U32 start_type_id)
+  // Cache_Budget key for the index of type entries. Other keys are type IDs.
+  static constexpr U64 type_entry_index_cache_key = U64{1} << 32;
+
+  explicit CodeView_Type_Table(Extent_Reader reader, U32 start_type_id)
       : reader_(reader), start_type_id_(start_type_id) {}
 
   void add_type_entry_at_offset_(U64 offset) {
@@ -72,17 +152,83 @@ class CodeView_Type_Table {
       return std::nullopt;
     }
 
-    return std::visit(
-        [&](auto* reader) {
-          U64 size = reader->u16(*offset);
-          Sub_File_Reader entry_reader(reader, *offset, size + 2);
-          return this->get_codeview_type_from_type_entry_(entry_reader, type_id,
-                                                          logger);
-        },
-        this->reader_);
+    U64 size = this->reader_.u16(*offset);
+    return this->get_codeview_type_from_type_entry_(
+        this->reader_.sub_reader(*offset, size + 2), type_id, logger);
+  }
+
+  // Returns the members of the LF_STRUCTURE, LF_CLASS, or LF_UNION with the
+  // given type ID (or of the type which an LF_MODIFIER modifies), in
+  // declaration order. Static members, methods, nested type declarations, and
+  // virtual base classes are omitted.
+  //
+  // The type's LF_FIELDLIST is decoded on the first call for each type ID.
+  // Later calls return the cached members.
+  //
+  // Returns an empty span if the type has no members or is a forward
+  // declaration.
+  //
+  // If a cache budget is set (see set_cache_budget), the returned span is
+  // invalidated by the next call to get_members.
+  std::span<const CodeView_Type_Member> get_members(
+      U32 type_id, Logger& logger = fallback_logger) {
+    auto cached_it = this->members_cache_.find(type_id);
+    if (cached_it != this->members_cache_.end()) {
+      if (this->cache_budget_ != nullptr) {
+        this->cache_budget_->touch_entry(this->cache_id_, type_id);
+      }
+      return cached_it->second;
+    }
+    // NOTE(strager): std::unordered_map does not move its values, so members
+    // stays valid if get_members_uncached_ recursively adds to the cache.
+    // members is not in the budget yet, so it is not evicted either.
+    std::vector<CodeView_Type_Member>& members =
+        this->members_cache_[type_id];
+    this->get_members_uncached_(type_id, members, logger);
+    if (this->cache_budget_ != nullptr) {
+      U64 byte_size = members.capacity() * sizeof(CodeView_Type_Member);
+      for (const CodeView_Type_Member& member : members) {
+        byte_size += member.name.capacity();
+      }
+      this->cache_budget_->add_entry(this->cache_id_, type_id, byte_size);
+    }
+    return members;
+  }
+
+  // Accounts for the index of type entries (keyed by
+  // type_entry_index_cache_key) and for each type's members (see get_members,
+  // keyed by type ID) in the given cache. The cache's evict function should
+  // call evict.
+  void set_cache_budget(Cache_Budget* budget, Cache_Budget::Cache_ID cache_id) {
+    this->cache_budget_ = budget;
+    this->cache_id_ = cache_id;
+    this->type_entry_offsets_.shrink_to_fit();
+    if (!this->type_entry_offsets_.empty()) {
+      this->cache_budget_->add_entry(
+          this->cache_id_, type_entry_index_cache_key,
+          this->type_entry_offsets_.capacity() * sizeof(U64));
+    }
+  }
+
+  // Frees memory used to speed up queries. The memory is reallocated by the
+  // next query which needs it.
+  void evict(U64 key) {
+    if (key == type_entry_index_cache_key) {
+      this->evicted_type_entry_count_ = this->type_entry_offsets_.size();
+      this->evicted_first_type_entry_offset_ = this->type_entry_offsets_.at(0);
+      this->type_entry_offsets_ = std::vector<U64>();
+    } else {
+      this->members_cache_.erase(narrow_cast<U32>(key));
+    }
   }
 
   std::optional<U64> get_offset_of_type_entry_(U32 type_id) const {
+    if (this->evicted_type_entry_count_ != 0) {
+      this->reload_type_entry_offsets_();
+    } else if (this->cache_budget_ != nullptr) {
+      this->cache_budget_->touch_entry(this->cache_id_,
+                                       type_entry_index_cache_key);
+    }
     U32 index = type_id - this->start_type_id_;
     if (index < 0 || index >= this->type_entry_offsets_.size()) {
       return std::nullopt;
@@ -90,16 +236,289 @@ class CodeView_Type_Table {
     return this->type_entry_offsets_[index];
   }
 
-  std::vector<U64> type_entry_offsets_;
-  std::variant<const Sub_File_Reader<Span_Reader>*,
-               const Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>*>
-      reader_;
+  // Empty if evicted (see evict).
+  mutable std::vector<U64> type_entry_offsets_;
+  Extent_Reader reader_;
   U32 start_type_id_;
 
  private:
-  template <class R>
+  // Finds the type entries again after evict freed type_entry_offsets_.
+  //
+  // NOTE(strager): parse_codeview_types_without_header already rejected bad
+  // records, so only walk as many records as it accepted.
+  void reload_type_entry_offsets_() const {
+    CodeView_Record_Cursor cursor(this->reader_,
+                                  this->evicted_first_type_entry_offset_);
+    this->type_entry_offsets_.reserve(this->evicted_type_entry_count_);
+    while (this->type_entry_offsets_.size() < this->evicted_type_entry_count_) {
+      std::optional<CodeView_Record> record = cursor.next();
+      CSS_ASSERT(record.has_value());
+      this->type_entry_offsets_.push_back(record->offset);
+    }
+    this->evicted_type_entry_count_ = 0;
+    if (this->cache_budget_ != nullptr) {
+      this->cache_budget_->add_entry(
+          this->cache_id_, type_entry_index_cache_key,
+          this->type_entry_offsets_.capacity() * sizeof(U64));
+    }
+  }
+
+  void get_members_uncached_(U32 type_id,
+                             std::vector<CodeView_Type_Member>& out_members,
+                             Logger& logger) {
+    if (type_id < this->start_type_id_) {
+      // Special types have no members.
+      return;
+    }
+    std::optional<U64> offset = this->get_offset_of_type_entry_(type_id);
+    if (!offset.has_value()) {
+      // FIXME(strager): This Location is wrong.
+      logger.log(fmt::format("cannot find type with ID: 0x{:x}", type_id),
+                 Location());
+      return;
+    }
+    const Extent_Reader& reader = this->reader_;
+    U32 field_list_type_id;
+    switch (reader.u16(*offset + 2)) {
+      case LF_MODIFIER: {
+        std::span<const CodeView_Type_Member> members =
+            this->get_members(reader.u32(*offset + 4), logger);
+        out_members.assign(members.begin(), members.end());
+        return;
+      }
+      case LF_CLASS:
+      case LF_STRUCTURE:
+      case LF_UNION: {
+        U16 properties = reader.u16(*offset + 6);
+        bool is_forward_declaration = properties & (1 << 7);
+        if (is_forward_declaration) {
+          // NOTE(strager): Locals and by-value members refer to the complete
+          // type, so forward declarations are only seen through pointers.
+          return;
+        }
+        field_list_type_id = reader.u32(*offset + 8);
+        break;
+      }
+      default:
+        return;
+    }
+
+    // LF_INDEX continues a long field list in another LF_FIELDLIST. Limit the
+    // number of continuations in case the continuations form a cycle.
+    for (U32 field_list_count = 0; field_list_count < 1000;
+         ++field_list_count) {
+      std::optional<U32> next_field_list_type_id =
+          this->decode_field_list_(field_list_type_id, out_members, logger);
+      if (!next_field_list_type_id.has_value()) {
+        return;
+      }
+      field_list_type_id = *next_field_list_type_id;
+    }
+    logger.log(fmt::format("too many LF_INDEX continuations for type ID 0x{:x}",
+                           type_id),
+               reader.locate(*offset));
+  }
+
+  // Appends the members in an LF_FIELDLIST to out_members.
+  //
+  // Returns the type ID of the continuation LF_FIELDLIST (see LF_INDEX), if
+  // any.
+  std::optional<U32> decode_field_list_(
+      U32 field_list_type_id, std::vector<CodeView_Type_Member>& out_members,
+      Logger& logger) {
+    std::optional<U64> offset =
+        this->get_offset_of_type_entry_(field_list_type_id);
+    if (!offset.has_value()) {
+      // FIXME(strager): This Location is wrong.
+      logger.log(fmt::format("cannot find field list with type ID: 0x{:x}",
+                             field_list_type_id),
+                 Location());
+      return std::nullopt;
+    }
+    U64 size = this->reader_.u16(*offset);
+    Extent_Reader reader = this->reader_.sub_reader(*offset, size + 2);
+    if (reader.u16(2) != LF_FIELDLIST) {
+      logger.log(fmt::format("expected LF_FIELDLIST but found 0x{:x}",
+                             reader.u16(2)),
+                 reader.locate(2));
+      return std::nullopt;
+    }
+
+    auto add_member = [&](std::u8string&& name, U32 type_id,
+                          U64 byte_offset, bool is_base_class) -> void {
+      std::optional<CodeView_Type> type = this->get_type(type_id, logger);
+      out_members.push_back(CodeView_Type_Member{
+          .name = std::move(name),
+          .type_id = type_id,
+          .byte_offset = byte_offset,
+          .byte_size =
+              type.has_value() ? type->byte_size : static_cast<U64>(-1),
+          .is_base_class = is_base_class,
+      });
+    };
+    // Returns the offset after the C string at the given offset.
+    auto skip_c_string = [&](U64 string_offset) -> std::optional<U64> {
+      std::optional<U64> terminator_offset = reader.find_u8(0, string_offset);
+      if (!terminator_offset.has_value()) {
+        return std::nullopt;
+      }
+      return *terminator_offset + 1;
+    };
+    // Returns the offset after the numeric leaf at the given offset.
+    auto skip_numeric_leaf = [&](U64 leaf_offset) -> std::optional<U64> {
+      std::optional<CodeView_Numeric_Leaf> leaf =
+          read_codeview_numeric_leaf(reader, leaf_offset);
+      if (!leaf.has_value()) {
+        return std::nullopt;
+      }
+      return leaf_offset + leaf->encoded_size;
+    };
+
+    std::optional<U32> continuation_type_id;
+    U64 member_offset = 4;
+    while (member_offset + 2 <= reader.size()) {
+      U8 first_byte = reader.u8(member_offset);
+      if (first_byte >= LF_PAD0) {
+        member_offset += std::max(first_byte & 0x0f, 1);
+        continue;
+      }
+
+      U16 member_kind = reader.u16(member_offset);
+      std::optional<U64> next_member_offset;
+      switch (member_kind) {
+        case LF_MEMBER: {
+          std::optional<CodeView_Numeric_Leaf> byte_offset =
+              read_codeview_numeric_leaf(reader, member_offset + 8);
+          if (!byte_offset.has_value()) {
+            break;
+          }
+          U64 name_offset = member_offset + 8 + byte_offset->encoded_size;
+          add_member(reader.utf_8_c_string(name_offset),
+                     reader.u32(member_offset + 4), byte_offset->value,
+                     /*is_base_class=*/false);
+          next_member_offset = skip_c_string(name_offset);
+          break;
+        }
+
+        case LF_BCLASS: {
+          U32 base_type_id = reader.u32(member_offset + 4);
+          std::optional<CodeView_Numeric_Leaf> byte_offset =
+              read_codeview_numeric_leaf(reader, member_offset + 8);
+          if (!byte_offset.has_value()) {
+            break;
+          }
+          std::optional<CodeView_Type> base_type =
+              this->get_type(base_type_id, logger);
+          add_member(base_type.has_value() ? std::move(base_type->name)
+                                           : u8"<base>",
+                     base_type_id, byte_offset->value,
+                     /*is_base_class=*/true);
+          next_member_offset = member_offset + 8 + byte_offset->encoded_size;
+          break;
+        }
+
+        case LF_VBCLASS:
+        case LF_IVBCLASS: {
+          // NOTE(strager): A virtual base class's location depends on the most
+          // derived class, so only the vbptr is reported.
+          U32 vbptr_type_id = reader.u32(member_offset + 8);
+          std::optional<CodeView_Numeric_Leaf> vbptr_offset =
+              read_codeview_numeric_leaf(reader, member_offset + 12);
+          if (!vbptr_offset.has_value()) {
+            break;
+          }
+          bool have_vbptr = std::any_of(
+              out_members.begin(), out_members.end(),
+              [&](const CodeView_Type_Member& member) -> bool {
+                return member.name == u8"<vbptr>" &&
+                       member.byte_offset == vbptr_offset->value;
+              });
+          if (!have_vbptr) {
+            add_member(u8"<vbptr>", vbptr_type_id, vbptr_offset->value,
+                       /*is_base_class=*/false);
+          }
+          next_member_offset = skip_numeric_leaf(
+              member_offset + 12 + vbptr_offset->encoded_size);
+          break;
+        }
+
+        case LF_VFUNCTAB:
+          // TODO(strager): Support vfptrs which are not at the start of the
+          // type.
+          add_member(u8"<vfptr>", reader.u32(member_offset + 4), 0,
+                     /*is_base_class=*/false);
+          next_member_offset = member_offset + 8;
+          break;
+
+        case LF_INDEX:
+          continuation_type_id = reader.u32(member_offset + 4);
+          next_member_offset = member_offset + 8;
+          break;
+
+        case LF_STMEMBER:
+        case LF_METHOD:
+        case LF_NESTTYPE:
+          next_member_offset = skip_c_string(member_offset + 8);
+          break;
+
+        case LF_ONEMETHOD: {
+          U16 attributes = reader.u16(member_offset + 2);
+          U16 method_property = (attributes >> 2) & 0x7;
+          bool has_vtable_offset = method_property == CV_MTINTRO ||
+                                   method_property == CV_MTPUREINTRO;
+          next_member_offset =
+              skip_c_string(member_offset + (has_vtable_offset ? 12 : 8));
+          break;
+        }
+
+        case LF_ENUMERATE: {
+          std::optional<U64> name_offset = skip_numeric_leaf(member_offset + 4);
+          if (name_offset.has_value()) {
+            next_member_offset = skip_c_string(*name_offset);
+          }
+          break;
+        }
+
+        default:
+          logger.log(
+              fmt::format("unsupported field list member kind: 0x{:x}",
+                          member_kind),
+              reader.locate(member_offset));
+          return continuation_type_id;
+      }
+      if (!next_member_offset.has_value()) {
+        logger.log("malformed field list member", reader.locate(member_offset));
+        return continuation_type_id;
+      }
+      member_offset = *next_member_offset;
+    }
+    return continuation_type_id;
+  }
+
+  // Reads a type's size, encoded as a numeric leaf.
+  //
+  // Returns null if the size is not a non-negative integer.
+  std::optional<CodeView_Numeric_Leaf> read_size_leaf_(
+      const Extent_Reader& type_entry_reader, U64 offset, Logger& logger) {
+    std::optional<CodeView_Numeric_Leaf> size =
+        read_codeview_numeric_leaf(type_entry_reader, offset);
+    if (!size.has_value()) {
+      logger.log(fmt::format("unsupported numeric leaf for size: 0x{:x}",
+                             type_entry_reader.u16(offset)),
+                 type_entry_reader.locate(offset));
+      return std::nullopt;
+    }
+    if (size->is_negative) {
+      logger.log(fmt::format("type has negative size: {}",
+                             static_cast<S64>(size->value)),
+                 type_entry_reader.locate(offset));
+      return std::nullopt;
+    }
+    return size;
+  }
+
   std::optional<CodeView_Type> get_codeview_type_from_type_entry_(
-      Sub_File_Reader<R> type_entry_reader, U32 type_id, Logger& logger) {
+      const Extent_Reader& type_entry_reader, U32 type_id, Logger& logger) {
     U16 type_entry_type = type_entry_reader.u16(2);
     switch (type_entry_type) {
       case LF_POINTER: {
@@ -145,11 +564,15 @@ class CodeView_Type_Table {
         U16 properties = type_entry_reader.u16(6);
         bool is_forward_declaration = properties & (1 << 7);
         (void)is_forward_declaration;
-        // TODO(strager): Support big structs (size >= 0x8000). I think these
-        // are encoded with LF_LONG.
-        U64 byte_size = type_entry_reader.u16(20);
-        std::u8string name = type_entry_reader.utf_8_c_string(22);
-        return CodeView_Type{.byte_size = byte_size, .name = std::move(name)};
+        std::optional<CodeView_Numeric_Leaf> byte_size =
+            this->read_size_leaf_(type_entry_reader, 20, logger);
+        if (!byte_size.has_value()) {
+          return std::nullopt;
+        }
+        std::u8string name =
+            type_entry_reader.utf_8_c_string(20 + byte_size->encoded_size);
+        return CodeView_Type{.byte_size = byte_size->value,
+                             .name = std::move(name)};
       }
 
       case LF_UNION: {
@@ -157,24 +580,31 @@ class CodeView_Type_Table {
         U16 properties = type_entry_reader.u16(6);
         bool is_forward_declaration = properties & (1 << 7);
         (void)is_forward_declaration;
-        // TODO(strager): Support big unions (size >= 0x8000). I think these are
-        // encoded with LF_LONG.
-        U64 byte_size = type_entry_reader.u16(12);
-        std::u8string name = type_entry_reader.utf_8_c_string(14);
-        return CodeView_Type{.byte_size = byte_size, .name = std::move(name)};
+        std::optional<CodeView_Numeric_Leaf> byte_size =
+            this->read_size_leaf_(type_entry_reader, 12, logger);
+        if (!byte_size.has_value()) {
+          return std::nullopt;
+        }
+        std::u8string name =
+            type_entry_reader.utf_8_c_string(12 + byte_size->encoded_size);
+        return CodeView_Type{.byte_size = byte_size->value,
+                             .name = std::move(name)};
       }
 
       case LF_ARRAY: {
         U32 element_type_id = type_entry_reader.u32(4);
         std::optional<CodeView_Type> element_type =
             this->get_type(element_type_id, logger);
-        // TODO(strager): Support big arrays (size >= 0x8000). I think these are
-        // encoded with LF_LONG.
-        U64 byte_size = type_entry_reader.u16(12);
+        std::optional<CodeView_Numeric_Leaf> byte_size =
+            this->read_size_leaf_(type_entry_reader, 12, logger);
+        if (!byte_size.has_value()) {
+          return std::nullopt;
+        }
         std::u8string name = element_type.has_value()
                                  ? element_type->name + u8"[]"
                                  : u8"<unknown>[]";
-        return CodeView_Type{.byte_size = byte_size, .name = std::move(name)};
+        return CodeView_Type{.byte_size = byte_size->value,
+                             .name = std::move(name)};
       }
 
       case LF_ENUM: {
@@ -214,6 +644,21 @@ class CodeView_Type_Table {
         return CodeView_Type{.byte_size = static_cast<U64>(-1),
                              .name = u8"<func>"};
 
+      case LF_BITFIELD: {
+        U32 underlying_type_id = type_entry_reader.u32(4);
+        U8 bit_count = type_entry_reader.u8(8);
+        std::optional<CodeView_Type> type =
+            this->get_type(underlying_type_id, logger);
+        if (!type.has_value()) {
+          return std::nullopt;
+        }
+        // byte_size is the size of the bit field's storage unit.
+        std::string bit_count_string = std::to_string(bit_count);
+        type->name += u8" : ";
+        type->name.append(bit_count_string.begin(), bit_count_string.end());
+        return type;
+      }
+
       default:
         logger.log(fmt::format("unknown entry kind 0x{:x} for type ID 0x{:x}",
                                type_entry_type, type_id),
@@ -221,8 +666,63 @@ class CodeView_Type_Table {
         return std::nullopt;
     }
   }
+
+  std::unordered_map<U32, std::vector<CodeView_Type_Member>> members_cache_;
+  Cache_Budget* cache_budget_ = nullptr;
+  Cache_Budget::Cache_ID cache_id_ = 0;
+  // If not 0, type_entry_offsets_ was evicted and had this many entries.
+  mutable U64 evicted_type_entry_count_ = 0;
+  U64 evicted_first_type_entry_offset_ = 0;
 };
 
+namespace detail {
+inline void get_codeview_leaf_members(
+    CodeView_Type_Table& type_table, U32 type_id, U64 base_byte_offset,
+    const std::u8string& name_prefix, U32 depth,
+    std::vector<CodeView_Type_Member>& out_members, Logger& logger) {
+  // NOTE(strager): Looking up member.type_id's members might evict type_id's
+  // members (see CodeView_Type_Table::set_cache_budget), so look them up
+  // again for each member instead of holding a span.
+  for (U64 i = 0;; ++i) {
+    std::span<const CodeView_Type_Member> members =
+        type_table.get_members(type_id, logger);
+    if (i >= members.size()) {
+      break;
+    }
+    CodeView_Type_Member member = members[i];
+    U64 byte_offset = base_byte_offset + member.byte_offset;
+    // NOTE(strager): Members can't contain themselves, but a malformed type
+    // table might claim otherwise.
+    if (depth < 32 && !type_table.get_members(member.type_id, logger).empty()) {
+      get_codeview_leaf_members(
+          type_table, member.type_id, byte_offset,
+          member.is_base_class ? name_prefix
+                               : name_prefix + member.name + u8".",
+          depth + 1, out_members, logger);
+      continue;
+    }
+    CodeView_Type_Member& leaf = out_members.emplace_back(member);
+    leaf.name = name_prefix + member.name;
+    leaf.byte_offset = byte_offset;
+  }
+}
+}
+
+// Appends the members of the given type to out_members, replacing members
+// which have members of their own (such as nested structs and base classes)
+// with their members. Byte offsets are relative to the start of the given
+// type.
+//
+// Names of nested members are qualified with their containing member's name
+// (such as "outer.inner"). Members of base classes are not qualified.
+inline void get_codeview_leaf_members(
+    CodeView_Type_Table& type_table, U32 type_id,
+    std::vector<CodeView_Type_Member>& out_members,
+    Logger& logger = fallback_logger) {
+  detail::get_codeview_leaf_members(type_table, type_id, 0, u8"", 0,
+                                    out_members, logger);
+}
+
 template <class Reader>
 CodeView_Type_Table parse_codeview_types(Reader* reader) {
   return parse_codeview_types(reader, fallback_logger);
@@ -243,55 +743,143 @@ CodeView_Type_Table parse_codeview_types_without_header(
   return parse_codeview_types_without_header(reader, 0, logger);
 }
 
-template <class Reader>
-CodeView_Type_Table parse_codeview_types_without_header(Reader* reader,
-                                                        U64 offset, Logger&) {
+inline CodeView_Type_Table parse_codeview_types_without_header(
+    const Extent_Reader& reader, U64 offset, Logger& logger) {
   // FIXME[start-type-id]: This should be a parameter. PDB can overwrite the
   // initial type ID.
   U32 start_type_id = 0x1000;
   CodeView_Type_Table table(reader, start_type_id);
-  while (offset < reader->size()) {
-    U64 record_size = reader->u16(offset + 0);
-    U16 record_type = reader->u16(offset + 2);
-    if (record_type == LF_TYPESERVER2) {
-      std::u8string pdb_path = reader->utf_8_c_string(offset + 24);
+  CodeView_Record_Cursor cursor(reader, offset);
+  while (std::optional<CodeView_Record> record = cursor.next()) {
+    if (record->length < 2) {
+      logger.log(fmt::format("record has unusual size: {}", record->length),
+                 reader.locate(record->offset));
+      break;
+    }
+    if (record->kind() == LF_TYPESERVER2) {
+      std::u8string pdb_path = record->bytes.utf_8_c_string(24);
       U8 pdb_guid_bytes[16];
-      reader->copy_bytes_into(pdb_guid_bytes, 8);
+      reader.copy_bytes_into(pdb_guid_bytes, 8);
       throw CodeView_Types_In_Separate_PDB_File(std::move(pdb_path),
                                                 GUID(pdb_guid_bytes));
     }
-    table.add_type_entry_at_offset_(offset);
-    offset += record_size + 2;
+    table.add_type_entry_at_offset_(record->offset);
   }
   return table;
 }
 
+template <class Reader>
+CodeView_Type_Table parse_codeview_types_without_header(Reader* reader,
+                                                        U64 offset,
+                                                        Logger& logger) {
+  return parse_codeview_types_without_header(Extent_Reader(*reader), offset,
+                                             logger);
+}
+
 struct CodeView_Function_Local;
 
+struct CodeView_Code_Location {
+  U32 section_index;
+  U32 offset;
+};
+
+// A parsed S_FRAMEPROC record, which describes a function's frame.
+struct CodeView_Frame_Proc {
+  // Number of bytes allocated by the prologue (such as with sub $0x28, %rsp)
+  // for locals, temporaries, and outgoing arguments (including the home space
+  // for callees' register parameters). Excludes saved registers and the
+  // return address.
+  //
+  // Same as CodeView_Function::self_stack_size.
+  U32 frame_size;
+  // Number of padding bytes in the frame, and their offset.
+  U32 padding_size;
+  U32 padding_offset;
+  // Number of bytes used by callee-saved registers (such as with push %rbx).
+  U32 saved_registers_size;
+  // Location of the exception handler, if any. Like
+  // CodeView_Function::code_section_index, exception_handler_section_index is
+  // 0-based.
+  U32 exception_handler_offset;
+  U32 exception_handler_section_index;
+  // CV_FRAMEPROC_* bits.
+  U32 flags;
+
+  bool has_alloca() const { return this->flags & CV_FRAMEPROC_HAS_ALLOCA; }
+  bool has_setjmp() const { return this->flags & CV_FRAMEPROC_HAS_SETJMP; }
+  bool has_longjmp() const { return this->flags & CV_FRAMEPROC_HAS_LONGJMP; }
+  bool has_inline_asm() const {
+    return this->flags & CV_FRAMEPROC_HAS_INLINE_ASM;
+  }
+  // C++ exception handling.
+  bool has_eh() const { return this->flags & CV_FRAMEPROC_HAS_EH; }
+  // Structured exception handling (__try).
+  bool has_seh() const { return this->flags & CV_FRAMEPROC_HAS_SEH; }
+  bool is_naked() const { return this->flags & CV_FRAMEPROC_NAKED; }
+  // Whether the function has a /GS security cookie.
+  bool has_security_checks() const {
+    return this->flags & CV_FRAMEPROC_SECURITY_CHECKS;
+  }
+  bool has_async_eh() const { return this->flags & CV_FRAMEPROC_ASYNC_EH; }
+  bool is_optimized_for_speed() const {
+    return this->flags & CV_FRAMEPROC_OPT_SPEED;
+  }
+
+  // The register which locals (or parameters) are addressed relative to. One
+  // of CV_FRAMEPROC_BASE_POINTER_*.
+  U8 local_base_pointer() const {
+    return (this->flags >> CV_FRAMEPROC_LOCAL_BASE_POINTER_SHIFT) & 3;
+  }
+  U8 param_base_pointer() const {
+    return (this->flags >> CV_FRAMEPROC_PARAM_BASE_POINTER_SHIFT) & 3;
+  }
+
+  // Number of bytes between the stack pointer after the prologue and the
+  // caller's stack pointer before the call instruction: the frame, saved
+  // registers, and the return address. Comparable to
+  // PE_Unwind_Frame::stack_size.
+  //
+  // Excludes dynamic allocations (see has_alloca) and the home space for this
+  // function's parameters, which is part of the caller's frame (see
+  // CodeView_Function::get_caller_stack_size).
+  U64 stack_size() const {
+    return U64{this->frame_size} + this->saved_registers_size + 8;
+  }
+};
+
 struct CodeView_Function {
   std::u8string name;
-  std::variant<Sub_File_Reader<Span_Reader>,
-               Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>>
-      reader;
+  // Reads the symbol records containing this function's record, either from a
+  // COFF section or from a PDB module stream. Empty for functions described
+  // by DWARF (see Project::get_all_functions).
+  Extent_Reader reader;
   U64 byte_offset;
   U32 self_stack_size = static_cast<U32>(-1);
+  // Frame, saved registers, and return address. See
+  // CodeView_Frame_Proc::stack_size. -1 if unknown.
+  //
+  // If uses_frame_pointer, this only counts bytes described by call frame
+  // information. See get_stack_size.
+  U32 stack_size = static_cast<U32>(-1);
 
   // Section number. Almost certainly refers to a .text section.
   //
-  // TODO[coff-relocations]: This is probably wrong because we don't perform
-  // relocations.
+  // For functions in a COFF (.obj) file, this is unrelocated and is usually
+  // wrong. Use get_code_location instead.
   U32 code_section_index = static_cast<U32>(-1);
 
-  // Byte offset within the section described by codeSectionIndex.
+  // Byte offset within the section described by code_section_index.
   //
-  // TODO[coff-relocations]: This is probably wrong because we don't perform
-  // relocations.
+  // For functions in a COFF (.obj) file, this is unrelocated and is usually
+  // wrong. Use get_code_location instead.
   U32 code_offset = static_cast<U32>(-1);
   // Number of bytes for this function's machine code.
   U32 code_size = static_cast<U32>(-1);
 
   // Associated PE or COFF file, if any.
   PE_File<Span_Reader>* pe_file = nullptr;
+  // Associated ELF file, if any. Set for functions described by DWARF.
+  ELF_File<Span_Reader>* elf_file = nullptr;
 
   // Associated module for Line_Tables lookups, if any.
   Line_Tables::Handle line_tables_handle = Line_Tables::Handle::null();
@@ -299,6 +887,9 @@ struct CodeView_Function {
   bool has_func_id_type;
   U32 type_id;
 
+  // See DWARF_Function::uses_frame_pointer.
+  bool uses_frame_pointer = false;
+
   U32 get_caller_stack_size(const CodeView_Type_Table& type_table,
                             Logger& logger = fallback_logger) {
     return this->get_caller_stack_size(type_table, type_table, logger);
@@ -307,137 +898,362 @@ struct CodeView_Function {
   U32 get_caller_stack_size(const CodeView_Type_Table& type_table,
                             const CodeView_Type_Table& type_index_table,
                             Logger& logger = fallback_logger) const {
-    // TODO(strager): Refactor the std::visit mess.
-    return std::visit(
-        [&](auto* reader_ptr) -> U32 {
-          auto& reader = *reader_ptr;
-          U32 type_id = this->type_id;
-          if (this->has_func_id_type) {
-            bool ok = std::visit(
-                [&](auto* index_reader_ptr) -> bool {
-                  auto& index_reader = *index_reader_ptr;
-                  std::optional<U64> func_id_type_offset =
-                      type_index_table.get_offset_of_type_entry_(type_id);
-                  if (!func_id_type_offset.has_value()) {
-                    logger.log(fmt::format("cannot find type with ID: 0x{:x}",
-                                           type_id),
-                               this->location());
-                    return false;
-                  }
-                  // TODO(strager): Check size.
-                  U64 func_id_type_record_type_offset =
-                      *func_id_type_offset + 2;
-                  U64 func_id_type_record_type =
-                      index_reader.u16(func_id_type_record_type_offset);
-                  switch (func_id_type_record_type) {
-                    case LF_FUNC_ID:
-                    case LF_MFUNC_ID:
-                      type_id = index_reader.u32(*func_id_type_offset + 8);
-                      return true;
-                    default:
-                      logger.log(
-                          fmt::format(
-                              "unrecognized function ID record type: 0x{:x}",
-                              func_id_type_record_type),
-                          reader.locate(func_id_type_record_type_offset));
-                      return false;
-                  }
-                },
-                type_index_table.reader_);
-            if (!ok) {
-              return -1;
-            }
-          }
+    const Extent_Reader& reader = type_table.reader_;
+    U32 type_id = this->type_id;
+    if (this->has_func_id_type) {
+      const Extent_Reader& index_reader = type_index_table.reader_;
+      std::optional<U64> func_id_type_offset =
+          type_index_table.get_offset_of_type_entry_(type_id);
+      if (!func_id_type_offset.has_value()) {
+        logger.log(fmt::format("cannot find type with ID: 0x{:x}", type_id),
+                   this->location());
+        return -1;
+      }
+      // TODO(strager): Check size.
+      U64 func_id_type_record_type_offset = *func_id_type_offset + 2;
+      U64 func_id_type_record_type =
+          index_reader.u16(func_id_type_record_type_offset);
+      switch (func_id_type_record_type) {
+        case LF_FUNC_ID:
+        case LF_MFUNC_ID:
+          type_id = index_reader.u32(*func_id_type_offset + 8);
+          break;
+        default:
+          logger.log(
+              fmt::format("unrecognized function ID record type: 0x{:x}",
+                          func_id_type_record_type),
+              index_reader.locate(func_id_type_record_type_offset));
+          return -1;
+      }
+    }
 
-          std::optional<U64> func_type_offset =
-              type_table.get_offset_of_type_entry_(type_id);
-          if (!func_type_offset.has_value()) {
-            // FIXME(strager): Location is wrong if this->has_func_id_type is
-            // true.
-            logger.log(fmt::format("cannot find type with ID: 0x{:x}", type_id),
-                       this->location());
-            return -1;
-          }
-          U64 func_type_record_type_offset = *func_type_offset + 2;
-          // TODO(strager): Check size.
-          U16 func_type_record_type = reader.u16(func_type_record_type_offset);
-
-          U32 this_type_id = T_NOTYPE;
-          U64 calling_convention_offset;
-          U64 parameter_count;
-          switch (func_type_record_type) {
-            case LF_PROCEDURE:
-              calling_convention_offset = *func_type_offset + 8;
-              parameter_count = reader.u16(*func_type_offset + 10);
-              break;
-
-            case LF_MFUNCTION:
-              this_type_id = reader.u32(*func_type_offset + 12);
-              calling_convention_offset = *func_type_offset + 16;
-              parameter_count = reader.u16(*func_type_offset + 18);
-              break;
-
-            default:
-              logger.log(
-                  fmt::format("unrecognized function type record type: 0x{:x}",
-                              func_type_record_type),
-                  reader.locate(func_type_record_type_offset));
-              return -1;
-          }
+    std::optional<U64> func_type_offset =
+        type_table.get_offset_of_type_entry_(type_id);
+    if (!func_type_offset.has_value()) {
+      // FIXME(strager): Location is wrong if this->has_func_id_type is true.
+      logger.log(fmt::format("cannot find type with ID: 0x{:x}", type_id),
+                 this->location());
+      return -1;
+    }
+    U64 func_type_record_type_offset = *func_type_offset + 2;
+    // TODO(strager): Check size.
+    U16 func_type_record_type = reader.u16(func_type_record_type_offset);
+
+    U32 this_type_id = T_NOTYPE;
+    U64 calling_convention_offset;
+    U64 parameter_count;
+    switch (func_type_record_type) {
+      case LF_PROCEDURE:
+        calling_convention_offset = *func_type_offset + 8;
+        parameter_count = reader.u16(*func_type_offset + 10);
+        break;
 
-          U8 calling_convention = reader.u8(calling_convention_offset);
-          switch (calling_convention) {
-            case CV_CALL_NEAR_C: {
-              if (this_type_id != T_NOTYPE) {
-                // HACK(strager): Assume that thisTypeID refers to a pointer
-                // type. The 'this' parameter would thus be one register (u64)
-                // wide like other parameters.
-                parameter_count += 1;
-              }
-              return std::max(parameter_count, U64{4}) * 8;
-            }
-
-            default:
-              logger.log(fmt::format(
-                             "unrecognized function calling convention: 0x{:x}",
-                             calling_convention),
-                         reader.locate(calling_convention_offset));
-              return -1;
-          }
-        },
-        type_table.reader_);
+      case LF_MFUNCTION:
+        this_type_id = reader.u32(*func_type_offset + 12);
+        calling_convention_offset = *func_type_offset + 16;
+        parameter_count = reader.u16(*func_type_offset + 18);
+        break;
+
+      default:
+        logger.log(
+            fmt::format("unrecognized function type record type: 0x{:x}",
+                        func_type_record_type),
+            reader.locate(func_type_record_type_offset));
+        return -1;
+    }
+
+    U8 calling_convention = reader.u8(calling_convention_offset);
+    switch (calling_convention) {
+      case CV_CALL_NEAR_C: {
+        if (this_type_id != T_NOTYPE) {
+          // HACK(strager): Assume that thisTypeID refers to a pointer type. The
+          // 'this' parameter would thus be one register (u64) wide like other
+          // parameters.
+          parameter_count += 1;
+        }
+        return std::max(parameter_count, U64{4}) * 8;
+      }
+
+      default:
+        logger.log(
+            fmt::format("unrecognized function calling convention: 0x{:x}",
+                        calling_convention),
+            reader.locate(calling_convention_offset));
+        return -1;
+    }
   }
 
   std::vector<CodeView_Function_Local> get_locals(
       U64 offset, Logger& logger = fallback_logger) const;
 
-  // Returns null if no PEFile is associated with this function.
+  // Parses this function's S_FRAMEPROC record.
+  //
+  // Returns null if the function has no S_FRAMEPROC record.
+  std::optional<CodeView_Frame_Proc> get_frame_proc(
+      Logger& logger = fallback_logger) const;
+
+  // Decodes this function's S_INLINESITE records.
+  CodeView_Inline_Site_Tree get_inline_sites(
+      Logger& logger = fallback_logger) const;
+
+  // Returns code_section_index and code_offset. If this function was read
+  // from a COFF (.obj) file's .debug$S section, the symbol record's
+  // relocations are applied first.
+  //
+  // Returns null if relocations could not be applied.
+  std::optional<CodeView_Code_Location> get_code_location(
+      Logger& logger = fallback_logger) const {
+    CodeView_Code_Location unrelocated = {
+        .section_index = this->code_section_index,
+        .offset = this->code_offset,
+    };
+    if (this->pe_file == nullptr || this->pe_file->symbol_count == 0) {
+      return unrelocated;
+    }
+    if (!this->reader.is_contiguous() ||
+        this->reader.base_reader() != this->pe_file->reader) {
+      // This function came from a PDB, not from the COFF file.
+      return unrelocated;
+    }
+
+    U64 record_file_offset = this->reader.sub_file_offset() + this->byte_offset;
+    std::optional<U32> debug_section_index =
+        this->pe_file->find_section_index_by_file_offset(record_file_offset);
+    if (!debug_section_index.has_value()) {
+      return unrelocated;
+    }
+    U32 record_offset = narrow_cast<U32>(
+        record_file_offset -
+        this->pe_file->sections[*debug_section_index].data_file_offset);
+    std::optional<COFF_Relocation_Target> offset_target =
+        this->pe_file->resolve_relocation(*debug_section_index,
+                                          record_offset + 32);
+    std::optional<COFF_Relocation_Target> section_target =
+        this->pe_file->resolve_relocation(*debug_section_index,
+                                          record_offset + 36);
+    if (!offset_target.has_value() || !section_target.has_value()) {
+      return unrelocated;
+    }
+    if (section_target->symbol.section_index == static_cast<U32>(-1)) {
+      logger.log(fmt::format("CodeView function refers to symbol {} which is "
+                             "not defined in this COFF file",
+                             u8string_to_string(section_target->symbol.name)),
+                 this->location());
+      return std::nullopt;
+    }
+    return CodeView_Code_Location{
+        .section_index = section_target->symbol.section_index,
+        .offset = offset_target->offset,
+    };
+  }
+
+  // Returns null if no PE or ELF file is associated with this function.
   std::optional<Sub_File_Reader<Span_Reader>> get_instruction_bytes_reader(
       Logger& logger = fallback_logger) const {
+    if (this->elf_file != nullptr) {
+      if (this->code_section_index >= this->elf_file->sections.size()) {
+        logger.log(fmt::format("could not find section index {} in ELF file "
+                               "referenced by DWARF function",
+                               this->code_section_index),
+                   this->location());
+        return std::nullopt;
+      }
+      Sub_File_Reader section_reader = this->elf_file->reader_for_section(
+          this->elf_file->sections[this->code_section_index]);
+      return section_reader.sub_reader(this->code_offset, this->code_size);
+    }
     if (this->pe_file == nullptr) {
       return std::nullopt;
     }
-    if (this->code_section_index >= this->pe_file->sections.size()) {
+    std::optional<CodeView_Code_Location> code_location =
+        this->get_code_location(logger);
+    if (!code_location.has_value()) {
+      return std::nullopt;
+    }
+    if (code_location->section_index >= this->pe_file->sections.size()) {
       logger.log(fmt::format("could not find section index {} in PE file "
                              "referenced by CodeView function",
-                             this->code_section_index),
+                             code_location->section_index),
                  this->location());
       return std::nullopt;
     }
     PE_Section& code_section =
-        this->pe_file->sections[this->code_section_index];
+        this->pe_file->sections[code_location->section_index];
     Sub_File_Reader section_reader =
         this->pe_file->reader_for_section(code_section);
-    return section_reader.sub_reader(this->code_offset, this->code_size);
+    return section_reader.sub_reader(code_location->offset, this->code_size);
   }
 
-  Location location() const {
-    return std::visit(
-        [&](auto& reader) { return reader.locate(this->byte_offset); },
-        this->reader);
+  // Returns stack_size. If uses_frame_pointer, also accounts for stack memory
+  // touched by the function's machine code (see analyze_x86_64_stack_map).
+  // This decodes the function's code, so it is much slower than reading
+  // stack_size.
+  U32 get_stack_size(Logger& logger = fallback_logger) const {
+    if (!this->uses_frame_pointer ||
+        this->stack_size == static_cast<U32>(-1)) {
+      return this->stack_size;
+    }
+    std::optional<Sub_File_Reader<Span_Reader>> code_reader =
+        this->get_instruction_bytes_reader(logger);
+    if (!code_reader.has_value()) {
+      return this->stack_size;
+    }
+    std::vector<U8> code(code_reader->size());
+    code_reader->copy_bytes_into(code, 0);
+    U64 touched_stack_size =
+        analyze_x86_64_stack_map(code).touched_stack_size();
+    // NOTE(strager): touched_stack_size excludes the return address.
+    return narrow_cast<U32>(
+        std::max(U64{this->stack_size}, touched_stack_size + 8));
+  }
+
+  // Returns the frame described by the PE file's x64 unwind information for
+  // this function's first byte (see PE_File::find_unwind_frame).
+  //
+  // Returns null if no PE file is associated with this function or if the
+  // function has no unwind information (such as leaf functions and functions
+  // in COFF files).
+  const PE_Unwind_Frame* get_unwind_frame(
+      Logger& logger = fallback_logger) const {
+    if (this->pe_file == nullptr ||
+        this->code_section_index >= this->pe_file->sections.size()) {
+      return nullptr;
+    }
+    U32 rva =
+        this->pe_file->sections[this->code_section_index].virtual_address +
+        this->code_offset;
+    return this->pe_file->find_unwind_frame(rva, logger);
+  }
+
+  // Resolves the COFF relocation (if any) which patches this function's
+  // machine code at the given offset. For example, for a 'call rel32'
+  // instruction at offset N, get_relocation_target(N + 1) returns the called
+  // function's symbol.
+  //
+  // Returns null if there is no such relocation, such as if this function came
+  // from a linked PE file.
+  std::optional<COFF_Relocation_Target> get_relocation_target(
+      U32 instruction_byte_offset, Logger& logger = fallback_logger) const {
+    if (this->pe_file == nullptr) {
+      return std::nullopt;
+    }
+    std::optional<CodeView_Code_Location> code_location =
+        this->get_code_location(logger);
+    if (!code_location.has_value()) {
+      return std::nullopt;
+    }
+    return this->pe_file->resolve_relocation(
+        code_location->section_index,
+        code_location->offset + instruction_byte_offset);
+  }
+
+  Location location() const { return this->reader.locate(this->byte_offset); }
+
+  // Identifies the file containing this function's machine code, so that
+  // code_section_index and code_offset can be told apart from those of
+  // functions in other files. Useful for identity comparisons only.
+  //
+  // This is the data of the PE file if there is one. Otherwise, it is the data
+  // of the file containing this function's symbol record: a COFF, ELF, or PDB
+  // file.
+  const void* code_file() const {
+    // NOTE(strager): Keep in sync with CodeView_Function_Table::code_file.
+    if (this->pe_file != nullptr) {
+      return this->pe_file->reader->data().data();
+    }
+    return this->reader.file_data();
   }
 };
 
+// Parses an S_GPROC32 or S_GPROC32_ID record read from reader.
+inline CodeView_Function make_codeview_function(const Extent_Reader& reader,
+                                                const CodeView_Record& record) {
+  return CodeView_Function{
+      .name = record.bytes.utf_8_c_string(39),
+      .reader = reader,
+      .byte_offset = record.offset,
+      .code_section_index = U32{record.bytes.u16(36)} - 1,
+      .code_offset = record.bytes.u32(32),
+      .code_size = record.bytes.u32(16),
+      .has_func_id_type = record.kind() == S_GPROC32_ID,
+      .type_id = record.bytes.u32(28),
+  };
+}
+
+// Parses an S_FRAMEPROC record read from reader.
+//
+// Returns null if the record is too short.
+inline std::optional<CodeView_Frame_Proc> parse_codeview_frame_proc(
+    const Extent_Reader& reader, const CodeView_Record& record,
+    Logger& logger) {
+  if (record.bytes.size() < 30) {
+    logger.log(fmt::format("S_FRAMEPROC record is too short: {} bytes",
+                           record.bytes.size()),
+               reader.locate(record.offset));
+    return std::nullopt;
+  }
+  return CodeView_Frame_Proc{
+      .frame_size = record.bytes.u32(4),
+      .padding_size = record.bytes.u32(8),
+      .padding_offset = record.bytes.u32(12),
+      .saved_registers_size = record.bytes.u32(16),
+      .exception_handler_offset = record.bytes.u32(20),
+      .exception_handler_section_index = U32{record.bytes.u16(24)} - 1,
+      .flags = record.bytes.u32(26),
+  };
+}
+
+inline void find_all_codeview_functions_in_subsection(
+    const Extent_Reader& reader, std::vector<CodeView_Function>& out_functions,
+    Logger& logger) {
+  // The function (added by us) which contains the current record, if any.
+  std::optional<U64> current_function_index = std::nullopt;
+  bool in_local_procedure = false;
+
+  CodeView_Record_Cursor cursor(reader);
+  while (std::optional<CodeView_Record> record = cursor.next()) {
+    if (record->length < 2) {
+      logger.log(fmt::format("record has unusual size: {}", record->length),
+                 reader.locate(record->offset));
+      break;
+    }
+    switch (record->kind()) {
+      case S_GPROC32:
+      case S_GPROC32_ID:
+        current_function_index = out_functions.size();
+        in_local_procedure = false;
+        out_functions.push_back(make_codeview_function(reader, *record));
+        break;
+
+      case S_LPROC32:
+      case S_LPROC32_ID:
+        // TODO(strager): Support local (static) functions.
+        current_function_index = std::nullopt;
+        in_local_procedure = true;
+        break;
+
+      case S_FRAMEPROC:
+        if (!current_function_index.has_value()) {
+          if (!in_local_procedure) {
+            logger.log("found S_FRAMEPROC with no corresponding S_GPROC32"sv,
+                       reader.locate(record->offset));
+          }
+          break;
+        }
+        if (std::optional<CodeView_Frame_Proc> frame_proc =
+                parse_codeview_frame_proc(reader, *record, logger)) {
+          CodeView_Function& func = out_functions[*current_function_index];
+          func.self_stack_size = frame_proc->frame_size;
+          func.stack_size = narrow_cast<U32>(frame_proc->stack_size());
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
 template <class Reader>
 std::vector<CodeView_Function> find_all_codeview_functions(Reader* reader) {
   std::vector<CodeView_Function> out_functions;
@@ -500,65 +1316,99 @@ template <class Reader>
 void find_all_codeview_functions_2(
     Reader* reader, std::vector<CodeView_Function>& out_functions,
     Logger& logger = fallback_logger) {
+  find_all_codeview_functions_2(reader, reader->size(), out_functions, logger);
+}
+
+// Only the first symbols_size bytes of the stream are parsed. In a PDB module
+// stream, symbols are followed by line tables (see
+// PDB_DBI_Module::symbols_size).
+template <class Reader>
+void find_all_codeview_functions_2(
+    Reader* reader, U64 symbols_size,
+    std::vector<CodeView_Function>& out_functions,
+    Logger& logger = fallback_logger) {
+  symbols_size = std::min(symbols_size, reader->size());
+  if (symbols_size < 4) {
+    // No room for the CodeView signature, so there are no symbols.
+    return;
+  }
   U32 signature = reader->u32(0);
   if (signature != CV_SIGNATURE_C13) {
     throw new Unsupported_CodeView_Error();
   }
 
-  find_all_codeview_functions_in_subsection<Reader>(
-      Sub_File_Reader(reader, 4, reader->size() - 4), out_functions, logger);
+  find_all_codeview_functions_in_subsection(
+      Extent_Reader(*reader).sub_reader(4, symbols_size - 4), out_functions,
+      logger);
 }
 
-template <class Reader>
-void find_all_codeview_functions_in_subsection(
-    Sub_File_Reader<Reader> reader,
-    std::vector<CodeView_Function>& out_functions, Logger& logger) {
-  U64 offset = 0;
-
-  while (offset < reader.size()) {
-    U64 record_size = reader.u16(offset + 0);
-    if (record_size < 2) {
-      logger.log(fmt::format("record has unusual size: {}", record_size),
-                 reader.locate(offset + 0));
+// Parses the S_FRAMEPROC record of the procedure whose record (such as
+// S_GPROC32) is at proc_offset. Only the procedure's own records are read.
+//
+// Returns nullopt if the procedure has no S_FRAMEPROC record.
+inline std::optional<CodeView_Frame_Proc> find_codeview_frame_proc(
+    const Extent_Reader& reader, U64 proc_offset,
+    Logger& logger = fallback_logger) {
+  CodeView_Record_Cursor cursor(reader, proc_offset);
+  if (!cursor.next().has_value()) {
+    return std::nullopt;
+  }
+  // S_FRAMEPROC is a direct child of the procedure and appears before any
+  // nested scopes.
+  while (cursor.offset() + 4 <= reader.size()) {
+    std::optional<CodeView_Record> child_record = cursor.next();
+    if (child_record->length < 2) {
+      logger.log(
+          fmt::format("record has unusual size: {}", child_record->length),
+          reader.locate(child_record->offset));
       break;
     }
-    U16 record_type = reader.u16(offset + 2);
-    switch (record_type) {
-      case S_GPROC32:
-      case S_GPROC32_ID: {
-        CodeView_Function func{
-            .name = reader.utf_8_c_string(offset + 39),
-            .reader = reader,
-            .byte_offset = offset,
-            .code_section_index = U32{reader.u16(offset + 36)} - 1,
-            .code_offset = reader.u32(offset + 32),
-            .code_size = reader.u32(offset + 16),
-            .has_func_id_type = record_type == S_GPROC32_ID,
-            .type_id = reader.u32(offset + 28),
-        };
-        out_functions.push_back(func);
-        break;
-      }
-
-      case S_FRAMEPROC: {
-        // FIXME(strager): This should instead check if the last function added
-        // was added by us.
-        if (out_functions.empty()) {
-          logger.log("found S_FRAMEPROC with no corresponding S_GPROC32"sv,
-                     reader.locate(offset + 0));
-          break;
-        }
-        CodeView_Function& func = out_functions[out_functions.size() - 1];
-        func.self_stack_size = reader.u32(offset + 4);
-        break;
-      }
-
-      default:
-        break;
+    U16 child_record_type = child_record->kind();
+    if (child_record_type == S_FRAMEPROC) {
+      return parse_codeview_frame_proc(reader, *child_record, logger);
     }
+    if (child_record_type == S_END || child_record_type == S_PROC_ID_END ||
+        child_record_type == S_BLOCK32 || child_record_type == S_GPROC32 ||
+        child_record_type == S_GPROC32_ID || child_record_type == S_LPROC32 ||
+        child_record_type == S_LPROC32_ID) {
+      break;
+    }
+  }
+  return std::nullopt;
+}
 
-    offset += record_size + 2;
+// Parses the S_GPROC32 or S_GPROC32_ID record at the given offset, and its
+// S_FRAMEPROC record if any. Only the function's own records are read.
+//
+// Returns nullopt if the record at offset is not a global procedure.
+inline std::optional<CodeView_Function> find_codeview_function_at(
+    const Extent_Reader& reader, U64 offset,
+    Logger& logger = fallback_logger) {
+  if (offset + 4 > reader.size()) {
+    logger.log("procedure offset is out of bounds", reader.locate(0));
+    return std::nullopt;
+  }
+  CodeView_Record_Cursor cursor(reader, offset);
+  std::optional<CodeView_Record> record = cursor.next();
+  if (record->length < 2) {
+    logger.log(fmt::format("record has unusual size: {}", record->length),
+               reader.locate(offset));
+    return std::nullopt;
+  }
+  U16 record_type = record->kind();
+  if (record_type != S_GPROC32 && record_type != S_GPROC32_ID) {
+    logger.log(fmt::format("expected S_GPROC32 but found record type {:#x}",
+                           record_type),
+               reader.locate(offset));
+    return std::nullopt;
+  }
+  CodeView_Function func = make_codeview_function(reader, *record);
+  if (std::optional<CodeView_Frame_Proc> frame_proc =
+          find_codeview_frame_proc(reader, offset, logger)) {
+    func.self_stack_size = frame_proc->frame_size;
+    func.stack_size = narrow_cast<U32>(frame_proc->stack_size());
   }
+  return func;
 }
 
 struct CodeView_Function_Local {
@@ -566,6 +1416,10 @@ struct CodeView_Function_Local {
   U32 sp_offset;
   U32 type_id;
   Location location;
+  // Index into CodeView_Inline_Site_Tree::sites of the inline site declaring
+  // this local, or CodeView_Inline_Site::no_parent if the function itself
+  // declares this local.
+  U32 inline_site_index = CodeView_Inline_Site::no_parent;
 
   std::optional<CodeView_Type> get_type(
       CodeView_Type_Table* type_table, Logger& logger = fallback_logger) const {
@@ -580,35 +1434,115 @@ struct CodeView_Function_Local {
   }
 };
 
-template <class Reader>
-std::vector<CodeView_Function_Local> get_codeview_function_locals(
-    Sub_File_Reader<Reader> reader, U64 offset) {
-  std::vector<CodeView_Function_Local> out_locals;
-  get_codeview_function_locals<Reader>(reader, offset, out_locals,
-                                       fallback_logger);
-  return out_locals;
-}
-
-template <class Reader>
-void get_codeview_function_locals(
-    Sub_File_Reader<Reader> reader, U64 offset,
-    std::vector<CodeView_Function_Local>& out_locals, Logger&) {
+// Finds the stack-allocated locals of the procedure whose record is at offset.
+//
+// Locals come from S_REGREL32 records and from S_LOCAL records whose
+// S_DEFRANGE_* records place them on the stack. Locals which only live in
+// registers are skipped.
+inline void get_codeview_function_locals(
+    const Extent_Reader& reader, U64 offset,
+    std::vector<CodeView_Function_Local>& out_locals, Logger& logger) {
   U32 depth = 1;
-  while (offset < reader.size()) {
-    U64 record_size = reader.u16(offset + 0);
-    U16 record_type = reader.u16(offset + 2);
-    switch (record_type) {
+  // Indexes of the inline sites enclosing the current record, innermost last.
+  std::vector<U32> inline_site_stack;
+  U32 inline_site_count = 0;
+  auto current_inline_site_index = [&]() -> U32 {
+    return inline_site_stack.empty() ? CodeView_Inline_Site::no_parent
+                                     : inline_site_stack.back();
+  };
+
+  // The S_LOCAL record which the following S_DEFRANGE_* records describe.
+  std::optional<CodeView_Function_Local> pending_local;
+  bool pending_local_is_param = false;
+  // Indexes into out_locals of locals from S_REGREL32 and S_LOCAL records.
+  std::vector<U64> regrel_indexes;
+  std::vector<U64> s_local_indexes;
+  std::optional<std::optional<CodeView_Frame_Proc>> frame_proc;
+  auto add_pending_local = [&](U32 sp_offset) -> void {
+    pending_local->sp_offset = sp_offset;
+    s_local_indexes.push_back(out_locals.size());
+    out_locals.push_back(std::move(*pending_local));
+    // NOTE(strager): If the local moves between stack slots, only the first
+    // slot is reported.
+    pending_local.reset();
+  };
+  auto is_frame_pointer_rsp = [&]() -> bool {
+    if (!frame_proc.has_value()) {
+      frame_proc = find_codeview_frame_proc(reader, offset, logger);
+    }
+    if (!frame_proc->has_value()) {
+      return false;
+    }
+    U8 base_pointer = pending_local_is_param
+                          ? (*frame_proc)->param_base_pointer()
+                          : (*frame_proc)->local_base_pointer();
+    // TODO(strager): Support locals relative to RBP.
+    return base_pointer == CV_FRAMEPROC_BASE_POINTER_RSP;
+  };
+
+  CodeView_Record_Cursor cursor(reader, offset);
+  while (std::optional<CodeView_Record> record = cursor.next()) {
+    if (record->length < 2) {
+      logger.log(fmt::format("record has unusual size: {}", record->length),
+                 reader.locate(record->offset));
+      break;
+    }
+    U16 kind = record->kind();
+    bool is_def_range = kind == S_DEFRANGE_REGISTER ||
+                        kind == S_DEFRANGE_FRAMEPOINTER_REL ||
+                        kind == S_DEFRANGE_SUBFIELD_REGISTER ||
+                        kind == S_DEFRANGE_FRAMEPOINTER_REL_FULL_SCOPE ||
+                        kind == S_DEFRANGE_REGISTER_REL;
+    if (!is_def_range) {
+      pending_local.reset();
+    }
+    switch (kind) {
       case S_REGREL32: {
         CodeView_Function_Local local{
-            .name = reader.utf_8_c_string(offset + 14),
+            .name = record->bytes.utf_8_c_string(14),
             // TODO(strager): Verify that the register is RSP.
-            .sp_offset = reader.u32(offset + 4),
-            .type_id = reader.u32(offset + 8),
-            .location = reader.locate(offset),
+            .sp_offset = record->bytes.u32(4),
+            .type_id = record->bytes.u32(8),
+            .location = reader.locate(record->offset),
+            .inline_site_index = current_inline_site_index(),
         };
+        regrel_indexes.push_back(out_locals.size());
         out_locals.push_back(local);
         break;
       }
+      case S_LOCAL:
+        pending_local = CodeView_Function_Local{
+            .name = record->bytes.utf_8_c_string(10),
+            .sp_offset = 0,
+            .type_id = record->bytes.u32(4),
+            .location = reader.locate(record->offset),
+            .inline_site_index = current_inline_site_index(),
+        };
+        pending_local_is_param =
+            (record->bytes.u16(8) & CV_LOCAL_IS_PARAM) != 0;
+        break;
+      case S_DEFRANGE_FRAMEPOINTER_REL:
+      case S_DEFRANGE_FRAMEPOINTER_REL_FULL_SCOPE:
+        if (pending_local.has_value() && is_frame_pointer_rsp()) {
+          add_pending_local(record->bytes.u32(4));
+        }
+        break;
+      case S_DEFRANGE_REGISTER_REL:
+        if (pending_local.has_value() &&
+            record->bytes.u16(4) == CV_AMD64_RSP) {
+          add_pending_local(record->bytes.u32(8));
+        }
+        break;
+      case S_INLINESITE:
+      case S_INLINESITE2:
+        inline_site_stack.push_back(inline_site_count);
+        inline_site_count += 1;
+        break;
+      case S_INLINESITE_END:
+        if (!inline_site_stack.empty()) {
+          inline_site_stack.pop_back();
+        }
+        break;
       case S_BLOCK32:
         depth += 1;
         break;
@@ -623,20 +1557,111 @@ void get_codeview_function_locals(
       default:
         break;
     }
+  }
+done:
+  // NOTE(strager): MSVC describes some parameters with both S_REGREL32 and
+  // S_LOCAL records. Keep only the S_REGREL32 local.
+  std::vector<U64> duplicate_indexes;
+  for (U64 s_local_index : s_local_indexes) {
+    const CodeView_Function_Local& s_local = out_locals[s_local_index];
+    for (U64 regrel_index : regrel_indexes) {
+      const CodeView_Function_Local& regrel = out_locals[regrel_index];
+      if (regrel.sp_offset == s_local.sp_offset &&
+          regrel.name == s_local.name &&
+          regrel.inline_site_index == s_local.inline_site_index) {
+        duplicate_indexes.push_back(s_local_index);
+        break;
+      }
+    }
+  }
+  for (auto it = duplicate_indexes.rbegin(); it != duplicate_indexes.rend();
+       ++it) {
+    out_locals.erase(out_locals.begin() + narrow_cast<std::ptrdiff_t>(*it));
+  }
+}
 
-    offset += record_size + 2;
+// Decodes the S_INLINESITE and S_INLINESITE2 records of the procedure whose
+// record is at offset.
+inline void get_codeview_inline_sites(const Extent_Reader& reader, U64 offset,
+                                      CodeView_Inline_Site_Tree& out_tree,
+                                      Logger& logger) {
+  U32 depth = 1;
+  std::vector<U32> inline_site_stack;
+  CodeView_Record_Cursor cursor(reader, offset);
+  while (std::optional<CodeView_Record> record = cursor.next()) {
+    if (record->length < 2) {
+      logger.log(fmt::format("record has unusual size: {}", record->length),
+                 reader.locate(record->offset));
+      break;
+    }
+    switch (record->kind()) {
+      case S_INLINESITE:
+      case S_INLINESITE2: {
+        U64 annotations_offset = record->kind() == S_INLINESITE2 ? 20 : 16;
+        std::span<const U8> record_bytes = record->bytes.data();
+        std::span<const U8> annotations =
+            annotations_offset <= record_bytes.size()
+                ? record_bytes.subspan(annotations_offset)
+                : std::span<const U8>();
+        U32 first_code_range_index =
+            narrow_cast<U32>(out_tree.code_ranges.size());
+        if (!decode_codeview_inline_site_code_ranges(annotations,
+                                                     out_tree.code_ranges)) {
+          logger.log("inline site has malformed binary annotations",
+                     reader.locate(record->offset));
+        }
+        U32 parent_index = inline_site_stack.empty()
+                               ? CodeView_Inline_Site::no_parent
+                               : inline_site_stack.back();
+        inline_site_stack.push_back(narrow_cast<U32>(out_tree.sites.size()));
+        out_tree.sites.push_back(CodeView_Inline_Site{
+            .inlinee_id = record->bytes.u32(12),
+            .parent_index = parent_index,
+            .first_code_range_index = first_code_range_index,
+            .code_range_count = narrow_cast<U32>(out_tree.code_ranges.size() -
+                                                 first_code_range_index),
+            .location = reader.locate(record->offset),
+        });
+        break;
+      }
+      case S_INLINESITE_END:
+        if (!inline_site_stack.empty()) {
+          inline_site_stack.pop_back();
+        }
+        break;
+      case S_BLOCK32:
+        depth += 1;
+        break;
+      case S_END:
+        depth -= 1;
+        if (depth == 0) {
+          return;
+        }
+        break;
+      case S_PROC_ID_END:
+        return;
+      default:
+        break;
+    }
   }
-done:;
 }
 
 inline std::vector<CodeView_Function_Local> CodeView_Function::get_locals(
     U64 offset, Logger& logger) const {
   std::vector<CodeView_Function_Local> out_locals;
-  std::visit(
-      [&](auto& reader) {
-        get_codeview_function_locals(reader, offset, out_locals, logger);
-      },
-      this->reader);
+  get_codeview_function_locals(this->reader, offset, out_locals, logger);
   return out_locals;
 }
+
+inline CodeView_Inline_Site_Tree CodeView_Function::get_inline_sites(
+    Logger& logger) const {
+  CodeView_Inline_Site_Tree tree;
+  get_codeview_inline_sites(this->reader, this->byte_offset, tree, logger);
+  return tree;
+}
+
+inline std::optional<CodeView_Frame_Proc> CodeView_Function::get_frame_proc(
+    Logger& logger) const {
+  return find_codeview_frame_proc(this->reader, this->byte_offset, logger);
+}
 }
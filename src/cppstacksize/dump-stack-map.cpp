@@ -20,4 +20,7 @@ int main(int argc, char** argv) {
   for (Stack_Map_Touch& touch : map.touches) {
     std::cout << touch << '\n';
   }
+  for (Stack_Map_Dynamic_Allocation& allocation : map.dynamic_allocations) {
+    std::cout << allocation << '\n';
+  }
 }
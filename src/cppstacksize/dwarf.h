@@ -0,0 +1,1590 @@
+#pragma once
+
+#include <algorithm>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/base.h>
+#include <cppstacksize/dwarf-constants.h>
+#include <cppstacksize/elf.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/reader.h>
+#include <cppstacksize/util.h>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Documentation:
+// https://dwarfstd.org/doc/DWARF5.pdf
+// https://refspecs.linuxfoundation.org/LSB_5.0.0/LSB-Core-generic/LSB-Core-generic/ehframechpt.html
+
+namespace cppstacksize {
+template <class Reader>
+U64 read_uleb128(const Reader& reader, U64* offset) {
+  U64 result = 0;
+  U32 shift = 0;
+  for (;;) {
+    U8 byte = reader.u8(*offset);
+    *offset += 1;
+    if (shift < 64) {
+      result |= U64{byte & 0x7fu} << shift;
+    }
+    shift += 7;
+    if ((byte & 0x80) == 0) {
+      return result;
+    }
+  }
+}
+
+template <class Reader>
+S64 read_sleb128(const Reader& reader, U64* offset) {
+  U64 result = 0;
+  U32 shift = 0;
+  U8 byte;
+  do {
+    byte = reader.u8(*offset);
+    *offset += 1;
+    if (shift < 64) {
+      result |= U64{byte & 0x7fu} << shift;
+    }
+    shift += 7;
+  } while (byte & 0x80);
+  if (shift < 64 && (byte & 0x40)) {
+    result |= ~U64{0} << shift;
+  }
+  return static_cast<S64>(result);
+}
+
+// Reads a DWARF initial length field. Returns the length and sets
+// *offset_size to 4 (32-bit DWARF) or 8 (64-bit DWARF).
+template <class Reader>
+U64 read_dwarf_initial_length(const Reader& reader, U64* offset,
+                              U8* offset_size) {
+  U64 length = reader.u32(*offset);
+  *offset += 4;
+  if (length == 0xffffffff) {
+    length = reader.u64(*offset);
+    *offset += 8;
+    *offset_size = 8;
+  } else {
+    *offset_size = 4;
+  }
+  return length;
+}
+
+template <class Reader>
+U64 read_dwarf_offset(const Reader& reader, U64 offset, U8 offset_size) {
+  return offset_size == 8 ? reader.u64(offset) : reader.u32(offset);
+}
+
+template <class Reader>
+U64 read_dwarf_address(const Reader& reader, U64 offset, U8 address_size) {
+  switch (address_size) {
+    case 4:
+      return reader.u32(offset);
+    case 8:
+      return reader.u64(offset);
+    default:
+      throw std::runtime_error("unsupported DWARF address size");
+  }
+}
+
+// The DWARF sections of an ELF file. Missing sections are empty.
+template <class Reader>
+struct DWARF_Sections {
+  Reader debug_info;
+  Reader debug_abbrev;
+  Reader debug_str;
+  Reader debug_line_str;
+  Reader debug_str_offsets;
+  Reader debug_addr;
+  Reader debug_line;
+  Reader debug_ranges;
+  Reader debug_rnglists;
+};
+
+template <class Reader>
+DWARF_Sections<Sub_File_Reader<Reader>> find_dwarf_sections(
+    const ELF_File<Reader>& elf) {
+  auto get = [&](std::u8string_view name) -> Sub_File_Reader<Reader> {
+    std::optional<Sub_File_Reader<Reader>> reader =
+        elf.find_section_reader_by_name(name);
+    return reader.has_value() ? *reader
+                              : Sub_File_Reader<Reader>(elf.reader, 0, 0);
+  };
+  return DWARF_Sections<Sub_File_Reader<Reader>>{
+      .debug_info = get(u8".debug_info"),
+      .debug_abbrev = get(u8".debug_abbrev"),
+      .debug_str = get(u8".debug_str"),
+      .debug_line_str = get(u8".debug_line_str"),
+      .debug_str_offsets = get(u8".debug_str_offsets"),
+      .debug_addr = get(u8".debug_addr"),
+      .debug_line = get(u8".debug_line"),
+      .debug_ranges = get(u8".debug_ranges"),
+      .debug_rnglists = get(u8".debug_rnglists"),
+  };
+}
+
+// A unit header in .debug_info.
+struct DWARF_Unit {
+  // Offsets are relative to the beginning of .debug_info.
+  U64 header_offset;
+  U64 dies_offset;
+  U64 end_offset;
+
+  U16 version;
+  U8 unit_type;
+  U8 address_size;
+  U8 offset_size;
+  U64 abbrev_offset;
+};
+
+// Parses only unit headers. DIEs are not parsed.
+template <class Reader>
+std::vector<DWARF_Unit> parse_dwarf_unit_headers(
+    const Reader& debug_info, Logger& logger = fallback_logger) {
+  std::vector<DWARF_Unit> units;
+  U64 offset = 0;
+  while (offset < debug_info.size()) {
+    DWARF_Unit unit;
+    unit.header_offset = offset;
+    U64 length =
+        read_dwarf_initial_length(debug_info, &offset, &unit.offset_size);
+    unit.end_offset = offset + length;
+    unit.version = debug_info.u16(offset);
+    offset += 2;
+    if (unit.version < 2 || unit.version > 5) {
+      logger.log(fmt::format("unsupported DWARF version {}; ignoring unit",
+                             unit.version),
+                 debug_info.locate(unit.header_offset));
+      offset = unit.end_offset;
+      continue;
+    }
+    if (unit.version >= 5) {
+      unit.unit_type = debug_info.u8(offset);
+      unit.address_size = debug_info.u8(offset + 1);
+      offset += 2;
+      unit.abbrev_offset =
+          read_dwarf_offset(debug_info, offset, unit.offset_size);
+      offset += unit.offset_size;
+      switch (unit.unit_type) {
+        case DW_UT_skeleton:
+        case DW_UT_split_compile:
+          offset += 8;  // DWO ID.
+          break;
+        case DW_UT_type:
+        case DW_UT_split_type:
+          offset += 8 + unit.offset_size;  // Type signature and offset.
+          break;
+        default:
+          break;
+      }
+    } else {
+      unit.unit_type = DW_UT_compile;
+      unit.abbrev_offset =
+          read_dwarf_offset(debug_info, offset, unit.offset_size);
+      offset += unit.offset_size;
+      unit.address_size = debug_info.u8(offset);
+      offset += 1;
+    }
+    unit.dies_offset = offset;
+    units.push_back(unit);
+    offset = unit.end_offset;
+  }
+  return units;
+}
+
+struct DWARF_Attribute_Spec {
+  U16 name;
+  U16 form;
+  // Only used for DW_FORM_implicit_const.
+  S64 implicit_const;
+};
+
+struct DWARF_Abbreviation {
+  U64 code;
+  U64 tag;
+  bool has_children;
+  std::vector<DWARF_Attribute_Spec> attributes;
+};
+
+class DWARF_Abbreviation_Table {
+ public:
+  // Returns null if there is no abbreviation with the given code.
+  const DWARF_Abbreviation* find(U64 code) const {
+    if (code != 0 && code < this->dense_.size()) {
+      return &this->dense_[code];
+    }
+    for (const DWARF_Abbreviation& abbreviation : this->sparse_) {
+      if (abbreviation.code == code) {
+        return &abbreviation;
+      }
+    }
+    return nullptr;
+  }
+
+  void add(DWARF_Abbreviation&& abbreviation) {
+    if (this->dense_.empty()) {
+      this->dense_.emplace_back();  // Code 0 is reserved.
+    }
+    if (abbreviation.code == this->dense_.size()) {
+      this->dense_.push_back(std::move(abbreviation));
+    } else {
+      this->sparse_.push_back(std::move(abbreviation));
+    }
+  }
+
+ private:
+  // Compilers number abbreviations densely starting from 1, so usually every
+  // abbreviation is in dense_, and dense_[code].code == code.
+  std::vector<DWARF_Abbreviation> dense_;
+  std::vector<DWARF_Abbreviation> sparse_;
+};
+
+template <class Reader>
+DWARF_Abbreviation_Table parse_dwarf_abbreviations(const Reader& debug_abbrev,
+                                                   U64 offset) {
+  DWARF_Abbreviation_Table table;
+  for (;;) {
+    U64 code = read_uleb128(debug_abbrev, &offset);
+    if (code == 0) {
+      break;
+    }
+    DWARF_Abbreviation abbreviation;
+    abbreviation.code = code;
+    abbreviation.tag = read_uleb128(debug_abbrev, &offset);
+    abbreviation.has_children = debug_abbrev.u8(offset) != 0;
+    offset += 1;
+    for (;;) {
+      U64 name = read_uleb128(debug_abbrev, &offset);
+      U64 form = read_uleb128(debug_abbrev, &offset);
+      if (name == 0 && form == 0) {
+        break;
+      }
+      S64 implicit_const = 0;
+      if (form == DW_FORM_implicit_const) {
+        implicit_const = read_sleb128(debug_abbrev, &offset);
+      }
+      abbreviation.attributes.push_back(DWARF_Attribute_Spec{
+          .name = narrow_cast<U16>(name),
+          .form = narrow_cast<U16>(form),
+          .implicit_const = implicit_const,
+      });
+    }
+    table.add(std::move(abbreviation));
+  }
+  return table;
+}
+
+struct DWARF_Attribute_Value {
+  U16 form;
+  // Meaning depends on form. For example, for DW_FORM_string, this is the
+  // offset of the string in .debug_info. For DW_FORM_strp, this is the offset
+  // of the string in .debug_str. For DW_FORM_strx, this is the string index.
+  U64 value;
+};
+
+// The attributes of a debugging information entry which we care about.
+// Other attributes are skipped.
+struct DWARF_DIE {
+  // Offset relative to the beginning of .debug_info.
+  U64 offset;
+  // Offset of the next DIE, which is either this DIE's first child (if
+  // has_children) or this DIE's next sibling.
+  U64 next_offset;
+
+  // 0 if this entry is a null entry (ending a list of siblings).
+  U64 tag;
+  bool has_children;
+  bool is_declaration = false;
+
+  std::optional<DWARF_Attribute_Value> name;
+  std::optional<DWARF_Attribute_Value> low_pc;
+  std::optional<DWARF_Attribute_Value> high_pc;
+  std::optional<DWARF_Attribute_Value> ranges;
+  std::optional<DWARF_Attribute_Value> sibling;
+  std::optional<DWARF_Attribute_Value> specification;
+  std::optional<DWARF_Attribute_Value> abstract_origin;
+  std::optional<DWARF_Attribute_Value> stmt_list;
+  std::optional<DWARF_Attribute_Value> str_offsets_base;
+  std::optional<DWARF_Attribute_Value> addr_base;
+  std::optional<DWARF_Attribute_Value> rnglists_base;
+};
+
+// [begin, end) of some machine code.
+struct DWARF_Address_Range {
+  U64 begin;
+  U64 end;
+
+  friend bool operator==(const DWARF_Address_Range&,
+                         const DWARF_Address_Range&) = default;
+};
+
+// Reads debugging information entries from one unit.
+template <class Reader>
+class DWARF_Unit_Reader {
+ public:
+  explicit DWARF_Unit_Reader(const DWARF_Sections<Reader>* sections,
+                             const DWARF_Unit& unit)
+      : sections_(sections),
+        unit_(unit),
+        abbreviations_(parse_dwarf_abbreviations(sections->debug_abbrev,
+                                                 unit.abbrev_offset)) {
+    if (unit.dies_offset < unit.end_offset) {
+      DWARF_DIE unit_die = this->parse_die(unit.dies_offset);
+      if (unit_die.str_offsets_base.has_value()) {
+        this->str_offsets_base_ = unit_die.str_offsets_base->value;
+      }
+      if (unit_die.addr_base.has_value()) {
+        this->addr_base_ = unit_die.addr_base->value;
+      }
+      if (unit_die.rnglists_base.has_value()) {
+        this->rnglists_base_ = unit_die.rnglists_base->value;
+      }
+      if (unit_die.low_pc.has_value()) {
+        // NOTE(strager): get_address needs addr_base_, so read the base
+        // address after setting addr_base_.
+        this->base_address_ = this->get_address(*unit_die.low_pc).value_or(0);
+      }
+    }
+  }
+
+  const DWARF_Unit& unit() const { return this->unit_; }
+
+  Location locate(U64 offset) const {
+    return this->sections_->debug_info.locate(offset);
+  }
+
+  DWARF_DIE parse_die(U64 offset) const {
+    const Reader& info = this->sections_->debug_info;
+    DWARF_DIE die;
+    die.offset = offset;
+    U64 code = read_uleb128(info, &offset);
+    if (code == 0) {
+      die.next_offset = offset;
+      die.tag = 0;
+      die.has_children = false;
+      return die;
+    }
+    const DWARF_Abbreviation* abbreviation = this->abbreviations_.find(code);
+    if (abbreviation == nullptr) {
+      throw std::runtime_error("DWARF DIE has unknown abbreviation code");
+    }
+    die.tag = abbreviation->tag;
+    die.has_children = abbreviation->has_children;
+    for (const DWARF_Attribute_Spec& spec : abbreviation->attributes) {
+      DWARF_Attribute_Value value =
+          this->read_attribute_value(spec, &offset);
+      switch (spec.name) {
+        case DW_AT_name:
+          die.name = value;
+          break;
+        case DW_AT_low_pc:
+          die.low_pc = value;
+          break;
+        case DW_AT_high_pc:
+          die.high_pc = value;
+          break;
+        case DW_AT_ranges:
+          die.ranges = value;
+          break;
+        case DW_AT_sibling:
+          die.sibling = value;
+          break;
+        case DW_AT_specification:
+          die.specification = value;
+          break;
+        case DW_AT_abstract_origin:
+          die.abstract_origin = value;
+          break;
+        case DW_AT_declaration:
+          die.is_declaration = value.value != 0;
+          break;
+        case DW_AT_stmt_list:
+          die.stmt_list = value;
+          break;
+        case DW_AT_str_offsets_base:
+          die.str_offsets_base = value;
+          break;
+        case DW_AT_addr_base:
+          die.addr_base = value;
+          break;
+        case DW_AT_rnglists_base:
+          die.rnglists_base = value;
+          break;
+        default:
+          break;
+      }
+    }
+    die.next_offset = offset;
+    return die;
+  }
+
+  // Returns the .debug_info offset referenced by a reference attribute.
+  U64 get_reference(const DWARF_Attribute_Value& value) const {
+    switch (value.form) {
+      case DW_FORM_ref_addr:
+        return value.value;
+      default:
+        return this->unit_.header_offset + value.value;
+    }
+  }
+
+  std::optional<std::u8string> get_string(
+      const DWARF_Attribute_Value& value) const {
+    switch (value.form) {
+      case DW_FORM_string:
+        return this->sections_->debug_info.utf_8_c_string(value.value);
+      case DW_FORM_strp:
+        return this->sections_->debug_str.utf_8_c_string(value.value);
+      case DW_FORM_line_strp:
+        return this->sections_->debug_line_str.utf_8_c_string(value.value);
+      case DW_FORM_strx:
+      case DW_FORM_strx1:
+      case DW_FORM_strx2:
+      case DW_FORM_strx3:
+      case DW_FORM_strx4: {
+        U64 str_offset = read_dwarf_offset(
+            this->sections_->debug_str_offsets,
+            this->str_offsets_base_ + value.value * this->unit_.offset_size,
+            this->unit_.offset_size);
+        return this->sections_->debug_str.utf_8_c_string(str_offset);
+      }
+      default:
+        return std::nullopt;
+    }
+  }
+
+  std::optional<U64> get_address(const DWARF_Attribute_Value& value) const {
+    switch (value.form) {
+      case DW_FORM_addr:
+        return value.value;
+      case DW_FORM_addrx:
+      case DW_FORM_addrx1:
+      case DW_FORM_addrx2:
+      case DW_FORM_addrx3:
+      case DW_FORM_addrx4:
+        return this->get_indexed_address(value.value);
+      default:
+        return std::nullopt;
+    }
+  }
+
+  // Returns the address ranges referenced by a DW_AT_ranges attribute, in the
+  // order they are listed. Empty ranges are skipped.
+  //
+  // DWARF 2 through 4 range lists are read from .debug_ranges. DWARF 5 range
+  // lists are read from .debug_rnglists.
+  std::vector<DWARF_Address_Range> get_ranges(
+      const DWARF_Attribute_Value& value) const {
+    std::vector<DWARF_Address_Range> ranges;
+    auto add_range = [&](U64 begin, U64 end) -> void {
+      if (begin < end) {
+        ranges.push_back(DWARF_Address_Range{.begin = begin, .end = end});
+      }
+    };
+    U8 address_size = this->unit_.address_size;
+    U64 base_address = this->base_address_;
+
+    if (this->unit_.version < 5) {
+      const Reader& reader = this->sections_->debug_ranges;
+      U64 max_address =
+          address_size == 8 ? static_cast<U64>(-1) : U64{0xffffffff};
+      U64 offset = value.value;
+      for (;;) {
+        U64 begin = read_dwarf_address(reader, offset, address_size);
+        U64 end = read_dwarf_address(reader, offset + address_size,
+                                     address_size);
+        offset += address_size * 2;
+        if (begin == 0 && end == 0) {
+          break;
+        }
+        if (begin == max_address) {
+          base_address = end;
+          continue;
+        }
+        add_range(base_address + begin, base_address + end);
+      }
+      return ranges;
+    }
+
+    const Reader& reader = this->sections_->debug_rnglists;
+    U64 offset = value.value;
+    if (value.form == DW_FORM_rnglistx) {
+      offset = this->rnglists_base_ +
+               read_dwarf_offset(reader,
+                                 this->rnglists_base_ +
+                                     value.value * this->unit_.offset_size,
+                                 this->unit_.offset_size);
+    }
+    for (;;) {
+      U8 kind = reader.u8(offset);
+      offset += 1;
+      switch (kind) {
+        case DW_RLE_end_of_list:
+          return ranges;
+        case DW_RLE_base_addressx:
+          base_address =
+              this->get_indexed_address(read_uleb128(reader, &offset));
+          break;
+        case DW_RLE_startx_endx: {
+          U64 begin = this->get_indexed_address(read_uleb128(reader, &offset));
+          U64 end = this->get_indexed_address(read_uleb128(reader, &offset));
+          add_range(begin, end);
+          break;
+        }
+        case DW_RLE_startx_length: {
+          U64 begin = this->get_indexed_address(read_uleb128(reader, &offset));
+          U64 length = read_uleb128(reader, &offset);
+          add_range(begin, begin + length);
+          break;
+        }
+        case DW_RLE_offset_pair: {
+          U64 begin = read_uleb128(reader, &offset);
+          U64 end = read_uleb128(reader, &offset);
+          add_range(base_address + begin, base_address + end);
+          break;
+        }
+        case DW_RLE_base_address:
+          base_address = read_dwarf_address(reader, offset, address_size);
+          offset += address_size;
+          break;
+        case DW_RLE_start_end: {
+          U64 begin = read_dwarf_address(reader, offset, address_size);
+          U64 end = read_dwarf_address(reader, offset + address_size,
+                                       address_size);
+          offset += address_size * 2;
+          add_range(begin, end);
+          break;
+        }
+        case DW_RLE_start_length: {
+          U64 begin = read_dwarf_address(reader, offset, address_size);
+          offset += address_size;
+          U64 length = read_uleb128(reader, &offset);
+          add_range(begin, begin + length);
+          break;
+        }
+        default:
+          throw std::runtime_error(
+              fmt::format("unsupported DWARF range list entry: 0x{:x}", kind));
+      }
+    }
+  }
+
+ private:
+  DWARF_Attribute_Value read_attribute_value(const DWARF_Attribute_Spec& spec,
+                                             U64* offset) const {
+    const Reader& info = this->sections_->debug_info;
+    U16 form = spec.form;
+    U64 value = 0;
+    switch (form) {
+      case DW_FORM_addr:
+        value = read_dwarf_address(info, *offset, this->unit_.address_size);
+        *offset += this->unit_.address_size;
+        break;
+
+      case DW_FORM_data1:
+      case DW_FORM_ref1:
+      case DW_FORM_flag:
+      case DW_FORM_strx1:
+      case DW_FORM_addrx1:
+        value = info.u8(*offset);
+        *offset += 1;
+        break;
+
+      case DW_FORM_data2:
+      case DW_FORM_ref2:
+      case DW_FORM_strx2:
+      case DW_FORM_addrx2:
+        value = info.u16(*offset);
+        *offset += 2;
+        break;
+
+      case DW_FORM_strx3:
+      case DW_FORM_addrx3:
+        value = U64{info.u16(*offset)} | (U64{info.u8(*offset + 2)} << 16);
+        *offset += 3;
+        break;
+
+      case DW_FORM_data4:
+      case DW_FORM_ref4:
+      case DW_FORM_ref_sup4:
+      case DW_FORM_strx4:
+      case DW_FORM_addrx4:
+        value = info.u32(*offset);
+        *offset += 4;
+        break;
+
+      case DW_FORM_data8:
+      case DW_FORM_ref8:
+      case DW_FORM_ref_sig8:
+      case DW_FORM_ref_sup8:
+        value = info.u64(*offset);
+        *offset += 8;
+        break;
+
+      case DW_FORM_data16:
+        *offset += 16;
+        break;
+
+      case DW_FORM_sdata:
+        value = static_cast<U64>(read_sleb128(info, offset));
+        break;
+
+      case DW_FORM_udata:
+      case DW_FORM_ref_udata:
+      case DW_FORM_strx:
+      case DW_FORM_addrx:
+      case DW_FORM_loclistx:
+      case DW_FORM_rnglistx:
+        value = read_uleb128(info, offset);
+        break;
+
+      case DW_FORM_strp:
+      case DW_FORM_line_strp:
+      case DW_FORM_strp_sup:
+      case DW_FORM_sec_offset:
+        value = read_dwarf_offset(info, *offset, this->unit_.offset_size);
+        *offset += this->unit_.offset_size;
+        break;
+
+      case DW_FORM_ref_addr: {
+        // DWARF 2 uses the address size instead of the offset size.
+        U8 size = this->unit_.version <= 2 ? this->unit_.address_size
+                                           : this->unit_.offset_size;
+        value = read_dwarf_offset(info, *offset, size);
+        *offset += size;
+        break;
+      }
+
+      case DW_FORM_string: {
+        value = *offset;
+        std::optional<U64> end_offset = info.find_u8(0, *offset);
+        if (!end_offset.has_value()) {
+          throw C_String_Null_Terminator_Not_Found();
+        }
+        *offset = *end_offset + 1;
+        break;
+      }
+
+      case DW_FORM_block1:
+        value = *offset;
+        *offset += 1 + info.u8(*offset);
+        break;
+      case DW_FORM_block2:
+        value = *offset;
+        *offset += 2 + info.u16(*offset);
+        break;
+      case DW_FORM_block4:
+        value = *offset;
+        *offset += 4 + info.u32(*offset);
+        break;
+      case DW_FORM_block:
+      case DW_FORM_exprloc: {
+        value = *offset;
+        U64 size = read_uleb128(info, offset);
+        *offset += size;
+        break;
+      }
+
+      case DW_FORM_flag_present:
+        value = 1;
+        break;
+
+      case DW_FORM_implicit_const:
+        value = static_cast<U64>(spec.implicit_const);
+        break;
+
+      case DW_FORM_indirect: {
+        DWARF_Attribute_Spec indirect_spec = spec;
+        indirect_spec.form = narrow_cast<U16>(read_uleb128(info, offset));
+        return this->read_attribute_value(indirect_spec, offset);
+      }
+
+      default:
+        throw std::runtime_error(
+            fmt::format("unsupported DWARF form: 0x{:x}", form));
+    }
+    return DWARF_Attribute_Value{.form = form, .value = value};
+  }
+
+  const DWARF_Sections<Reader>* sections_;
+  DWARF_Unit unit_;
+  DWARF_Abbreviation_Table abbreviations_;
+  // Reads the index-th address in the unit's part of .debug_addr.
+  U64 get_indexed_address(U64 index) const {
+    return read_dwarf_address(
+        this->sections_->debug_addr,
+        this->addr_base_ + index * this->unit_.address_size,
+        this->unit_.address_size);
+  }
+
+  U64 str_offsets_base_ = 0;
+  U64 addr_base_ = 0;
+  U64 rnglists_base_ = 0;
+  // The unit's DW_AT_low_pc, which offsets in range lists are relative to.
+  U64 base_address_ = 0;
+};
+
+class DWARF_Line_Tables {
+ public:
+  struct Handle {
+    static constexpr U64 null_index = static_cast<U64>(-1);
+
+    U64 index;
+
+    static Handle null() { return Handle{.index = null_index}; }
+
+    bool is_null() const { return this->index == null_index; }
+  };
+
+  void clear() { this->tables_.clear(); }
+
+  // The line program is not parsed until source_info_for_address needs it.
+  //
+  // debug_line must remain valid.
+  Handle add_unit_line_table(Sub_File_Reader<Span_Reader> debug_line,
+                             U64 program_offset, U8 address_size) {
+    U64 index = this->tables_.size();
+    this->tables_.push_back(Table{
+        .debug_line = debug_line,
+        .program_offset = program_offset,
+        .address_size = address_size,
+        .rows = {},
+        .sequences = {},
+    });
+    return Handle{.index = index};
+  }
+
+  Line_Source_Info source_info_for_address(Handle handle, U64 address,
+                                           Logger& logger = fallback_logger);
+
+ private:
+  struct Row {
+    U64 address;
+    U32 line_number;
+    bool is_end_sequence;
+  };
+
+  struct Sequence {
+    U64 begin_row_index;
+    U64 end_row_index;  // Index of the DW_LNE_end_sequence row.
+  };
+
+  struct Table {
+    Sub_File_Reader<Span_Reader> debug_line;
+    U64 program_offset;
+    U8 address_size;
+
+    bool is_parsed = false;
+    std::vector<Row> rows;
+    std::vector<Sequence> sequences;
+  };
+
+  static void parse_table(Table&, Logger&);
+
+  std::vector<Table> tables_;
+};
+
+inline Line_Source_Info DWARF_Line_Tables::source_info_for_address(
+    Handle handle, U64 address, Logger& logger) {
+  CSS_ASSERT(!handle.is_null());
+  Table& table = this->tables_.at(handle.index);
+  if (!table.is_parsed) {
+    table.is_parsed = true;
+    try {
+      parse_table(table, logger);
+    } catch (Out_Of_Bounds_Read&) {
+      logger.log("line program is truncated",
+                 table.debug_line.locate(table.program_offset));
+    }
+  }
+  for (const Sequence& sequence : table.sequences) {
+    const Row* begin = &table.rows[sequence.begin_row_index];
+    const Row* end = &table.rows[sequence.end_row_index];
+    if (!(begin->address <= address && address < end->address)) {
+      continue;
+    }
+    const Row* next_row = std::upper_bound(
+        begin, end, address,
+        [](U64 address, const Row& row) { return address < row.address; });
+    CSS_ASSERT(next_row != begin);
+    return Line_Source_Info{.line_number = (next_row - 1)->line_number};
+  }
+  return Line_Source_Info::out_of_bounds();
+}
+
+inline void DWARF_Line_Tables::parse_table(Table& table, Logger& logger) {
+  const Sub_File_Reader<Span_Reader>& reader = table.debug_line;
+  U64 offset = table.program_offset;
+  U8 offset_size;
+  U64 unit_length = read_dwarf_initial_length(reader, &offset, &offset_size);
+  U64 end_offset = offset + unit_length;
+  U16 version = reader.u16(offset);
+  offset += 2;
+  if (version < 2 || version > 5) {
+    logger.log(fmt::format("unsupported line program version {}", version),
+               reader.locate(table.program_offset));
+    return;
+  }
+  U8 address_size = table.address_size;
+  if (version >= 5) {
+    address_size = reader.u8(offset);
+    offset += 2;  // Address size and segment selector size.
+  }
+  U64 header_length = read_dwarf_offset(reader, offset, offset_size);
+  offset += offset_size;
+  U64 program_offset = offset + header_length;
+  U8 minimum_instruction_length = reader.u8(offset);
+  offset += 1;
+  if (version >= 4) {
+    offset += 1;  // Maximum operations per instruction.
+  }
+  offset += 1;  // Default is_stmt.
+  S8 line_base = static_cast<S8>(reader.u8(offset));
+  U8 line_range = reader.u8(offset + 1);
+  U8 opcode_base = reader.u8(offset + 2);
+  offset += 3;
+  U64 standard_opcode_lengths_offset = offset;
+  if (line_range == 0) {
+    logger.log("line program has zero line range",
+               reader.locate(table.program_offset));
+    return;
+  }
+
+  // NOTE(strager): We don't need the include directory and file name tables
+  // (see TODO[line-table-file]), so skip them using header_length.
+  offset = program_offset;
+
+  U64 address = 0;
+  S64 line = 1;
+  U64 sequence_begin_row_index = table.rows.size();
+  auto emit_row = [&](bool is_end_sequence) -> void {
+    table.rows.push_back(Row{
+        .address = address,
+        .line_number = narrow_cast<U32>(line),
+        .is_end_sequence = is_end_sequence,
+    });
+    if (is_end_sequence) {
+      table.sequences.push_back(Sequence{
+          .begin_row_index = sequence_begin_row_index,
+          .end_row_index = table.rows.size() - 1,
+      });
+      sequence_begin_row_index = table.rows.size();
+      address = 0;
+      line = 1;
+    }
+  };
+
+  while (offset < end_offset) {
+    U8 opcode = reader.u8(offset);
+    offset += 1;
+    if (opcode >= opcode_base) {
+      U8 adjusted_opcode = opcode - opcode_base;
+      address += (adjusted_opcode / line_range) * minimum_instruction_length;
+      line += line_base + (adjusted_opcode % line_range);
+      emit_row(false);
+      continue;
+    }
+    switch (opcode) {
+      case 0: {
+        U64 size = read_uleb128(reader, &offset);
+        U64 extended_end_offset = offset + size;
+        if (size == 0) {
+          break;
+        }
+        U8 extended_opcode = reader.u8(offset);
+        switch (extended_opcode) {
+          case DW_LNE_end_sequence:
+            emit_row(true);
+            break;
+          case DW_LNE_set_address:
+            address = read_dwarf_address(reader, offset + 1, address_size);
+            break;
+          default:
+            break;
+        }
+        offset = extended_end_offset;
+        break;
+      }
+      case DW_LNS_copy:
+        emit_row(false);
+        break;
+      case DW_LNS_advance_pc:
+        address += read_uleb128(reader, &offset) * minimum_instruction_length;
+        break;
+      case DW_LNS_advance_line:
+        line += read_sleb128(reader, &offset);
+        break;
+      case DW_LNS_const_add_pc:
+        address += ((255 - opcode_base) / line_range) *
+                   minimum_instruction_length;
+        break;
+      case DW_LNS_fixed_advance_pc:
+        address += reader.u16(offset);
+        offset += 2;
+        break;
+      default: {
+        // Skip the opcode's operands, including those of DW_LNS_set_file,
+        // DW_LNS_set_column, DW_LNS_set_isa, and unknown opcodes.
+        U8 operand_count =
+            reader.u8(standard_opcode_lengths_offset + opcode - 1);
+        for (U8 i = 0; i < operand_count; ++i) {
+          read_uleb128(reader, &offset);
+        }
+        break;
+      }
+    }
+  }
+}
+
+// Stack frame information for one function, derived from call frame
+// information (.debug_frame or .eh_frame).
+struct DWARF_Frame {
+  U64 begin_address;
+  U64 size;
+  // Largest distance between the stack pointer and the canonical frame address
+  // (CFA) at any point in the function. The CFA is the stack pointer before
+  // the call instruction, so this includes the return address.
+  U64 max_cfa_offset_from_sp;
+  // If true, the CFA is computed from a register other than the stack pointer
+  // (typically the frame pointer) at some point in the function, so
+  // max_cfa_offset_from_sp might be too small.
+  bool uses_frame_pointer;
+};
+
+class DWARF_Frame_Table {
+ public:
+  // Returns null if no frame contains the given address.
+  const DWARF_Frame* find_frame(U64 address) const {
+    auto it = std::upper_bound(this->frames_.begin(), this->frames_.end(),
+                               address, [](U64 address, const DWARF_Frame& f) {
+                                 return address < f.begin_address;
+                               });
+    if (it == this->frames_.begin()) {
+      return nullptr;
+    }
+    --it;
+    if (address - it->begin_address >= it->size) {
+      return nullptr;
+    }
+    return &*it;
+  }
+
+  std::span<const DWARF_Frame> frames() const { return this->frames_; }
+
+  // Call after adding frames.
+  void sort() {
+    std::sort(this->frames_.begin(), this->frames_.end(),
+              [](const DWARF_Frame& a, const DWARF_Frame& b) {
+                return a.begin_address < b.begin_address;
+              });
+  }
+
+  void add_frame(const DWARF_Frame& frame) { this->frames_.push_back(frame); }
+
+ private:
+  std::vector<DWARF_Frame> frames_;
+};
+
+namespace detail {
+struct DWARF_CIE {
+  U64 code_alignment_factor;
+  S64 data_alignment_factor;
+  U8 address_size;
+  U8 pointer_encoding;
+  bool has_augmentation_data;
+  U64 instructions_offset;
+  U64 instructions_end_offset;
+};
+
+struct DWARF_CFA_State {
+  U64 cfa_register;
+  S64 cfa_offset;
+  bool cfa_is_expression;
+};
+
+// Reads a pointer encoded with DW_EH_PE_* flags. section_address is the
+// virtual address of the beginning of the section, used for DW_EH_PE_pcrel.
+template <class Reader>
+std::optional<U64> read_dwarf_encoded_pointer(const Reader& reader,
+                                              U64* offset, U8 encoding,
+                                              U64 section_address,
+                                              Logger& logger) {
+  U64 field_address = section_address + *offset;
+  U64 value;
+  switch (encoding & 0x0f) {
+    case DW_EH_PE_absptr:
+    case DW_EH_PE_udata8:
+    case DW_EH_PE_sdata8:
+      value = reader.u64(*offset);
+      *offset += 8;
+      break;
+    case DW_EH_PE_udata2:
+      value = reader.u16(*offset);
+      *offset += 2;
+      break;
+    case DW_EH_PE_sdata2:
+      value = static_cast<U64>(static_cast<S64>(
+          static_cast<S16>(reader.u16(*offset))));
+      *offset += 2;
+      break;
+    case DW_EH_PE_udata4:
+      value = reader.u32(*offset);
+      *offset += 4;
+      break;
+    case DW_EH_PE_sdata4:
+      value = static_cast<U64>(static_cast<S64>(
+          static_cast<S32>(reader.u32(*offset))));
+      *offset += 4;
+      break;
+    case DW_EH_PE_uleb128:
+      value = read_uleb128(reader, offset);
+      break;
+    case DW_EH_PE_sleb128:
+      value = static_cast<U64>(read_sleb128(reader, offset));
+      break;
+    default:
+      logger.log(fmt::format("unsupported pointer encoding: 0x{:x}", encoding),
+                 reader.locate(*offset));
+      return std::nullopt;
+  }
+  switch (encoding & 0x70) {
+    case 0x00:
+      return value;
+    case DW_EH_PE_pcrel:
+      return field_address + value;
+    default:
+      logger.log(fmt::format("unsupported pointer encoding: 0x{:x}", encoding),
+                 reader.locate(*offset));
+      return std::nullopt;
+  }
+}
+
+// Runs call frame instructions, updating *state and *frame. Returns false if
+// an instruction could not be interpreted.
+template <class Reader>
+bool run_dwarf_cfa_instructions(const Reader& reader, U64 offset,
+                                U64 end_offset, const DWARF_CIE& cie,
+                                U64 section_address,
+                                const DWARF_CFA_State& initial_state,
+                                DWARF_CFA_State* state,
+                                std::vector<DWARF_CFA_State>* state_stack,
+                                DWARF_Frame* frame, Logger& logger) {
+  auto update_frame = [&]() -> void {
+    if (state->cfa_is_expression || state->cfa_register != DW_X86_64_RSP) {
+      frame->uses_frame_pointer = true;
+    } else if (state->cfa_offset > 0) {
+      frame->max_cfa_offset_from_sp = std::max(
+          frame->max_cfa_offset_from_sp, static_cast<U64>(state->cfa_offset));
+    }
+  };
+  auto skip_block = [&]() -> void {
+    U64 size = read_uleb128(reader, &offset);
+    offset += size;
+  };
+
+  update_frame();
+  while (offset < end_offset) {
+    U64 instruction_offset = offset;
+    U8 opcode = reader.u8(offset);
+    offset += 1;
+    switch (opcode & 0xc0) {
+      case DW_CFA_advance_loc:
+      case DW_CFA_restore:
+        continue;
+      case DW_CFA_offset:
+        read_uleb128(reader, &offset);
+        continue;
+      default:
+        break;
+    }
+    switch (opcode) {
+      case DW_CFA_nop:
+        break;
+      case DW_CFA_set_loc:
+        if (cie.pointer_encoding != DW_EH_PE_omit) {
+          if (!read_dwarf_encoded_pointer(reader, &offset,
+                                          cie.pointer_encoding,
+                                          section_address, logger)
+                   .has_value()) {
+            return false;
+          }
+        } else {
+          offset += cie.address_size;
+        }
+        break;
+      case DW_CFA_advance_loc1:
+        offset += 1;
+        break;
+      case DW_CFA_advance_loc2:
+        offset += 2;
+        break;
+      case DW_CFA_advance_loc4:
+        offset += 4;
+        break;
+      case DW_CFA_offset_extended:
+      case DW_CFA_register:
+      case DW_CFA_val_offset:
+        read_uleb128(reader, &offset);
+        read_uleb128(reader, &offset);
+        break;
+      case DW_CFA_offset_extended_sf:
+      case DW_CFA_val_offset_sf:
+        read_uleb128(reader, &offset);
+        read_sleb128(reader, &offset);
+        break;
+      case DW_CFA_restore_extended:
+      case DW_CFA_undefined:
+      case DW_CFA_same_value:
+      case DW_CFA_GNU_args_size:
+        read_uleb128(reader, &offset);
+        break;
+      case DW_CFA_remember_state:
+        state_stack->push_back(*state);
+        break;
+      case DW_CFA_restore_state:
+        if (state_stack->empty()) {
+          *state = initial_state;
+        } else {
+          *state = state_stack->back();
+          state_stack->pop_back();
+        }
+        update_frame();
+        break;
+      case DW_CFA_def_cfa:
+        state->cfa_register = read_uleb128(reader, &offset);
+        state->cfa_offset = static_cast<S64>(read_uleb128(reader, &offset));
+        state->cfa_is_expression = false;
+        update_frame();
+        break;
+      case DW_CFA_def_cfa_sf:
+        state->cfa_register = read_uleb128(reader, &offset);
+        state->cfa_offset =
+            read_sleb128(reader, &offset) * cie.data_alignment_factor;
+        state->cfa_is_expression = false;
+        update_frame();
+        break;
+      case DW_CFA_def_cfa_register:
+        state->cfa_register = read_uleb128(reader, &offset);
+        state->cfa_is_expression = false;
+        update_frame();
+        break;
+      case DW_CFA_def_cfa_offset:
+        state->cfa_offset = static_cast<S64>(read_uleb128(reader, &offset));
+        update_frame();
+        break;
+      case DW_CFA_def_cfa_offset_sf:
+        state->cfa_offset =
+            read_sleb128(reader, &offset) * cie.data_alignment_factor;
+        update_frame();
+        break;
+      case DW_CFA_def_cfa_expression:
+        skip_block();
+        state->cfa_is_expression = true;
+        update_frame();
+        break;
+      case DW_CFA_expression:
+      case DW_CFA_val_expression:
+        read_uleb128(reader, &offset);
+        skip_block();
+        break;
+      default:
+        logger.log(
+            fmt::format("unsupported call frame instruction: 0x{:02x}", opcode),
+            reader.locate(instruction_offset));
+        return false;
+    }
+  }
+  return true;
+}
+}
+
+// Parses a .debug_frame (is_eh_frame=false) or .eh_frame (is_eh_frame=true)
+// section and adds the frames to *out.
+//
+// section_address is the section's virtual address, needed for .eh_frame's
+// PC-relative pointers.
+template <class Reader>
+void parse_dwarf_call_frame_information(const Reader& reader, bool is_eh_frame,
+                                        U64 section_address, U8 address_size,
+                                        DWARF_Frame_Table* out,
+                                        Logger& logger = fallback_logger) {
+  std::unordered_map<U64, detail::DWARF_CIE> cies;
+  auto parse_cie = [&](U64 cie_offset) -> const detail::DWARF_CIE* {
+    auto existing = cies.find(cie_offset);
+    if (existing != cies.end()) {
+      return &existing->second;
+    }
+    U64 offset = cie_offset;
+    U8 offset_size;
+    U64 length = read_dwarf_initial_length(reader, &offset, &offset_size);
+    U64 end_offset = offset + length;
+    offset += offset_size;  // CIE ID.
+    U8 version = reader.u8(offset);
+    offset += 1;
+    std::u8string augmentation = reader.utf_8_c_string(offset);
+    offset += augmentation.size() + 1;
+
+    detail::DWARF_CIE cie = {
+        .code_alignment_factor = 0,
+        .data_alignment_factor = 0,
+        .address_size = address_size,
+        .pointer_encoding =
+            narrow_cast<U8>(is_eh_frame ? DW_EH_PE_absptr : DW_EH_PE_omit),
+        .has_augmentation_data = false,
+        .instructions_offset = 0,
+        .instructions_end_offset = 0,
+    };
+    if (version >= 4) {
+      cie.address_size = reader.u8(offset);
+      offset += 2;  // Address size and segment selector size.
+    }
+    cie.code_alignment_factor = read_uleb128(reader, &offset);
+    cie.data_alignment_factor = read_sleb128(reader, &offset);
+    if (version == 1) {
+      offset += 1;  // Return address register.
+    } else {
+      read_uleb128(reader, &offset);  // Return address register.
+    }
+    if (!augmentation.empty() && augmentation[0] == u8'z') {
+      cie.has_augmentation_data = true;
+      U64 augmentation_size = read_uleb128(reader, &offset);
+      U64 augmentation_end_offset = offset + augmentation_size;
+      for (char8_t c : augmentation.substr(1)) {
+        switch (c) {
+          case u8'R':
+            cie.pointer_encoding = reader.u8(offset);
+            offset += 1;
+            break;
+          case u8'L':
+            offset += 1;  // LSDA encoding.
+            break;
+          case u8'P': {
+            U8 personality_encoding = reader.u8(offset);
+            offset += 1;
+            detail::read_dwarf_encoded_pointer(reader, &offset,
+                                               personality_encoding,
+                                               section_address, logger);
+            break;
+          }
+          default:
+            break;
+        }
+      }
+      offset = augmentation_end_offset;
+    } else if (!augmentation.empty()) {
+      logger.log(fmt::format("unsupported CIE augmentation: {}",
+                             u8string_to_string(augmentation)),
+                 reader.locate(cie_offset));
+      return nullptr;
+    }
+    cie.instructions_offset = offset;
+    cie.instructions_end_offset = end_offset;
+    return &cies.emplace(cie_offset, cie).first->second;
+  };
+
+  U64 offset = 0;
+  while (offset < reader.size()) {
+    U8 offset_size;
+    U64 length = read_dwarf_initial_length(reader, &offset, &offset_size);
+    if (length == 0) {
+      if (is_eh_frame) {
+        // Zero terminator.
+        break;
+      }
+      continue;
+    }
+    U64 end_offset = offset + length;
+    U64 id_offset = offset;
+    U64 id = read_dwarf_offset(reader, offset, offset_size);
+    offset += offset_size;
+    bool is_cie = is_eh_frame ? id == 0
+                              : id == (offset_size == 8 ? ~U64{0}
+                                                        : U64{0xffffffff});
+    if (is_cie) {
+      offset = end_offset;
+      continue;
+    }
+
+    U64 cie_offset = is_eh_frame ? id_offset - id : id;
+    const detail::DWARF_CIE* cie = parse_cie(cie_offset);
+    if (cie == nullptr) {
+      offset = end_offset;
+      continue;
+    }
+    std::optional<U64> begin_address;
+    std::optional<U64> size;
+    if (cie->pointer_encoding == DW_EH_PE_omit) {
+      begin_address = read_dwarf_address(reader, offset, cie->address_size);
+      size = read_dwarf_address(reader, offset + cie->address_size,
+                                cie->address_size);
+      offset += 2 * cie->address_size;
+    } else {
+      begin_address = detail::read_dwarf_encoded_pointer(
+          reader, &offset, cie->pointer_encoding, section_address, logger);
+      // The range is never PC-relative.
+      size = detail::read_dwarf_encoded_pointer(
+          reader, &offset, cie->pointer_encoding & 0x0f, section_address,
+          logger);
+    }
+    if (!begin_address.has_value() || !size.has_value()) {
+      offset = end_offset;
+      continue;
+    }
+    if (cie->has_augmentation_data) {
+      U64 augmentation_size = read_uleb128(reader, &offset);
+      offset += augmentation_size;
+    }
+
+    DWARF_Frame frame = {
+        .begin_address = *begin_address,
+        .size = *size,
+        .max_cfa_offset_from_sp = 0,
+        .uses_frame_pointer = false,
+    };
+    detail::DWARF_CFA_State state = {
+        .cfa_register = DW_X86_64_RSP,
+        .cfa_offset = 0,
+        .cfa_is_expression = false,
+    };
+    std::vector<detail::DWARF_CFA_State> state_stack;
+    bool ok = detail::run_dwarf_cfa_instructions(
+        reader, cie->instructions_offset, cie->instructions_end_offset, *cie,
+        section_address, state, &state, &state_stack, &frame, logger);
+    if (ok) {
+      detail::DWARF_CFA_State initial_state = state;
+      ok = detail::run_dwarf_cfa_instructions(
+          reader, offset, end_offset, *cie, section_address, initial_state,
+          &state, &state_stack, &frame, logger);
+    }
+    if (ok) {
+      out->add_frame(frame);
+    }
+    offset = end_offset;
+  }
+  out->sort();
+}
+
+// A function described by a DW_TAG_subprogram debugging information entry.
+struct DWARF_Function {
+  std::u8string name;
+  // Location of the DW_TAG_subprogram entry.
+  Location location;
+
+  U64 code_address;
+  U64 code_size;
+
+  // Bytes allocated by this function (pushes and stack pointer adjustments),
+  // excluding the return address pushed by the caller. -1 if unknown.
+  //
+  // If uses_frame_pointer, this only counts bytes described by call frame
+  // information. See get_self_stack_size.
+  U32 self_stack_size = static_cast<U32>(-1);
+
+  // Whether the function's call frame information switches the CFA to the
+  // frame pointer. After the switch, call frame information does not describe
+  // changes to the stack pointer.
+  bool uses_frame_pointer = false;
+
+  // Associated ELF file, if any.
+  ELF_File<Span_Reader>* elf_file = nullptr;
+
+  DWARF_Line_Tables::Handle line_tables_handle =
+      DWARF_Line_Tables::Handle::null();
+
+  // Returns null if no ELF file is associated with this function or if the
+  // function's code is not in the file.
+  std::optional<Sub_File_Reader<Span_Reader>> get_instruction_bytes_reader()
+      const {
+    if (this->elf_file == nullptr) {
+      return std::nullopt;
+    }
+    return this->elf_file->reader_for_address(this->code_address,
+                                              this->code_size);
+  }
+
+  // Returns self_stack_size. If uses_frame_pointer, also accounts for stack
+  // memory touched by the function's machine code (see
+  // analyze_x86_64_stack_map). This decodes the function's code, so it is
+  // much slower than reading self_stack_size.
+  U32 get_self_stack_size(Logger& logger = fallback_logger) const {
+    if (!this->uses_frame_pointer ||
+        this->self_stack_size == static_cast<U32>(-1)) {
+      return this->self_stack_size;
+    }
+    std::optional<Sub_File_Reader<Span_Reader>> code_reader =
+        this->get_instruction_bytes_reader();
+    if (!code_reader.has_value()) {
+      logger.log("function's code is not in the file; cannot compute stack "
+                 "size of function using a frame pointer",
+                 this->location);
+      return this->self_stack_size;
+    }
+    std::vector<U8> code(code_reader->size());
+    code_reader->copy_bytes_into(code, 0);
+    return narrow_cast<U32>(
+        std::max(U64{this->self_stack_size},
+                 analyze_x86_64_stack_map(code).touched_stack_size()));
+  }
+};
+
+namespace detail {
+// Follows DW_AT_specification and DW_AT_abstract_origin to find a function's
+// name.
+template <class Reader>
+std::optional<std::u8string> get_dwarf_die_name(
+    const DWARF_Unit_Reader<Reader>& unit_reader, const DWARF_DIE& die) {
+  const DWARF_DIE* current = &die;
+  DWARF_DIE referenced_die;
+  for (int depth = 0; depth < 8; ++depth) {
+    if (current->name.has_value()) {
+      return unit_reader.get_string(*current->name);
+    }
+    const std::optional<DWARF_Attribute_Value>& reference =
+        current->specification.has_value() ? current->specification
+                                           : current->abstract_origin;
+    if (!reference.has_value()) {
+      return std::nullopt;
+    }
+    if (reference->form == DW_FORM_ref_addr) {
+      // TODO(strager): Support references to other units.
+      return std::nullopt;
+    }
+    referenced_die = unit_reader.parse_die(unit_reader.get_reference(*reference));
+    current = &referenced_die;
+  }
+  return std::nullopt;
+}
+}
+
+// Finds all functions with code in the given unit.
+//
+// Children of functions (parameters, local variables, lexical blocks, etc.)
+// are skipped using DW_AT_sibling if possible.
+//
+// If line_tables is not null, the unit's line table is added to it.
+template <class Reader>
+void find_dwarf_functions_in_unit(const DWARF_Sections<Reader>& sections,
+                                  const DWARF_Unit& unit,
+                                  std::vector<DWARF_Function>& out_functions,
+                                  DWARF_Line_Tables* line_tables,
+                                  Logger& logger = fallback_logger) {
+  DWARF_Unit_Reader<Reader> unit_reader(&sections, unit);
+
+  U64 offset = unit.dies_offset;
+  DWARF_Line_Tables::Handle line_tables_handle =
+      DWARF_Line_Tables::Handle::null();
+  if (offset < unit.end_offset && line_tables != nullptr) {
+    DWARF_DIE unit_die = unit_reader.parse_die(offset);
+    if (unit_die.stmt_list.has_value()) {
+      line_tables_handle = line_tables->add_unit_line_table(
+          sections.debug_line, unit_die.stmt_list->value, unit.address_size);
+    }
+  }
+
+  while (offset < unit.end_offset) {
+    DWARF_DIE die = unit_reader.parse_die(offset);
+    offset = die.next_offset;
+    if (die.tag != DW_TAG_subprogram || die.is_declaration) {
+      continue;
+    }
+
+    auto add_function = [&](U64 code_address, U64 code_size) -> void {
+      std::optional<std::u8string> name =
+          detail::get_dwarf_die_name(unit_reader, die);
+      out_functions.push_back(DWARF_Function{
+          .name = name.has_value() ? std::move(*name) : u8"<unnamed>",
+          .location = unit_reader.locate(die.offset),
+          .code_address = code_address,
+          .code_size = code_size,
+          .line_tables_handle = line_tables_handle,
+      });
+    };
+    if (die.low_pc.has_value() && die.high_pc.has_value()) {
+      std::optional<U64> low_pc = unit_reader.get_address(*die.low_pc);
+      std::optional<U64> high_pc = unit_reader.get_address(*die.high_pc);
+      if (low_pc.has_value()) {
+        // In DWARF 4 and newer, a non-address high_pc is a size.
+        add_function(*low_pc, high_pc.has_value() ? *high_pc - *low_pc
+                                                  : die.high_pc->value);
+      }
+    } else if (die.ranges.has_value()) {
+      std::vector<DWARF_Address_Range> ranges =
+          unit_reader.get_ranges(*die.ranges);
+      if (ranges.empty()) {
+        logger.log("function has no code ranges; ignoring",
+                   unit_reader.locate(die.offset));
+      } else {
+        // NOTE(strager): With hot/cold splitting, GCC and Clang list the part
+        // containing the function's entry point first. Other parts (such as
+        // GCC's foo.cold) run in the entry part's frame, so they do not change
+        // the function's stack size.
+        //
+        // TODO(strager): Report the other parts' code too (e.g. for
+        // Function_Address_Index).
+        add_function(ranges[0].begin, ranges[0].end - ranges[0].begin);
+      }
+    }
+
+    if (die.has_children && die.sibling.has_value()) {
+      offset = unit_reader.get_reference(*die.sibling);
+    }
+  }
+}
+
+// Finds all functions in an ELF file's DWARF debug information, and fills in
+// their stack sizes from call frame information.
+//
+// Stack sizes of functions which use a frame pointer are not computed from
+// their machine code. Call DWARF_Function::get_self_stack_size when needed.
+template <class Reader>
+void find_all_dwarf_functions(ELF_File<Reader>& elf,
+                              std::vector<DWARF_Function>& out_functions,
+                              DWARF_Line_Tables* line_tables,
+                              Logger& logger = fallback_logger) {
+  DWARF_Sections<Sub_File_Reader<Reader>> sections = find_dwarf_sections(elf);
+  U64 begin_function_index = out_functions.size();
+  for (const DWARF_Unit& unit :
+       parse_dwarf_unit_headers(sections.debug_info, logger)) {
+    if (unit.unit_type != DW_UT_compile && unit.unit_type != DW_UT_partial) {
+      continue;
+    }
+    try {
+      find_dwarf_functions_in_unit(sections, unit, out_functions, line_tables,
+                                   logger);
+    } catch (Out_Of_Bounds_Read&) {
+      logger.log("unit is truncated",
+                 sections.debug_info.locate(unit.header_offset));
+    } catch (std::runtime_error& e) {
+      logger.log(e.what(), sections.debug_info.locate(unit.header_offset));
+    }
+  }
+
+  DWARF_Frame_Table frames;
+  if (const ELF_Section* section = elf.find_section_by_name(u8".debug_frame")) {
+    parse_dwarf_call_frame_information(elf.reader_for_section(*section),
+                                       /*is_eh_frame=*/false, section->address,
+                                       /*address_size=*/8, &frames, logger);
+  }
+  if (const ELF_Section* section = elf.find_section_by_name(u8".eh_frame")) {
+    parse_dwarf_call_frame_information(elf.reader_for_section(*section),
+                                       /*is_eh_frame=*/true, section->address,
+                                       /*address_size=*/8, &frames, logger);
+  }
+
+  for (U64 i = begin_function_index; i < out_functions.size(); ++i) {
+    DWARF_Function& func = out_functions[i];
+    const DWARF_Frame* frame = frames.find_frame(func.code_address);
+    if (frame == nullptr || frame->max_cfa_offset_from_sp < 8) {
+      continue;
+    }
+    func.self_stack_size =
+        narrow_cast<U32>(frame->max_cfa_offset_from_sp - 8);
+    func.uses_frame_pointer = frame->uses_frame_pointer;
+  }
+}
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/reader.h>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Documentation:
+// https://refspecs.linuxfoundation.org/elf/gabi4+/ch4.eheader.html
+
+enum {
+  ELF_SHT_NOBITS = 8,
+};
+
+namespace cppstacksize {
+class ELF_Magic_Mismatch_Error : public std::exception {
+ public:
+  const char* what() const noexcept override { return "ELF magic mismatched"; }
+};
+
+struct ELF_Section {
+  std::u8string name;
+  U32 type;
+  U64 flags;
+  U64 address;
+  U64 data_file_offset;
+  U64 data_size;
+};
+
+// A Linux ELF executable, shared object, or relocatable object file.
+//
+// Only 64-bit little-endian x86-64 files are supported.
+template <class Reader>
+struct ELF_File {
+  const Reader* reader;
+  std::vector<ELF_Section> sections;
+
+  explicit ELF_File(const Reader* reader) : reader(reader) {}
+
+  // Returns null if there is no section with the given name.
+  const ELF_Section* find_section_by_name(
+      std::u8string_view section_name) const {
+    for (const ELF_Section& section : this->sections) {
+      if (section.name == section_name) {
+        return &section;
+      }
+    }
+    return nullptr;
+  }
+
+  // Returns null if there is no section with the given name.
+  std::optional<Sub_File_Reader<Reader>> find_section_reader_by_name(
+      std::u8string_view section_name) const {
+    const ELF_Section* section = this->find_section_by_name(section_name);
+    if (section == nullptr) {
+      return std::nullopt;
+    }
+    return this->reader_for_section(*section);
+  }
+
+  // Returns the section containing the given virtual address, or null if there
+  // is no such section.
+  const ELF_Section* find_section_by_address(U64 address) const {
+    for (const ELF_Section& section : this->sections) {
+      if (section.address != 0 && section.type != ELF_SHT_NOBITS &&
+          section.address <= address &&
+          address - section.address < section.data_size) {
+        return &section;
+      }
+    }
+    return nullptr;
+  }
+
+  Sub_File_Reader<Reader> reader_for_section(
+      const ELF_Section& section) const {
+    if (section.type == ELF_SHT_NOBITS) {
+      return Sub_File_Reader<Reader>(this->reader, 0, 0);
+    }
+    return Sub_File_Reader<Reader>(this->reader, section.data_file_offset,
+                                   section.data_size);
+  }
+
+  // Returns null if the given range is not entirely within one section.
+  std::optional<Sub_File_Reader<Reader>> reader_for_address(U64 address,
+                                                            U64 size) const {
+    const ELF_Section* section = this->find_section_by_address(address);
+    if (section == nullptr) {
+      return std::nullopt;
+    }
+    U64 offset_in_section = address - section->address;
+    if (size > section->data_size - offset_in_section) {
+      return std::nullopt;
+    }
+    return Sub_File_Reader<Reader>(
+        this->reader, section->data_file_offset + offset_in_section, size);
+  }
+};
+
+template <class Reader>
+inline bool is_elf_file(const Reader& reader) {
+  return reader.size() >= 4 && reader.u32(0) == 0x464c457f;  // "\x7fELF"
+}
+
+template <class Reader>
+inline ELF_File<Reader> parse_elf_file(const Reader* reader) {
+  if (!is_elf_file(*reader)) {
+    throw ELF_Magic_Mismatch_Error();
+  }
+  U8 elf_class = reader->u8(4);
+  if (elf_class != 2) {
+    throw std::runtime_error("unsupported ELF class; expected 64-bit");
+  }
+  U8 elf_data = reader->u8(5);
+  if (elf_data != 1) {
+    throw std::runtime_error("unsupported ELF byte order; expected LSB");
+  }
+  U16 machine = reader->u16(18);
+  if (machine != 62) {
+    throw std::runtime_error("unsupported ELF machine; expected x86-64");
+  }
+
+  ELF_File<Reader> elf(reader);
+  U64 section_header_table_offset = reader->u64(0x28);
+  U64 section_header_size = reader->u16(0x3a);
+  U64 section_count = reader->u16(0x3c);
+  U64 section_names_section_index = reader->u16(0x3e);
+  if (section_count == 0 && section_header_table_offset != 0) {
+    // The real count is in the first section header's sh_size.
+    section_count = reader->u64(section_header_table_offset + 0x20);
+  }
+  if (section_names_section_index == 0xffff) {
+    // SHN_XINDEX: The real index is in the first section header's sh_link.
+    section_names_section_index =
+        reader->u32(section_header_table_offset + 0x28);
+  }
+
+  std::vector<U32> name_offsets;
+  for (U64 section_index = 0; section_index < section_count;
+       ++section_index) {
+    U64 offset =
+        section_header_table_offset + section_index * section_header_size;
+    name_offsets.push_back(reader->u32(offset + 0x00));
+    elf.sections.push_back(ELF_Section{
+        .name = u8"",
+        .type = reader->u32(offset + 0x04),
+        .flags = reader->u64(offset + 0x08),
+        .address = reader->u64(offset + 0x10),
+        .data_file_offset = reader->u64(offset + 0x18),
+        .data_size = reader->u64(offset + 0x20),
+    });
+  }
+
+  if (section_names_section_index < elf.sections.size()) {
+    Sub_File_Reader<Reader> names_reader =
+        elf.reader_for_section(elf.sections[section_names_section_index]);
+    for (U64 section_index = 0; section_index < elf.sections.size();
+         ++section_index) {
+      elf.sections[section_index].name =
+          names_reader.utf_8_c_string(name_offsets[section_index]);
+    }
+  }
+
+  return elf;
+}
+}
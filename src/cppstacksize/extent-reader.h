@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cppstacksize/base.h>
+#include <cppstacksize/pdb-reader.h>
+#include <cppstacksize/reader.h>
+#include <cstring>
+#include <optional>
+#include <span>
+
+namespace cppstacksize {
+// Reads bytes of a file which are either contiguous (such as a COFF section)
+// or split into equally-sized blocks (such as a PDB stream).
+//
+// Unlike Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>, an Extent_Reader
+// reads directly from the file's bytes without going through other readers.
+// One type works for both layouts, so code which accepts either layout does
+// not need templates or std::variant.
+//
+// An Extent_Reader does not own the file's bytes nor the block list. Like
+// Sub_File_Reader, the reader it was created from must outlive it.
+class Extent_Reader : public Reader_Base<Extent_Reader> {
+ public:
+  /*implicit*/ Extent_Reader(const Span_Reader& reader)
+      : Extent_Reader(&reader, reader.data(), 0, reader.size()) {}
+
+  /*implicit*/ Extent_Reader(const Sub_File_Reader<Span_Reader>& reader)
+      : Extent_Reader(reader.base_reader(), reader.base_reader()->data(),
+                      reader.sub_file_offset(), reader.size()) {}
+
+  /*implicit*/ Extent_Reader(const PDB_Blocks_Reader<Span_Reader>& reader)
+      : Extent_Reader(reader, 0, reader.size()) {}
+
+  /*implicit*/ Extent_Reader(
+      const Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>& reader)
+      : Extent_Reader(*reader.base_reader(), reader.sub_file_offset(),
+                      reader.size()) {}
+
+  // The reader this reader was created from: a Span_Reader or a
+  // PDB_Blocks_Reader<Span_Reader>. Useful for identity comparisons only.
+  const void* base_reader() const { return this->base_reader_; }
+  // The bytes of the whole file, including bytes outside this reader (such as
+  // other PDB streams). Useful for identity comparisons only.
+  const U8* file_data() const { return this->file_data_.data(); }
+  // Offset of this reader's first byte within base_reader().
+  U64 sub_file_offset() const { return this->sub_file_offset_; }
+  U64 size() const { return this->size_; }
+
+  // If true, the bytes are not split into blocks, and
+  // locate(offset).file_offset == sub_file_offset() + offset.
+  bool is_contiguous() const { return this->block_indexes_.empty(); }
+
+  Extent_Reader sub_reader(U64 offset) const {
+    return this->sub_reader(offset,
+                            this->size_ - std::min(offset, this->size_));
+  }
+
+  Extent_Reader sub_reader(U64 offset, U64 size) const {
+    // NOTE(strager): Match Sub_File_Reader, which clamps the size.
+    Extent_Reader result = *this;
+    result.sub_file_offset_ = this->sub_file_offset_ + offset;
+    result.size_ =
+        offset >= this->size_ ? 0 : std::min(size, this->size_ - offset);
+    return result;
+  }
+
+  Location locate(U64 offset) const {
+    U64 base_offset = this->sub_file_offset_ + offset;
+    if (this->is_contiguous()) {
+      return Location{.file_offset = base_offset};
+    }
+    U64 block_index_index = this->block_index_index(base_offset);
+    U64 file_offset =
+        block_index_index < this->block_indexes_.size()
+            ? this->block_file_offset(block_index_index) +
+                  this->offset_in_block(base_offset)
+            : 0;
+    return Location{
+        .file_offset = file_offset,
+        .stream_index = this->stream_index_,
+        .stream_offset = narrow_cast<U32>(base_offset),
+    };
+  }
+
+  // Returns the bytes starting at offset which are contiguous in the file: up
+  // to the end of offset's block or the end of this reader, whichever is first.
+  //
+  // Returns an empty span if offset is out of bounds.
+  std::span<const U8> contiguous_bytes(U64 offset) const {
+    if (offset >= this->size_) {
+      return std::span<const U8>();
+    }
+    U64 base_offset = this->sub_file_offset_ + offset;
+    U64 size = this->size_ - offset;
+    U64 file_offset = base_offset;
+    if (!this->is_contiguous()) {
+      U64 block_index_index = this->block_index_index(base_offset);
+      if (block_index_index >= this->block_indexes_.size()) {
+        return std::span<const U8>();
+      }
+      U64 offset_in_block = this->offset_in_block(base_offset);
+      file_offset =
+          this->block_file_offset(block_index_index) + offset_in_block;
+      size = std::min(size, this->block_size_ - offset_in_block);
+    }
+    if (file_offset >= this->file_data_.size()) {
+      return std::span<const U8>();
+    }
+    return this->file_data_.subspan(
+        file_offset, std::min(size, this->file_data_.size() - file_offset));
+  }
+
+  U8 u8(U64 offset) const {
+    this->check_bounds(offset, 1);
+    return *this->file_bytes(this->sub_file_offset_ + offset, 1);
+  }
+
+  U16 u16(U64 offset) const { return this->read_integer<U16>(offset); }
+  U32 u32(U64 offset) const { return this->read_integer<U32>(offset); }
+
+  std::optional<U64> find_u8(U8 b, U64 offset) const {
+    return this->find_u8(b, offset, this->size_);
+  }
+
+  std::optional<U64> find_u8(U8 b, U64 offset, U64 end_offset) const {
+    end_offset = std::min(end_offset, this->size_);
+    if (offset >= end_offset) {
+      return std::nullopt;
+    }
+    std::optional<U64> result = std::nullopt;
+    U64 chunk_offset = offset;
+    this->enumerate_bytes(offset, end_offset - offset,
+                          [&](std::span<const U8> chunk) -> void {
+                            if (result.has_value()) {
+                              return;
+                            }
+                            const U8* found = static_cast<const U8*>(
+                                std::memchr(chunk.data(), b, chunk.size()));
+                            if (found != nullptr) {
+                              result = chunk_offset + (found - chunk.data());
+                            }
+                            chunk_offset += chunk.size();
+                          });
+    return result;
+  }
+
+  template <class Callback>
+  void enumerate_bytes(U64 offset, U64 size, Callback callback) const {
+    this->check_bounds(offset, size);
+    U64 base_offset = this->sub_file_offset_ + offset;
+    if (this->is_contiguous()) {
+      callback(std::span<const U8>(this->file_bytes(base_offset, size), size));
+      return;
+    }
+    while (size > 0) {
+      U64 chunk_size = std::min(
+          size, U64{this->block_size_} - this->offset_in_block(base_offset));
+      callback(std::span<const U8>(this->file_bytes(base_offset, chunk_size),
+                                   chunk_size));
+      base_offset += chunk_size;
+      size -= chunk_size;
+    }
+  }
+
+ private:
+  explicit Extent_Reader(const void* base_reader,
+                         std::span<const U8> file_data, U64 sub_file_offset,
+                         U64 size)
+      : file_data_(file_data),
+        base_reader_(base_reader),
+        sub_file_offset_(sub_file_offset),
+        size_(size) {}
+
+  explicit Extent_Reader(const PDB_Blocks_Reader<Span_Reader>& stream,
+                         U64 sub_file_offset, U64 size)
+      : file_data_(stream.base_reader()->data()),
+        block_indexes_(stream.blocks()),
+        base_reader_(&stream),
+        sub_file_offset_(sub_file_offset),
+        size_(size),
+        block_size_(stream.block_size()),
+        block_shift_(std::has_single_bit(stream.block_size())
+                         ? std::countr_zero(stream.block_size())
+                         : 0),
+        stream_index_(stream.stream_index()) {}
+
+  U64 block_index_index(U64 base_offset) const {
+    return this->block_shift_ != 0 ? base_offset >> this->block_shift_
+                                   : base_offset / this->block_size_;
+  }
+
+  U64 offset_in_block(U64 base_offset) const {
+    return this->block_shift_ != 0 ? base_offset & (this->block_size_ - 1)
+                                   : base_offset % this->block_size_;
+  }
+
+  U64 block_file_offset(U64 block_index_index) const {
+    return U64{this->block_indexes_[block_index_index]} * this->block_size_;
+  }
+
+  // Returns a pointer to size bytes starting at base_offset.
+  //
+  // Precondition: the bytes are in one block.
+  const U8* file_bytes(U64 base_offset, U64 size) const {
+    U64 file_offset = base_offset;
+    if (!this->is_contiguous()) {
+      U64 block_index_index = this->block_index_index(base_offset);
+      if (block_index_index >= this->block_indexes_.size()) {
+        throw Out_Of_Bounds_Read();
+      }
+      file_offset = this->block_file_offset(block_index_index) +
+                    this->offset_in_block(base_offset);
+    }
+    if (file_offset > this->file_data_.size() ||
+        size > this->file_data_.size() - file_offset) {
+      throw Out_Of_Bounds_Read();
+    }
+    return this->file_data_.data() + file_offset;
+  }
+
+  template <class Integer>
+  Integer read_integer(U64 offset) const {
+    this->check_bounds(offset, sizeof(Integer));
+    U64 base_offset = this->sub_file_offset_ + offset;
+    U8 bytes[sizeof(Integer)];
+    if (this->is_contiguous() || this->offset_in_block(base_offset) +
+                                         sizeof(Integer) <=
+                                     this->block_size_) {
+      std::memcpy(bytes, this->file_bytes(base_offset, sizeof(Integer)),
+                  sizeof(Integer));
+    } else {
+      // The integer straddles two blocks.
+      for (U64 i = 0; i < sizeof(Integer); ++i) {
+        bytes[i] = *this->file_bytes(base_offset + i, 1);
+      }
+    }
+    Integer result = 0;
+    for (U64 i = 0; i < sizeof(Integer); ++i) {
+      result |= static_cast<Integer>(Integer{bytes[i]} << (i * 8));
+    }
+    return result;
+  }
+
+  std::span<const U8> file_data_;
+  // Empty if the bytes are contiguous.
+  std::span<const U32> block_indexes_;
+  const void* base_reader_;
+  U64 sub_file_offset_;
+  U64 size_;
+  U32 block_size_ = 0;
+  // log2(block_size_), or 0 if block_size_ is not a power of two.
+  U32 block_shift_ = 0;
+  std::optional<U32> stream_index_ = std::nullopt;
+};
+}
@@ -19,6 +19,10 @@ Loaded_File Loaded_File::load(const char* path) {
   return Loaded_File(std::move(data_stream).str());
 }
 
+Loaded_File Loaded_File::from_bytes(std::span<const U8> data) {
+  return Loaded_File(std::string(data.begin(), data.end()));
+}
+
 std::span<const U8> Loaded_File::data() const noexcept {
   return std::span<const U8>(reinterpret_cast<const U8*>(this->data_.data()),
                              this->data_.size());
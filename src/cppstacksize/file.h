@@ -8,6 +8,8 @@ namespace cppstacksize {
 class Loaded_File {
  public:
   static Loaded_File load(const char* path);
+  // Copies the given bytes.
+  static Loaded_File from_bytes(std::span<const U8> data);
 
   Loaded_File(const Loaded_File&) = delete;
   Loaded_File& operator=(const Loaded_File&) = delete;
@@ -0,0 +1,9 @@
+#include <cppstacksize/frame-shrink.h>
+#include <ostream>
+
+namespace cppstacksize {
+std::ostream& operator<<(std::ostream& out, const Stack_Byte_Range& range) {
+  out << '[' << range.begin << ", " << range.end << ')';
+  return out;
+}
+}
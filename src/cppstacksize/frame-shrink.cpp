@@ -0,0 +1,655 @@
+#include <algorithm>
+#include <atomic>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/base.h>
+#include <cppstacksize/codeview-constants.h>
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/frame-shrink.h>
+#include <cppstacksize/function-address-index.h>
+#include <cppstacksize/pe.h>
+#include <cppstacksize/reader.h>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+// Sorts ranges then combines overlapping and adjacent ranges.
+void merge_ranges(std::vector<Stack_Byte_Range>& ranges) {
+  std::sort(ranges.begin(), ranges.end(),
+            [](const Stack_Byte_Range& a, const Stack_Byte_Range& b) -> bool {
+              return a.begin < b.begin;
+            });
+  U64 merged_count = 0;
+  for (const Stack_Byte_Range& range : ranges) {
+    if (merged_count != 0 && range.begin <= ranges[merged_count - 1].end) {
+      Stack_Byte_Range& last = ranges[merged_count - 1];
+      last.end = std::max(last.end, range.end);
+    } else {
+      ranges[merged_count] = range;
+      merged_count += 1;
+    }
+  }
+  ranges.resize(merged_count);
+}
+
+// Returns the number of bytes of range covered by merged_ranges.
+//
+// Precondition: merged_ranges was processed by merge_ranges.
+U64 count_covered_bytes(std::span<const Stack_Byte_Range> merged_ranges,
+                        Stack_Byte_Range range) {
+  auto it = std::upper_bound(
+      merged_ranges.begin(), merged_ranges.end(), range.begin,
+      [](S64 address, const Stack_Byte_Range& r) -> bool {
+        return address < r.end;
+      });
+  U64 covered = 0;
+  for (; it != merged_ranges.end() && it->begin < range.end; ++it) {
+    S64 begin = std::max(it->begin, range.begin);
+    S64 end = std::min(it->end, range.end);
+    covered += static_cast<U64>(end - begin);
+  }
+  return covered;
+}
+
+bool ranges_overlap(const Stack_Byte_Range& a, const Stack_Byte_Range& b) {
+  return a.begin < b.end && b.begin < a.end;
+}
+
+// Inclusive range of instruction offsets.
+struct Live_Range {
+  U32 first;
+  U32 last;
+
+  bool overlaps(const Live_Range& other) const {
+    return this->first <= other.last && other.first <= this->last;
+  }
+};
+
+// Slots which overlap each other (and thus already share storage).
+struct Storage_Unit {
+  Stack_Byte_Range range;
+  Live_Range live_range;
+  // Indexes into the slots given to analyze_frame_shrink.
+  std::vector<U32> slot_indexes;
+  // Number of touched bytes in range.
+  U64 used_byte_count;
+};
+
+// A group of Storage_Unit-s with disjoint live ranges which could be placed at
+// the same address.
+struct Storage_Bin {
+  U64 byte_size;
+  std::vector<Live_Range> live_ranges;
+};
+
+// Computes how many bytes would be saved if Storage_Unit-s with disjoint live
+// ranges shared storage.
+//
+// NOTE(strager): Finding the best assignment is NP-hard. Placing the largest
+// units first is a good approximation.
+U64 compute_sharing_savings(std::span<const Storage_Unit> units) {
+  std::vector<const Storage_Unit*> sorted_units;
+  sorted_units.reserve(units.size());
+  for (const Storage_Unit& unit : units) {
+    sorted_units.push_back(&unit);
+  }
+  std::stable_sort(sorted_units.begin(), sorted_units.end(),
+                   [](const Storage_Unit* a, const Storage_Unit* b) -> bool {
+                     return a->used_byte_count > b->used_byte_count;
+                   });
+
+  U64 total_used_byte_count = 0;
+  std::vector<Storage_Bin> bins;
+  for (const Storage_Unit* unit : sorted_units) {
+    total_used_byte_count += unit->used_byte_count;
+    auto bin_it = std::find_if(
+        bins.begin(), bins.end(), [&](const Storage_Bin& bin) -> bool {
+          return std::none_of(bin.live_ranges.begin(), bin.live_ranges.end(),
+                              [&](const Live_Range& live_range) -> bool {
+                                return live_range.overlaps(unit->live_range);
+                              });
+        });
+    if (bin_it == bins.end()) {
+      bins.push_back(Storage_Bin{.byte_size = unit->used_byte_count,
+                                 .live_ranges = {}});
+      bin_it = bins.end() - 1;
+    }
+    // NOTE(strager): Units are sorted by size, so the bin's first unit is its
+    // largest.
+    bin_it->live_ranges.push_back(unit->live_range);
+  }
+
+  U64 total_bin_byte_size = 0;
+  for (const Storage_Bin& bin : bins) {
+    total_bin_byte_size += bin.byte_size;
+  }
+  return total_used_byte_count - total_bin_byte_size;
+}
+
+// A function to analyze in rank_frame_shrink_opportunities.
+struct Frame_Shrink_Job {
+  U64 function_index;
+  std::span<const U8> code;
+  // See CodeView_Function::code_file.
+  const void* code_file;
+  CodeView_Code_Location code_location;
+  U64 frame_size;
+  std::vector<Stack_Slot> slots;
+};
+
+// Returns null if the function has no machine code.
+std::optional<Frame_Shrink_Job> make_frame_shrink_job(
+    const CodeView_Function_Table& functions, U64 function_index,
+    CodeView_Type_Table* type_table, Logger& logger) {
+  CodeView_Function function = functions[function_index];
+  std::optional<CodeView_Code_Location> code_location =
+      function.get_code_location(logger);
+  std::optional<Sub_File_Reader<Span_Reader>> code_reader =
+      function.get_instruction_bytes_reader(logger);
+  if (!code_location.has_value() || !code_reader.has_value()) {
+    return std::nullopt;
+  }
+  std::span<const U8> file_data = code_reader->base_reader()->data();
+  U64 code_file_offset = code_reader->sub_file_offset();
+  if (code_file_offset > file_data.size() ||
+      code_reader->size() > file_data.size() - code_file_offset) {
+    logger.log("function's code is outside its PE file", function.location());
+    return std::nullopt;
+  }
+
+  Frame_Shrink_Job job = {
+      .function_index = function_index,
+      .code = file_data.subspan(code_file_offset, code_reader->size()),
+      .code_file = function.code_file(),
+      .code_location = *code_location,
+      .frame_size = 0,
+      .slots = {},
+  };
+
+  const PE_Unwind_Frame* frame = function.get_unwind_frame(logger);
+  if (function.elf_file != nullptr) {
+    // NOTE(strager): DWARF functions have no locals (see
+    // CodeView_Function::get_locals), so only untouched bytes are found.
+    if (function.self_stack_size == static_cast<U32>(-1)) {
+      logger.log("function has no call frame information; ignoring",
+                 function.location());
+      return std::nullopt;
+    }
+    job.frame_size = function.self_stack_size;
+    if (function.uses_frame_pointer) {
+      // TODO(strager): See the frame_register case below.
+      return job;
+    }
+  } else if (frame != nullptr) {
+    job.frame_size = frame->frame_size();
+    if (frame->frame_register.has_value()) {
+      // TODO(strager): Locals are probably relative to the frame register,
+      // not to the stack pointer after the prologue.
+      return job;
+    }
+  } else {
+    // NOTE(strager): Unwind information is missing for functions in COFF
+    // (.obj) files and for leaf functions. S_FRAMEPROC describes the same
+    // frame.
+    std::optional<CodeView_Frame_Proc> frame_proc =
+        function.get_frame_proc(logger);
+    if (!frame_proc.has_value()) {
+      logger.log("function has neither unwind information nor S_FRAMEPROC; "
+                 "ignoring",
+                 function.location());
+      return std::nullopt;
+    }
+    job.frame_size =
+        U64{frame_proc->frame_size} + frame_proc->saved_registers_size;
+    if (frame_proc->local_base_pointer() != CV_FRAMEPROC_BASE_POINTER_RSP) {
+      // TODO(strager): See the frame_register case above.
+      return job;
+    }
+  }
+
+  for (const CodeView_Function_Local& local :
+       function.get_locals(function.byte_offset, logger)) {
+    S64 address = static_cast<S64>(static_cast<S32>(local.sp_offset)) -
+                  static_cast<S64>(job.frame_size);
+    if (address >= 0) {
+      // Parameters in the caller's frame.
+      continue;
+    }
+    U64 byte_size = 0;
+    if (type_table != nullptr) {
+      std::optional<CodeView_Type> type = local.get_type(type_table, logger);
+      if (type.has_value()) {
+        byte_size = type->byte_size;
+      }
+    }
+    job.slots.push_back(Stack_Slot{
+        .entry_rsp_relative_address = address,
+        .byte_size = byte_size,
+    });
+  }
+  // Assume slots with unknown sizes extend to the next slot.
+  std::sort(job.slots.begin(), job.slots.end(),
+            [](const Stack_Slot& a, const Stack_Slot& b) -> bool {
+              return a.entry_rsp_relative_address <
+                     b.entry_rsp_relative_address;
+            });
+  for (U64 i = 0; i < job.slots.size(); ++i) {
+    Stack_Slot& slot = job.slots[i];
+    if (slot.byte_size == 0) {
+      S64 end = i + 1 < job.slots.size()
+                    ? job.slots[i + 1].entry_rsp_relative_address
+                    : 0;
+      slot.byte_size = static_cast<U64>(end - slot.entry_rsp_relative_address);
+    }
+  }
+  return job;
+}
+
+// Computes Frame_Shrink_Function_Report::call_depth for each node of a call
+// graph. callees[i] lists the nodes called by node i.
+std::vector<U32> compute_call_depths(
+    const std::vector<std::vector<U32>>& callees) {
+  U32 node_count = narrow_cast<U32>(callees.size());
+  std::vector<bool> has_caller(node_count, false);
+  for (const std::vector<U32>& node_callees : callees) {
+    for (U32 callee : node_callees) has_caller[callee] = true;
+  }
+
+  // Depth-first search, starting at functions without callers. Calls back to
+  // a function on the search stack (recursion) are marked and ignored.
+  enum class Visit_State : U8 { unvisited, on_stack, done };
+  std::vector<Visit_State> states(node_count, Visit_State::unvisited);
+  std::vector<std::vector<bool>> is_back_edge(node_count);
+  for (U32 node = 0; node < node_count; ++node) {
+    is_back_edge[node].resize(callees[node].size(), false);
+  }
+  std::vector<U32> post_order;
+  post_order.reserve(node_count);
+  // Node and index of the next callee to visit.
+  std::vector<std::pair<U32, U64>> stack;
+  auto visit = [&](U32 root) -> void {
+    if (states[root] != Visit_State::unvisited) return;
+    states[root] = Visit_State::on_stack;
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+      auto& [node, next_callee_index] = stack.back();
+      if (next_callee_index == callees[node].size()) {
+        states[node] = Visit_State::done;
+        post_order.push_back(node);
+        stack.pop_back();
+        continue;
+      }
+      U64 edge_index = next_callee_index++;
+      U32 callee = callees[node][edge_index];
+      switch (states[callee]) {
+        case Visit_State::unvisited:
+          states[callee] = Visit_State::on_stack;
+          stack.push_back({callee, 0});
+          break;
+        case Visit_State::on_stack:
+          is_back_edge[node][edge_index] = true;
+          break;
+        case Visit_State::done:
+          break;
+      }
+    }
+  };
+  for (U32 node = 0; node < node_count; ++node) {
+    if (!has_caller[node]) visit(node);
+  }
+  for (U32 node = 0; node < node_count; ++node) {
+    visit(node);
+  }
+
+  // Without back edges, reverse post-order is a topological order.
+  std::vector<U32> depths(node_count, 1);
+  for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+    U32 node = *it;
+    for (U64 edge_index = 0; edge_index < callees[node].size(); ++edge_index) {
+      if (is_back_edge[node][edge_index]) continue;
+      U32 callee = callees[node][edge_index];
+      depths[callee] = std::max(depths[callee], depths[node] + 1);
+    }
+  }
+  return depths;
+}
+}
+
+Frame_Shrink_Report analyze_frame_shrink(
+    std::span<const Stack_Map_Touch> touches,
+    std::span<const Stack_Slot> slots, U64 frame_size) {
+  Frame_Shrink_Report report;
+  report.frame_size = frame_size;
+  report.slots.resize(slots.size());
+  Stack_Byte_Range frame = {.begin = -static_cast<S64>(frame_size), .end = 0};
+
+  auto slot_range = [&](U64 slot_index) -> Stack_Byte_Range {
+    const Stack_Slot& slot = slots[slot_index];
+    return Stack_Byte_Range{
+        .begin = slot.entry_rsp_relative_address,
+        .end = slot.entry_rsp_relative_address +
+               static_cast<S64>(slot.byte_size),
+    };
+  };
+
+  std::vector<Stack_Byte_Range> touched_ranges;
+  touched_ranges.reserve(touches.size());
+  std::vector<bool> is_slot_touched(slots.size(), false);
+  for (const Stack_Map_Touch& touch : touches) {
+    S64 begin = touch.entry_rsp_relative_address;
+    S64 end;
+    if (touch.byte_count == static_cast<U32>(-1)) {
+      end = std::max(begin, frame.end);
+      for (U64 i = 0; i < slots.size(); ++i) {
+        Stack_Byte_Range r = slot_range(i);
+        if (r.begin <= begin && begin < r.end) {
+          end = r.end;
+          break;
+        }
+      }
+    } else {
+      end = begin + static_cast<S64>(touch.byte_count);
+    }
+    Stack_Byte_Range range = {.begin = begin, .end = end};
+
+    for (U32 i = 0; i < slots.size(); ++i) {
+      if (!ranges_overlap(range, slot_range(i))) continue;
+      Stack_Slot_Liveness& liveness = report.slots[i];
+      if (!is_slot_touched[i]) {
+        is_slot_touched[i] = true;
+        liveness.first_touch_offset = touch.offset;
+        liveness.last_touch_offset = touch.offset;
+      } else {
+        liveness.first_touch_offset =
+            std::min(liveness.first_touch_offset, touch.offset);
+        liveness.last_touch_offset =
+            std::max(liveness.last_touch_offset, touch.offset);
+      }
+    }
+
+    range.begin = std::max(range.begin, frame.begin);
+    range.end = std::min(range.end, frame.end);
+    if (range.begin < range.end) {
+      touched_ranges.push_back(range);
+    }
+  }
+  merge_ranges(touched_ranges);
+
+  S64 untouched_begin = frame.begin;
+  for (const Stack_Byte_Range& touched : touched_ranges) {
+    if (untouched_begin < touched.begin) {
+      report.untouched_ranges.push_back(
+          Stack_Byte_Range{.begin = untouched_begin, .end = touched.begin});
+    }
+    untouched_begin = touched.end;
+  }
+  if (untouched_begin < frame.end) {
+    report.untouched_ranges.push_back(
+        Stack_Byte_Range{.begin = untouched_begin, .end = frame.end});
+  }
+  for (const Stack_Byte_Range& untouched : report.untouched_ranges) {
+    report.untouched_byte_count += untouched.size();
+  }
+
+  for (U32 i = 0; i < slots.size(); ++i) {
+    if (is_slot_touched[i]) {
+      report.slots[i].touched_byte_count =
+          count_covered_bytes(touched_ranges, slot_range(i));
+    }
+  }
+
+  // Group touched slots which overlap each other.
+  std::vector<U32> touched_slot_indexes;
+  for (U32 i = 0; i < slots.size(); ++i) {
+    if (report.slots[i].is_touched()) touched_slot_indexes.push_back(i);
+  }
+  std::sort(touched_slot_indexes.begin(), touched_slot_indexes.end(),
+            [&](U32 a, U32 b) -> bool {
+              return slot_range(a).begin < slot_range(b).begin;
+            });
+  std::vector<Storage_Unit> units;
+  for (U32 slot_index : touched_slot_indexes) {
+    Stack_Byte_Range range = slot_range(slot_index);
+    Live_Range live_range = {
+        .first = report.slots[slot_index].first_touch_offset,
+        .last = report.slots[slot_index].last_touch_offset,
+    };
+    if (!units.empty() && range.begin < units.back().range.end) {
+      Storage_Unit& unit = units.back();
+      unit.range.end = std::max(unit.range.end, range.end);
+      unit.live_range.first = std::min(unit.live_range.first, live_range.first);
+      unit.live_range.last = std::max(unit.live_range.last, live_range.last);
+      unit.slot_indexes.push_back(slot_index);
+    } else {
+      units.push_back(Storage_Unit{
+          .range = range,
+          .live_range = live_range,
+          .slot_indexes = {slot_index},
+          .used_byte_count = 0,
+      });
+    }
+  }
+  for (Storage_Unit& unit : units) {
+    unit.used_byte_count = count_covered_bytes(touched_ranges, unit.range);
+  }
+
+  for (U64 i = 0; i < units.size(); ++i) {
+    for (U64 j = i + 1; j < units.size(); ++j) {
+      if (units[i].live_range.overlaps(units[j].live_range)) continue;
+      for (U32 a : units[i].slot_indexes) {
+        for (U32 b : units[j].slot_indexes) {
+          report.shareable_slot_pairs.push_back(
+              {std::min(a, b), std::max(a, b)});
+        }
+      }
+    }
+  }
+  std::sort(report.shareable_slot_pairs.begin(),
+            report.shareable_slot_pairs.end());
+
+  report.reclaimable_byte_count =
+      report.untouched_byte_count + compute_sharing_savings(units);
+  return report;
+}
+
+Stack_Slot_Field_Report analyze_slot_fields(
+    std::span<const Stack_Map_Touch> touches, const Stack_Slot& slot,
+    std::span<const Stack_Field> fields) {
+  Stack_Slot_Field_Report report;
+  report.fields.resize(fields.size());
+  Stack_Byte_Range slot_range = {
+      .begin = slot.entry_rsp_relative_address,
+      .end = slot.entry_rsp_relative_address + static_cast<S64>(slot.byte_size),
+  };
+  auto field_range = [&](U64 field_index) -> Stack_Byte_Range {
+    const Stack_Field& field = fields[field_index];
+    S64 begin = slot_range.begin + static_cast<S64>(field.byte_offset);
+    return Stack_Byte_Range{
+        .begin = begin,
+        .end = begin + static_cast<S64>(field.byte_size),
+    };
+  };
+
+  std::vector<Stack_Byte_Range> touched_ranges;
+  std::vector<bool> is_field_touched(fields.size(), false);
+  for (const Stack_Map_Touch& touch : touches) {
+    S64 begin = touch.entry_rsp_relative_address;
+    S64 end = touch.byte_count == static_cast<U32>(-1)
+                  ? std::max(begin, slot_range.end)
+                  : begin + static_cast<S64>(touch.byte_count);
+    Stack_Byte_Range range = {.begin = std::max(begin, slot_range.begin),
+                              .end = std::min(end, slot_range.end)};
+    if (range.begin >= range.end) continue;
+    touched_ranges.push_back(range);
+
+    for (U64 i = 0; i < fields.size(); ++i) {
+      if (!ranges_overlap(range, field_range(i))) continue;
+      Stack_Slot_Liveness& liveness = report.fields[i];
+      if (!is_field_touched[i]) {
+        is_field_touched[i] = true;
+        liveness.first_touch_offset = touch.offset;
+        liveness.last_touch_offset = touch.offset;
+      } else {
+        liveness.first_touch_offset =
+            std::min(liveness.first_touch_offset, touch.offset);
+        liveness.last_touch_offset =
+            std::max(liveness.last_touch_offset, touch.offset);
+      }
+    }
+  }
+  merge_ranges(touched_ranges);
+  for (U64 i = 0; i < fields.size(); ++i) {
+    if (is_field_touched[i]) {
+      report.fields[i].touched_byte_count =
+          count_covered_bytes(touched_ranges, field_range(i));
+    }
+  }
+
+  std::vector<Stack_Byte_Range> field_ranges;
+  field_ranges.reserve(fields.size());
+  for (U64 i = 0; i < fields.size(); ++i) {
+    Stack_Byte_Range range = field_range(i);
+    range.begin = std::max(range.begin, slot_range.begin);
+    range.end = std::min(range.end, slot_range.end);
+    if (range.begin < range.end) {
+      field_ranges.push_back(range);
+    }
+  }
+  merge_ranges(field_ranges);
+  S64 padding_begin = slot_range.begin;
+  for (const Stack_Byte_Range& field : field_ranges) {
+    if (padding_begin < field.begin) {
+      report.padding_ranges.push_back(
+          Stack_Byte_Range{.begin = padding_begin, .end = field.begin});
+    }
+    padding_begin = field.end;
+  }
+  if (padding_begin < slot_range.end) {
+    report.padding_ranges.push_back(
+        Stack_Byte_Range{.begin = padding_begin, .end = slot_range.end});
+  }
+  for (const Stack_Byte_Range& padding : report.padding_ranges) {
+    report.padding_byte_count += padding.size();
+  }
+  return report;
+}
+
+std::vector<Frame_Shrink_Function_Report> rank_frame_shrink_opportunities(
+    const CodeView_Function_Table& functions, CodeView_Type_Table* type_table,
+    Logger& logger, unsigned thread_count) {
+  // NOTE(strager): PE_File and CodeView_Type_Table lazily populate caches and
+  // are not thread-safe, so look up code, frames, and locals on this thread.
+  // Decoding machine code (the slow part) happens in parallel.
+  std::vector<Frame_Shrink_Job> jobs;
+  // Index into jobs, or -1 if the function has no job.
+  std::vector<U32> job_index_by_function_index(functions.size(),
+                                               static_cast<U32>(-1));
+  for (U64 i = 0; i < functions.size(); ++i) {
+    std::optional<Frame_Shrink_Job> job;
+    try {
+      job = make_frame_shrink_job(functions, i, type_table, logger);
+    } catch (Out_Of_Bounds_Read&) {
+      logger.log("failed to read function; ignoring",
+                 functions[i].location());
+    }
+    if (job.has_value()) {
+      job_index_by_function_index[i] = narrow_cast<U32>(jobs.size());
+      jobs.push_back(std::move(*job));
+    }
+  }
+
+  Function_Address_Index address_index;
+  address_index.build(functions, logger);
+
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  thread_count = static_cast<unsigned>(
+      std::min<U64>(thread_count, std::max<U64>(jobs.size(), 1)));
+
+  // Each worker writes only to the indexes it claims.
+  std::vector<Frame_Shrink_Report> reports(jobs.size());
+  std::vector<U64> dynamic_allocation_bounds(jobs.size(), 0);
+  // 1 if the function's Stack_Map::is_dynamic is true, 0 otherwise.
+  // NOTE(strager): std::vector<bool> is not safe to write from multiple
+  // threads.
+  std::vector<U8> is_dynamic(jobs.size(), 0);
+  // Indexes into jobs.
+  std::vector<std::vector<U32>> callees(jobs.size());
+  std::atomic<U64> next_job_index = 0;
+  auto work = [&]() -> void {
+    for (;;) {
+      U64 job_index = next_job_index.fetch_add(1);
+      if (job_index >= jobs.size()) {
+        break;
+      }
+      const Frame_Shrink_Job& job = jobs[job_index];
+      Stack_Map map = analyze_x86_64_stack_map(job.code);
+      reports[job_index] =
+          analyze_frame_shrink(map.touches, job.slots, job.frame_size);
+      is_dynamic[job_index] = map.is_dynamic();
+      dynamic_allocation_bounds[job_index] = map.dynamic_allocation_bound();
+
+      std::vector<U32>& job_callees = callees[job_index];
+      for (S64 target : map.direct_call_targets) {
+        S64 target_offset =
+            static_cast<S64>(job.code_location.offset) + target;
+        if (target_offset < 0 || target_offset > static_cast<U32>(-1)) {
+          continue;
+        }
+        std::optional<U32> callee_function_index =
+            address_index.find_function_index(
+                job.code_file, job.code_location.section_index,
+                static_cast<U32>(target_offset));
+        if (!callee_function_index.has_value()) continue;
+        U32 callee = job_index_by_function_index[*callee_function_index];
+        if (callee == static_cast<U32>(-1) || callee == job_index) continue;
+        job_callees.push_back(callee);
+      }
+      std::sort(job_callees.begin(), job_callees.end());
+      job_callees.erase(std::unique(job_callees.begin(), job_callees.end()),
+                        job_callees.end());
+    }
+  };
+
+  if (thread_count == 1) {
+    work();
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+      threads.emplace_back(work);
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  std::vector<U32> call_depths = compute_call_depths(callees);
+  std::vector<Frame_Shrink_Function_Report> result;
+  result.reserve(jobs.size());
+  for (U64 job_index = 0; job_index < jobs.size(); ++job_index) {
+    U64 reclaimable_byte_count = reports[job_index].reclaimable_byte_count;
+    result.push_back(Frame_Shrink_Function_Report{
+        .function_index = jobs[job_index].function_index,
+        .report = std::move(reports[job_index]),
+        .call_depth = call_depths[job_index],
+        .weighted_reclaimable_byte_count =
+            reclaimable_byte_count * call_depths[job_index],
+        .is_dynamic = is_dynamic[job_index] != 0,
+        .dynamic_allocation_bound = dynamic_allocation_bounds[job_index],
+    });
+  }
+  std::stable_sort(result.begin(), result.end(),
+                   [](const Frame_Shrink_Function_Report& a,
+                      const Frame_Shrink_Function_Report& b) -> bool {
+                     return a.weighted_reclaimable_byte_count >
+                            b.weighted_reclaimable_byte_count;
+                   });
+  return result;
+}
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/logger.h>
+#include <iosfwd>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Finds stack memory which functions reserve but do not need.
+//
+// A function's frame is the bytes between its stack pointer after the prologue
+// and its return address. Addresses are relative to the stack pointer on
+// function entry (like Stack_Map_Touch::entry_rsp_relative_address), so a
+// frame of N bytes is [-N, 0).
+
+namespace cppstacksize {
+class CodeView_Function_Table;
+class CodeView_Type_Table;
+struct Stack_Map_Touch;
+
+// Storage for a local variable.
+struct Stack_Slot {
+  S64 entry_rsp_relative_address;
+  U64 byte_size;
+};
+
+// [begin, end).
+struct Stack_Byte_Range {
+  S64 begin;
+  S64 end;
+
+  U64 size() const { return static_cast<U64>(this->end - this->begin); }
+
+  friend bool operator==(const Stack_Byte_Range&,
+                         const Stack_Byte_Range&) = default;
+};
+
+struct Stack_Slot_Liveness {
+  // Number of the slot's bytes touched by at least one instruction.
+  U64 touched_byte_count = 0;
+  // Byte offsets of the first and last instructions which touch the slot.
+  // Meaningless if the slot is not touched.
+  U32 first_touch_offset = 0;
+  U32 last_touch_offset = 0;
+
+  bool is_touched() const { return this->touched_byte_count != 0; }
+};
+
+struct Frame_Shrink_Report {
+  U64 frame_size = 0;
+
+  // Frame bytes which no instruction touches, sorted by address.
+  std::vector<Stack_Byte_Range> untouched_ranges;
+  U64 untouched_byte_count = 0;
+
+  // Indexed like the slots given to analyze_frame_shrink.
+  std::vector<Stack_Slot_Liveness> slots;
+  // Pairs of indexes into slots (lower index first) whose live ranges do not
+  // overlap. Each pair could share storage.
+  std::vector<std::pair<U32, U32>> shareable_slot_pairs;
+
+  // untouched_byte_count plus the bytes saved if slots with disjoint live
+  // ranges shared storage.
+  U64 reclaimable_byte_count = 0;
+};
+
+// Computes which bytes of a frame of frame_size bytes are touched, and which
+// slots could share storage.
+//
+// A slot is live from the first instruction which touches it to the last
+// instruction which touches it. Control flow is ignored, so a slot touched at
+// the top and the bottom of a loop is not considered live for the whole loop.
+// Treat shareable_slot_pairs as suggestions.
+//
+// Touches with an unknown size (such as a pointer passed to a call) are
+// assumed to touch the rest of their slot, or the rest of the frame if they are
+// not in a slot.
+//
+// Slots which overlap each other already share storage, so they are never
+// reported as shareable.
+Frame_Shrink_Report analyze_frame_shrink(
+    std::span<const Stack_Map_Touch> touches,
+    std::span<const Stack_Slot> slots, U64 frame_size);
+
+// A member of a slot's type, such as a struct's data member. See
+// get_codeview_leaf_members.
+struct Stack_Field {
+  // Relative to the start of the slot.
+  U64 byte_offset;
+  U64 byte_size;
+};
+
+struct Stack_Slot_Field_Report {
+  // Indexed like the fields given to analyze_slot_fields.
+  std::vector<Stack_Slot_Liveness> fields;
+  // Slot bytes which are not part of any field (such as padding between
+  // fields), sorted by address.
+  std::vector<Stack_Byte_Range> padding_ranges;
+  U64 padding_byte_count = 0;
+};
+
+// Computes which fields of a slot are touched, and which bytes of the slot are
+// not part of any field.
+//
+// A field which is never touched is unused by the function. Touches with an
+// unknown size are assumed to touch the rest of the slot.
+Stack_Slot_Field_Report analyze_slot_fields(
+    std::span<const Stack_Map_Touch> touches, const Stack_Slot& slot,
+    std::span<const Stack_Field> fields);
+
+struct Frame_Shrink_Function_Report {
+  // Index into the CodeView_Function_Table given to
+  // rank_frame_shrink_opportunities.
+  U64 function_index;
+  Frame_Shrink_Report report;
+  // Number of functions in the longest known chain of direct calls which ends
+  // with this function (1 if the function has no known callers). Recursive
+  // calls are ignored.
+  U32 call_depth;
+  // report.reclaimable_byte_count * call_depth. Functions deep in a call chain
+  // are more likely to be on the stack when the stack is deepest.
+  U64 weighted_reclaimable_byte_count;
+
+  // If true, the function allocates stack dynamically (e.g. with alloca), so
+  // its stack usage exceeds its frame. See Stack_Map::is_dynamic.
+  bool is_dynamic;
+  // See Stack_Map::dynamic_allocation_bound. 0 if is_dynamic is false.
+  U64 dynamic_allocation_bound;
+};
+
+// Analyzes the frame of every function with machine code (see
+// analyze_x86_64_stack_map and analyze_frame_shrink), using up to
+// thread_count threads. If thread_count is 0, a thread count is picked
+// automatically.
+//
+// Frame sizes come from x64 unwind information (see
+// CodeView_Function::get_unwind_frame) or, for functions without unwind
+// information, from S_FRAMEPROC (see CodeView_Function::get_frame_proc). Frame
+// sizes of functions described by DWARF come from call frame information.
+// Functions with none of these are skipped. Slots come from the functions'
+// locals (see CodeView_Function::get_locals). If type_table is null, each slot
+// is assumed to extend to the next slot.
+//
+// Returns reports sorted by weighted_reclaimable_byte_count, largest first.
+std::vector<Frame_Shrink_Function_Report> rank_frame_shrink_opportunities(
+    const CodeView_Function_Table&, CodeView_Type_Table* type_table,
+    Logger& logger = fallback_logger, unsigned thread_count = 0);
+
+std::ostream& operator<<(std::ostream& out, const Stack_Byte_Range&);
+}
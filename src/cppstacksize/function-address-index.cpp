@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/function-address-index.h>
+
+namespace cppstacksize {
+namespace {
+bool entry_address_less(const Function_Address_Index::Entry& entry,
+                        U64 address) {
+  return entry.address < address;
+}
+
+bool address_entry_less(U64 address,
+                        const Function_Address_Index::Entry& entry) {
+  return address < entry.address;
+}
+}
+
+template <class Get_Code_Size, class Get_Code_Location, class Get_Code_File>
+void Function_Address_Index::build_entries(
+    U64 function_count, Get_Code_Size&& get_code_size,
+    Get_Code_Location&& get_code_location, Get_Code_File&& get_code_file) {
+  CSS_ASSERT(function_count <= U64{static_cast<U32>(-1)});
+  this->entries_.clear();
+  this->entries_.reserve(function_count);
+  this->code_files_.clear();
+  for (U64 i = 0; i < function_count; ++i) {
+    U32 code_size = get_code_size(i);
+    if (code_size == static_cast<U32>(-1)) {
+      continue;
+    }
+    std::optional<CodeView_Code_Location> code_location = get_code_location(i);
+    if (!code_location.has_value() ||
+        code_location->section_index == static_cast<U32>(-1)) {
+      continue;
+    }
+    // NOTE(strager): Projects have few code files, and consecutive functions
+    // are usually in the same file, so check the most recent file first.
+    const void* code_file = get_code_file(i);
+    U32 file_index;
+    if (!this->code_files_.empty() && this->code_files_.back() == code_file) {
+      file_index = narrow_cast<U32>(this->code_files_.size() - 1);
+    } else {
+      std::optional<U32> existing_file_index =
+          this->find_file_index(code_file);
+      if (existing_file_index.has_value()) {
+        file_index = *existing_file_index;
+      } else {
+        file_index = narrow_cast<U32>(this->code_files_.size());
+        this->code_files_.push_back(code_file);
+      }
+    }
+    this->entries_.push_back(Entry{
+        .file_index = file_index,
+        .code_size = code_size,
+        .address =
+            make_address(code_location->section_index, code_location->offset),
+        .function_index = narrow_cast<U32>(i),
+    });
+  }
+
+  // NOTE(strager): Functions in a PDB are usually already sorted within each
+  // module, so the check is cheap compared to an unconditional sort.
+  auto entry_less = [](const Entry& a, const Entry& b) -> bool {
+    if (a.file_index != b.file_index) {
+      return a.file_index < b.file_index;
+    }
+    if (a.address != b.address) {
+      return a.address < b.address;
+    }
+    return a.function_index < b.function_index;
+  };
+  if (!std::is_sorted(this->entries_.begin(), this->entries_.end(),
+                      entry_less)) {
+    std::sort(this->entries_.begin(), this->entries_.end(), entry_less);
+  }
+}
+
+void Function_Address_Index::build(std::span<const CodeView_Function> functions,
+                                   Logger& logger) {
+  this->build_entries(
+      functions.size(),
+      [&](U64 i) -> U32 { return functions[i].code_size; },
+      [&](U64 i) -> std::optional<CodeView_Code_Location> {
+        return functions[i].get_code_location(logger);
+      },
+      [&](U64 i) -> const void* { return functions[i].code_file(); });
+}
+
+void Function_Address_Index::build(const CodeView_Function_Table& functions,
+                                   Logger& logger) {
+  this->build_entries(
+      functions.size(),
+      [&](U64 i) -> U32 { return functions.code_size(i); },
+      [&](U64 i) -> std::optional<CodeView_Code_Location> {
+        return functions.get_code_location(i, logger);
+      },
+      [&](U64 i) -> const void* { return functions.code_file(i); });
+}
+
+void Function_Address_Index::clear() {
+  this->entries_.clear();
+  this->code_files_.clear();
+}
+
+std::optional<U32> Function_Address_Index::find_function_index(
+    const void* code_file, U32 section_index, U32 code_offset) const {
+  std::optional<U32> file_index = this->find_file_index(code_file);
+  if (!file_index.has_value()) {
+    return std::nullopt;
+  }
+  std::span<const Entry> entries = this->file_entries(*file_index);
+  U64 address = make_address(section_index, code_offset);
+  auto it = std::upper_bound(entries.begin(), entries.end(), address,
+                             address_entry_less);
+  if (it == entries.begin()) {
+    return std::nullopt;
+  }
+  --it;
+  // it is the last entry starting at or before address. Check every function
+  // starting at the same address, preferring the lowest function index.
+  auto group_begin =
+      std::lower_bound(entries.begin(), it, it->address, entry_address_less);
+  for (auto entry = group_begin; entry <= it; ++entry) {
+    if (address < entry->end_address()) {
+      return entry->function_index;
+    }
+  }
+  return std::nullopt;
+}
+
+std::span<const Function_Address_Index::Entry>
+Function_Address_Index::find_functions_in_range(const void* code_file,
+                                                U32 section_index,
+                                                U32 begin_offset,
+                                                U32 end_offset) const {
+  if (begin_offset >= end_offset) {
+    return {};
+  }
+  std::optional<U32> file_index = this->find_file_index(code_file);
+  if (!file_index.has_value()) {
+    return {};
+  }
+  std::span<const Entry> entries = this->file_entries(*file_index);
+  U64 begin_address = make_address(section_index, begin_offset);
+  U64 end_address = make_address(section_index, end_offset);
+  auto begin = std::lower_bound(entries.begin(), entries.end(), begin_address,
+                                entry_address_less);
+  auto end = std::lower_bound(begin, entries.end(), end_address,
+                              entry_address_less);
+  // Include functions which start before the range but extend into it.
+  while (begin != entries.begin() &&
+         std::prev(begin)->end_address() > begin_address) {
+    --begin;
+  }
+  return std::span<const Entry>(begin, end);
+}
+
+std::span<const Function_Address_Index::Entry>
+Function_Address_Index::entries() const {
+  return this->entries_;
+}
+
+std::optional<U32> Function_Address_Index::find_file_index(
+    const void* code_file) const {
+  auto it =
+      std::find(this->code_files_.begin(), this->code_files_.end(), code_file);
+  if (it == this->code_files_.end()) {
+    return std::nullopt;
+  }
+  return narrow_cast<U32>(it - this->code_files_.begin());
+}
+
+std::span<const Function_Address_Index::Entry>
+Function_Address_Index::file_entries(U32 file_index) const {
+  auto begin = std::lower_bound(
+      this->entries_.begin(), this->entries_.end(), file_index,
+      [](const Entry& entry, U32 index) -> bool {
+        return entry.file_index < index;
+      });
+  auto end = std::upper_bound(begin, this->entries_.end(), file_index,
+                              [](U32 index, const Entry& entry) -> bool {
+                                return index < entry.file_index;
+                              });
+  return std::span<const Entry>(begin, end);
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/logger.h>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace cppstacksize {
+class CodeView_Function_Table;
+struct CodeView_Function;
+
+// Maps code addresses (file, section index, and offset) to
+// CodeView_Function-s.
+//
+// Files are identified by CodeView_Function::code_file, so functions in
+// different files with the same section index and offset do not collide.
+//
+// Build the index once after loading functions. Lookups are O(log n).
+//
+// Functions are assumed not to partially overlap each other. Functions with
+// the same address (e.g. after identical code folding) are allowed.
+class Function_Address_Index {
+ public:
+  struct Entry {
+    // Index into the index's list of distinct code files. Entries are sorted
+    // by file_index first.
+    U32 file_index;
+    U32 code_size;
+    // Sort key within a file: (section_index << 32) | code_offset.
+    U64 address;
+    // Index into the functions given to build.
+    U32 function_index;
+
+    U32 section_index() const { return narrow_cast<U32>(this->address >> 32); }
+    U32 code_offset() const { return narrow_cast<U32>(this->address); }
+    U64 end_address() const { return this->address + this->code_size; }
+  };
+
+  // Replaces the index's contents.
+  //
+  // Function locations are relocated (see
+  // CodeView_Function::get_code_location). Functions whose location is unknown
+  // are not indexed.
+  void build(std::span<const CodeView_Function> functions,
+             Logger& logger = fallback_logger);
+  void build(const CodeView_Function_Table& functions,
+             Logger& logger = fallback_logger);
+
+  void clear();
+
+  // Returns the index of the function whose code contains the given byte, or
+  // null if no function contains it.
+  //
+  // code_file is the file containing the code (see
+  // CodeView_Function::code_file).
+  //
+  // If several functions share the same address, the one with the lowest
+  // function index is returned.
+  std::optional<U32> find_function_index(const void* code_file,
+                                         U32 section_index,
+                                         U32 code_offset) const;
+
+  // Returns the entries for all functions whose code overlaps the byte range
+  // [begin_offset, end_offset) within the given section of code_file, sorted
+  // by address.
+  std::span<const Entry> find_functions_in_range(const void* code_file,
+                                                 U32 section_index,
+                                                 U32 begin_offset,
+                                                 U32 end_offset) const;
+
+  // All indexed functions sorted by file, then by address.
+  std::span<const Entry> entries() const;
+
+ private:
+  static U64 make_address(U32 section_index, U32 code_offset) {
+    return (U64{section_index} << 32) | code_offset;
+  }
+
+  // Returns null if no indexed function is in code_file.
+  std::optional<U32> find_file_index(const void* code_file) const;
+  // Returns the entries of the file_index-th file.
+  std::span<const Entry> file_entries(U32 file_index) const;
+
+  template <class Get_Code_Size, class Get_Code_Location, class Get_Code_File>
+  void build_entries(U64 function_count, Get_Code_Size&& get_code_size,
+                     Get_Code_Location&& get_code_location,
+                     Get_Code_File&& get_code_file);
+
+  // Sorted by file_index, then by address, then by function_index.
+  std::vector<Entry> entries_;
+  // Distinct code files, in order of first appearance. Indexed by
+  // Entry::file_index.
+  std::vector<const void*> code_files_;
+};
+}
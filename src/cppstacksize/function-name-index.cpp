@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cppstacksize/function-name-index.h>
+#include <numeric>
+
+namespace cppstacksize {
+namespace {
+char fold_ascii_case(char c) {
+  if ('A' <= c && c <= 'Z') {
+    return static_cast<char>(c - 'A' + 'a');
+  }
+  return c;
+}
+
+// Maps a byte (already case-folded) to a 6-bit symbol. Common identifier bytes
+// get their own symbol; rare bytes share symbols.
+U32 trigram_symbol(char c) {
+  if ('a' <= c && c <= 'z') {
+    return U32(c - 'a');  // 0-25
+  }
+  if ('0' <= c && c <= '9') {
+    return U32(c - '0') + 26;  // 26-35
+  }
+  switch (c) {
+    // clang-format off
+    case '_':  return 36;
+    case ':':  return 37;
+    case '<':  return 38;
+    case '>':  return 39;
+    case ',':  return 40;
+    case ' ':  return 41;
+    case '(':  return 42;
+    case ')':  return 43;
+    case '*':  return 44;
+    case '&':  return 45;
+    case '~':  return 46;
+    case '=':  return 47;
+    case '-':  return 48;
+    case '.':  return 49;
+    case '[':  return 50;
+    case ']':  return 51;
+    case '$':  return 52;
+    case '@':  return 53;
+    case '?':  return 54;
+    case '`':  return 55;
+    case '\'': return 56;
+    // clang-format on
+    default:
+      return 57 + (static_cast<U8>(c) % 7);  // 57-63
+  }
+}
+
+// Returns true if trigram_symbol maps more than one byte to the symbol.
+bool trigram_symbol_is_shared(U32 symbol) { return symbol >= 57; }
+
+bool contains_wildcard(std::string_view pattern) {
+  return pattern.find_first_of("*?") != std::string_view::npos;
+}
+
+// Matches a case-folded name against a case-folded glob pattern.
+bool glob_matches(std::string_view pattern, std::string_view name) {
+  std::size_t p = 0;
+  std::size_t n = 0;
+  std::size_t star_p = std::string_view::npos;
+  std::size_t star_n = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      p += 1;
+      n += 1;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star_p = p;
+      star_n = n;
+      p += 1;
+    } else if (star_p != std::string_view::npos) {
+      // Let the last '*' consume one more byte.
+      p = star_p + 1;
+      star_n += 1;
+      n = star_n;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    p += 1;
+  }
+  return p == pattern.size();
+}
+}
+
+Function_Name_Index::Trigram Function_Name_Index::make_trigram(
+    const char* bytes) {
+  return (trigram_symbol(bytes[0]) << 12) | (trigram_symbol(bytes[1]) << 6) |
+         trigram_symbol(bytes[2]);
+}
+
+void Function_Name_Index::add_name(std::u8string_view name) {
+  this->name_offsets_.push_back(narrow_cast<U32>(this->names_.size()));
+  this->names_.append(name);
+  this->names_.push_back(u8'\0');
+}
+
+void Function_Name_Index::build() {
+  U32 name_count = this->size();
+
+  this->folded_names_.resize(this->names_.size());
+  std::transform(this->names_.begin(), this->names_.end(),
+                 this->folded_names_.begin(),
+                 [](char8_t c) { return fold_ascii_case(char(c)); });
+
+  // Exact index. Count, then assign ranges, then fill, so function indexes
+  // within each group stay in increasing order.
+  this->exact_index_.clear();
+  this->exact_index_.reserve(name_count);
+  for (U32 i = 0; i < name_count; ++i) {
+    this->exact_index_[this->name(i)].second += 1;
+  }
+  U32 group_begin = 0;
+  for (auto& [name, range] : this->exact_index_) {
+    U32 group_size = range.second;
+    range.first = group_begin;
+    range.second = group_begin;  // Fill cursor.
+    group_begin += group_size;
+  }
+  this->indexes_grouped_by_name_.resize(name_count);
+  for (U32 i = 0; i < name_count; ++i) {
+    std::pair<U32, U32>& range = this->exact_index_.find(this->name(i))->second;
+    this->indexes_grouped_by_name_[range.second] = i;
+    range.second += 1;
+  }
+
+  this->name_symbol_masks_.assign(name_count, 0);
+  this->short_name_indexes_.clear();
+  for (U32 i = 0; i < name_count; ++i) {
+    std::string_view name = this->folded_name(i);
+    U64 mask = 0;
+    for (char c : name) {
+      mask |= U64{1} << trigram_symbol(c);
+    }
+    this->name_symbol_masks_[i] = mask;
+    if (name.size() < 3) {
+      this->short_name_indexes_.push_back(i);
+    }
+  }
+
+  // Trigram index. Count, then assign ranges, then fill, so each posting list
+  // is sorted.
+  //
+  // last_name_with_trigram de-duplicates trigrams which appear multiple times
+  // in one name.
+  std::vector<U32> last_name_with_trigram(trigram_count,
+                                          static_cast<U32>(-1));
+  this->trigram_posting_offsets_.assign(trigram_count + 1, 0);
+  for (U32 i = 0; i < name_count; ++i) {
+    std::string_view name = this->folded_name(i);
+    for (std::size_t j = 0; j + 3 <= name.size(); ++j) {
+      Trigram trigram = make_trigram(&name[j]);
+      if (last_name_with_trigram[trigram] != i) {
+        last_name_with_trigram[trigram] = i;
+        this->trigram_posting_offsets_[trigram + 1] += 1;
+      }
+    }
+  }
+  std::partial_sum(this->trigram_posting_offsets_.begin(),
+                   this->trigram_posting_offsets_.end(),
+                   this->trigram_posting_offsets_.begin());
+  this->trigram_postings_.resize(this->trigram_posting_offsets_.back());
+  std::vector<U32> fill_offsets(this->trigram_posting_offsets_.begin(),
+                                this->trigram_posting_offsets_.end() - 1);
+  std::fill(last_name_with_trigram.begin(), last_name_with_trigram.end(),
+            static_cast<U32>(-1));
+  for (U32 i = 0; i < name_count; ++i) {
+    std::string_view name = this->folded_name(i);
+    for (std::size_t j = 0; j + 3 <= name.size(); ++j) {
+      Trigram trigram = make_trigram(&name[j]);
+      if (last_name_with_trigram[trigram] != i) {
+        last_name_with_trigram[trigram] = i;
+        this->trigram_postings_[fill_offsets[trigram]] = i;
+        fill_offsets[trigram] += 1;
+      }
+    }
+  }
+}
+
+std::span<const U32> Function_Name_Index::find_exact(
+    std::u8string_view name) const {
+  auto it = this->exact_index_.find(name);
+  if (it == this->exact_index_.end()) {
+    return {};
+  }
+  return std::span<const U32>(this->indexes_grouped_by_name_)
+      .subspan(it->second.first, it->second.second - it->second.first);
+}
+
+void Function_Name_Index::find_matching(std::u8string_view raw_pattern,
+                                        std::vector<U32>& out) const {
+  out.clear();
+  U32 name_count = this->size();
+
+  std::string pattern(raw_pattern.size(), '\0');
+  std::transform(raw_pattern.begin(), raw_pattern.end(), pattern.begin(),
+                 [](char8_t c) { return fold_ascii_case(char(c)); });
+
+  if (pattern.empty()) {
+    out.resize(name_count);
+    std::iota(out.begin(), out.end(), U32{0});
+    return;
+  }
+
+  std::vector<U32> candidates;
+  if (!contains_wildcard(pattern)) {
+    std::string_view literals[] = {pattern};
+    if (this->find_literal_candidates(literals, candidates)) {
+      for (U32 i : candidates) {
+        if (this->folded_name(i).find(pattern) != std::string_view::npos) {
+          out.push_back(i);
+        }
+      }
+      return;
+    }
+
+    this->find_short_substring(pattern, out);
+    return;
+  }
+
+  // Every literal part of the glob must appear in a matching name.
+  std::vector<std::string_view> literals;
+  std::string_view remaining = pattern;
+  while (!remaining.empty()) {
+    std::size_t wildcard = remaining.find_first_of("*?");
+    literals.push_back(remaining.substr(0, wildcard));
+    if (wildcard == std::string_view::npos) {
+      break;
+    }
+    remaining = remaining.substr(wildcard + 1);
+  }
+  if (this->find_literal_candidates(literals, candidates)) {
+    for (U32 i : candidates) {
+      if (glob_matches(pattern, this->folded_name(i))) {
+        out.push_back(i);
+      }
+    }
+  } else {
+    for (U32 i = 0; i < name_count; ++i) {
+      if (glob_matches(pattern, this->folded_name(i))) {
+        out.push_back(i);
+      }
+    }
+  }
+}
+
+bool Function_Name_Index::find_literal_candidates(
+    std::span<const std::string_view> folded_literals,
+    std::vector<U32>& out) const {
+  out.clear();
+  std::vector<std::span<const U32>> posting_lists;
+  for (std::string_view literal : folded_literals) {
+    for (std::size_t j = 0; j + 3 <= literal.size(); ++j) {
+      posting_lists.push_back(
+          this->find_trigram_postings(make_trigram(&literal[j])));
+    }
+  }
+  if (posting_lists.empty()) {
+    return false;
+  }
+  std::sort(posting_lists.begin(), posting_lists.end(),
+            [](std::span<const U32> a, std::span<const U32> b) -> bool {
+              return a.size() < b.size();
+            });
+  if (posting_lists[0].empty()) {
+    return true;
+  }
+
+  out.assign(posting_lists[0].begin(), posting_lists[0].end());
+  // NOTE(strager): Intersecting with a few more lists shrinks the candidate
+  // set a lot. Intersecting with every list has diminishing returns; the
+  // caller checks each candidate anyway.
+  static constexpr U64 max_intersections = 3;
+  for (U64 list_index = 1;
+       list_index < std::min<U64>(posting_lists.size(), max_intersections + 1);
+       ++list_index) {
+    std::span<const U32> list = posting_lists[list_index];
+    std::erase_if(out, [&](U32 i) -> bool {
+      return !std::binary_search(list.begin(), list.end(), i);
+    });
+  }
+  return true;
+}
+
+void Function_Name_Index::find_short_substring(std::string_view folded_pattern,
+                                               std::vector<U32>& out) const {
+  CSS_ASSERT(folded_pattern.size() == 1 || folded_pattern.size() == 2);
+  U32 name_count = this->size();
+  bool need_verify = false;
+  for (char c : folded_pattern) {
+    need_verify = need_verify || trigram_symbol_is_shared(trigram_symbol(c));
+  }
+
+  if (folded_pattern.size() == 1) {
+    U64 mask = U64{1} << trigram_symbol(folded_pattern[0]);
+    for (U32 i = 0; i < name_count; ++i) {
+      if ((this->name_symbol_masks_[i] & mask) != 0 &&
+          (!need_verify || this->folded_name(i).find(folded_pattern[0]) !=
+                               std::string_view::npos)) {
+        out.push_back(i);
+      }
+    }
+    return;
+  }
+
+  // A name with at least three bytes contains the pattern if and only if it
+  // contains the trigram pattern+x or x+pattern for some x. Check shorter
+  // names directly.
+  std::vector<bool> is_candidate(name_count, false);
+  U32 first = trigram_symbol(folded_pattern[0]);
+  U32 second = trigram_symbol(folded_pattern[1]);
+  for (U32 other = 0; other < 64; ++other) {
+    for (U32 i :
+         this->find_trigram_postings((first << 12) | (second << 6) | other)) {
+      is_candidate[i] = true;
+    }
+    for (U32 i :
+         this->find_trigram_postings((other << 12) | (first << 6) | second)) {
+      is_candidate[i] = true;
+    }
+  }
+  for (U32 i : this->short_name_indexes_) {
+    if (this->folded_name(i) == folded_pattern) {
+      is_candidate[i] = true;
+    }
+  }
+  for (U32 i = 0; i < name_count; ++i) {
+    if (is_candidate[i] &&
+        (!need_verify ||
+         this->folded_name(i).find(folded_pattern) != std::string_view::npos)) {
+      out.push_back(i);
+    }
+  }
+}
+
+std::span<const U32> Function_Name_Index::find_trigram_postings(
+    Trigram trigram) const {
+  if (this->trigram_posting_offsets_.empty()) {
+    return {};
+  }
+  U32 begin = this->trigram_posting_offsets_[trigram];
+  U32 end = this->trigram_posting_offsets_[trigram + 1];
+  return std::span<const U32>(this->trigram_postings_)
+      .subspan(begin, end - begin);
+}
+
+std::u8string_view Function_Name_Index::name(U32 index) const {
+  U32 begin = this->name_offsets_[index];
+  U32 end = index + 1 < this->name_offsets_.size()
+                ? this->name_offsets_[index + 1]
+                : narrow_cast<U32>(this->names_.size());
+  // Exclude the null terminator.
+  return std::u8string_view(this->names_).substr(begin, end - begin - 1);
+}
+
+std::string_view Function_Name_Index::folded_name(U32 index) const {
+  std::u8string_view n = this->name(index);
+  return std::string_view(this->folded_names_)
+      .substr(narrow_cast<U64>(n.data() - this->names_.data()), n.size());
+}
+}
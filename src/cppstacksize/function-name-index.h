@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace cppstacksize {
+// Finds functions by name.
+//
+// Usage:
+//
+// 1. Call add_name once per function, in function index order.
+// 2. Call build. build is slow for many names; it can run on a different
+//    thread from add_name.
+// 3. Call find_exact or find_matching, possibly from several threads at once.
+class Function_Name_Index {
+ public:
+  // Copies the name.
+  void add_name(std::u8string_view name);
+
+  void build();
+
+  U32 size() const { return narrow_cast<U32>(this->name_offsets_.size()); }
+
+  // Returns the indexes of functions with exactly the given name in increasing
+  // order.
+  std::span<const U32> find_exact(std::u8string_view name) const;
+
+  // Finds functions whose name matches the pattern, ignoring ASCII case.
+  //
+  // If the pattern contains '*' (any string) or '?' (any byte), then the entire
+  // name must match. Otherwise, pattern is a substring to search for.
+  //
+  // Writes function indexes in increasing order. An empty pattern matches
+  // everything.
+  void find_matching(std::u8string_view pattern, std::vector<U32>& out) const;
+
+ private:
+  // A trigram is three 6-bit symbols. Several bytes map to the same symbol
+  // (see trigram_symbol), so lookups can produce false positives which must
+  // be filtered out by checking the name.
+  using Trigram = U32;
+  static constexpr U32 trigram_count = 1 << 18;
+
+  static Trigram make_trigram(const char* bytes);
+
+  std::u8string_view name(U32 index) const;
+  // Returns name(index) with ASCII letters lowercased.
+  std::string_view folded_name(U32 index) const;
+
+  // Returns the indexes of functions whose name might contain the trigram in
+  // increasing order.
+  std::span<const U32> find_trigram_postings(Trigram) const;
+
+  // Handles patterns too short for find_literal_candidates.
+  void find_short_substring(std::string_view folded_pattern,
+                            std::vector<U32>& out) const;
+
+  // Writes candidate function indexes for names which contain every (folded)
+  // literal. Returns false if the literals are too short to use the trigram
+  // index, in which case every function is a candidate.
+  bool find_literal_candidates(
+      std::span<const std::string_view> folded_literals,
+      std::vector<U32>& out) const;
+
+  // Each name followed by a null terminator.
+  std::u8string names_;
+  // names_ with ASCII letters lowercased.
+  std::string folded_names_;
+  // Offset into names_ of each name.
+  std::vector<U32> name_offsets_;
+
+  struct String_View_Hash {
+    std::size_t operator()(std::u8string_view s) const noexcept {
+      return std::hash<std::u8string_view>()(s);
+    }
+  };
+  // Function indexes grouped by name.
+  std::vector<U32> indexes_grouped_by_name_;
+  // Key points into names_. Value is a [begin, end) range in
+  // indexes_grouped_by_name_.
+  std::unordered_map<std::u8string_view, std::pair<U32, U32>, String_View_Hash>
+      exact_index_;
+
+  // Bit s is set if the name contains a byte with trigram symbol s.
+  std::vector<U64> name_symbol_masks_;
+  // Indexes of names with fewer than three bytes (i.e. with no trigrams).
+  std::vector<U32> short_name_indexes_;
+
+  // Posting lists: trigram t's function indexes are
+  // trigram_postings_[trigram_posting_offsets_[t]] through
+  // trigram_postings_[trigram_posting_offsets_[t + 1]] (exclusive).
+  std::vector<U32> trigram_posting_offsets_;
+  std::vector<U32> trigram_postings_;
+};
+}
@@ -0,0 +1,123 @@
+#include <cppstacksize/base.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace {
+[[noreturn]] void usage(const char* program_name) {
+  std::fprintf(stderr,
+               "usage: %s [OPTIONS] OUTPUT.pdb\n"
+               "options:\n"
+               "  --modules=N\n"
+               "  --functions-per-module=N\n"
+               "  --locals-per-function=N\n"
+               "  --lines-per-function=N\n"
+               "  --extra-types=N\n"
+               "  --block-size=N            512, 1024, 2048, or 4096\n"
+               "  --layout=LAYOUT           sequential, interleaved, or "
+               "shuffled\n"
+               "  --seed=N\n",
+               program_name);
+  std::exit(2);
+}
+
+// If arg is --name=VALUE, returns VALUE. Otherwise, returns nullptr.
+const char* match_option(const char* arg, std::string_view name) {
+  if (std::strncmp(arg, name.data(), name.size()) != 0 ||
+      arg[name.size()] != '=') {
+    return nullptr;
+  }
+  return arg + name.size() + 1;
+}
+
+cppstacksize::U64 parse_number(const char* program_name, const char* s) {
+  char* end;
+  unsigned long long value = std::strtoull(s, &end, 0);
+  if (*s == '\0' || *end != '\0') {
+    std::fprintf(stderr, "error: invalid number: %s\n", s);
+    usage(program_name);
+  }
+  return value;
+}
+}
+
+int main(int argc, char** argv) {
+  using namespace cppstacksize;
+
+  Synthetic_PDB_Options options;
+  const char* output_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    if (const char* value = match_option(arg, "--modules")) {
+      options.module_count = parse_number(argv[0], value);
+    } else if (const char* value =
+                   match_option(arg, "--functions-per-module")) {
+      options.functions_per_module = parse_number(argv[0], value);
+    } else if (const char* value = match_option(arg, "--locals-per-function")) {
+      options.locals_per_function = parse_number(argv[0], value);
+    } else if (const char* value = match_option(arg, "--lines-per-function")) {
+      options.lines_per_function =
+          static_cast<U32>(parse_number(argv[0], value));
+    } else if (const char* value = match_option(arg, "--extra-types")) {
+      options.extra_type_count = parse_number(argv[0], value);
+    } else if (const char* value = match_option(arg, "--block-size")) {
+      options.block_size = static_cast<U32>(parse_number(argv[0], value));
+      switch (options.block_size) {
+        case 512:
+        case 1024:
+        case 2048:
+        case 4096:
+          break;
+        default:
+          std::fprintf(stderr, "error: unsupported block size: %s\n", value);
+          usage(argv[0]);
+      }
+    } else if (const char* value = match_option(arg, "--layout")) {
+      std::string_view layout = value;
+      if (layout == "sequential") {
+        options.block_layout = Synthetic_MSF_Block_Layout::sequential;
+      } else if (layout == "interleaved") {
+        options.block_layout = Synthetic_MSF_Block_Layout::interleaved;
+      } else if (layout == "shuffled") {
+        options.block_layout = Synthetic_MSF_Block_Layout::shuffled;
+      } else {
+        std::fprintf(stderr, "error: unknown layout: %s\n", value);
+        usage(argv[0]);
+      }
+    } else if (const char* value = match_option(arg, "--seed")) {
+      options.seed = static_cast<U32>(parse_number(argv[0], value));
+    } else if (arg[0] == '-') {
+      std::fprintf(stderr, "error: unknown option: %s\n", arg);
+      usage(argv[0]);
+    } else if (output_path == nullptr) {
+      output_path = arg;
+    } else {
+      usage(argv[0]);
+    }
+  }
+  if (output_path == nullptr) {
+    usage(argv[0]);
+  }
+
+  std::vector<U8> pdb;
+  try {
+    pdb = make_synthetic_pdb(options);
+  } catch (std::runtime_error& e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    std::exit(1);
+  }
+  std::ofstream file(output_path, std::ofstream::out | std::ofstream::binary |
+                                      std::ofstream::trunc);
+  file.write(reinterpret_cast<const char*>(pdb.data()),
+             static_cast<std::streamsize>(pdb.size()));
+  file.close();
+  if (!file) {
+    std::fprintf(stderr, "error: failed to write file %s\n", output_path);
+    std::exit(1);
+  }
+}
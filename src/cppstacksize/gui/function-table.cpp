@@ -7,31 +7,56 @@
 namespace cppstacksize {
 Function_Table_Model::Function_Table_Model(Project* project, Logger* logger,
                                            QObject* parent)
-    : QAbstractTableModel(parent),
-      project_(project),
-      logger_(logger),
-      function_data_cache_(/*maxCost=*/1000) {}
+    : QAbstractTableModel(parent), project_(project), logger_(logger) {
+  this->function_data_cache_id_ = this->project_->get_cache_budget().add_cache(
+      "function table rows", [this](U64 function_index) -> void {
+        this->function_data_cache_.erase(function_index);
+      });
+  this->stack_size_cache_id_ = this->project_->get_cache_budget().add_cache(
+      "function table stack sizes", [this](U64 function_index) -> void {
+        this->stack_size_cache_.erase(function_index);
+      });
+}
 
-Function_Table_Model::~Function_Table_Model() = default;
+Function_Table_Model::~Function_Table_Model() {
+  this->project_->get_cache_budget().remove_cache(
+      this->function_data_cache_id_);
+  this->project_->get_cache_budget().remove_cache(this->stack_size_cache_id_);
+}
 
 int Function_Table_Model::rowCount(const QModelIndex&) const {
-  return narrow_cast<int>(this->functions_.size());
+  if (this->has_name_filter_) {
+    return narrow_cast<int>(this->filtered_function_indexes_.size());
+  }
+  if (this->functions_ == nullptr) {
+    return 0;
+  }
+  return narrow_cast<int>(this->functions_->size());
 }
 
 int Function_Table_Model::columnCount(const QModelIndex&) const { return 3; }
 
 QVariant Function_Table_Model::data(const QModelIndex& index, int role) const {
-  const CodeView_Function* func = this->get_function(index);
-  if (func == nullptr) {
+  std::optional<U64> function_index = this->get_function_index(index);
+  if (!function_index.has_value()) {
     return QVariant();
   }
   switch (role) {
     case Qt::DisplayRole:
       switch (index.column()) {
-        case 0:
-          return QString(func->name.c_str());
-        case 1:
-          return func->self_stack_size;
+        case 0: {
+          std::u8string_view name = this->functions_->name(*function_index);
+          return QString::fromUtf8(name.data(),
+                                   narrow_cast<qsizetype>(name.size()));
+        }
+        case 1: {
+          U32 stack_size =
+              this->get_stack_size_data(*function_index)->stack_size;
+          if (stack_size == static_cast<U32>(-1)) {
+            return QVariant();
+          }
+          return stack_size;
+        }
         case 2: {
           Cached_Function_Data* data = this->get_function_data(index.row());
           if (data == nullptr) {
@@ -47,6 +72,14 @@ QVariant Function_Table_Model::data(const QModelIndex& index, int role) const {
 
     case Qt::BackgroundRole:
       switch (index.column()) {
+        case 1: {
+          const std::optional<Stack_Usage_Check>& check =
+              this->get_stack_size_data(*function_index)->stack_usage_check;
+          if (check.has_value() && !check->is_consistent) {
+            return warning_background_brush;
+          }
+          break;
+        }
         case 2: {
           Cached_Function_Data* data = this->get_function_data(index.row());
           if (data == nullptr || !data->errors_for_tool_tip.empty()) {
@@ -55,7 +88,6 @@ QVariant Function_Table_Model::data(const QModelIndex& index, int role) const {
           break;
         }
         case 0:
-        case 1:
         default:
           break;
       }
@@ -63,6 +95,23 @@ QVariant Function_Table_Model::data(const QModelIndex& index, int role) const {
 
     case Qt::ToolTipRole:
       switch (index.column()) {
+        case 1: {
+          const std::optional<Stack_Usage_Check>& check =
+              this->get_stack_size_data(*function_index)->stack_usage_check;
+          if (!check.has_value()) {
+            break;
+          }
+          QString tool_tip =
+              QString("stack usage file: %1 bytes\n"
+                      "touched by machine code: %2 bytes")
+                  .arg(check->reported_stack_size)
+                  .arg(check->touched_stack_size);
+          if (!check->is_consistent) {
+            tool_tip += "\nThe machine code touches more stack than the "
+                        "stack usage file reported.";
+          }
+          return tool_tip;
+        }
         case 2: {
           Cached_Function_Data* data = this->get_function_data(index.row());
           if (data == nullptr) {
@@ -78,7 +127,6 @@ QVariant Function_Table_Model::data(const QModelIndex& index, int role) const {
         }
 
         case 0:
-        case 1:
         default:
           break;
       }
@@ -95,7 +143,7 @@ QVariant Function_Table_Model::headerData(int section,
       case 0:
         return QString("function");
       case 1:
-        return QString("self size");
+        return QString("stack size");
       case 2:
         return QString("params size");
     }
@@ -106,24 +154,69 @@ QVariant Function_Table_Model::headerData(int section,
 void Function_Table_Model::sync_data_from_project() {
   this->beginResetModel();
 
-  this->functions_ = this->project_->get_all_functions(*this->logger_);
+  this->functions_ = &this->project_->get_all_functions(*this->logger_);
   this->type_table_ = this->project_->get_type_table(*this->logger_);
   this->type_index_table_ =
       this->project_->get_type_index_table(*this->logger_);
   this->function_data_cache_.clear();
+  this->project_->get_cache_budget().remove_all_entries(
+      this->function_data_cache_id_);
+  this->stack_size_cache_.clear();
+  this->project_->get_cache_budget().remove_all_entries(
+      this->stack_size_cache_id_);
+  if (this->has_name_filter_) {
+    this->project_->find_functions_by_name(
+        this->name_filter_, this->filtered_function_indexes_, *this->logger_);
+  }
+
+  this->endResetModel();
+}
+
+void Function_Table_Model::set_name_filter(std::u8string_view pattern) {
+  this->beginResetModel();
+
+  this->name_filter_ = pattern;
+  this->has_name_filter_ = !pattern.empty();
+  if (this->has_name_filter_) {
+    this->project_->find_functions_by_name(
+        this->name_filter_, this->filtered_function_indexes_, *this->logger_);
+  } else {
+    this->filtered_function_indexes_.clear();
+  }
 
   this->endResetModel();
 }
 
-const CodeView_Function* Function_Table_Model::get_function(
+U64 Function_Table_Model::row_to_function_index(U64 row) const {
+  if (this->has_name_filter_) {
+    CSS_ASSERT(row < this->filtered_function_indexes_.size());
+    return this->filtered_function_indexes_[row];
+  }
+  return row;
+}
+
+std::optional<CodeView_Function> Function_Table_Model::get_function(
+    const QModelIndex& index) const {
+  std::optional<U64> function_index = this->get_function_index(index);
+  if (!function_index.has_value()) {
+    return std::nullopt;
+  }
+  return (*this->functions_)[*function_index];
+}
+
+std::optional<U64> Function_Table_Model::get_function_index(
     const QModelIndex& index) const {
   CSS_ASSERT(index.row() >= 0);
-  U64 row = narrow_cast<U64>(index.row());
-  CSS_ASSERT(row < this->functions_.size());
-  if (row >= this->functions_.size()) {
-    return nullptr;
+  if (this->functions_ == nullptr) {
+    return std::nullopt;
   }
-  return &this->functions_[index.row()];
+  U64 function_index =
+      this->row_to_function_index(narrow_cast<U64>(index.row()));
+  CSS_ASSERT(function_index < this->functions_->size());
+  if (function_index >= this->functions_->size()) {
+    return std::nullopt;
+  }
+  return function_index;
 }
 
 Function_Table_Model::Cached_Function_Data*
@@ -133,23 +226,70 @@ Function_Table_Model::get_function_data(const QModelIndex& index) const {
 
 Function_Table_Model::Cached_Function_Data*
 Function_Table_Model::get_function_data(U64 row) const {
-  CSS_ASSERT(row < this->functions_.size());
+  U64 function_index = this->row_to_function_index(row);
+  CSS_ASSERT(function_index < this->functions_->size());
   if (this->type_table_ == nullptr || this->type_index_table_ == nullptr) {
     return nullptr;
   }
 
-  Cached_Function_Data* data = this->function_data_cache_[row];
-  if (data == nullptr) {
-    Capturing_Logger func_logger(this->logger_);
-    U32 caller_stack_size = this->functions_[row].get_caller_stack_size(
-        *this->type_table_, *this->type_index_table_, func_logger);
-    data = new Cached_Function_Data{
-        .caller_stack_size = caller_stack_size,
-    };
-    data->errors_for_tool_tip =
-        func_logger.get_logged_messages_string_for_tool_tip();
-    this->function_data_cache_.insert(row, data);
+  // NOTE(strager): The cache is keyed by function index, not by row, so
+  // entries stay valid when the name filter changes.
+  Cache_Budget& budget = this->project_->get_cache_budget();
+  auto it = this->function_data_cache_.find(function_index);
+  if (it != this->function_data_cache_.end()) {
+    budget.touch_entry(this->function_data_cache_id_, function_index);
+    return &it->second;
   }
-  return data;
+
+  Capturing_Logger func_logger(this->logger_);
+  U32 caller_stack_size =
+      (*this->functions_)[function_index].get_caller_stack_size(
+          *this->type_table_, *this->type_index_table_, func_logger);
+  Cached_Function_Data& data =
+      this->function_data_cache_
+          .emplace(function_index,
+                   Cached_Function_Data{
+                       .caller_stack_size = caller_stack_size,
+                       .errors_for_tool_tip =
+                           func_logger
+                               .get_logged_messages_string_for_tool_tip(),
+                   })
+          .first->second;
+  // NOTE(strager): This might evict other entries, but not this one.
+  budget.add_entry(
+      this->function_data_cache_id_, function_index,
+      sizeof(std::pair<const U64, Cached_Function_Data>) +
+          data.errors_for_tool_tip.capacity());
+  return &data;
+}
+
+const Function_Table_Model::Cached_Stack_Size_Data*
+Function_Table_Model::get_stack_size_data(U64 function_index) const {
+  CSS_ASSERT(function_index < this->functions_->size());
+  Cache_Budget& budget = this->project_->get_cache_budget();
+  auto it = this->stack_size_cache_.find(function_index);
+  if (it != this->stack_size_cache_.end()) {
+    budget.touch_entry(this->stack_size_cache_id_, function_index);
+    return &it->second;
+  }
+
+  // NOTE(strager): Both CodeView_Function::get_stack_size (for functions
+  // which use a frame pointer) and Project::get_stack_usage_check decode the
+  // function's machine code, so only do it for visible rows.
+  CodeView_Function function = (*this->functions_)[function_index];
+  const Cached_Stack_Size_Data& data =
+      this->stack_size_cache_
+          .emplace(function_index,
+                   Cached_Stack_Size_Data{
+                       .stack_size = function.get_stack_size(*this->logger_),
+                       .stack_usage_check =
+                           this->project_->get_stack_usage_check(
+                               function, *this->logger_),
+                   })
+          .first->second;
+  // NOTE(strager): This might evict other entries, but not this one.
+  budget.add_entry(this->stack_size_cache_id_, function_index,
+                   sizeof(std::pair<const U64, Cached_Stack_Size_Data>));
+  return &data;
 }
 }
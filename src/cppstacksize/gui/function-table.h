@@ -1,15 +1,19 @@
 #pragma once
 
 #include <QAbstractTableModel>
-#include <QCache>
+#include <cppstacksize/cache-budget.h>
+#include <cppstacksize/codeview-function-table.h>
 #include <cppstacksize/codeview.h>
+#include <cppstacksize/stack-usage.h>
 #include <optional>
-#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace cppstacksize {
 class Logger;
 class Project;
-struct CodeView_Function;
 
 class Function_Table_Model : public QAbstractTableModel {
   Q_OBJECT
@@ -25,7 +29,12 @@ class Function_Table_Model : public QAbstractTableModel {
                       int role) const override;
 
   void sync_data_from_project();
-  const CodeView_Function *get_function(const QModelIndex &) const;
+  // Returns a copy of the function.
+  std::optional<CodeView_Function> get_function(const QModelIndex &) const;
+
+  // Shows only functions whose name matches the pattern. See
+  // Function_Name_Index::find_matching.
+  void set_name_filter(std::u8string_view pattern);
 
  private:
   struct Cached_Function_Data {
@@ -34,15 +43,43 @@ class Function_Table_Model : public QAbstractTableModel {
     std::string errors_for_tool_tip;
   };
 
-  // Possibly returns nullptr.
+  // Possibly returns nullptr. The returned pointer is invalidated by the next
+  // call.
   Cached_Function_Data *get_function_data(const QModelIndex &index) const;
   Cached_Function_Data *get_function_data(U64 row) const;
 
-  std::span<const CodeView_Function> functions_;
+  struct Cached_Stack_Size_Data {
+    // See CodeView_Function::get_stack_size. (U32)-1 if unknown.
+    U32 stack_size;
+    // See Project::get_stack_usage_check.
+    std::optional<Stack_Usage_Check> stack_usage_check;
+  };
+
+  // The returned pointer is invalidated by the next call.
+  const Cached_Stack_Size_Data *get_stack_size_data(U64 function_index) const;
+
+  // Returns an index into functions_.
+  U64 row_to_function_index(U64 row) const;
+  // Returns an index into functions_, or null if the row has no function.
+  std::optional<U64> get_function_index(const QModelIndex &) const;
+
+  const CodeView_Function_Table *functions_ = nullptr;
+  // Indexes into functions_ of rows which match the name filter. If empty and
+  // has_name_filter_ is false, every function is shown.
+  std::vector<U32> filtered_function_indexes_;
+  bool has_name_filter_ = false;
+  std::u8string name_filter_;
   CodeView_Type_Table *type_table_ = nullptr;
   CodeView_Type_Table *type_index_table_ = nullptr;
   Project *project_;
   Logger *logger_;
-  mutable QCache<U64, Cached_Function_Data> function_data_cache_;
+  // Key is an index into functions_. Entries are evicted by the Project's
+  // Cache_Budget.
+  mutable std::unordered_map<U64, Cached_Function_Data> function_data_cache_;
+  Cache_Budget::Cache_ID function_data_cache_id_;
+  // Key is an index into functions_. Entries are evicted by the Project's
+  // Cache_Budget.
+  mutable std::unordered_map<U64, Cached_Stack_Size_Data> stack_size_cache_;
+  Cache_Budget::Cache_ID stack_size_cache_id_;
 };
 }
@@ -7,12 +7,16 @@
 namespace cppstacksize {
 Locals_Table_Model::Locals_Table_Model(Project* project, Logger* logger,
                                        QObject* parent)
-    : QAbstractTableModel(parent),
-      project_(project),
-      logger_(logger),
-      local_data_cache_(100) {}
+    : QAbstractTableModel(parent), project_(project), logger_(logger) {
+  this->local_data_cache_id_ = this->project_->get_cache_budget().add_cache(
+      "locals table rows", [this](U64 row) -> void {
+        this->local_data_cache_.erase(row);
+      });
+}
 
-Locals_Table_Model::~Locals_Table_Model() = default;
+Locals_Table_Model::~Locals_Table_Model() {
+  this->project_->get_cache_budget().remove_cache(this->local_data_cache_id_);
+}
 
 int Locals_Table_Model::rowCount(const QModelIndex&) const {
   return narrow_cast<int>(this->locals_.size());
@@ -110,14 +114,17 @@ QVariant Locals_Table_Model::headerData(int section,
 
 void Locals_Table_Model::set_function(const CodeView_Function* function) {
   this->beginResetModel();
-  this->function_ = function;
-  if (this->function_) {
+  if (function) {
+    this->function_ = *function;
     this->locals_ = this->function_->get_locals(this->function_->byte_offset,
                                                 *this->logger_);
   } else {
+    this->function_ = std::nullopt;
     this->locals_.clear();
   }
   this->local_data_cache_.clear();
+  this->project_->get_cache_budget().remove_all_entries(
+      this->local_data_cache_id_);
   this->endResetModel();
 }
 
@@ -125,17 +132,32 @@ Locals_Table_Model::Cached_Local_Data* Locals_Table_Model::get_local_data(
     U64 row) const {
   CSS_ASSERT(row < this->locals_.size());
 
-  Cached_Local_Data* data = this->local_data_cache_[row];
-  if (data == nullptr) {
-    Capturing_Logger logger(this->logger_);
-    const CodeView_Function_Local& local = this->locals_[row];
-    data = new Cached_Local_Data{
-        .type = local.get_type(this->project_->get_type_table(), logger),
-    };
-    data->errors_for_tool_tip =
-        logger.get_logged_messages_string_for_tool_tip();
-    this->local_data_cache_.insert(row, data);
+  Cache_Budget& budget = this->project_->get_cache_budget();
+  auto it = this->local_data_cache_.find(row);
+  if (it != this->local_data_cache_.end()) {
+    budget.touch_entry(this->local_data_cache_id_, row);
+    return &it->second;
+  }
+
+  Capturing_Logger logger(this->logger_);
+  const CodeView_Function_Local& local = this->locals_[row];
+  Cached_Local_Data& data =
+      this->local_data_cache_
+          .emplace(row,
+                   Cached_Local_Data{
+                       .type = local.get_type(this->project_->get_type_table(),
+                                              logger),
+                       .errors_for_tool_tip =
+                           logger.get_logged_messages_string_for_tool_tip(),
+                   })
+          .first->second;
+  U64 byte_size = sizeof(std::pair<const U64, Cached_Local_Data>) +
+                  data.errors_for_tool_tip.capacity();
+  if (data.type.has_value()) {
+    byte_size += data.type->name.capacity();
   }
-  return data;
+  // NOTE(strager): This might evict other entries, but not this one.
+  budget.add_entry(this->local_data_cache_id_, row, byte_size);
+  return &data;
 }
 }
@@ -1,15 +1,15 @@
 #pragma once
 
 #include <QAbstractTableModel>
-#include <QCache>
+#include <cppstacksize/cache-budget.h>
 #include <cppstacksize/codeview.h>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 namespace cppstacksize {
 class Logger;
 class Project;
-struct CodeView_Function;
 
 class Locals_Table_Model : public QAbstractTableModel {
   Q_OBJECT
@@ -25,6 +25,7 @@ class Locals_Table_Model : public QAbstractTableModel {
   QVariant headerData(int section, Qt::Orientation orientation,
                       int role) const override;
 
+  // Copies the function.
   void set_function(const CodeView_Function *function);
 
  private:
@@ -34,12 +35,16 @@ class Locals_Table_Model : public QAbstractTableModel {
     std::string errors_for_tool_tip;
   };
 
+  // The returned pointer is invalidated by the next call.
   Cached_Local_Data *get_local_data(U64 row) const;
 
   Project *project_;
   Logger *logger_;
-  const CodeView_Function *function_ = nullptr;
+  std::optional<CodeView_Function> function_;
   std::vector<CodeView_Function_Local> locals_;
-  mutable QCache<U64, Cached_Local_Data> local_data_cache_;
+  // Key is an index into locals_. Entries are evicted by the Project's
+  // Cache_Budget.
+  mutable std::unordered_map<U64, Cached_Local_Data> local_data_cache_;
+  Cache_Budget::Cache_ID local_data_cache_id_;
 };
 }
@@ -1,15 +1,25 @@
 #include <QAction>
 #include <QDockWidget>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QHeaderView>
 #include <QMainWindow>
 #include <QMenuBar>
 #include <QSplitter>
+#include <QVBoxLayout>
+#include <algorithm>
 #include <cppstacksize/gui/main-window.h>
 #include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace cppstacksize {
 Main_Window::Main_Window() {
+  this->set_cache_budget(default_cache_budget_bytes);
+
   QMenu *file_menu = this->menuBar()->addMenu("&File");
   QAction *open_action = new QAction("&Open...");
   open_action->setShortcuts(QKeySequence::Open);
@@ -17,6 +27,15 @@ Main_Window::Main_Window() {
   connect(open_action, &QAction::triggered, this, &Main_Window::do_open);
   file_menu->addAction(open_action);
 
+  this->file_reload_timer_.setSingleShot(true);
+  this->file_reload_timer_.setInterval(500);
+  connect(&this->file_reload_timer_, &QTimer::timeout, this,
+          &Main_Window::reload_changed_files);
+  connect(&this->file_watcher_, &QFileSystemWatcher::fileChanged, this,
+          &Main_Window::changed_file);
+  connect(&this->file_watcher_, &QFileSystemWatcher::directoryChanged, this,
+          &Main_Window::changed_directory);
+
   this->function_table_.setShowGrid(false);
   this->function_table_.verticalHeader()->setVisible(false);
   this->function_table_.setSortingEnabled(true);
@@ -28,7 +47,17 @@ Main_Window::Main_Window() {
   connect(this->function_table_.selectionModel(),
           &QItemSelectionModel::selectionChanged, this,
           &Main_Window::changed_selected_function);
-  this->setCentralWidget(&this->function_table_);
+
+  this->function_filter_.setPlaceholderText(
+      "Filter functions (substring, or glob with * and ?)");
+  this->function_filter_.setClearButtonEnabled(true);
+  connect(&this->function_filter_, &QLineEdit::textChanged, this,
+          &Main_Window::changed_function_filter);
+  QVBoxLayout *function_panel_layout = new QVBoxLayout(&this->function_panel_);
+  function_panel_layout->setContentsMargins(0, 0, 0, 0);
+  function_panel_layout->addWidget(&this->function_filter_);
+  function_panel_layout->addWidget(&this->function_table_);
+  this->setCentralWidget(&this->function_panel_);
 
   this->locals_table_.setShowGrid(false);
   this->locals_table_.verticalHeader()->setVisible(false);
@@ -64,29 +93,122 @@ Main_Window::Main_Window() {
   this->addDockWidget(Qt::BottomDockWidgetArea, dock);
 }
 
+void Main_Window::set_cache_budget(U64 max_bytes) {
+  this->project_.get_cache_budget().set_max_bytes(max_bytes);
+}
+
 void Main_Window::open_files(std::span<const QString> file_paths) {
-  this->project_.clear();
+  // NOTE(strager): Files which were already open are reloaded instead of
+  // re-added so that functions in unchanged PDB modules are not scanned again.
+  std::vector<std::string> removed_names;
+  for (std::string_view name : this->project_.get_file_names()) {
+    if (std::find(file_paths.begin(), file_paths.end(),
+                  QString::fromStdString(std::string(name))) ==
+        file_paths.end()) {
+      removed_names.emplace_back(name);
+    }
+  }
+  for (const std::string &name : removed_names) {
+    this->project_.remove_file(name);
+  }
+  this->project_.clear_stack_usage_files();
+  if (!this->file_watcher_.files().isEmpty()) {
+    this->file_watcher_.removePaths(this->file_watcher_.files());
+  }
+  if (!this->file_watcher_.directories().isEmpty()) {
+    this->file_watcher_.removePaths(this->file_watcher_.directories());
+  }
+  this->watched_file_paths_.clear();
+  this->changed_file_paths_.clear();
 
+  std::vector<std::string> stack_usage_paths;
   for (const QString &path : file_paths) {
     std::string path_std_string = path.toStdString();
+    if (path.endsWith(".su")) {
+      stack_usage_paths.push_back(std::move(path_std_string));
+      continue;
+    }
     qDebug() << "adding file" << path_std_string.c_str() << "to project";
-    this->project_.add_file(path_std_string,
-                            Loaded_File::load(path_std_string.c_str()));
+    this->project_.reload_file(path_std_string,
+                               Loaded_File::load(path_std_string.c_str()),
+                               this->logger_);
+    this->watched_file_paths_.append(path);
+    this->file_watcher_.addPath(path);
+    this->file_watcher_.addPath(QFileInfo(path).absolutePath());
+  }
+  if (!stack_usage_paths.empty()) {
+    qDebug() << "adding" << stack_usage_paths.size()
+             << "stack usage files to project";
+    this->project_.add_stack_usage_files(stack_usage_paths, this->logger_);
+  }
+
+  this->sync_data_from_project();
+}
+
+void Main_Window::changed_file(const QString &path) {
+  this->changed_file_paths_.insert(path);
+  this->file_reload_timer_.start();
+}
+
+void Main_Window::changed_directory(const QString &path) {
+  // NOTE(strager): QFileSystemWatcher stops watching a file if the file is
+  // deleted, which happens if a linker replaces the file. Start watching the
+  // new file.
+  QStringList watched_files = this->file_watcher_.files();
+  for (const QString &file_path : this->watched_file_paths_) {
+    if (!watched_files.contains(file_path) &&
+        QFileInfo(file_path).absolutePath() == path &&
+        QFileInfo::exists(file_path)) {
+      this->file_watcher_.addPath(file_path);
+      this->changed_file(file_path);
+    }
+  }
+}
+
+void Main_Window::reload_changed_files() {
+  bool reloaded_any_file = false;
+  for (const QString &path : std::exchange(this->changed_file_paths_, {})) {
+    if (!QFileInfo::exists(path)) {
+      // The file was deleted. Keep the old copy until the file is recreated
+      // (see changed_directory).
+      continue;
+    }
+    std::string path_std_string = path.toStdString();
+    qDebug() << "reloading file" << path_std_string.c_str();
+    this->project_.reload_file(path_std_string,
+                               Loaded_File::load(path_std_string.c_str()),
+                               this->logger_);
+    reloaded_any_file = true;
+  }
+  if (reloaded_any_file) {
+    this->sync_data_from_project();
   }
+}
 
+void Main_Window::sync_data_from_project() {
+  // NOTE(strager): The selected function might have been freed.
+  this->locals_table_model_.set_function(nullptr);
+  this->stack_map_table_model_.set_function(nullptr);
   this->function_table_model_.sync_data_from_project();
 }
 
 void Main_Window::do_open() {
   QFileDialog dialog(this);
   dialog.setFileMode(QFileDialog::ExistingFiles);
-  dialog.setNameFilter(tr("Binaries (*.dll *.exe *.obj *.pdb)"));
+  dialog.setNameFilter(tr("Binaries (*.dll *.exe *.obj *.pdb *.su)"));
 
   if (dialog.exec()) {
     this->open_files(dialog.selectedFiles());
   }
 }
 
+void Main_Window::changed_function_filter(const QString &text) {
+  QByteArray pattern = text.toUtf8();
+  this->function_table_model_.set_name_filter(std::u8string_view(
+      reinterpret_cast<const char8_t *>(pattern.data()),
+      narrow_cast<std::size_t>(pattern.size())));
+}
+
 void Main_Window::changed_selected_function(
     const QItemSelection &selected,
     [[maybe_unused]] const QItemSelection &deselected) {
@@ -104,12 +226,14 @@ void Main_Window::changed_selected_function(
     }
   }
 
-  const CodeView_Function *selected_function =
-      selected_indexes.empty() ? nullptr
+  std::optional<CodeView_Function> selected_function =
+      selected_indexes.empty() ? std::nullopt
                                : this->function_table_model_.get_function(
                                      this->function_table_sorter_.mapToSource(
                                          selected_indexes.at(0)));
-  this->locals_table_model_.set_function(selected_function);
-  this->stack_map_table_model_.set_function(selected_function);
+  const CodeView_Function *selected_function_ptr =
+      selected_function.has_value() ? &*selected_function : nullptr;
+  this->locals_table_model_.set_function(selected_function_ptr);
+  this->stack_map_table_model_.set_function(selected_function_ptr);
 }
 }
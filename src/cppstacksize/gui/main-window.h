@@ -1,9 +1,15 @@
 #pragma once
 
+#include <QFileSystemWatcher>
 #include <QItemSelection>
+#include <QLineEdit>
 #include <QMainWindow>
+#include <QSet>
 #include <QSortFilterProxyModel>
+#include <QStringList>
 #include <QTableView>
+#include <QTimer>
+#include <QWidget>
 #include <cppstacksize/gui/function-table.h>
 #include <cppstacksize/gui/locals-table.h>
 #include <cppstacksize/gui/log-table.h>
@@ -14,21 +20,44 @@ namespace cppstacksize {
 class Main_Window : public QMainWindow {
   Q_OBJECT
  public:
+  // Default limit for memory used by recomputable data. See
+  // Project::get_cache_budget.
+  static constexpr U64 default_cache_budget_bytes = U64{256} * 1024 * 1024;
+
   explicit Main_Window();
 
   void open_files(std::span<const QString>);
+  void set_cache_budget(U64 max_bytes);
 
  private slots:
   void do_open();
+  void changed_function_filter(const QString &text);
   void changed_selected_function(const QItemSelection &selected,
                                  const QItemSelection &deselected);
+  void changed_file(const QString &path);
+  void changed_directory(const QString &path);
+  void reload_changed_files();
 
  private:
+  void sync_data_from_project();
+
   Project project_;
 
+  // Watches opened files (except .su files) and their directories.
+  QFileSystemWatcher file_watcher_;
+  QStringList watched_file_paths_;
+  // Delays reloading so a file being written by a linker is reloaded once,
+  // after the linker finishes.
+  QTimer file_reload_timer_;
+  QSet<QString> changed_file_paths_;
+
   QTableView log_table_;
   Log_Table_Model logger_;
 
+  // Contains function_filter_ and function_table_. Declared before them so
+  // they are destroyed first.
+  QWidget function_panel_;
+  QLineEdit function_filter_;
   QTableView function_table_;
   Function_Table_Model function_table_model_ =
       Function_Table_Model(&this->project_, &this->logger_);
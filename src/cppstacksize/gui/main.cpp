@@ -1,6 +1,7 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <cppstacksize/gui/main-window.h>
+#include <cstdio>
 
 using namespace cppstacksize;
 
@@ -12,9 +13,26 @@ int main(int argc, char **argv) {
   parser.addVersionOption();
   parser.addPositionalArgument("files", "List of files to open on start.",
                                "[FILE ...]");
+  QCommandLineOption cache_budget_option(
+      "cache-budget",
+      "Memory to use for recomputable data such as type tables, in MiB.",
+      "MiB",
+      QString::number(Main_Window::default_cache_budget_bytes / 1024 / 1024));
+  parser.addOption(cache_budget_option);
   parser.process(app);
 
+  bool cache_budget_ok;
+  qulonglong cache_budget_mib =
+      parser.value(cache_budget_option).toULongLong(&cache_budget_ok);
+  if (!cache_budget_ok ||
+      cache_budget_mib > Cache_Budget::unlimited / 1024 / 1024) {
+    std::fprintf(stderr, "error: invalid --cache-budget: %s\n",
+                 qPrintable(parser.value(cache_budget_option)));
+    return 1;
+  }
+
   Main_Window window;
+  window.set_cache_budget(U64{cache_budget_mib} * 1024 * 1024);
   window.open_files(parser.positionalArguments());
   window.show();
   return app.exec();
@@ -108,8 +108,8 @@ void Stack_Map_Table_Model::set_function(const CodeView_Function* function) {
   this->stack_map_.clear();
   this->touch_locations_.clear();
 
-  this->function_ = function;
   if (function) {
+    this->function_ = *function;
     std::optional<Sub_File_Reader<Span_Reader>> instructions_reader =
         function->get_instruction_bytes_reader(*this->logger_);
     if (instructions_reader.has_value()) {
@@ -117,6 +117,8 @@ void Stack_Map_Table_Model::set_function(const CodeView_Function* function) {
       instructions_reader->copy_bytes_into(instruction_bytes, 0);
       this->stack_map_ = analyze_x86_64_stack_map(instruction_bytes);
     }
+  } else {
+    this->function_ = std::nullopt;
   }
   this->update_touch_locations();
   this->update_touch_groups();
@@ -135,13 +137,22 @@ void Stack_Map_Table_Model::update_touch_locations() {
     return;
   }
 
+  std::optional<CodeView_Code_Location> code_location =
+      !this->function_.has_value()
+          ? std::nullopt
+          : this->function_->get_code_location(*this->logger_);
+  if (!code_location.has_value()) {
+    // See NOTE[touch-locations-size].
+    this->touch_locations_.resize(this->stack_map_.touches.size());
+    return;
+  }
+
   for (Stack_Map_Touch& touch : this->stack_map_.touches) {
     Capturing_Logger logger(this->logger_);
     Stack_Map_Touch_Location touch_location = {
         .line_source_info = line_tables->source_info_for_offset(
-            this->function_->line_tables_handle,
-            this->function_->code_section_index,
-            this->function_->code_offset + touch.offset, logger),
+            this->function_->line_tables_handle, code_location->section_index,
+            code_location->offset + touch.offset, logger),
     };
     std::string errors_for_tool_tip =
         logger.get_logged_messages_string_for_tool_tip();
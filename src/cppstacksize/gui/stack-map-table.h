@@ -1,16 +1,16 @@
 #pragma once
 
 #include <QAbstractTableModel>
-#include <QCache>
 #include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/codeview.h>
 #include <cppstacksize/stack-map-touch-group.h>
 #include <memory_resource>
+#include <optional>
 #include <vector>
 
 namespace cppstacksize {
 class Logger;
 class Project;
-struct CodeView_Function;
 
 class Stack_Map_Table_Model : public QAbstractTableModel {
   Q_OBJECT
@@ -26,6 +26,7 @@ class Stack_Map_Table_Model : public QAbstractTableModel {
   QVariant headerData(int section, Qt::Orientation orientation,
                       int role) const override;
 
+  // Copies the function.
   void set_function(const CodeView_Function *function);
 
  private:
@@ -44,7 +45,7 @@ class Stack_Map_Table_Model : public QAbstractTableModel {
   // stack_map_.touches[i].
   std::vector<Stack_Map_Touch_Location> touch_locations_;
   Stack_Map_Touch_Groups touch_groups_;
-  const CodeView_Function *function_ = nullptr;
+  std::optional<CodeView_Function> function_;
 
   std::pmr::monotonic_buffer_resource touch_location_strings_;
 };
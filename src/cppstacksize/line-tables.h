@@ -1,14 +1,15 @@
 #pragma once
 
 #include <cppstacksize/base.h>
+#include <cppstacksize/cache-budget.h>
 #include <cppstacksize/codeview-constants.h>
+#include <cppstacksize/extent-reader.h>
 #include <cppstacksize/logger.h>
 #include <cppstacksize/pdb-reader.h>
 #include <cppstacksize/pdb.h>
 #include <cppstacksize/reader.h>
 #include <cppstacksize/util.h>
 #include <iosfwd>
-#include <variant>
 #include <vector>
 
 namespace cppstacksize {
@@ -45,7 +46,27 @@ class Line_Tables {
     bool is_null() const { return this->module_index == null_module_index; }
   };
 
-  void clear() { this->modules_.clear(); }
+  void clear() {
+    this->modules_.clear();
+    if (this->cache_budget_ != nullptr) {
+      this->cache_budget_->remove_all_entries(this->cache_id_);
+    }
+  }
+
+  // Accounts for each module's index of line subsections in the given cache.
+  // The cache's evict function should call evict_module_index.
+  void set_cache_budget(Cache_Budget* budget, Cache_Budget::Cache_ID cache_id) {
+    this->cache_budget_ = budget;
+    this->cache_id_ = cache_id;
+  }
+
+  // Frees memory used to speed up queries for the given module. The memory is
+  // reallocated by the next query.
+  void evict_module_index(Handle handle) {
+    Module& module = this->modules_.at(handle.module_index);
+    module.subsection_offsets = std::vector<U64>();
+    module.found_subsections = false;
+  }
 
   // pdb_streams[module.debug_info_stream_index] must remain valid.
   template <class Reader>
@@ -70,11 +91,32 @@ class Line_Tables {
 
   // Copies codeview_reader. Data referenced by codeview_reader must remain
   // valid.
-  template <class Reader>
-  Handle add_module_line_tables(Reader codeview_reader) {
+  //
+  // codeview_reader is not read until the module's line tables are first
+  // queried.
+  Handle add_module_line_tables(Extent_Reader codeview_reader) {
     U64 module_index = this->modules_.size();
-    Module& module = this->modules_.emplace_back(codeview_reader);
+    this->modules_.emplace_back(codeview_reader);
+    return Handle{.module_index = module_index};
+  }
 
+  Line_Source_Info source_info_for_offset(Handle handle, U32 code_section_index,
+                                          U32 instruction_offset,
+                                          Logger& logger = fallback_logger);
+
+ private:
+  struct Module {
+    explicit Module(Extent_Reader r) : reader(r) {}
+
+    Extent_Reader reader;
+    // Populated by find_subsections.
+    std::vector<U64> subsection_offsets;
+    bool found_subsections = false;
+  };
+
+  // Populates module.subsection_offsets.
+  static void find_subsections(Module& module,
+                               const Extent_Reader& codeview_reader) {
     U64 offset = 0;
     for (;;) {
       offset = align_up(offset, 4);
@@ -96,35 +138,21 @@ class Line_Tables {
       }
       offset += subsection_size;
     }
-    return Handle{.module_index = module_index};
+    module.found_subsections = true;
   }
 
-  Line_Source_Info source_info_for_offset(Handle handle, U32 code_section_index,
-                                          U32 instruction_offset,
-                                          Logger& logger = fallback_logger);
-
- private:
-  struct Module {
-    template <class Reader>
-    explicit Module(Reader r) : reader(std::move(r)) {}
-
-    std::variant<Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>> reader;
-    std::vector<U64> subsection_offsets;
-  };
-
   // Searches for a match in a DEBUG_S_LINES subsection.
-  template <class Reader>
-  Line_Source_Info source_info_for_offset_in_subsection(const Reader& reader,
-                                                        U32 code_section_index,
-                                                        U32 instruction_offset,
-                                                        Logger& logger);
+  Line_Source_Info source_info_for_offset_in_subsection(
+      const Extent_Reader& reader, U32 code_section_index,
+      U32 instruction_offset, Logger& logger);
 
   std::vector<Module> modules_;
+  Cache_Budget* cache_budget_ = nullptr;
+  Cache_Budget::Cache_ID cache_id_ = 0;
 };
 
-template <class Reader>
 inline Line_Source_Info Line_Tables::source_info_for_offset_in_subsection(
-    const Reader& reader, U32 code_section_index, U32 instruction_offset,
+    const Extent_Reader& reader, U32 code_section_index, U32 instruction_offset,
     Logger& logger) {
   U32 instructions_start_offset = reader.u32(0);
   U32 current_code_section_index = U32{reader.u16(4)} - 1;
@@ -208,22 +236,27 @@ inline Line_Source_Info Line_Tables::source_info_for_offset(
     Logger& logger) {
   CSS_ASSERT(!handle.is_null());
   Module& module = this->modules_.at(handle.module_index);
-  return std::visit(
-      [&](auto& reader) -> Line_Source_Info {
-        for (U64 subsection_offset : module.subsection_offsets) {
-          CSS_ASSERT(reader.u32(subsection_offset + 0) == DEBUG_S_LINES);
-          U32 subsection_size = reader.u32(subsection_offset + 4);
-          Sub_File_Reader subsection_reader =
-              reader.sub_reader(subsection_offset + 8, subsection_size);
-          Line_Source_Info info = this->source_info_for_offset_in_subsection(
-              subsection_reader, code_section_index, instruction_offset,
-              logger);
-          if (!info.is_out_of_bounds()) {
-            return info;
-          }
-        }
-        return Line_Source_Info::out_of_bounds();
-      },
-      module.reader);
+  const Extent_Reader& reader = module.reader;
+  if (!module.found_subsections) {
+    find_subsections(module, reader);
+    if (this->cache_budget_ != nullptr) {
+      this->cache_budget_->add_entry(
+          this->cache_id_, handle.module_index,
+          module.subsection_offsets.capacity() * sizeof(U64));
+    }
+  } else if (this->cache_budget_ != nullptr) {
+    this->cache_budget_->touch_entry(this->cache_id_, handle.module_index);
+  }
+  for (U64 subsection_offset : module.subsection_offsets) {
+    CSS_ASSERT(reader.u32(subsection_offset + 0) == DEBUG_S_LINES);
+    U32 subsection_size = reader.u32(subsection_offset + 4);
+    Line_Source_Info info = this->source_info_for_offset_in_subsection(
+        reader.sub_reader(subsection_offset + 8, subsection_size),
+        code_section_index, instruction_offset, logger);
+    if (!info.is_out_of_bounds()) {
+      return info;
+    }
+  }
+  return Line_Source_Info::out_of_bounds();
 }
 }
@@ -4,6 +4,7 @@
 #include <cppstacksize/reader.h>
 #include <optional>
 #include <span>
+#include <stdexcept>
 #include <vector>
 
 namespace cppstacksize {
@@ -23,7 +24,10 @@ class PDB_Blocks_Reader : public Reader_Base<PDB_Blocks_Reader<Base_Reader_T>> {
 
   U64 size() const { return this->byte_size_; }
 
+  const Base_Reader* base_reader() const { return this->base_reader_; }
   std::span<const U32> blocks() const { return this->block_indexes_; }
+  U32 block_size() const { return this->block_size_; }
+  U32 stream_index() const { return this->stream_index_; }
 
   Location locate(U64 offset) const {
     U32 block_index = this->block_indexes_[offset / this->block_size_];
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <cppstacksize/codeview-constants.h>
 #include <cppstacksize/guid.h>
 #include <cppstacksize/logger.h>
 #include <cppstacksize/pdb-reader.h>
 #include <cppstacksize/reader.h>
 #include <cppstacksize/util.h>
+#include <optional>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace cppstacksize {
@@ -136,10 +142,225 @@ struct PDB_DBI_Module {
   }
 };
 
+// Describes which module contributed a range of bytes to a PE section.
+struct PDB_DBI_Section_Contribution {
+  U16 pe_section_index;
+  U32 offset;
+  U32 size;
+  // IMAGE_SCN_* flags.
+  U32 characteristics;
+  // Index into PDB_DBI::modules.
+  U16 module_index;
+
+  U32 end_offset() const { return this->offset + this->size; }
+};
+
+struct PDB_DBI_Section_Map_Entry {
+  U16 flags;
+  // 1-based index of the PE section, or 0 if none.
+  U16 frame;
+  U32 offset;
+  U32 size;
+};
+
 struct PDB_DBI {
   std::vector<PDB_DBI_Module> modules;
+
+  // Sorted by pe_section_index then by offset.
+  std::vector<PDB_DBI_Section_Contribution> section_contributions;
+  std::vector<PDB_DBI_Section_Map_Entry> section_map;
+
+  // Module i's source files are source_file_name_offsets[j] for
+  // module_source_file_begin_indexes[i] <= j <
+  // module_source_file_begin_indexes[i + 1]. Each offset points to a
+  // null-terminated path in source_file_names.
+  std::vector<U32> module_source_file_begin_indexes;
+  std::vector<U32> source_file_name_offsets;
+  std::u8string source_file_names;
+
+  // Stream containing copies of the PE file's section headers.
+  std::optional<U16> section_header_stream_index;
+
+  // Stream containing the hash table for global symbols (GSI).
+  std::optional<U16> global_symbol_stream_index;
+  // Stream containing the hash table for public symbols (PSI).
+  std::optional<U16> public_symbol_stream_index;
+  // Stream containing the symbol records referenced by the global and public
+  // symbol hash tables.
+  std::optional<U16> symbol_record_stream_index;
+
+  // Returns the section contribution containing the given byte, or null if
+  // there is none.
+  const PDB_DBI_Section_Contribution* find_section_contribution(
+      U16 pe_section_index, U32 offset) const {
+    auto it = std::upper_bound(
+        this->section_contributions.begin(), this->section_contributions.end(),
+        std::pair(pe_section_index, offset),
+        [](const std::pair<U16, U32>& address,
+           const PDB_DBI_Section_Contribution& contribution) -> bool {
+          return address <
+                 std::pair(contribution.pe_section_index, contribution.offset);
+        });
+    if (it == this->section_contributions.begin()) {
+      return nullptr;
+    }
+    --it;
+    if (it->pe_section_index != pe_section_index ||
+        offset >= it->end_offset()) {
+      return nullptr;
+    }
+    return &*it;
+  }
+
+  // Returns the index into this->modules of the module which contributed the
+  // given byte.
+  std::optional<U16> find_module_index(U16 pe_section_index,
+                                       U32 offset) const {
+    const PDB_DBI_Section_Contribution* contribution =
+        this->find_section_contribution(pe_section_index, offset);
+    if (contribution == nullptr) {
+      return std::nullopt;
+    }
+    return contribution->module_index;
+  }
+
+  U32 source_file_count(U64 module_index) const {
+    if (module_index + 1 >= this->module_source_file_begin_indexes.size()) {
+      return 0;
+    }
+    return this->module_source_file_begin_indexes[module_index + 1] -
+           this->module_source_file_begin_indexes[module_index];
+  }
+
+  std::u8string_view source_file_path(U64 module_index, U32 file_index) const {
+    CSS_ASSERT(file_index < this->source_file_count(module_index));
+    U32 name_offset =
+        this->source_file_name_offsets
+            [this->module_source_file_begin_indexes[module_index] + file_index];
+    if (name_offset >= this->source_file_names.size()) {
+      return std::u8string_view();
+    }
+    // NOTE(strager): source_file_names always ends with a null terminator.
+    return std::u8string_view(this->source_file_names.data() + name_offset);
+  }
 };
 
+template <class Reader>
+void parse_pdb_dbi_section_contributions(const Reader& reader, PDB_DBI& dbi,
+                                         Logger& logger) {
+  if (reader.size() == 0) {
+    return;
+  }
+  U32 version = reader.u32(0);
+  U64 entry_size;
+  switch (version) {
+    case 0xeffe0000 + 19970605:  // V60
+      entry_size = 28;
+      break;
+    case 0xeffe0000 + 20140516:  // V2
+      entry_size = 32;
+      break;
+    default:
+      logger.log(fmt::format("unsupported section contribution version: {:#x}",
+                             version),
+                 reader.locate(0));
+      return;
+  }
+
+  U64 entry_count = (reader.size() - 4) / entry_size;
+  dbi.section_contributions.reserve(entry_count);
+  for (U64 i = 0; i < entry_count; ++i) {
+    U64 offset = 4 + i * entry_size;
+    U16 section = reader.u16(offset + 0x00);
+    if (section == 0) {
+      continue;
+    }
+    dbi.section_contributions.push_back(PDB_DBI_Section_Contribution{
+        .pe_section_index = narrow_cast<U16>(section - 1),
+        .offset = reader.u32(offset + 0x04),
+        .size = reader.u32(offset + 0x08),
+        .characteristics = reader.u32(offset + 0x0c),
+        .module_index = reader.u16(offset + 0x10),
+    });
+  }
+
+  // NOTE(strager): Linkers write contributions in address order, so usually
+  // no sorting is needed.
+  auto contribution_less = [](const PDB_DBI_Section_Contribution& a,
+                              const PDB_DBI_Section_Contribution& b) -> bool {
+    return std::pair(a.pe_section_index, a.offset) <
+           std::pair(b.pe_section_index, b.offset);
+  };
+  if (!std::is_sorted(dbi.section_contributions.begin(),
+                      dbi.section_contributions.end(), contribution_less)) {
+    std::sort(dbi.section_contributions.begin(),
+              dbi.section_contributions.end(), contribution_less);
+  }
+}
+
+template <class Reader>
+void parse_pdb_dbi_section_map(const Reader& reader, PDB_DBI& dbi,
+                               Logger& logger) {
+  if (reader.size() == 0) {
+    return;
+  }
+  U16 entry_count = reader.u16(0);
+  constexpr U64 entry_size = 20;
+  if (4 + U64{entry_count} * entry_size > reader.size()) {
+    logger.log("section map is truncated", reader.locate(0));
+    entry_count = narrow_cast<U16>((reader.size() - 4) / entry_size);
+  }
+  dbi.section_map.reserve(entry_count);
+  for (U64 i = 0; i < entry_count; ++i) {
+    U64 offset = 4 + i * entry_size;
+    dbi.section_map.push_back(PDB_DBI_Section_Map_Entry{
+        .flags = reader.u16(offset + 0x00),
+        .frame = reader.u16(offset + 0x06),
+        .offset = reader.u32(offset + 0x0c),
+        .size = reader.u32(offset + 0x10),
+    });
+  }
+}
+
+template <class Reader>
+void parse_pdb_dbi_source_info(const Reader& reader, PDB_DBI& dbi,
+                               Logger& logger) {
+  if (reader.size() == 0) {
+    return;
+  }
+  U16 module_count = reader.u16(0);
+  if (module_count != dbi.modules.size()) {
+    logger.log(fmt::format("source info has {} modules but DBI has {}",
+                           module_count, dbi.modules.size()),
+               reader.locate(0));
+  }
+  // NOTE(strager): The header's file count is only 16 bits, so it is wrong
+  // for big programs. Add the per-module file counts instead.
+  U64 file_counts_offset = 4 + U64{module_count} * 2;
+  dbi.module_source_file_begin_indexes.reserve(module_count + 1);
+  U32 file_count = 0;
+  for (U64 i = 0; i < module_count; ++i) {
+    dbi.module_source_file_begin_indexes.push_back(file_count);
+    file_count += reader.u16(file_counts_offset + i * 2);
+  }
+  dbi.module_source_file_begin_indexes.push_back(file_count);
+
+  U64 name_offsets_offset = file_counts_offset + U64{module_count} * 2;
+  U64 names_offset = name_offsets_offset + U64{file_count} * 4;
+  if (names_offset > reader.size()) {
+    logger.log("source info is truncated", reader.locate(0));
+    dbi.module_source_file_begin_indexes.clear();
+    return;
+  }
+  dbi.source_file_name_offsets.resize(file_count);
+  for (U64 i = 0; i < file_count; ++i) {
+    dbi.source_file_name_offsets[i] = reader.u32(name_offsets_offset + i * 4);
+  }
+  dbi.source_file_names =
+      reader.utf_8_string(names_offset, reader.size() - names_offset);
+  dbi.source_file_names.push_back(u8'\0');
+}
+
 template <class Reader>
 PDB_DBI parse_pdb_dbi_stream(const Reader& reader,
                              Logger& logger = fallback_logger) {
@@ -148,13 +369,29 @@ PDB_DBI parse_pdb_dbi_stream(const Reader& reader,
     return dbi;
   }
 
+  auto stream_index = [&](U64 offset) -> std::optional<U16> {
+    U16 index = reader.u16(offset);
+    if (index == 0xffff) {
+      return std::nullopt;
+    }
+    return index;
+  };
+  dbi.global_symbol_stream_index = stream_index(0x0c);
+  dbi.public_symbol_stream_index = stream_index(0x10);
+  dbi.symbol_record_stream_index = stream_index(0x14);
+
   U32 module_info_size = reader.u32(0x18);
   U64 module_infos_begin = 0x40;
   Sub_File_Reader<Reader> module_infos_reader(&reader, module_infos_begin,
                                               module_info_size);
   U64 offset = 0;
-  while (offset < module_infos_reader.size()) {
+  for (;;) {
+    // NOTE(strager): The module info substream's size might include padding
+    // after the last entry.
     offset = align_up(offset, 4);
+    if (offset >= module_infos_reader.size()) {
+      break;
+    }
     U64 module_header_offset = offset + module_infos_reader.sub_file_offset();
     U16 module_section_section = module_infos_reader.u16(offset + 0x04);
     U16 module_section_offset = module_infos_reader.u16(offset + 0x08);
@@ -206,9 +443,127 @@ PDB_DBI parse_pdb_dbi_stream(const Reader& reader,
             },
     });
   }
+
+  U64 substream_offset = module_infos_begin + module_info_size;
+  U32 section_contribution_size = reader.u32(0x1c);
+  U32 section_map_size = reader.u32(0x20);
+  U32 source_info_size = reader.u32(0x24);
+  U32 type_server_map_size = reader.u32(0x28);
+  U32 optional_debug_header_size = reader.u32(0x30);
+  U32 ec_substream_size = reader.u32(0x34);
+
+  parse_pdb_dbi_section_contributions(
+      Sub_File_Reader<Reader>(&reader, substream_offset,
+                              section_contribution_size),
+      dbi, logger);
+  substream_offset += section_contribution_size;
+
+  parse_pdb_dbi_section_map(
+      Sub_File_Reader<Reader>(&reader, substream_offset, section_map_size),
+      dbi, logger);
+  substream_offset += section_map_size;
+
+  parse_pdb_dbi_source_info(
+      Sub_File_Reader<Reader>(&reader, substream_offset, source_info_size),
+      dbi, logger);
+  substream_offset += source_info_size;
+
+  substream_offset += type_server_map_size;
+  substream_offset += ec_substream_size;
+
+  // Optional debug header: an array of stream indexes. Index 5 is the section
+  // header stream.
+  constexpr U64 section_header_stream_offset = 5 * 2;
+  if (optional_debug_header_size >= section_header_stream_offset + 2) {
+    U16 index = reader.u16(substream_offset + section_header_stream_offset);
+    if (index != 0xffff) {
+      dbi.section_header_stream_index = index;
+    }
+  }
   return dbi;
 }
 
+// An S_PROCREF record from the global symbol stream.
+struct PDB_Procedure_Reference {
+  // Index into PDB_DBI::modules.
+  U16 module_index;
+  // Offset of the procedure's S_GPROC32 record from the beginning of the
+  // module's symbol stream.
+  U32 symbol_offset;
+};
+
+// Finds global procedures using the global symbol hash table (GSI) without
+// reading any module symbol streams.
+//
+// The result is sorted by module then by symbol offset, matching the order of
+// the procedures in the module symbol streams.
+template <class Reader>
+std::vector<PDB_Procedure_Reference> parse_pdb_global_procedure_references(
+    const Reader& global_symbol_reader, const Reader& symbol_record_reader,
+    Logger& logger = fallback_logger) {
+  std::vector<PDB_Procedure_Reference> references;
+  if (global_symbol_reader.size() == 0) {
+    return references;
+  }
+
+  U32 signature = global_symbol_reader.u32(0x0);
+  U32 version = global_symbol_reader.u32(0x4);
+  if (signature != 0xffffffff || version != 0xeffe0000 + 19990810) {
+    logger.log(fmt::format("unsupported global symbol stream version: {:#x}",
+                           version),
+               global_symbol_reader.locate(0x4));
+    return references;
+  }
+  U32 hash_records_size = global_symbol_reader.u32(0x8);
+  constexpr U64 hash_records_begin = 0x10;
+  constexpr U64 hash_record_size = 8;
+  U64 hash_record_count = hash_records_size / hash_record_size;
+  references.reserve(hash_record_count);
+  for (U64 i = 0; i < hash_record_count; ++i) {
+    U64 hash_record_offset = hash_records_begin + i * hash_record_size;
+    // NOTE(strager): The stored offset is one more than the record's offset.
+    U32 symbol_record_offset_plus_one =
+        global_symbol_reader.u32(hash_record_offset);
+    if (symbol_record_offset_plus_one == 0) {
+      logger.log("global symbol hash record has invalid offset",
+                 global_symbol_reader.locate(hash_record_offset));
+      continue;
+    }
+    U64 offset = symbol_record_offset_plus_one - 1;
+    if (offset + 4 > symbol_record_reader.size()) {
+      logger.log("global symbol hash record offset is out of bounds",
+                 global_symbol_reader.locate(hash_record_offset));
+      continue;
+    }
+    U16 record_type = symbol_record_reader.u16(offset + 2);
+    if (record_type != S_PROCREF) {
+      continue;
+    }
+    U16 module_number = symbol_record_reader.u16(offset + 12);
+    if (module_number == 0) {
+      logger.log("S_PROCREF has no module",
+                 symbol_record_reader.locate(offset + 12));
+      continue;
+    }
+    // NOTE(strager): The procedure's name follows, but callers get the name
+    // from the S_GPROC32 record, so don't bother reading it.
+    references.push_back(PDB_Procedure_Reference{
+        .module_index = narrow_cast<U16>(module_number - 1),
+        .symbol_offset = symbol_record_reader.u32(offset + 8),
+    });
+  }
+
+  std::sort(references.begin(), references.end(),
+            [](const PDB_Procedure_Reference& a,
+               const PDB_Procedure_Reference& b) -> bool {
+              if (a.module_index != b.module_index) {
+                return a.module_index < b.module_index;
+              }
+              return a.symbol_offset < b.symbol_offset;
+            });
+  return references;
+}
+
 template <class Reader>
 struct PDB_TPI {
   Sub_File_Reader<Reader> type_reader;
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cppstacksize/base.h>
 #include <cppstacksize/guid.h>
+#include <cppstacksize/logger.h>
 #include <cppstacksize/reader.h>
 #include <exception>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
@@ -11,11 +15,51 @@
 
 // Documentation:
 // https://learn.microsoft.com/en-us/windows/win32/debug/pe-format
+// https://learn.microsoft.com/en-us/cpp/build/exception-handling-x64
 
 enum {
   IMAGE_DEBUG_TYPE_CODEVIEW = 2,
 };
 
+enum {
+  IMAGE_SCN_LNK_NRELOC_OVFL = 0x01000000,
+};
+
+enum {
+  IMAGE_REL_AMD64_ABSOLUTE = 0x0000,
+  IMAGE_REL_AMD64_ADDR64 = 0x0001,
+  IMAGE_REL_AMD64_ADDR32 = 0x0002,
+  IMAGE_REL_AMD64_ADDR32NB = 0x0003,
+  IMAGE_REL_AMD64_REL32 = 0x0004,
+  IMAGE_REL_AMD64_REL32_1 = 0x0005,
+  IMAGE_REL_AMD64_REL32_2 = 0x0006,
+  IMAGE_REL_AMD64_REL32_3 = 0x0007,
+  IMAGE_REL_AMD64_REL32_4 = 0x0008,
+  IMAGE_REL_AMD64_REL32_5 = 0x0009,
+  IMAGE_REL_AMD64_SECTION = 0x000a,
+  IMAGE_REL_AMD64_SECREL = 0x000b,
+};
+
+enum {
+  UNW_FLAG_EHANDLER = 0x1,
+  UNW_FLAG_UHANDLER = 0x2,
+  UNW_FLAG_CHAININFO = 0x4,
+};
+
+enum {
+  UWOP_PUSH_NONVOL = 0,
+  UWOP_ALLOC_LARGE = 1,
+  UWOP_ALLOC_SMALL = 2,
+  UWOP_SET_FPREG = 3,
+  UWOP_SAVE_NONVOL = 4,
+  UWOP_SAVE_NONVOL_FAR = 5,
+  UWOP_EPILOG = 6,
+  UWOP_SPARE_CODE = 7,
+  UWOP_SAVE_XMM128 = 8,
+  UWOP_SAVE_XMM128_FAR = 9,
+  UWOP_PUSH_MACHFRAME = 10,
+};
+
 namespace cppstacksize {
 class PE_Magic_Mismatch_Error : public std::exception {
  public:
@@ -28,6 +72,36 @@ struct PE_Section {
   U32 virtual_address;
   U32 data_size;
   U32 data_file_offset;
+  U32 relocations_file_offset;
+  // If characteristics has IMAGE_SCN_LNK_NRELOC_OVFL, the true count is stored
+  // in the first relocation. See PE_File::get_section_relocations.
+  U32 relocation_count;
+  U32 characteristics;
+};
+
+struct COFF_Relocation {
+  // Offset within the section of the bytes to patch.
+  U32 offset;
+  U32 symbol_index;
+  U16 type;
+};
+
+struct COFF_Symbol {
+  std::u8string name;
+  U32 value;
+  // Zero-based. -1 if the symbol is external, absolute, or a debug symbol.
+  U32 section_index;
+  U8 storage_class;
+};
+
+// The thing a relocation points to, with any addend stored in the relocated
+// bytes already applied.
+struct COFF_Relocation_Target {
+  COFF_Symbol symbol;
+  U16 relocation_type;
+  // Offset within the symbol's section. Meaningless if the symbol's
+  // section_index is -1.
+  U32 offset;
 };
 
 struct PE_Debug_Directory_Entry {
@@ -37,6 +111,49 @@ struct PE_Debug_Directory_Entry {
   U32 data_file_offset;
 };
 
+// A function's stack frame according to its x64 unwind information (a
+// RUNTIME_FUNCTION in .pdata and its UNWIND_INFO in .xdata).
+struct PE_Unwind_Frame {
+  // The code described by the RUNTIME_FUNCTION is [begin_rva, end_rva). This
+  // is either a whole function or a fragment of one (see chain_length).
+  U32 begin_rva;
+  U32 end_rva;
+  U32 unwind_info_rva;
+
+  // Number of bytes allocated by UWOP_ALLOC_SMALL and UWOP_ALLOC_LARGE.
+  // Comparable to the frame size in the function's S_FRAMEPROC record.
+  U64 allocation_size = 0;
+  // Number of registers pushed by UWOP_PUSH_NONVOL.
+  U32 pushed_register_count = 0;
+  // Number of bytes pushed by UWOP_PUSH_MACHFRAME. Zero unless the function is
+  // an interrupt or exception handler.
+  U32 machine_frame_size = 0;
+  // Bit N is set if the general-purpose register with x64 encoding N (0 for
+  // rax, 1 for rcx, ..., 15 for r15) is saved by the prologue.
+  U16 saved_register_mask = 0;
+  // x64 encoding of the register set by UWOP_SET_FPREG, if any.
+  std::optional<U8> frame_register = std::nullopt;
+  // Size of the prologue described by the first UNWIND_INFO.
+  U8 prologue_size = 0;
+  // Number of UNWIND_INFO-s followed through UNW_FLAG_CHAININFO. Zero if the
+  // unwind information is not chained.
+  U8 chain_length = 0;
+
+  // Number of bytes between the stack pointer after the prologue and the
+  // return address (or the machine frame).
+  U64 frame_size() const {
+    return this->allocation_size + U64{this->pushed_register_count} * 8 +
+           this->machine_frame_size;
+  }
+
+  // Number of bytes used by the function, including the return address.
+  // Comparable to Stack_Usage_Entry::stack_size.
+  U64 stack_size() const {
+    // NOTE(strager): A machine frame replaces the return address.
+    return this->frame_size() + (this->machine_frame_size == 0 ? 8 : 0);
+  }
+};
+
 // A Windows PE (.dll or .exe) or COFF (.obj) file.
 template <class Reader>
 struct PE_File {
@@ -44,6 +161,15 @@ struct PE_File {
   std::vector<PE_Section> sections;
   std::vector<PE_Debug_Directory_Entry> debug_directory;
 
+  // Location of the array of RUNTIME_FUNCTION-s (usually the .pdata section).
+  // Zero if there is no exception directory (typical for COFF files).
+  U32 exception_directory_rva = 0;
+  U32 exception_directory_size = 0;
+
+  // Zero if there is no symbol table (typical for PE images).
+  U64 symbol_table_offset = 0;
+  U32 symbol_count = 0;
+
   explicit PE_File(const Reader* reader) : reader(reader) {}
 
   // Returns a Reader for each section with the given name.
@@ -58,12 +184,163 @@ struct PE_File {
     return found_sections;
   }
 
+  // Returns the relocations for the given section sorted by offset.
+  //
+  // Relocations are parsed the first time a section is queried.
+  std::span<const COFF_Relocation> get_section_relocations(
+      U32 section_index) {
+    if (section_index >= this->sections.size()) {
+      return {};
+    }
+    if (this->section_relocations_.size() != this->sections.size()) {
+      this->section_relocations_.resize(this->sections.size());
+    }
+    std::optional<std::vector<COFF_Relocation>>& relocations =
+        this->section_relocations_[section_index];
+    if (!relocations.has_value()) {
+      relocations = parse_section_relocations_(this->sections[section_index]);
+    }
+    return *relocations;
+  }
+
+  // Returns null if no relocation patches the bytes at the given offset.
+  //
+  // Runs in O(log n) time.
+  const COFF_Relocation* find_relocation(U32 section_index, U32 offset) {
+    std::span<const COFF_Relocation> relocations =
+        this->get_section_relocations(section_index);
+    auto it = std::lower_bound(
+        relocations.begin(), relocations.end(), offset,
+        [](const COFF_Relocation& r, U32 o) -> bool { return r.offset < o; });
+    if (it == relocations.end() || it->offset != offset) {
+      return nullptr;
+    }
+    return &*it;
+  }
+
+  // Returns the relocations which patch bytes in [begin_offset, end_offset).
+  //
+  // Runs in O(log n) time.
+  std::span<const COFF_Relocation> find_relocations_in_range(
+      U32 section_index, U32 begin_offset, U32 end_offset) {
+    std::span<const COFF_Relocation> relocations =
+        this->get_section_relocations(section_index);
+    auto begin = std::lower_bound(
+        relocations.begin(), relocations.end(), begin_offset,
+        [](const COFF_Relocation& r, U32 o) -> bool { return r.offset < o; });
+    auto end = std::lower_bound(
+        begin, relocations.end(), end_offset,
+        [](const COFF_Relocation& r, U32 o) -> bool { return r.offset < o; });
+    return relocations.subspan(begin - relocations.begin(), end - begin);
+  }
+
+  // Returns the frames described by the exception directory's unwind
+  // information, sorted by begin_rva. See parse_pe_unwind_frames.
+  //
+  // Unwind information is parsed the first time this function is called.
+  std::span<const PE_Unwind_Frame> get_unwind_frames(
+      Logger& logger = fallback_logger) {
+    if (!this->unwind_frames_.has_value()) {
+      this->unwind_frames_ = parse_pe_unwind_frames(*this, logger);
+    }
+    return *this->unwind_frames_;
+  }
+
+  // Returns null if no RUNTIME_FUNCTION covers the given RVA. Leaf functions
+  // which do not adjust the stack pointer have no RUNTIME_FUNCTION.
+  //
+  // Runs in O(log n) time.
+  const PE_Unwind_Frame* find_unwind_frame(U32 rva,
+                                           Logger& logger = fallback_logger) {
+    std::span<const PE_Unwind_Frame> frames = this->get_unwind_frames(logger);
+    auto it = std::upper_bound(frames.begin(), frames.end(), rva,
+                               [](U32 r, const PE_Unwind_Frame& f) -> bool {
+                                 return r < f.begin_rva;
+                               });
+    if (it == frames.begin()) {
+      return nullptr;
+    }
+    --it;
+    if (rva >= it->end_rva) {
+      return nullptr;
+    }
+    return &*it;
+  }
+
+  // Returns null if no relocation patches the bytes at the given offset.
+  std::optional<COFF_Relocation_Target> resolve_relocation(U32 section_index,
+                                                           U32 offset) {
+    const COFF_Relocation* relocation =
+        this->find_relocation(section_index, offset);
+    if (relocation == nullptr) {
+      return std::nullopt;
+    }
+    COFF_Symbol symbol = this->get_symbol(relocation->symbol_index);
+    U32 target_offset = symbol.value;
+    if (relocation->type != IMAGE_REL_AMD64_SECTION &&
+        relocation->type != IMAGE_REL_AMD64_ABSOLUTE) {
+      // NOTE(strager): For ADDR64, the high 32 bits of the addend are ignored.
+      // Section offsets fit in 32 bits.
+      Sub_File_Reader<Reader> section_reader =
+          this->reader_for_section(this->sections[section_index]);
+      target_offset += section_reader.u32(offset);
+    }
+    return COFF_Relocation_Target{
+        .symbol = std::move(symbol),
+        .relocation_type = relocation->type,
+        .offset = target_offset,
+    };
+  }
+
+  COFF_Symbol get_symbol(U32 symbol_index) const {
+    if (symbol_index >= this->symbol_count) {
+      throw std::runtime_error("COFF symbol index out of bounds");
+    }
+    U64 offset = this->symbol_table_offset + U64{symbol_index} * 18;
+    std::u8string name;
+    if (this->reader->u32(offset) == 0) {
+      // Long name: offset into the string table, which immediately follows the
+      // symbol table.
+      U64 string_table_offset =
+          this->symbol_table_offset + U64{this->symbol_count} * 18;
+      name = this->reader->utf_8_c_string(string_table_offset +
+                                          this->reader->u32(offset + 4));
+    } else {
+      name = this->reader->fixed_width_string(offset, 8);
+    }
+    S16 section_number = static_cast<S16>(this->reader->u16(offset + 12));
+    return COFF_Symbol{
+        .name = std::move(name),
+        .value = this->reader->u32(offset + 8),
+        .section_index = section_number > 0
+                             ? static_cast<U32>(section_number - 1)
+                             : static_cast<U32>(-1),
+        .storage_class = this->reader->u8(offset + 16),
+    };
+  }
+
+  // Returns the index of the section containing the given file offset, or
+  // null if no section contains it.
+  std::optional<U32> find_section_index_by_file_offset(U64 file_offset) const {
+    for (U32 section_index = 0; section_index < this->sections.size();
+         ++section_index) {
+      const PE_Section& section = this->sections[section_index];
+      if (section.data_file_offset <= file_offset &&
+          file_offset - section.data_file_offset < section.data_size) {
+        return section_index;
+      }
+    }
+    return std::nullopt;
+  }
+
   void parse_sections_(U64 offset) {
     U16 coff_magic = this->reader->u16(offset);
     if (coff_magic != 0x8664) {
       throw PE_Magic_Mismatch_Error();
     }
     U32 section_count = this->reader->u16(offset + 2);
+    this->symbol_table_offset = this->reader->u32(offset + 8);
+    this->symbol_count = this->reader->u32(offset + 12);
     U64 optional_header_size = this->reader->u16(offset + 16);
     U64 section_table_offset = offset + 20 + optional_header_size;
     for (U32 section_index = 0; section_index < section_count;
@@ -95,6 +372,11 @@ struct PE_File {
 
     Sub_File_Reader<Sub_File_Reader<Reader>> data_directory_reader(
         &optional_header_reader, data_directory_offset);
+    bool hasExceptionDataDirectory = data_directory_reader.size() >= 32;
+    if (hasExceptionDataDirectory) {
+      this->exception_directory_rva = data_directory_reader.u32(24);
+      this->exception_directory_size = data_directory_reader.u32(24 + 4);
+    }
     bool hasDebugDataDirectory = data_directory_reader.size() >= 56;
     if (!hasDebugDataDirectory) {
       return;
@@ -126,7 +408,7 @@ struct PE_File {
     // TODO(strager): Support 0 padding if baseRVA+size extends beyond dataSize.
     for (const PE_Section& section : this->sections) {
       bool in_bounds = section.virtual_address <= base_rva &&
-                       base_rva + size < section.virtual_address +
+                       base_rva + size <= section.virtual_address +
                                              std::min(section.virtual_size,
                                                       section.data_size);
       if (in_bounds) {
@@ -138,6 +420,48 @@ struct PE_File {
     }
     throw std::runtime_error("cannot find section for RVA");
   }
+
+  std::vector<COFF_Relocation> parse_section_relocations_(
+      const PE_Section& section) const {
+    U64 offset = section.relocations_file_offset;
+    U64 relocation_count = section.relocation_count;
+    if (relocation_count == 0xffff &&
+        (section.characteristics & IMAGE_SCN_LNK_NRELOC_OVFL)) {
+      // The first relocation holds the real count (including itself).
+      relocation_count = this->reader->u32(offset);
+      if (relocation_count > 0) {
+        relocation_count -= 1;
+      }
+      offset += 10;
+    }
+
+    std::vector<COFF_Relocation> relocations;
+    relocations.reserve(relocation_count);
+    for (U64 i = 0; i < relocation_count; ++i) {
+      relocations.push_back(COFF_Relocation{
+          .offset = this->reader->u32(offset + 0),
+          .symbol_index = this->reader->u32(offset + 4),
+          .type = this->reader->u16(offset + 8),
+      });
+      offset += 10;
+    }
+    // NOTE(strager): Compilers usually emit relocations in order already.
+    auto by_offset = [](const COFF_Relocation& a,
+                        const COFF_Relocation& b) -> bool {
+      return a.offset < b.offset;
+    };
+    if (!std::is_sorted(relocations.begin(), relocations.end(), by_offset)) {
+      std::stable_sort(relocations.begin(), relocations.end(), by_offset);
+    }
+    return relocations;
+  }
+
+ private:
+  // Lazily-populated. Indexed by section index.
+  std::vector<std::optional<std::vector<COFF_Relocation>>>
+      section_relocations_;
+  // Lazily-populated. See get_unwind_frames.
+  std::optional<std::vector<PE_Unwind_Frame>> unwind_frames_;
 };
 
 template <class Reader>
@@ -181,6 +505,174 @@ inline std::optional<External_PDB_File_Reference> get_pe_pdb_reference(
   return std::nullopt;
 }
 
+// Applies the unwind codes of the UNWIND_INFO at unwind_info_rva, and of any
+// UNWIND_INFO chained to it, to frame.
+//
+// Throws if the unwind information is malformed.
+template <class Reader>
+inline void add_pe_unwind_info(PE_File<Reader>& pe, U32 unwind_info_rva,
+                               PE_Unwind_Frame& frame) {
+  // NOTE(strager): Limit chains so corrupt files cannot cause infinite loops.
+  static constexpr U8 max_chain_length = 32;
+
+  for (;;) {
+    Sub_File_Reader<Reader> header = pe.reader_for_rva(unwind_info_rva, 4);
+    U8 version_and_flags = header.u8(0);
+    U8 version = version_and_flags & 0x7;
+    U8 flags = version_and_flags >> 3;
+    if (version != 1 && version != 2) {
+      throw std::runtime_error("unsupported UNWIND_INFO version");
+    }
+    U8 code_count = header.u8(2);
+    U8 frame_register_and_offset = header.u8(3);
+    if (frame.chain_length == 0) {
+      frame.prologue_size = header.u8(1);
+    }
+
+    // Codes are padded to a multiple of 4 bytes.
+    U64 codes_size = U64{(code_count + 1u) & ~1u} * 2;
+    bool is_chained = (flags & UNW_FLAG_CHAININFO) != 0;
+    Sub_File_Reader<Reader> info = pe.reader_for_rva(
+        unwind_info_rva, 4 + codes_size + (is_chained ? 12 : 0));
+
+    U64 slot = 0;
+    while (slot < code_count) {
+      U64 code_offset = 4 + slot * 2;
+      U8 operation_and_info = info.u8(code_offset + 1);
+      U8 operation = operation_and_info & 0xf;
+      U8 operation_info = operation_and_info >> 4;
+      switch (operation) {
+        case UWOP_PUSH_NONVOL:
+          frame.pushed_register_count += 1;
+          frame.saved_register_mask |= U16{1} << operation_info;
+          slot += 1;
+          break;
+        case UWOP_ALLOC_LARGE:
+          if (operation_info == 0) {
+            frame.allocation_size += U64{info.u16(code_offset + 2)} * 8;
+            slot += 2;
+          } else {
+            frame.allocation_size += info.u32(code_offset + 2);
+            slot += 3;
+          }
+          break;
+        case UWOP_ALLOC_SMALL:
+          frame.allocation_size += U64{operation_info} * 8 + 8;
+          slot += 1;
+          break;
+        case UWOP_SET_FPREG:
+          frame.frame_register = frame_register_and_offset & 0xf;
+          slot += 1;
+          break;
+        case UWOP_SAVE_NONVOL:
+          frame.saved_register_mask |= U16{1} << operation_info;
+          slot += 2;
+          break;
+        case UWOP_SAVE_NONVOL_FAR:
+          frame.saved_register_mask |= U16{1} << operation_info;
+          slot += 3;
+          break;
+        case UWOP_EPILOG:
+        case UWOP_SAVE_XMM128:
+          slot += 2;
+          break;
+        case UWOP_SPARE_CODE:
+        case UWOP_SAVE_XMM128_FAR:
+          slot += 3;
+          break;
+        case UWOP_PUSH_MACHFRAME:
+          frame.machine_frame_size += operation_info == 0 ? 40 : 48;
+          slot += 1;
+          break;
+        default:
+          throw std::runtime_error("unknown unwind operation code");
+      }
+    }
+    if (slot != code_count) {
+      throw std::runtime_error("unwind code extends past UNWIND_INFO");
+    }
+
+    if (!is_chained) {
+      return;
+    }
+    if (frame.chain_length >= max_chain_length) {
+      throw std::runtime_error("UNWIND_INFO chain is too long");
+    }
+    frame.chain_length += 1;
+    // The chained RUNTIME_FUNCTION follows the codes.
+    unwind_info_rva = info.u32(4 + codes_size + 8);
+  }
+}
+
+// Reads every RUNTIME_FUNCTION in the exception directory in one pass,
+// computing each function's frame from its unwind codes.
+//
+// Chained unwind information (UNW_FLAG_CHAININFO) is followed, so a function
+// fragment's frame includes the allocations made by the primary function's
+// prologue.
+//
+// RUNTIME_FUNCTION-s with malformed unwind information are logged and skipped.
+template <class Reader>
+inline std::vector<PE_Unwind_Frame> parse_pe_unwind_frames(
+    PE_File<Reader>& pe, Logger& logger = fallback_logger) {
+  std::vector<PE_Unwind_Frame> frames;
+  if (pe.exception_directory_size == 0) {
+    return frames;
+  }
+  std::optional<Sub_File_Reader<Reader>> table;
+  try {
+    table = pe.reader_for_rva(pe.exception_directory_rva,
+                              pe.exception_directory_size);
+  } catch (std::runtime_error& e) {
+    logger.log(e.what(), pe.reader->locate(0));
+    return frames;
+  }
+
+  static constexpr U64 runtime_function_size = 12;
+  U64 runtime_function_count = table->size() / runtime_function_size;
+  frames.reserve(runtime_function_count);
+  for (U64 i = 0; i < runtime_function_count; ++i) {
+    U64 offset = i * runtime_function_size;
+    PE_Unwind_Frame frame = {
+        .begin_rva = table->u32(offset + 0),
+        .end_rva = table->u32(offset + 4),
+        .unwind_info_rva = table->u32(offset + 8),
+    };
+    if (frame.begin_rva == 0 && frame.end_rva == 0) {
+      // Padding.
+      continue;
+    }
+    U32 unwind_info_rva = frame.unwind_info_rva;
+    try {
+      if ((unwind_info_rva & 1) != 0) {
+        // NOTE(strager): Some linkers point at another RUNTIME_FUNCTION
+        // (with the low bit set) instead of at an UNWIND_INFO.
+        unwind_info_rva = pe.reader_for_rva(unwind_info_rva & ~U32{1},
+                                            runtime_function_size)
+                              .u32(8);
+      }
+      add_pe_unwind_info(pe, unwind_info_rva, frame);
+    } catch (std::runtime_error& e) {
+      logger.log(e.what(), table->locate(offset));
+      continue;
+    } catch (Out_Of_Bounds_Read&) {
+      logger.log("unwind information is out of bounds", table->locate(offset));
+      continue;
+    }
+    frames.push_back(frame);
+  }
+
+  // NOTE(strager): The exception directory is supposed to be sorted already.
+  auto by_begin_rva = [](const PE_Unwind_Frame& a,
+                         const PE_Unwind_Frame& b) -> bool {
+    return a.begin_rva < b.begin_rva;
+  };
+  if (!std::is_sorted(frames.begin(), frames.end(), by_begin_rva)) {
+    std::stable_sort(frames.begin(), frames.end(), by_begin_rva);
+  }
+  return frames;
+}
+
 template <class Reader>
 inline PE_Section parse_coff_section(const Reader& reader, U64 offset) {
   return PE_Section{
@@ -189,6 +681,9 @@ inline PE_Section parse_coff_section(const Reader& reader, U64 offset) {
       .virtual_address = reader.u32(offset + 12),
       .data_size = reader.u32(offset + 16),
       .data_file_offset = reader.u32(offset + 20),
+      .relocations_file_offset = reader.u32(offset + 24),
+      .relocation_count = reader.u16(offset + 32),
+      .characteristics = reader.u32(offset + 36),
   };
 }
 
@@ -1,15 +1,42 @@
 #pragma once
 
+#include <chrono>
+#include <cppstacksize/cache-budget.h>
+#include <cppstacksize/codeview-function-table.h>
 #include <cppstacksize/codeview.h>
+#include <cppstacksize/dwarf.h>
+#include <cppstacksize/elf.h>
 #include <cppstacksize/file.h>
+#include <cppstacksize/function-address-index.h>
+#include <cppstacksize/function-name-index.h>
 #include <cppstacksize/line-tables.h>
 #include <cppstacksize/pdb.h>
 #include <cppstacksize/pe.h>
+#include <cppstacksize/stack-usage.h>
 #include <cppstacksize/util.h>
+#include <future>
 #include <memory>
 #include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace cppstacksize {
+// See Project_File::pdb_module_caches.
+struct Project_PDB_Module_Cache {
+  // If true, [begin_function_index, end_function_index) of the Project's most
+  // recently loaded functions (see Project::get_all_functions) were found in
+  // this module.
+  bool has_functions = false;
+  U64 begin_function_index = 0;
+  U64 end_function_index = 0;
+
+  // Index into the Project's lazy modules (see
+  // Project::get_pdb_module_functions), if registered.
+  std::optional<U32> pdb_module_index = std::nullopt;
+};
+
 struct Project_File {
   using Reader = Span_Reader;
 
@@ -25,11 +52,16 @@ struct Project_File {
   std::optional<PDB_DBI> pdb_dbi;
   std::optional<PDB_TPI<PDB_Blocks_Reader<Reader>>> pdb_tpi_header;
   std::optional<PDB_TPI<PDB_Blocks_Reader<Reader>>> pdb_ipi_header;
+  // Indexed like pdb_dbi->modules. Maintained by Project so that functions
+  // from unchanged modules can be reused when this file is reloaded.
+  std::vector<Project_PDB_Module_Cache> pdb_module_caches;
 
   std::optional<PE_File<Reader>> pe_file;
   std::vector<Sub_File_Reader<Reader>> debug_s_sections;
   std::vector<Sub_File_Reader<Reader>> debug_t_sections;
 
+  std::optional<ELF_File<Reader>> elf_file;
+
   explicit Project_File(std::string&& name, Loaded_File file)
       : name(std::move(name)),
         file(std::move(file)),
@@ -45,6 +77,18 @@ struct Project_File {
     }
   }
 
+  void try_load_elf_file(Logger& logger = fallback_logger) {
+    try {
+      if (!this->elf_file.has_value()) {
+        this->elf_file = parse_elf_file(&this->reader);
+      }
+    } catch (ELF_Magic_Mismatch_Error&) {
+      return;
+    } catch (std::runtime_error& e) {
+      logger.log(e.what(), this->reader.locate(0));
+    }
+  }
+
   void try_load_pdb_generic_headers(Logger& logger) {
     try {
       if (!this->pdb_super_block.has_value()) {
@@ -59,6 +103,14 @@ struct Project_File {
     }
   }
 
+  void try_load_pdb_dbi(Logger& logger) {
+    this->try_load_pdb_generic_headers(logger);
+    if (this->pdb_streams.has_value() && !this->pdb_dbi.has_value()) {
+      this->pdb_dbi = parse_pdb_dbi_stream(this->pdb_streams->at(3), logger);
+      this->pdb_module_caches.resize(this->pdb_dbi->modules.size());
+    }
+  }
+
   void try_load_debug_t_sections() {
     if (this->debug_t_sections.empty() && this->pe_file.has_value()) {
       this->debug_t_sections =
@@ -78,20 +130,152 @@ class Project {
  public:
   using Reader = Span_Reader;
 
+  Project() {
+    this->line_tables_cache_id_ = this->cache_budget_.add_cache(
+        "line table indexes", [this](U64 key) -> void {
+          this->line_tables_.evict_module_index(
+              Line_Tables::Handle{.module_index = key});
+        });
+    this->line_tables_.set_cache_budget(&this->cache_budget_,
+                                        this->line_tables_cache_id_);
+    this->pdb_module_functions_cache_id_ = this->cache_budget_.add_cache(
+        "PDB module functions", [this](U64 key) -> void {
+          this->unload_pdb_module(this->pdb_modules_[key]);
+        });
+    this->pdb_module_line_tables_cache_id_ = this->cache_budget_.add_cache(
+        "PDB module line table indexes", [this](U64 key) -> void {
+          this->pdb_module_line_tables_.evict_module_index(
+              Line_Tables::Handle{.module_index = key});
+        });
+    this->pdb_module_line_tables_.set_cache_budget(
+        &this->cache_budget_, this->pdb_module_line_tables_cache_id_);
+    this->type_table_cache_id_ = this->cache_budget_.add_cache(
+        "type table", [this](U64 key) -> void {
+          this->type_table_cache_->evict(key);
+        });
+    this->type_index_table_cache_id_ = this->cache_budget_.add_cache(
+        "type index table", [this](U64 key) -> void {
+          this->type_index_table_cache_->evict(key);
+        });
+  }
+
+  // NOTE(strager): Project is not movable because caches registered with
+  // cache_budget_ refer to this.
+  Project(const Project&) = delete;
+  Project& operator=(const Project&) = delete;
+
   void add_file(std::string name, Loaded_File file) {
     this->files_.push_back(
         std::make_unique<Project_File>(std::move(name), std::move(file)));
+    this->mark_files_dirty();
+  }
+
+  // Replaces the file which was added with the given name. If no file has the
+  // given name, adds the file.
+  //
+  // Functions found in other files are not scanned again. Functions found in
+  // a PDB module are not scanned again if the module's DBI entry and symbol
+  // stream are unchanged.
+  void reload_file(std::string_view name, Loaded_File file,
+                   Logger& logger = fallback_logger) {
+    std::unique_ptr<Project_File>* old_file = this->find_file(name);
+    if (old_file == nullptr) {
+      this->add_file(std::string(name), std::move(file));
+      return;
+    }
+    std::unique_ptr<Project_File> new_file =
+        std::make_unique<Project_File>(std::string(name), std::move(file));
+    this->copy_caches_of_unchanged_pdb_modules(**old_file, *new_file, logger);
+    *old_file = std::move(new_file);
+    this->mark_files_dirty();
+  }
+
+  // Returns false if no file has the given name.
+  bool remove_file(std::string_view name) {
+    std::unique_ptr<Project_File>* file = this->find_file(name);
+    if (file == nullptr) {
+      return false;
+    }
+    this->files_.erase(this->files_.begin() + (file - this->files_.data()));
+    this->mark_files_dirty();
+    return true;
+  }
+
+  // Returns the names given to add_file or reload_file, in order.
+  std::vector<std::string_view> get_file_names() const {
+    std::vector<std::string_view> names;
+    for (const std::unique_ptr<Project_File>& file : this->files_) {
+      names.push_back(file->name);
+    }
+    return names;
+  }
+
+  // Forgets all files and everything derived from them.
+  //
+  // Caches registered with get_cache_budget by other objects are kept.
+  void clear() {
+    // NOTE(strager): Wait for the background thread before freeing what it
+    // uses.
+    this->function_name_index_build_ = std::future<void>();
+    this->function_name_index_.reset();
+
+    this->functions_cache_.clear();
     this->functions_are_dirty_ = true;
+    this->function_address_index_.clear();
+    this->function_address_index_is_dirty_ = true;
+    this->use_pdb_global_symbols_ = false;
+    this->line_tables_.clear();
+
+    this->pdb_modules_.clear();
+    this->pdb_module_files_.clear();
+    this->pdb_module_line_tables_.clear();
+    this->cache_budget_.remove_all_entries(
+        this->pdb_module_functions_cache_id_);
+    this->pdb_modules_are_dirty_ = true;
+
+    this->type_table_cache_.reset();
+    this->cache_budget_.remove_all_entries(this->type_table_cache_id_);
     this->type_table_is_dirty_ = true;
+    this->type_index_table_cache_.reset();
+    this->cache_budget_.remove_all_entries(this->type_index_table_cache_id_);
     this->type_index_table_is_dirty_ = true;
+
+    this->dwarf_functions_cache_.clear();
+    this->dwarf_functions_are_dirty_ = true;
+    this->dwarf_line_tables_.clear();
+
+    this->clear_stack_usage_files();
+
+    this->files_.clear();
   }
 
-  void clear() { *this = Project(); }
+  // Limits memory used by recomputable data, such as functions loaded by
+  // get_pdb_module_functions, line table indexes, and type tables. Other
+  // objects (such as GUI models) may register their own caches.
+  Cache_Budget& get_cache_budget() { return this->cache_budget_; }
+
+  // If true, get_all_functions finds functions in PDB files using the global
+  // symbol stream instead of scanning every module's symbol stream. Module
+  // symbol streams are only read for each function's own records.
+  //
+  // Functions are found in the same order either way.
+  void set_use_pdb_global_symbols(bool use_global_symbols) {
+    if (this->use_pdb_global_symbols_ != use_global_symbols) {
+      this->use_pdb_global_symbols_ = use_global_symbols;
+      this->functions_are_dirty_ = true;
+    }
+  }
 
   // Possibly returns nullptr.
   CodeView_Type_Table* get_type_table(Logger& logger = fallback_logger) {
     if (this->type_table_is_dirty_) {
+      this->type_table_cache_.reset();
+      this->cache_budget_.remove_all_entries(this->type_table_cache_id_);
       this->load_type_table(logger);
+      if (this->type_table_cache_.has_value()) {
+        this->type_table_cache_->set_cache_budget(&this->cache_budget_,
+                                                  this->type_table_cache_id_);
+      }
       this->type_table_is_dirty_ = false;
     } else {
       // TODO(strager): Copy logs from prior load?
@@ -102,7 +286,13 @@ class Project {
   // Possibly returns nullptr.
   CodeView_Type_Table* get_type_index_table(Logger& logger = fallback_logger) {
     if (this->type_index_table_is_dirty_) {
+      this->type_index_table_cache_.reset();
+      this->cache_budget_.remove_all_entries(this->type_index_table_cache_id_);
       this->load_type_index_table(logger);
+      if (this->type_index_table_cache_.has_value()) {
+        this->type_index_table_cache_->set_cache_budget(
+            &this->cache_budget_, this->type_index_table_cache_id_);
+      }
       this->type_index_table_is_dirty_ = false;
     } else {
       // TODO(strager): Copy logs from prior load?
@@ -110,23 +300,278 @@ class Project {
     return get(this->type_index_table_cache_);
   }
 
-  std::span<const CodeView_Function> get_all_functions(
+  const CodeView_Function_Table& get_all_functions(
       Logger& logger = fallback_logger) {
     if (this->functions_are_dirty_) {
       this->load_functions(logger);
       this->functions_are_dirty_ = false;
+      this->function_address_index_is_dirty_ = true;
+      this->start_building_function_name_index();
     } else {
       // TODO(strager): Copy logs from prior load?
     }
     return this->functions_cache_;
   }
 
+  // Maps code addresses to indexes into get_all_functions().
+  const Function_Address_Index& get_function_address_index(
+      Logger& logger = fallback_logger) {
+    const CodeView_Function_Table& functions = this->get_all_functions(logger);
+    if (this->function_address_index_is_dirty_) {
+      this->function_address_index_.build(functions, logger);
+      this->function_address_index_is_dirty_ = false;
+    }
+    return this->function_address_index_;
+  }
+
+  // Returns null if no function contains the given byte.
+  //
+  // file_name names the PE, COFF, or ELF file containing the code. For code
+  // described by a PDB file with no PE file in this Project, file_name names
+  // the PDB file.
+  std::optional<CodeView_Function> find_function_by_address(
+      std::string_view file_name, U32 section_index, U32 code_offset,
+      Logger& logger = fallback_logger) {
+    const Function_Address_Index& index =
+        this->get_function_address_index(logger);
+    std::unique_ptr<Project_File>* file = this->find_file(file_name);
+    if (file == nullptr) {
+      return std::nullopt;
+    }
+    // See CodeView_Function::code_file.
+    std::optional<U32> function_index = index.find_function_index(
+        (*file)->reader.data().data(), section_index, code_offset);
+    if (!function_index.has_value()) {
+      return std::nullopt;
+    }
+    return this->functions_cache_[*function_index];
+  }
+
+  // Maps function names to indexes into get_all_functions().
+  //
+  // The index is built on a background thread after functions are loaded.
+  // This function waits for the build to finish.
+  const Function_Name_Index& get_function_name_index(
+      Logger& logger = fallback_logger) {
+    this->get_all_functions(logger);
+    if (this->function_name_index_build_.valid()) {
+      this->function_name_index_build_.get();
+    }
+    return *this->function_name_index_;
+  }
+
+  // Returns true if get_function_name_index would not wait.
+  bool is_function_name_index_ready() const {
+    return !this->functions_are_dirty_ &&
+           (!this->function_name_index_build_.valid() ||
+            this->function_name_index_build_.wait_for(std::chrono::seconds(
+                0)) == std::future_status::ready);
+  }
+
+  // See Function_Name_Index::find_matching.
+  void find_functions_by_name(std::u8string_view pattern,
+                              std::vector<U32>& out_function_indexes,
+                              Logger& logger = fallback_logger) {
+    this->get_function_name_index(logger).find_matching(pattern,
+                                                         out_function_indexes);
+  }
+
   Line_Tables* get_line_tables(Logger& logger = fallback_logger) {
     get_all_functions(logger);  // Side effect: Populate Line_Tables if needed.
     return &this->line_tables_;
   }
 
+  // Lazy alternative to get_all_functions for PDB files. PDB modules are
+  // registered using only the DBI stream; a module's symbol stream is scanned
+  // the first time its functions are requested.
+  //
+  // Functions in .obj files are not visible through the get_pdb_module_*
+  // functions.
+  //
+  // NOTE(strager): This API is for library users which need only a few
+  // functions, such as a function at a known address (see
+  // find_pdb_function_by_address). The GUI and rank_frame_shrink_opportunities
+  // look at every function, so they use get_all_functions instead.
+  //
+  // TODO(strager): Let the GUI list PDB modules and scan each module's symbol
+  // stream when it is first shown.
+  //
+  // Returns the number of modules in all PDB files.
+  U32 get_pdb_module_count(Logger& logger = fallback_logger) {
+    this->register_pdb_modules_if_dirty(logger);
+    return narrow_cast<U32>(this->pdb_modules_.size());
+  }
+
+  // Returns the functions in the given module, scanning the module's symbol
+  // stream if needed.
+  //
+  // The returned reference is invalidated by the next call which adds to the
+  // cache budget (such as get_pdb_module_functions) because the module might
+  // be evicted (see get_cache_budget).
+  //
+  // Each function's line_tables_handle refers to get_pdb_module_line_tables.
+  const CodeView_Function_Table& get_pdb_module_functions(
+      U32 pdb_module_index, Logger& logger = fallback_logger) {
+    this->register_pdb_modules_if_dirty(logger);
+    CSS_ASSERT(pdb_module_index < this->pdb_modules_.size());
+    Lazy_PDB_Module& module = this->pdb_modules_[pdb_module_index];
+    if (module.is_loaded) {
+      this->cache_budget_.touch_entry(this->pdb_module_functions_cache_id_,
+                                      pdb_module_index);
+    } else {
+      U64 byte_size = this->load_pdb_module(module, logger);
+      // NOTE(strager): This might unload other modules, but not this one.
+      this->cache_budget_.add_entry(this->pdb_module_functions_cache_id_,
+                                    pdb_module_index, byte_size);
+    }
+    return module.functions;
+  }
+
+  bool is_pdb_module_loaded(U32 pdb_module_index) const {
+    return pdb_module_index < this->pdb_modules_.size() &&
+           this->pdb_modules_[pdb_module_index].is_loaded;
+  }
+
+  // Returns the index of the module (for get_pdb_module_functions) whose code
+  // contains the given byte according to the DBI section contributions.
+  //
+  // No symbol streams are scanned.
+  std::optional<U32> find_pdb_module_by_address(
+      U32 section_index, U32 code_offset, Logger& logger = fallback_logger) {
+    this->register_pdb_modules_if_dirty(logger);
+    for (const Lazy_PDB_File& pdb_file : this->pdb_module_files_) {
+      std::optional<U16> module_index =
+          pdb_file.file->pdb_dbi->find_module_index(
+              narrow_cast<U16>(section_index), code_offset);
+      if (module_index.has_value() &&
+          *module_index < pdb_file.end_pdb_module_index -
+                              pdb_file.begin_pdb_module_index) {
+        return pdb_file.begin_pdb_module_index + *module_index;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Like find_function_by_address, but only scans the symbol stream of the
+  // module containing the given byte.
+  std::optional<CodeView_Function> find_pdb_function_by_address(
+      U32 section_index, U32 code_offset, Logger& logger = fallback_logger) {
+    if (section_index > 0xffff) {
+      return std::nullopt;
+    }
+    std::optional<U32> pdb_module_index =
+        this->find_pdb_module_by_address(section_index, code_offset, logger);
+    if (!pdb_module_index.has_value()) {
+      return std::nullopt;
+    }
+    const CodeView_Function_Table& functions =
+        this->get_pdb_module_functions(*pdb_module_index, logger);
+    for (U64 i = 0; i < functions.size(); ++i) {
+      std::optional<CodeView_Code_Location> code_location =
+          functions.get_code_location(i, logger);
+      if (code_location.has_value() &&
+          code_location->section_index == section_index &&
+          code_location->offset <= code_offset &&
+          code_offset - code_location->offset < functions.code_size(i)) {
+        return functions[i];
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Line tables for functions returned by get_pdb_module_functions.
+  Line_Tables* get_pdb_module_line_tables(Logger& logger = fallback_logger) {
+    this->register_pdb_modules_if_dirty(logger);
+    return &this->pdb_module_line_tables_;
+  }
+
+  // Approximate number of bytes used by loaded modules' functions.
+  U64 get_pdb_module_cache_size() const {
+    return this->cache_budget_.cache_byte_size(
+        this->pdb_module_functions_cache_id_);
+  }
+
+  // Functions from ELF files with DWARF debug information.
+  std::span<const DWARF_Function> get_all_dwarf_functions(
+      Logger& logger = fallback_logger) {
+    if (this->dwarf_functions_are_dirty_) {
+      this->load_dwarf_functions(logger);
+      this->dwarf_functions_are_dirty_ = false;
+    }
+    return this->dwarf_functions_cache_;
+  }
+
+  DWARF_Line_Tables* get_dwarf_line_tables(Logger& logger = fallback_logger) {
+    // Side effect: Populate DWARF_Line_Tables if needed.
+    get_all_dwarf_functions(logger);
+    return &this->dwarf_line_tables_;
+  }
+
+  // Reads .su files created by -fstack-usage. Files are read in parallel and
+  // are not kept in memory.
+  void add_stack_usage_files(std::span<const std::string> paths,
+                             Logger& logger = fallback_logger) {
+    load_stack_usage_files(paths, this->stack_usage_table_, logger);
+  }
+
+  void clear_stack_usage_files() {
+    this->stack_usage_table_ = Stack_Usage_Table();
+  }
+
+  const Stack_Usage_Table& get_stack_usage_table() const {
+    return this->stack_usage_table_;
+  }
+
+  // Compares the function's entry in the loaded .su files (see
+  // Stack_Usage_Table::find_function) against the stack memory touched by the
+  // function's machine code (see analyze_x86_64_stack_map).
+  //
+  // Returns null if no .su entry matches the function or if the function's
+  // machine code is unavailable.
+  std::optional<Stack_Usage_Check> get_stack_usage_check(
+      const CodeView_Function& function,
+      Logger& logger = fallback_logger) const {
+    const Stack_Usage_Entry* entry =
+        this->stack_usage_table_.find_function(
+            u8string_to_string(function.name));
+    if (entry == nullptr) {
+      return std::nullopt;
+    }
+    std::optional<Sub_File_Reader<Span_Reader>> code_reader =
+        function.get_instruction_bytes_reader(logger);
+    if (!code_reader.has_value()) {
+      return std::nullopt;
+    }
+    std::vector<U8> code(code_reader->size());
+    code_reader->copy_bytes_into(code, 0);
+    return check_stack_usage(*entry, analyze_x86_64_stack_map(code).touches);
+  }
+
+  // Number of times get_all_functions or get_pdb_module_functions scanned a
+  // PDB module's symbol stream for functions.
+  U64 get_pdb_module_scan_count() const {
+    return this->pdb_module_scan_count_;
+  }
+
  private:
+  // See get_pdb_module_functions.
+  struct Lazy_PDB_Module {
+    Project_File* file;
+    // Index into file->pdb_dbi->modules.
+    U32 module_index;
+    Line_Tables::Handle line_tables_handle;
+
+    bool is_loaded = false;
+    // Populated if is_loaded.
+    CodeView_Function_Table functions = {};
+  };
+  struct Lazy_PDB_File {
+    Project_File* file;
+    // [begin, end) range in pdb_modules_.
+    U32 begin_pdb_module_index;
+    U32 end_pdb_module_index;
+  };
+
   void load_type_table(Logger& logger) {
     for (std::unique_ptr<Project_File>& file : this->files_) {
       file->try_load_pdb_generic_headers(logger);
@@ -182,8 +627,15 @@ class Project {
   }
 
   void load_functions(Logger& logger) {
+    // NOTE(strager): Functions from PDB modules which were not changed since
+    // the previous load are moved from previous_functions instead of being
+    // scanned again. See Project_PDB_Module_Cache.
+    CodeView_Function_Table previous_functions =
+        std::move(this->functions_cache_);
     this->functions_cache_.clear();
     this->line_tables_.clear();
+    // Reused for each scanned module.
+    std::vector<CodeView_Function> scanned_functions;
 
     for (std::unique_ptr<Project_File>& file : this->files_) {
       file->try_load_pdb_generic_headers(logger);
@@ -193,64 +645,502 @@ class Project {
     for (std::unique_ptr<Project_File>& file : this->files_) {
       if (!file->pdb_streams.has_value()) continue;
       PDB_Blocks_Reader<Span_Reader>& dbi_reader = file->pdb_streams->at(3);
-      if (!file->pdb_dbi.has_value()) {
-        file->pdb_dbi = parse_pdb_dbi_stream(dbi_reader, logger);
+      file->try_load_pdb_dbi(logger);
+      if (this->use_pdb_global_symbols_ &&
+          this->load_pdb_functions_from_global_symbols(*file, logger)) {
+        for (Project_PDB_Module_Cache& module_cache : file->pdb_module_caches) {
+          module_cache.has_functions = false;
+        }
+        continue;
       }
-      U64 module_index = 0;
-      for (const PDB_DBI_Module& module : file->pdb_dbi->modules) {
+      for (U64 module_index = 0; module_index < file->pdb_dbi->modules.size();
+           ++module_index) {
+        const PDB_DBI_Module& module = file->pdb_dbi->modules[module_index];
+        Project_PDB_Module_Cache& module_cache =
+            file->pdb_module_caches[module_index];
         if (module.debug_info_stream_index >= file->pdb_streams->size()) {
           logger.log(
               fmt::format(
                   "module #{} has out of bounds stream index {}; ignoring",
                   module_index, module.debug_info_stream_index),
               dbi_reader.locate(module.header_offset));
+          module_cache.has_functions = false;
           continue;
         }
         PDB_Blocks_Reader<Reader>& codeview_stream =
             (*file->pdb_streams)[module.debug_info_stream_index];
-        U64 begin_function_index = this->functions_cache_.size();
-        find_all_codeview_functions_2(&codeview_stream, this->functions_cache_,
-                                      logger);
-        U64 end_function_index = this->functions_cache_.size();
-
         Line_Tables::Handle line_tables_handle =
             this->line_tables_.add_module_line_tables(module,
                                                       *file->pdb_streams);
-        for (U64 function_index = begin_function_index;
-             function_index < end_function_index; ++function_index) {
-          this->functions_cache_[function_index].line_tables_handle =
-              line_tables_handle;
+        U64 begin_function_index = this->functions_cache_.size();
+        if (module_cache.has_functions) {
+          CSS_ASSERT(module_cache.end_function_index <=
+                     previous_functions.size());
+          this->functions_cache_.append(previous_functions,
+                                        module_cache.begin_function_index,
+                                        module_cache.end_function_index);
+          this->functions_cache_.update_module_fields(
+              begin_function_index, this->functions_cache_.size(),
+              [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+                rebase_pdb_module_reader(fields, &codeview_stream);
+                fields.line_tables_handle = line_tables_handle;
+              });
+        } else {
+          scanned_functions.clear();
+          find_all_codeview_functions_2(&codeview_stream, module.symbols_size,
+                                        scanned_functions, logger);
+          for (CodeView_Function& func : scanned_functions) {
+            func.line_tables_handle = line_tables_handle;
+          }
+          this->functions_cache_.append(scanned_functions);
+          this->pdb_module_scan_count_ += 1;
         }
-        ++module_index;
+        module_cache.has_functions = true;
+        module_cache.begin_function_index = begin_function_index;
+        module_cache.end_function_index = this->functions_cache_.size();
       }
     }
 
+    U64 pdb_function_count = this->functions_cache_.size();
     for (std::unique_ptr<Project_File>& file : this->files_) {
       if (!file->pe_file.has_value()) continue;
       // TODO(strager): Only attach to functions from PDBs linked with this PE
       // (according to the PDB's GUID).
-      for (CodeView_Function& func : this->functions_cache_) {
-        func.pe_file = &*file->pe_file;
-      }
+      this->functions_cache_.update_module_fields(
+          0, pdb_function_count,
+          [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+            fields.pe_file = &*file->pe_file;
+          });
 
       file->try_load_debug_s_sections();
       for (Sub_File_Reader<Reader>& section_reader : file->debug_s_sections) {
-        find_all_codeview_functions(&section_reader, this->functions_cache_);
+        scanned_functions.clear();
+        find_all_codeview_functions(&section_reader, scanned_functions);
+        for (CodeView_Function& func : scanned_functions) {
+          func.pe_file = &*file->pe_file;
+        }
+        this->functions_cache_.append(scanned_functions);
+      }
+    }
+
+    for (const DWARF_Function& func : this->get_all_dwarf_functions(logger)) {
+      this->functions_cache_.push_back(
+          make_codeview_function_from_dwarf_function(func));
+    }
+  }
+
+  // Describes a DWARF function like a function from a PE file so that
+  // get_all_functions can list it.
+  //
+  // The ELF section containing the function's code is used as the function's
+  // code section. The function has no CodeView type.
+  static CodeView_Function make_codeview_function_from_dwarf_function(
+      const DWARF_Function& func) {
+    CSS_ASSERT(func.elf_file != nullptr);
+    const ELF_File<Reader>& elf = *func.elf_file;
+    CodeView_Function result = {
+        .name = func.name,
+        // NOTE(strager): The reader is empty so that CodeView_Function does
+        // not parse DWARF as CodeView records (see get_locals), but
+        // location() still points to the DW_TAG_subprogram entry. Every
+        // function shares the reader so they share one
+        // CodeView_Function_Table module.
+        .reader = Extent_Reader(*elf.reader).sub_reader(0, 0),
+        .byte_offset = func.location.file_offset,
+        .self_stack_size = func.self_stack_size,
+        // NOTE(strager): DWARF_Function::self_stack_size includes saved
+        // registers but not the return address.
+        .stack_size = func.self_stack_size == static_cast<U32>(-1)
+                          ? static_cast<U32>(-1)
+                          : func.self_stack_size + 8,
+        .code_size = narrow_cast<U32>(func.code_size),
+        .elf_file = func.elf_file,
+        .has_func_id_type = false,
+        .type_id = T_NOTYPE,
+        .uses_frame_pointer = func.uses_frame_pointer,
+    };
+    if (const ELF_Section* section =
+            elf.find_section_by_address(func.code_address)) {
+      result.code_section_index =
+          narrow_cast<U32>(section - elf.sections.data());
+      result.code_offset =
+          narrow_cast<U32>(func.code_address - section->address);
+    }
+    return result;
+  }
+
+  // Returns false if the PDB has no global symbol stream.
+  bool load_pdb_functions_from_global_symbols(Project_File& file,
+                                              Logger& logger) {
+    std::vector<PDB_Blocks_Reader<Reader>>& streams = *file.pdb_streams;
+    const PDB_DBI& dbi = *file.pdb_dbi;
+    if (!dbi.global_symbol_stream_index.has_value() ||
+        *dbi.global_symbol_stream_index >= streams.size() ||
+        !dbi.symbol_record_stream_index.has_value() ||
+        *dbi.symbol_record_stream_index >= streams.size()) {
+      return false;
+    }
+    std::vector<PDB_Procedure_Reference> references =
+        parse_pdb_global_procedure_references(
+            streams[*dbi.global_symbol_stream_index],
+            streams[*dbi.symbol_record_stream_index], logger);
+
+    std::vector<std::optional<Line_Tables::Handle>> line_tables_handles(
+        dbi.modules.size());
+    for (const PDB_Procedure_Reference& reference : references) {
+      if (reference.module_index >= dbi.modules.size()) {
+        logger.log(fmt::format("S_PROCREF has out of bounds module index {}; "
+                               "ignoring",
+                               reference.module_index),
+                   streams[*dbi.symbol_record_stream_index].locate(0));
+        continue;
+      }
+      const PDB_DBI_Module& module = dbi.modules[reference.module_index];
+      if (module.debug_info_stream_index >= streams.size()) {
+        logger.log(
+            fmt::format(
+                "module #{} has out of bounds stream index {}; ignoring",
+                reference.module_index, module.debug_info_stream_index),
+            streams[3].locate(module.header_offset));
+        continue;
+      }
+      PDB_Blocks_Reader<Reader>& codeview_stream =
+          streams[module.debug_info_stream_index];
+      U64 symbols_size =
+          std::min(U64{module.symbols_size}, codeview_stream.size());
+      if (symbols_size < 4) {
+        logger.log(fmt::format("S_PROCREF refers to module #{}, which has no "
+                               "symbols; ignoring",
+                               reference.module_index),
+                   codeview_stream.locate(0));
+        continue;
+      }
+      // NOTE(strager): Match find_all_codeview_functions_2, which excludes the
+      // CodeView signature from the reader.
+      Sub_File_Reader<PDB_Blocks_Reader<Reader>> symbols_reader(
+          &codeview_stream, 4, symbols_size - 4);
+      if (reference.symbol_offset < 4) {
+        logger.log(fmt::format("S_PROCREF has invalid offset {}; ignoring",
+                               reference.symbol_offset),
+                   codeview_stream.locate(0));
+        continue;
+      }
+      std::optional<CodeView_Function> func = find_codeview_function_at(
+          symbols_reader, reference.symbol_offset - 4, logger);
+      if (!func.has_value()) {
+        continue;
+      }
+
+      std::optional<Line_Tables::Handle>& line_tables_handle =
+          line_tables_handles[reference.module_index];
+      if (!line_tables_handle.has_value()) {
+        line_tables_handle =
+            this->line_tables_.add_module_line_tables(module, streams);
+      }
+      func->line_tables_handle = *line_tables_handle;
+      this->functions_cache_.push_back(*func);
+    }
+    return true;
+  }
+
+  void register_pdb_modules_if_dirty(Logger& logger) {
+    if (!this->pdb_modules_are_dirty_) {
+      return;
+    }
+    // NOTE(strager): Functions of loaded modules which were not changed since
+    // the previous registration are moved from previous_pdb_modules instead
+    // of being scanned again. See Project_PDB_Module_Cache.
+    std::vector<Lazy_PDB_Module> previous_pdb_modules =
+        std::move(this->pdb_modules_);
+    this->pdb_modules_.clear();
+    this->pdb_module_files_.clear();
+    this->pdb_module_line_tables_.clear();
+    this->cache_budget_.remove_all_entries(
+        this->pdb_module_functions_cache_id_);
+    for (std::unique_ptr<Project_File>& file : this->files_) {
+      file->try_load_pdb_generic_headers(logger);
+      file->try_load_pe_file(logger);
+    }
+    PE_File<Reader>* pe_file = this->find_pe_file_for_pdb_functions();
+
+    for (std::unique_ptr<Project_File>& file : this->files_) {
+      if (!file->pdb_streams.has_value()) continue;
+      file->try_load_pdb_dbi(logger);
+      U32 begin_pdb_module_index = narrow_cast<U32>(this->pdb_modules_.size());
+      for (U64 module_index = 0; module_index < file->pdb_dbi->modules.size();
+           ++module_index) {
+        const PDB_DBI_Module& module = file->pdb_dbi->modules[module_index];
+        Project_PDB_Module_Cache& module_cache =
+            file->pdb_module_caches[module_index];
+        Line_Tables::Handle line_tables_handle = Line_Tables::Handle::null();
+        if (module.debug_info_stream_index < file->pdb_streams->size()) {
+          line_tables_handle =
+              this->pdb_module_line_tables_.add_module_line_tables(
+                  module, *file->pdb_streams);
+        }
+        U32 pdb_module_index = narrow_cast<U32>(this->pdb_modules_.size());
+        Lazy_PDB_Module& lazy_module =
+            this->pdb_modules_.emplace_back(Lazy_PDB_Module{
+                .file = file.get(),
+                .module_index = narrow_cast<U32>(module_index),
+                .line_tables_handle = line_tables_handle,
+            });
+
+        if (module_cache.pdb_module_index.has_value() &&
+            module.debug_info_stream_index < file->pdb_streams->size()) {
+          CSS_ASSERT(*module_cache.pdb_module_index <
+                     previous_pdb_modules.size());
+          Lazy_PDB_Module& previous_module =
+              previous_pdb_modules[*module_cache.pdb_module_index];
+          if (previous_module.is_loaded) {
+            lazy_module.functions = std::move(previous_module.functions);
+            lazy_module.is_loaded = true;
+            CodeView_Function_Table& functions = lazy_module.functions;
+            functions.update_module_fields(
+                0, functions.size(),
+                [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+                  rebase_pdb_module_reader(
+                      fields,
+                      &(*file->pdb_streams)[module.debug_info_stream_index]);
+                  fields.line_tables_handle = line_tables_handle;
+                  fields.pe_file = pe_file;
+                });
+            // NOTE(strager): This might unload other modules, but not this
+            // one.
+            this->cache_budget_.add_entry(this->pdb_module_functions_cache_id_,
+                                          pdb_module_index,
+                                          functions.byte_size());
+          }
+        }
+        module_cache.pdb_module_index = pdb_module_index;
+      }
+      this->pdb_module_files_.push_back(Lazy_PDB_File{
+          .file = file.get(),
+          .begin_pdb_module_index = begin_pdb_module_index,
+          .end_pdb_module_index = narrow_cast<U32>(this->pdb_modules_.size()),
+      });
+    }
+    this->pdb_modules_are_dirty_ = false;
+  }
+
+  // Returns the approximate number of bytes used by the module's functions.
+  U64 load_pdb_module(Lazy_PDB_Module& lazy_module, Logger& logger) {
+    CSS_ASSERT(!lazy_module.is_loaded);
+    Project_File& file = *lazy_module.file;
+    const PDB_DBI_Module& module =
+        file.pdb_dbi->modules[lazy_module.module_index];
+    if (module.debug_info_stream_index >= file.pdb_streams->size()) {
+      logger.log(
+          fmt::format("module #{} has out of bounds stream index {}; ignoring",
+                      lazy_module.module_index, module.debug_info_stream_index),
+          file.pdb_streams->at(3).locate(module.header_offset));
+    } else {
+      PDB_Blocks_Reader<Reader>& codeview_stream =
+          (*file.pdb_streams)[module.debug_info_stream_index];
+      std::vector<CodeView_Function> functions;
+      find_all_codeview_functions_2(&codeview_stream, module.symbols_size,
+                                    functions, logger);
+      lazy_module.functions.append(functions);
+      this->pdb_module_scan_count_ += 1;
+    }
+
+    PE_File<Reader>* pe_file = this->find_pe_file_for_pdb_functions();
+    lazy_module.functions.update_module_fields(
+        0, lazy_module.functions.size(),
+        [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+          fields.line_tables_handle = lazy_module.line_tables_handle;
+          fields.pe_file = pe_file;
+        });
+    lazy_module.is_loaded = true;
+    return lazy_module.functions.byte_size();
+  }
+
+  // NOTE(strager): Match load_functions, which attaches the last PE file.
+  PE_File<Reader>* find_pe_file_for_pdb_functions() {
+    PE_File<Reader>* pe_file = nullptr;
+    for (std::unique_ptr<Project_File>& f : this->files_) {
+      if (f->pe_file.has_value()) {
+        pe_file = &*f->pe_file;
+      }
+    }
+    return pe_file;
+  }
+
+  // Points functions found in a module's symbol stream at another stream with
+  // the same bytes, such as the module's stream in a reloaded file.
+  //
+  // Forgets the functions' PE file.
+  static void rebase_pdb_module_reader(
+      CodeView_Function_Table::Module_Fields& fields,
+      const PDB_Blocks_Reader<Reader>* codeview_stream) {
+    fields.reader = Sub_File_Reader<PDB_Blocks_Reader<Reader>>(
+        codeview_stream, fields.reader.sub_file_offset(), fields.reader.size());
+    fields.pe_file = nullptr;
+  }
+
+  std::unique_ptr<Project_File>* find_file(std::string_view name) {
+    for (std::unique_ptr<Project_File>& file : this->files_) {
+      if (file->name == name) {
+        return &file;
+      }
+    }
+    return nullptr;
+  }
+
+  void mark_files_dirty() {
+    this->functions_are_dirty_ = true;
+    this->dwarf_functions_are_dirty_ = true;
+    this->type_table_is_dirty_ = true;
+    this->type_index_table_is_dirty_ = true;
+    this->pdb_modules_are_dirty_ = true;
+  }
+
+  // Lets new_file reuse functions which were found in old_file's modules if
+  // the modules are unchanged.
+  void copy_caches_of_unchanged_pdb_modules(Project_File& old_file,
+                                            Project_File& new_file,
+                                            Logger& logger) {
+    bool old_file_has_cached_functions = false;
+    for (const Project_PDB_Module_Cache& module_cache :
+         old_file.pdb_module_caches) {
+      if (module_cache.has_functions ||
+          module_cache.pdb_module_index.has_value()) {
+        old_file_has_cached_functions = true;
+        break;
+      }
+    }
+    if (!old_file_has_cached_functions) {
+      return;
+    }
+    new_file.try_load_pdb_dbi(logger);
+    if (!new_file.pdb_dbi.has_value()) {
+      return;
+    }
+    std::vector<PDB_Blocks_Reader<Reader>>& old_streams =
+        *old_file.pdb_streams;
+    std::vector<PDB_Blocks_Reader<Reader>>& new_streams =
+        *new_file.pdb_streams;
+    const std::vector<PDB_DBI_Module>& old_modules = old_file.pdb_dbi->modules;
+    const std::vector<PDB_DBI_Module>& new_modules = new_file.pdb_dbi->modules;
+
+    // NOTE(strager): Match modules by path (rather than by index) in case
+    // modules were added or removed. Paths are not necessarily unique, so
+    // match same-path modules in order.
+    std::unordered_map<std::u8string_view, std::vector<U32>>
+        old_module_indexes_by_path;
+    for (U64 i = old_modules.size(); i-- > 0;) {
+      old_module_indexes_by_path[old_modules[i].linked_object_path].push_back(
+          narrow_cast<U32>(i));
+    }
+    for (U64 new_module_index = 0; new_module_index < new_modules.size();
+         ++new_module_index) {
+      const PDB_DBI_Module& new_module = new_modules[new_module_index];
+      auto it = old_module_indexes_by_path.find(new_module.linked_object_path);
+      if (it == old_module_indexes_by_path.end() || it->second.empty()) {
+        continue;
+      }
+      U32 old_module_index = it->second.back();
+      it->second.pop_back();
+      const PDB_DBI_Module& old_module = old_modules[old_module_index];
+      if (old_module.source_object_path != new_module.source_object_path ||
+          old_module.symbols_size != new_module.symbols_size ||
+          old_module.c11_line_info_size != new_module.c11_line_info_size ||
+          old_module.c13_line_info_size != new_module.c13_line_info_size ||
+          old_module.debug_info_stream_index >= old_streams.size() ||
+          new_module.debug_info_stream_index >= new_streams.size() ||
+          !readers_have_same_bytes(
+              old_streams[old_module.debug_info_stream_index],
+              new_streams[new_module.debug_info_stream_index])) {
+        continue;
+      }
+      new_file.pdb_module_caches[new_module_index] =
+          old_file.pdb_module_caches[old_module_index];
+    }
+  }
+
+  void unload_pdb_module(Lazy_PDB_Module& lazy_module) {
+    lazy_module.functions = CodeView_Function_Table();
+    lazy_module.is_loaded = false;
+  }
+
+  void start_building_function_name_index() {
+    // Copy the names now so the background thread doesn't touch
+    // functions_cache_.
+    std::shared_ptr<Function_Name_Index> index =
+        std::make_shared<Function_Name_Index>();
+    for (U64 i = 0; i < this->functions_cache_.size(); ++i) {
+      index->add_name(this->functions_cache_.name(i));
+    }
+    this->function_name_index_ = index;
+    this->function_name_index_build_ =
+        std::async(std::launch::async, [index]() -> void { index->build(); });
+  }
+
+  void load_dwarf_functions(Logger& logger) {
+    this->dwarf_functions_cache_.clear();
+    this->dwarf_line_tables_.clear();
+
+    for (std::unique_ptr<Project_File>& file : this->files_) {
+      file->try_load_elf_file(logger);
+      if (!file->elf_file.has_value()) continue;
+      U64 begin_function_index = this->dwarf_functions_cache_.size();
+      find_all_dwarf_functions(*file->elf_file, this->dwarf_functions_cache_,
+                               &this->dwarf_line_tables_, logger);
+      for (U64 i = begin_function_index;
+           i < this->dwarf_functions_cache_.size(); ++i) {
+        this->dwarf_functions_cache_[i].elf_file = &*file->elf_file;
       }
     }
   }
 
+  // NOTE(strager): Declared first so registered caches are destroyed before
+  // the budget.
+  Cache_Budget cache_budget_;
+
   std::vector<std::unique_ptr<Project_File>> files_;
 
-  std::vector<CodeView_Function> functions_cache_;
+  CodeView_Function_Table functions_cache_;
   bool functions_are_dirty_ = true;
 
+  Function_Address_Index function_address_index_;
+  bool function_address_index_is_dirty_ = true;
+
+  // Shared with the background thread building the index.
+  std::shared_ptr<Function_Name_Index> function_name_index_;
+  // Invalid once the build has been waited for.
+  std::future<void> function_name_index_build_;
+
+  bool use_pdb_global_symbols_ = false;
+
+  std::vector<Lazy_PDB_Module> pdb_modules_;
+  std::vector<Lazy_PDB_File> pdb_module_files_;
+  Line_Tables pdb_module_line_tables_;
+  bool pdb_modules_are_dirty_ = true;
+  // Keys are indexes into pdb_modules_.
+  Cache_Budget::Cache_ID pdb_module_functions_cache_id_;
+  // Keys are Line_Tables::Handle::module_index.
+  Cache_Budget::Cache_ID pdb_module_line_tables_cache_id_;
+
   std::optional<CodeView_Type_Table> type_table_cache_;
   bool type_table_is_dirty_ = true;
+  // See CodeView_Type_Table::set_cache_budget.
+  Cache_Budget::Cache_ID type_table_cache_id_;
 
   std::optional<CodeView_Type_Table> type_index_table_cache_;
   bool type_index_table_is_dirty_ = true;
+  // See CodeView_Type_Table::set_cache_budget.
+  Cache_Budget::Cache_ID type_index_table_cache_id_;
 
   Line_Tables line_tables_;
+  // Keys are Line_Tables::Handle::module_index.
+  Cache_Budget::Cache_ID line_tables_cache_id_;
+
+  std::vector<DWARF_Function> dwarf_functions_cache_;
+  bool dwarf_functions_are_dirty_ = true;
+  DWARF_Line_Tables dwarf_line_tables_;
+
+  Stack_Usage_Table stack_usage_table_;
+
+  U64 pdb_module_scan_count_ = 0;
 };
 }
@@ -27,6 +27,11 @@ class Sub_File_Reader;
 template <class Derived>
 class Reader_Base {
  public:
+  U64 u64(U64 offset) const {
+    return U64{this->derived()->u32(offset)} |
+           (U64{this->derived()->u32(offset + 4)} << 32);
+  }
+
   std::u8string fixed_width_string(U64 offset, U64 size) const {
     std::optional<U64> string_end_offset =
         this->derived()->find_u8(0, offset, offset + size);
@@ -90,6 +95,7 @@ class Span_Reader : public Reader_Base<Span_Reader> {
   explicit Span_Reader(std::span<const U8> data) : data_(data) {}
 
   U64 size() const { return this->data_.size(); }
+  std::span<const U8> data() const { return this->data_; }
 
   Location locate(U64 offset) const { return Location{.file_offset = offset}; }
 
@@ -239,4 +245,24 @@ class Sub_File_Reader : public Reader_Base<Sub_File_Reader<Base_Reader_T>> {
   U64 sub_file_offset_;
   U64 sub_file_size_;
 };
+
+// Returns true if both readers have the same size and bytes.
+template <class Reader_A, class Reader_B>
+bool readers_have_same_bytes(const Reader_A& a, const Reader_B& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  U8 a_chunk[4096];
+  U8 b_chunk[4096];
+  for (U64 offset = 0; offset < a.size(); offset += sizeof(a_chunk)) {
+    std::size_t chunk_size = static_cast<std::size_t>(
+        std::min(U64{sizeof(a_chunk)}, a.size() - offset));
+    a.copy_bytes_into(std::span<U8>(a_chunk, chunk_size), offset);
+    b.copy_bytes_into(std::span<U8>(b_chunk, chunk_size), offset);
+    if (!std::equal(a_chunk, a_chunk + chunk_size, b_chunk)) {
+      return false;
+    }
+  }
+  return true;
+}
 }
@@ -13,6 +13,15 @@ std::ostream& operator<<(std::ostream& out, const Register_Value& value) {
     case Register_Value_Kind::literal:
       out << value.literal;
       break;
+    case Register_Value_Kind::literal_range:
+      out << "[" << value.literal_range.min << ", " << value.literal_range.max
+          << "]";
+      break;
+    case Register_Value_Kind::entry_rsp_relative_range:
+      out << "entry_rsp_relative(["
+          << static_cast<S64>(value.entry_rsp_relative_range.min) << ", "
+          << static_cast<S64>(value.entry_rsp_relative_range.max) << "])";
+      break;
   }
   out << " @" << value.last_update_offset;
   return out;
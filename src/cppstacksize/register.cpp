@@ -1,105 +1,20 @@
-#include <array>
-#include <capstone/capstone.h>
-#include <cppstacksize/asm-stack-map.h>
+#include <algorithm>
 #include <cppstacksize/base.h>
 #include <cppstacksize/register.h>
+#include <cppstacksize/x86-64-decoder.h>
+#include <optional>
 
 namespace cppstacksize {
-namespace {
-enum class Register_Piece : U8 {
-  low_64,         // e.g. %rax
-  low_32,         // e.g. %eax
-  low_16,         // e.g. %ax
-  low_8,          // e.g. %al
-  low_16_high_8,  // e.g. %ah
-};
-
-constexpr std::array<Register_Name, ::X86_REG_ENDING>
-make_capstone_x86_reg_to_register_name() {
-  std::array<Register_Name, ::X86_REG_ENDING> names;
-  for (Register_Name& name : names) {
-    name = Register_Name::max_register_name;
+std::optional<Register_Value_Range> get_literal_range(
+    const Register_Value& value) {
+  switch (value.kind) {
+    case Register_Value_Kind::literal:
+      return Register_Value_Range{.min = value.literal, .max = value.literal};
+    case Register_Value_Kind::literal_range:
+      return value.literal_range;
+    default:
+      return std::nullopt;
   }
-
-  auto set = [&names](Register_Name name,
-                      std::initializer_list<::x86_reg> registers) {
-    for (::x86_reg r : registers) names[r] = name;
-  };
-  // clang-format off
-  set(Register_Name::rax, {::X86_REG_RAX, ::X86_REG_EAX,  ::X86_REG_AX,   ::X86_REG_AL, ::X86_REG_AH});
-  set(Register_Name::rbx, {::X86_REG_RBX, ::X86_REG_EBX,  ::X86_REG_BX,   ::X86_REG_BL, ::X86_REG_BH});
-  set(Register_Name::rcx, {::X86_REG_RCX, ::X86_REG_ECX,  ::X86_REG_CX,   ::X86_REG_CL, ::X86_REG_CH});
-  set(Register_Name::rdx, {::X86_REG_RDX, ::X86_REG_EDX,  ::X86_REG_DX,   ::X86_REG_DL, ::X86_REG_DH});
-  set(Register_Name::rsi, {::X86_REG_RSI, ::X86_REG_ESI,  ::X86_REG_SI,   ::X86_REG_SIL});
-  set(Register_Name::rdi, {::X86_REG_RDI, ::X86_REG_EDI,  ::X86_REG_DI,   ::X86_REG_DIL});
-  set(Register_Name::rbp, {::X86_REG_RBP, ::X86_REG_EBP,  ::X86_REG_BP,   ::X86_REG_BPL});
-  set(Register_Name::rsp, {::X86_REG_RSP, ::X86_REG_ESP,  ::X86_REG_SP,   ::X86_REG_SPL});
-  set(Register_Name::r8,  {::X86_REG_R8,  ::X86_REG_R8D,  ::X86_REG_R8W,  ::X86_REG_R8B});
-  set(Register_Name::r9,  {::X86_REG_R9,  ::X86_REG_R9D,  ::X86_REG_R9W,  ::X86_REG_R9B});
-  set(Register_Name::r10, {::X86_REG_R10, ::X86_REG_R10D, ::X86_REG_R10W, ::X86_REG_R10B});
-  set(Register_Name::r11, {::X86_REG_R11, ::X86_REG_R11D, ::X86_REG_R11W, ::X86_REG_R11B});
-  set(Register_Name::r12, {::X86_REG_R12, ::X86_REG_R12D, ::X86_REG_R12W, ::X86_REG_R12B});
-  set(Register_Name::r13, {::X86_REG_R13, ::X86_REG_R13D, ::X86_REG_R13W, ::X86_REG_R13B});
-  set(Register_Name::r14, {::X86_REG_R14, ::X86_REG_R14D, ::X86_REG_R14W, ::X86_REG_R14B});
-  set(Register_Name::r15, {::X86_REG_R15, ::X86_REG_R15D, ::X86_REG_R15W, ::X86_REG_R15B});
-  // clang-format on
-
-  return names;
-}
-
-constexpr std::array<Register_Name, ::X86_REG_ENDING>
-    capstone_x86_reg_to_register_name =
-        make_capstone_x86_reg_to_register_name();
-
-constexpr std::array<Register_Piece, ::X86_REG_ENDING>
-make_capstone_x86_reg_to_register_piece() {
-  std::array<Register_Piece, ::X86_REG_ENDING> pieces;
-  for (Register_Piece& piece : pieces) {
-    piece = Register_Piece::low_64;
-  }
-
-  for (::x86_reg r :
-       {::X86_REG_RAX, ::X86_REG_RBX, ::X86_REG_RCX, ::X86_REG_RDX,  //
-        ::X86_REG_RSI, ::X86_REG_RDI, ::X86_REG_RBP, ::X86_REG_RSP,  //
-        ::X86_REG_R8, ::X86_REG_R9, ::X86_REG_R10, ::X86_REG_R11,    //
-        ::X86_REG_R12, ::X86_REG_R13, ::X86_REG_R14, ::X86_REG_R15}) {
-    pieces[r] = Register_Piece::low_64;
-  }
-
-  for (::x86_reg r :
-       {::X86_REG_EAX, ::X86_REG_EBX, ::X86_REG_ECX, ::X86_REG_EDX,    //
-        ::X86_REG_ESI, ::X86_REG_EDI, ::X86_REG_EBP, ::X86_REG_ESP,    //
-        ::X86_REG_R8D, ::X86_REG_R9D, ::X86_REG_R10D, ::X86_REG_R11D,  //
-        ::X86_REG_R12D, ::X86_REG_R13D, ::X86_REG_R14D, ::X86_REG_R15D}) {
-    pieces[r] = Register_Piece::low_32;
-  }
-
-  for (::x86_reg r :
-       {::X86_REG_AX, ::X86_REG_BX, ::X86_REG_CX, ::X86_REG_DX,        //
-        ::X86_REG_SI, ::X86_REG_DI, ::X86_REG_BP, ::X86_REG_SP,        //
-        ::X86_REG_R8W, ::X86_REG_R9W, ::X86_REG_R10W, ::X86_REG_R11W,  //
-        ::X86_REG_R12W, ::X86_REG_R13W, ::X86_REG_R14W, ::X86_REG_R15W}) {
-    pieces[r] = Register_Piece::low_16;
-  }
-
-  for (::x86_reg r :
-       {::X86_REG_AL, ::X86_REG_BL, ::X86_REG_CL, ::X86_REG_DL,        //
-        ::X86_REG_SIL, ::X86_REG_DIL, ::X86_REG_BPL, ::X86_REG_SPL,    //
-        ::X86_REG_R8B, ::X86_REG_R9B, ::X86_REG_R10B, ::X86_REG_R11B,  //
-        ::X86_REG_R12B, ::X86_REG_R13B, ::X86_REG_R14B, ::X86_REG_R15B}) {
-    pieces[r] = Register_Piece::low_8;
-  }
-
-  for (::x86_reg r : {::X86_REG_AH, ::X86_REG_BH, ::X86_REG_CH, ::X86_REG_DH}) {
-    pieces[r] = Register_Piece::low_16_high_8;
-  }
-
-  return pieces;
-}
-
-constexpr std::array<Register_Piece, ::X86_REG_ENDING>
-    capstone_x86_reg_to_register_piece =
-        make_capstone_x86_reg_to_register_piece();
 }
 
 bool operator==(const Register_Value& lhs, const Register_Value& rhs) {
@@ -112,6 +27,14 @@ bool operator==(const Register_Value& lhs, const Register_Value& rhs) {
       return lhs.entry_rsp_relative_offset == rhs.entry_rsp_relative_offset;
     case Register_Value_Kind::literal:
       return lhs.literal == rhs.literal;
+    case Register_Value_Kind::literal_range:
+      return lhs.literal_range.min == rhs.literal_range.min &&
+             lhs.literal_range.max == rhs.literal_range.max;
+    case Register_Value_Kind::entry_rsp_relative_range:
+      return lhs.entry_rsp_relative_range.min ==
+                 rhs.entry_rsp_relative_range.min &&
+             lhs.entry_rsp_relative_range.max ==
+                 rhs.entry_rsp_relative_range.max;
   }
   CSS_UNREACHABLE();
 }
@@ -140,39 +63,39 @@ Register_File::Register_File()
           Register_Value::make_uninitialized(),
       } {}
 
-void Register_File::store(U32 dest, const ::cs_x86_op& src, U32 update_offset) {
-  switch (src.type) {
-    case ::X86_OP_IMM: {
+void Register_File::store(X86_64_Register dest, const X86_64_Operand& src,
+                          U32 update_offset) {
+  switch (src.kind) {
+    case X86_64_Operand_Kind::immediate: {
       // Examples:
       // mov $0, %rax
       // mov $69, %ah
-      Register_Name name = capstone_x86_reg_to_register_name[dest];
-      if (name == Register_Name::max_register_name) {
+      if (!dest.is_tracked()) {
         // TODO(strager)
       } else {
-        Register_Value& value = this->values[name];
-        switch (capstone_x86_reg_to_register_piece[dest]) {
+        Register_Value& value = this->values[dest.name];
+        switch (dest.piece) {
           case Register_Piece::low_32:
           case Register_Piece::low_64:
-            value = Register_Value::make_literal(src.imm, update_offset);
+            value = Register_Value::make_literal(src.immediate, update_offset);
             break;
 
           case Register_Piece::low_16:
           case Register_Piece::low_16_high_8:
           case Register_Piece::low_8:
-            Register_Value old_value = this->values[name];
+            Register_Value old_value = this->values[dest.name];
             switch (old_value.kind) {
               case Register_Value_Kind::literal: {
                 U64 v = old_value.literal;
-                switch (capstone_x86_reg_to_register_piece[dest]) {
+                switch (dest.piece) {
                   case Register_Piece::low_16:
-                    v = (v & ~U64(0xffff)) | src.imm;
+                    v = (v & ~U64(0xffff)) | U64(src.immediate & 0xffff);
                     break;
                   case Register_Piece::low_8:
-                    v = (v & ~U64(0xff)) | src.imm;
+                    v = (v & ~U64(0xff)) | U64(src.immediate & 0xff);
                     break;
                   case Register_Piece::low_16_high_8:
-                    v = (v & ~U64(0xff00)) | (src.imm << 8);
+                    v = (v & ~U64(0xff00)) | (U64(src.immediate & 0xff) << 8);
                     break;
                   default:
                     CSS_UNREACHABLE();
@@ -191,33 +114,42 @@ void Register_File::store(U32 dest, const ::cs_x86_op& src, U32 update_offset) {
       break;
     }
 
-    case ::X86_OP_REG:
+    case X86_64_Operand_Kind::register_:
       this->store(dest, this->load(src.reg), update_offset);
       break;
 
-    case ::X86_OP_MEM:
-      // TODO(strager)
-      break;
-
-    case ::X86_OP_INVALID:
-      CSS_UNREACHABLE();
+    case X86_64_Operand_Kind::memory:
+      // TODO(strager): Track values stored on the stack.
+      this->store(dest, Register_Value::make_unknown(update_offset),
+                  update_offset);
       break;
   }
 }
 
-void Register_File::store(U32 dest, const Register_Value& src,
+void Register_File::store(X86_64_Register dest, const Register_Value& src,
                           U32 update_offset) {
-  Register_Name name = capstone_x86_reg_to_register_name[dest];
-  if (name == Register_Name::max_register_name) {
+  if (!dest.is_tracked()) {
     // TODO(strager)
   } else {
-    Register_Value& value = this->values[name];
-    switch (capstone_x86_reg_to_register_piece[dest]) {
+    Register_Value& value = this->values[dest.name];
+    switch (dest.piece) {
       case Register_Piece::low_64:
         value = src;
         break;
 
       case Register_Piece::low_32:
+        // NOTE(strager): Writing a 32-bit register zeroes the upper 32 bits.
+        if (src.kind == Register_Value_Kind::literal) {
+          value = Register_Value::make_literal(src.literal & 0xffffffff,
+                                               update_offset);
+        } else if (src.kind == Register_Value_Kind::literal_range &&
+                   src.literal_range.max <= 0xffffffff) {
+          value = src;
+        } else {
+          value = Register_Value::make_unknown(update_offset);
+        }
+        break;
+
       case Register_Piece::low_16:
       case Register_Piece::low_16_high_8:
       case Register_Piece::low_8:
@@ -228,14 +160,26 @@ void Register_File::store(U32 dest, const Register_Value& src,
   }
 }
 
-Register_Value Register_File::load(/*::x86_reg*/ U32 src) {
-  Register_Name name = capstone_x86_reg_to_register_name[src];
-  if (name == Register_Name::max_register_name) {
+Register_Value Register_File::load(X86_64_Register src) {
+  if (!src.is_tracked()) {
     return Register_Value::make_uninitialized();
   } else {
-    switch (capstone_x86_reg_to_register_piece[src]) {
+    switch (src.piece) {
       case Register_Piece::low_64:
-        return this->values[name];
+        return this->values[src.name];
+      case Register_Piece::low_32: {
+        const Register_Value& value = this->values[src.name];
+        if (value.kind == Register_Value_Kind::literal) {
+          return Register_Value::make_literal(value.literal & 0xffffffff,
+                                              value.last_update_offset);
+        }
+        if (value.kind == Register_Value_Kind::literal_range &&
+            value.literal_range.max <= 0xffffffff) {
+          return value;
+        }
+        // TODO(strager)
+        return Register_Value::make_uninitialized();
+      }
       default:
         // TODO(strager)
         return Register_Value::make_uninitialized();
@@ -243,16 +187,16 @@ Register_Value Register_File::load(/*::x86_reg*/ U32 src) {
   }
 }
 
-Register_Value Register_File::load(const ::cs_x86_op& src) {
-  switch (src.type) {
-    case ::X86_OP_IMM:
+Register_Value Register_File::load(const X86_64_Operand& src) {
+  switch (src.kind) {
+    case X86_64_Operand_Kind::immediate:
       // Examples:
       // sub $0x18, %rsp
       // add $0x18, %rsp
       // FIXME(strager): The last_update_offset is incorrect.
-      return Register_Value::make_literal(src.imm, (U32)-1);
+      return Register_Value::make_literal(src.immediate, (U32)-1);
 
-    case ::X86_OP_REG:
+    case X86_64_Operand_Kind::register_:
       // Examples:
       // sub %rax, %rsp
       return this->load(src.reg);
@@ -264,13 +208,13 @@ Register_Value Register_File::load(const ::cs_x86_op& src) {
   CSS_UNREACHABLE();
 }
 
-void Register_File::add(/*::x86_reg*/ U32 dest, U64 addend, U32 update_offset) {
-  Register_Name name = capstone_x86_reg_to_register_name[dest];
-  if (name == Register_Name::max_register_name) {
+void Register_File::add(X86_64_Register dest, U64 addend,
+                        U32 update_offset) {
+  if (!dest.is_tracked()) {
     // TODO(strager)
   } else {
-    Register_Value& value = this->values[name];
-    switch (capstone_x86_reg_to_register_piece[dest]) {
+    Register_Value& value = this->values[dest.name];
+    switch (dest.piece) {
       case Register_Piece::low_64: {
         switch (value.kind) {
           case Register_Value_Kind::unknown:
@@ -282,6 +226,22 @@ void Register_File::add(/*::x86_reg*/ U32 dest, U64 addend, U32 update_offset) {
           case Register_Value_Kind::literal:
             value.literal += addend;
             break;
+          case Register_Value_Kind::literal_range: {
+            U64 min = value.literal_range.min + addend;
+            U64 max = value.literal_range.max + addend;
+            if (min <= max) {
+              value.literal_range =
+                  Register_Value_Range{.min = min, .max = max};
+            } else {
+              // The range wrapped around.
+              value = Register_Value::make_unknown(update_offset);
+            }
+            break;
+          }
+          case Register_Value_Kind::entry_rsp_relative_range:
+            value.entry_rsp_relative_range.min += addend;
+            value.entry_rsp_relative_range.max += addend;
+            break;
         }
         break;
       }
@@ -296,4 +256,132 @@ void Register_File::add(/*::x86_reg*/ U32 dest, U64 addend, U32 update_offset) {
     value.last_update_offset = update_offset;
   }
 }
+
+void Register_File::subtract(X86_64_Register dest,
+                             const Register_Value& subtrahend,
+                             U32 update_offset) {
+  if (!dest.is_tracked()) {
+    // TODO(strager)
+    return;
+  }
+  if (subtrahend.kind == Register_Value_Kind::literal) {
+    this->add(dest, -subtrahend.literal, update_offset);
+    return;
+  }
+
+  Register_Value result = Register_Value::make_unknown(update_offset);
+  std::optional<Register_Value_Range> rhs = get_literal_range(subtrahend);
+  // NOTE(strager): Like in load_address, ignore huge ranges so the
+  // subtraction cannot overflow.
+  if (dest.piece == Register_Piece::low_64 && rhs.has_value() &&
+      rhs->max <= 0xffffffff) {
+    Register_Value& value = this->values[dest.name];
+    switch (value.kind) {
+      case Register_Value_Kind::entry_rsp_relative:
+      case Register_Value_Kind::entry_rsp_relative_range: {
+        Register_Value_Range lhs =
+            value.kind == Register_Value_Kind::entry_rsp_relative
+                ? Register_Value_Range{.min = value.entry_rsp_relative_offset,
+                                       .max = value.entry_rsp_relative_offset}
+                : value.entry_rsp_relative_range;
+        result = Register_Value::make_entry_rsp_relative_range(
+            lhs.min - rhs->max, lhs.max - rhs->min, update_offset);
+        break;
+      }
+      case Register_Value_Kind::literal:
+      case Register_Value_Kind::literal_range: {
+        Register_Value_Range lhs = *get_literal_range(value);
+        if (lhs.min >= rhs->max) {
+          result = Register_Value::make_literal_range(
+              lhs.min - rhs->max, lhs.max - rhs->min, update_offset);
+        }
+        break;
+      }
+      case Register_Value_Kind::unknown:
+        break;
+    }
+  }
+  this->store(dest, result, update_offset);
+}
+
+Register_Value Register_File::load_address(const X86_64_Memory_Operand& src) {
+  // NOTE(strager): If there is no base register, or if the base register is
+  // %rip, src.base is untracked and the address is unknown.
+  Register_Value base = this->load(src.base);
+  Register_Value_Range address;
+  bool is_entry_rsp_relative;
+  switch (base.kind) {
+    case Register_Value_Kind::entry_rsp_relative:
+      address = Register_Value_Range{.min = base.entry_rsp_relative_offset,
+                                     .max = base.entry_rsp_relative_offset};
+      is_entry_rsp_relative = true;
+      break;
+    case Register_Value_Kind::entry_rsp_relative_range:
+      address = base.entry_rsp_relative_range;
+      is_entry_rsp_relative = true;
+      break;
+    case Register_Value_Kind::literal:
+    case Register_Value_Kind::literal_range:
+      address = *get_literal_range(base);
+      is_entry_rsp_relative = false;
+      break;
+    case Register_Value_Kind::unknown:
+      return Register_Value::make_unknown(base.last_update_offset);
+  }
+
+  if (src.index.is_tracked()) {
+    std::optional<Register_Value_Range> index =
+        get_literal_range(this->load(src.index));
+    if (!index.has_value()) {
+      return Register_Value::make_unknown(base.last_update_offset);
+    }
+    if (index->min != index->max && index->max > 0xffffffff) {
+      // NOTE(strager): Multiplying by the scale might overflow. Such a large
+      // range is useless anyway.
+      return Register_Value::make_unknown(base.last_update_offset);
+    }
+    address.min += index->min * src.scale;
+    address.max += index->max * src.scale;
+  }
+  address.min += src.displacement;
+  address.max += src.displacement;
+
+  if (is_entry_rsp_relative) {
+    if (static_cast<S64>(address.min) > static_cast<S64>(address.max)) {
+      return Register_Value::make_unknown(base.last_update_offset);
+    }
+    return Register_Value::make_entry_rsp_relative_range(
+        address.min, address.max, base.last_update_offset);
+  } else {
+    if (address.min > address.max) {
+      return Register_Value::make_unknown(base.last_update_offset);
+    }
+    return Register_Value::make_literal_range(address.min, address.max,
+                                              base.last_update_offset);
+  }
+}
+
+void Register_File::bitwise_and(X86_64_Register dest,
+                                const Register_Value& mask,
+                                U32 update_offset) {
+  if (!dest.is_tracked()) {
+    // TODO(strager)
+    return;
+  }
+  std::optional<Register_Value_Range> lhs =
+      get_literal_range(this->load(dest));
+  std::optional<Register_Value_Range> rhs = get_literal_range(mask);
+  Register_Value result = Register_Value::make_unknown(update_offset);
+  if (lhs.has_value() && rhs.has_value() && lhs->min == lhs->max &&
+      rhs->min == rhs->max) {
+    result = Register_Value::make_literal(lhs->min & rhs->min, update_offset);
+  } else if (lhs.has_value() || rhs.has_value()) {
+    // NOTE(strager): x & y is at most x and at most y (unsigned).
+    U64 max = U64(-1);
+    if (lhs.has_value()) max = std::min(max, lhs->max);
+    if (rhs.has_value()) max = std::min(max, rhs->max);
+    result = Register_Value::make_literal_range(0, max, update_offset);
+  }
+  this->store(dest, result, update_offset);
+}
 }
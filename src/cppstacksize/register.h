@@ -2,14 +2,21 @@
 
 #include <cppstacksize/base.h>
 #include <iosfwd>
-
-typedef struct cs_x86_op cs_x86_op;
+#include <optional>
 
 namespace cppstacksize {
+struct X86_64_Memory_Operand;
+struct X86_64_Operand;
+
 enum class Register_Value_Kind : U8 {
   unknown,
   literal,
   entry_rsp_relative,
+  // One of a range of literals. Example: the result of and $0xf, %rax
+  literal_range,
+  // One of a range of entry_rsp_relative offsets. Example: the result of
+  // lea 0x10(%rsp,%rcx,4), %rax if %rcx is a literal_range.
+  entry_rsp_relative_range,
 };
 
 enum Register_Name : U8 {
@@ -36,6 +43,48 @@ enum Register_Name : U8 {
   max_register_name,
 };
 
+enum class Register_Piece : U8 {
+  low_64,         // e.g. %rax
+  low_32,         // e.g. %eax
+  low_16,         // e.g. %ax
+  low_8,          // e.g. %al
+  low_16_high_8,  // e.g. %ah
+};
+
+// A general-purpose register or a part of one, such as %eax (the low 32 bits
+// of %rax).
+//
+// If name == Register_Name::max_register_name, the register is not tracked by
+// Register_File (e.g. %rip or %xmm0), or there is no register.
+struct X86_64_Register {
+  static constexpr X86_64_Register full(Register_Name name) {
+    return X86_64_Register{.name = name, .piece = Register_Piece::low_64};
+  }
+
+  static constexpr X86_64_Register untracked() {
+    return full(Register_Name::max_register_name);
+  }
+
+  bool is_tracked() const {
+    return this->name != Register_Name::max_register_name;
+  }
+
+  friend bool operator==(const X86_64_Register&,
+                         const X86_64_Register&) = default;
+
+  Register_Name name;
+  Register_Piece piece;
+};
+
+// Inclusive bounds.
+//
+// For literal_range, min and max are unsigned. For entry_rsp_relative_range,
+// min and max are signed (like entry_rsp_relative_offset).
+struct Register_Value_Range {
+  U64 min;
+  U64 max;
+};
+
 struct Register_Value {
   Register_Value_Kind kind;
   U32 last_update_offset;
@@ -46,6 +95,12 @@ struct Register_Value {
 
     // If kind == Register_Value_Kind::entry_rsp_relative:
     U64 entry_rsp_relative_offset;
+
+    // If kind == Register_Value_Kind::literal_range:
+    Register_Value_Range literal_range;
+
+    // If kind == Register_Value_Kind::entry_rsp_relative_range:
+    Register_Value_Range entry_rsp_relative_range;
   };
 
   static Register_Value make_uninitialized() { return make_unknown((U32)-1); }
@@ -97,6 +152,35 @@ struct Register_Value {
     return value;
   }
 
+  // If min == max, returns a literal instead of a literal_range.
+  static Register_Value make_literal_range(U64 min, U64 max,
+                                           U32 last_update_offset) {
+    CSS_ASSERT(min <= max);
+    if (min == max) return make_literal(min, last_update_offset);
+    Register_Value value;
+    value.kind = Register_Value_Kind::literal_range;
+    value.literal_range = Register_Value_Range{.min = min, .max = max};
+    value.last_update_offset = last_update_offset;
+    return value;
+  }
+
+  // If min_offset == max_offset, returns an entry_rsp_relative instead of an
+  // entry_rsp_relative_range.
+  static Register_Value make_entry_rsp_relative_range(U64 min_offset,
+                                                      U64 max_offset,
+                                                      U32 last_update_offset) {
+    CSS_ASSERT(static_cast<S64>(min_offset) <= static_cast<S64>(max_offset));
+    if (min_offset == max_offset) {
+      return make_entry_rsp_relative(min_offset, last_update_offset);
+    }
+    Register_Value value;
+    value.kind = Register_Value_Kind::entry_rsp_relative_range;
+    value.entry_rsp_relative_range =
+        Register_Value_Range{.min = min_offset, .max = max_offset};
+    value.last_update_offset = last_update_offset;
+    return value;
+  }
+
   friend bool operator==(const Register_Value&, const Register_Value&);
   friend bool operator!=(const Register_Value&, const Register_Value&);
 
@@ -109,15 +193,38 @@ struct Register_File {
 
   Register_Value values[Register_Name::max_register_name];
 
-  void store(/*::x86_reg*/ U32 dest, const ::cs_x86_op& src, U32 update_offset);
-  void store(/*::x86_reg*/ U32 dest, const Register_Value& src,
+  void store(X86_64_Register dest, const X86_64_Operand& src,
+             U32 update_offset);
+  void store(X86_64_Register dest, const Register_Value& src,
              U32 update_offset);
 
-  Register_Value load(/*::x86_reg*/ U32 src);
-  Register_Value load(const ::cs_x86_op& src);
-
-  void add(/*::x86_reg*/ U32 dest, U64 addend, U32 update_offset);
+  Register_Value load(X86_64_Register src);
+  Register_Value load(const X86_64_Operand& src);
+
+  // Computes the address of a memory operand, i.e. what lea would store.
+  //
+  // If the index register holds a range, the result is a range.
+  Register_Value load_address(const X86_64_Memory_Operand& src);
+
+  void add(X86_64_Register dest, U64 addend, U32 update_offset);
+
+  // Examples:
+  // sub $0x18, %rsp
+  // sub %rax, %rsp
+  //
+  // If subtrahend is a range, the result is a range.
+  void subtract(X86_64_Register dest, const Register_Value& subtrahend,
+                U32 update_offset);
+
+  // Examples:
+  // and $0xf, %ecx
+  // and %rdx, %rax
+  void bitwise_and(X86_64_Register dest, const Register_Value& mask,
+                   U32 update_offset);
 };
 
+// Returns std::nullopt if value is not a literal or a literal_range.
+std::optional<Register_Value_Range> get_literal_range(const Register_Value&);
+
 std::ostream& operator<<(std::ostream& out, const Register_Value&);
 }
@@ -0,0 +1,381 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/pe.h>
+#include <cppstacksize/stack-usage.h>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace cppstacksize {
+namespace {
+template <class Int>
+bool parse_decimal(std::string_view s, Int* out) {
+  if (s.empty()) {
+    return false;
+  }
+  const char* end = s.data() + s.size();
+  std::from_chars_result result = std::from_chars(s.data(), end, *out);
+  return result.ec == std::errc() && result.ptr == end;
+}
+
+// Splits "path:line:column:name" or "path:line:name". If there is no source
+// location, sets *name to the entire string.
+void parse_stack_usage_location(std::string_view s, Stack_Usage_Entry* out) {
+  // NOTE(strager): Paths can contain ':' (e.g. "C:\foo.c" on Windows), and so
+  // can names (e.g. "ns::f()"). Find the first ":<digits>:" and assume that's
+  // the line number.
+  for (std::size_t colon = s.find(':'); colon != std::string_view::npos;
+       colon = s.find(':', colon + 1)) {
+    std::size_t line_end = s.find(':', colon + 1);
+    if (line_end == std::string_view::npos) {
+      break;
+    }
+    U32 line_number;
+    if (!parse_decimal(s.substr(colon + 1, line_end - (colon + 1)),
+                       &line_number)) {
+      continue;
+    }
+    out->source_path = s.substr(0, colon);
+    out->line_number = line_number;
+    std::string_view rest = s.substr(line_end + 1);
+
+    std::size_t column_end = rest.find(':');
+    U32 column_number;
+    if (column_end != std::string_view::npos &&
+        parse_decimal(rest.substr(0, column_end), &column_number)) {
+      out->column_number = column_number;
+      rest = rest.substr(column_end + 1);
+    }
+    out->function_name = rest;
+    return;
+  }
+  out->function_name = s;
+}
+
+std::string_view trim_line_ending(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+}
+
+std::optional<Stack_Usage_Entry> parse_stack_usage_line(
+    std::string_view line) {
+  line = trim_line_ending(line);
+
+  // NOTE(strager): Function names can contain spaces but not tabs, so split
+  // from the right.
+  std::size_t qualifiers_tab = line.rfind('\t');
+  if (qualifiers_tab == std::string_view::npos || qualifiers_tab == 0) {
+    return std::nullopt;
+  }
+  std::size_t size_tab = line.rfind('\t', qualifiers_tab - 1);
+  if (size_tab == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  Stack_Usage_Entry entry;
+  if (!parse_decimal(line.substr(size_tab + 1, qualifiers_tab - (size_tab + 1)),
+                     &entry.stack_size)) {
+    return std::nullopt;
+  }
+
+  std::string_view qualifiers = line.substr(qualifiers_tab + 1);
+  while (!qualifiers.empty()) {
+    std::size_t comma = qualifiers.find(',');
+    std::string_view qualifier = qualifiers.substr(0, comma);
+    if (qualifier == "dynamic") {
+      entry.is_dynamic = true;
+    } else if (qualifier == "bounded") {
+      entry.is_bounded = true;
+    } else if (qualifier != "static") {
+      return std::nullopt;
+    }
+    if (comma == std::string_view::npos) {
+      break;
+    }
+    qualifiers = qualifiers.substr(comma + 1);
+  }
+
+  parse_stack_usage_location(line.substr(0, size_tab), &entry);
+  if (entry.function_name.empty()) {
+    return std::nullopt;
+  }
+  return entry;
+}
+
+std::string_view stack_usage_qualified_name(std::string_view function_name) {
+  std::string_view name = function_name;
+
+  // "void f(T) [with T = int]" -> "void f(T)"
+  if (name.ends_with(']')) {
+    std::size_t with = name.rfind(" [with ");
+    if (with != std::string_view::npos) {
+      name = name.substr(0, with);
+    }
+  }
+
+  // Strip the parameter list and any trailing qualifiers:
+  // "int ns::f(int) const" -> "int ns::f"
+  std::size_t close_paren = name.rfind(')');
+  if (close_paren == std::string_view::npos) {
+    return function_name;
+  }
+  int depth = 0;
+  std::size_t open_paren = std::string_view::npos;
+  for (std::size_t i = close_paren + 1; i-- > 0;) {
+    if (name[i] == ')') {
+      depth += 1;
+    } else if (name[i] == '(') {
+      depth -= 1;
+      if (depth == 0) {
+        open_paren = i;
+        break;
+      }
+    }
+  }
+  if (open_paren == std::string_view::npos || open_paren == 0) {
+    return function_name;
+  }
+  name = name.substr(0, open_paren);
+
+  // Strip the return type: "int ns::f" -> "ns::f"
+  depth = 0;
+  for (std::size_t i = name.size(); i-- > 0;) {
+    char c = name[i];
+    if (c == '>') {
+      depth += 1;
+    } else if (c == '<') {
+      depth -= 1;
+    } else if (c == ' ' && depth == 0) {
+      // Keep "operator new", "operator int", etc. intact.
+      if (name.substr(0, i).ends_with("operator")) {
+        continue;
+      }
+      return name.substr(i + 1);
+    }
+  }
+  return name;
+}
+
+void Stack_Usage_Table::add_entry(Stack_Usage_Entry&& entry) {
+  auto existing_it = this->index_by_name_.find(entry.function_name);
+  if (existing_it != this->index_by_name_.end()) {
+    U64 existing_index = existing_it->second;
+    if (entry.stack_size > this->entries_[existing_index].stack_size) {
+      this->entries_[existing_index] = std::move(entry);
+      this->index_qualified_name(existing_index);
+    }
+    return;
+  }
+
+  U64 entry_index = this->entries_.size();
+  this->entries_.push_back(std::move(entry));
+  this->index_by_name_.emplace(this->entries_.back().function_name,
+                               entry_index);
+  this->index_qualified_name(entry_index);
+}
+
+void Stack_Usage_Table::index_qualified_name(U64 entry_index) {
+  const Stack_Usage_Entry& entry = this->entries_[entry_index];
+  std::string_view qualified_name =
+      stack_usage_qualified_name(entry.function_name);
+  if (qualified_name == entry.function_name) {
+    // find_function checks index_by_name_ first, so don't bother indexing.
+    return;
+  }
+  auto [it, inserted] = this->index_by_qualified_name_.try_emplace(
+      std::string(qualified_name), entry_index);
+  if (!inserted &&
+      entry.stack_size > this->entries_[it->second].stack_size) {
+    it->second = entry_index;
+  }
+}
+
+void Stack_Usage_Table::merge(Stack_Usage_Table&& other) {
+  if (this->entries_.empty()) {
+    *this = std::move(other);
+    return;
+  }
+  this->entries_.reserve(this->entries_.size() + other.entries_.size());
+  for (Stack_Usage_Entry& entry : other.entries_) {
+    this->add_entry(std::move(entry));
+  }
+  other.clear();
+}
+
+void Stack_Usage_Table::add_file_data(std::string_view data,
+                                      std::string_view file_name,
+                                      Logger& logger) {
+  U64 line_offset = 0;
+  while (line_offset < data.size()) {
+    std::size_t line_end = data.find('\n', line_offset);
+    if (line_end == std::string_view::npos) {
+      line_end = data.size();
+    }
+    std::string_view line = data.substr(line_offset, line_end - line_offset);
+    if (!trim_line_ending(line).empty()) {
+      std::optional<Stack_Usage_Entry> entry = parse_stack_usage_line(line);
+      if (entry.has_value()) {
+        this->add_entry(std::move(*entry));
+      } else {
+        logger.log(fmt::format("{}: malformed stack usage line; ignoring",
+                               file_name),
+                   Location{.file_offset = line_offset});
+      }
+    }
+    line_offset = line_end + 1;
+  }
+}
+
+const Stack_Usage_Entry* Stack_Usage_Table::find_by_name(
+    std::string_view function_name) const {
+  auto it = this->index_by_name_.find(function_name);
+  if (it == this->index_by_name_.end()) {
+    return nullptr;
+  }
+  return &this->entries_[it->second];
+}
+
+const Stack_Usage_Entry* Stack_Usage_Table::find_function(
+    std::string_view function_name) const {
+  if (const Stack_Usage_Entry* entry = this->find_by_name(function_name)) {
+    return entry;
+  }
+  auto it = this->index_by_qualified_name_.find(function_name);
+  if (it == this->index_by_qualified_name_.end()) {
+    return nullptr;
+  }
+  return &this->entries_[it->second];
+}
+
+std::span<const Stack_Usage_Entry> Stack_Usage_Table::entries() const {
+  return this->entries_;
+}
+
+U64 Stack_Usage_Table::size() const { return this->entries_.size(); }
+
+void Stack_Usage_Table::clear() { *this = Stack_Usage_Table(); }
+
+void load_stack_usage_files(std::span<const std::string> paths,
+                            Stack_Usage_Table& out, Logger& logger,
+                            unsigned thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  thread_count = static_cast<unsigned>(
+      std::min<U64>(thread_count, std::max<U64>(paths.size(), 1)));
+
+  // Each worker claims the next unread file, so a few huge files don't stall
+  // the other workers.
+  std::atomic<U64> next_path_index = 0;
+
+  struct Worker_Result {
+    Stack_Usage_Table table;
+    // Logger is not thread-safe, so buffer messages until all workers finish.
+    std::vector<Captured_Log_Message> log_messages;
+  };
+  std::vector<Worker_Result> results(thread_count);
+
+  auto work = [&](Worker_Result& result) -> void {
+    std::string line;
+    for (;;) {
+      U64 path_index = next_path_index.fetch_add(1);
+      if (path_index >= paths.size()) {
+        break;
+      }
+      const std::string& path = paths[path_index];
+      std::ifstream file(path, std::ifstream::in | std::ifstream::binary);
+      if (!file) {
+        result.log_messages.push_back(Captured_Log_Message{
+            .location = Location{.file_offset = 0},
+            .message = fmt::format("{}: failed to open file", path),
+        });
+        continue;
+      }
+      U64 line_offset = 0;
+      while (std::getline(file, line)) {
+        if (!trim_line_ending(line).empty()) {
+          std::optional<Stack_Usage_Entry> entry =
+              parse_stack_usage_line(line);
+          if (entry.has_value()) {
+            result.table.add_entry(std::move(*entry));
+          } else {
+            result.log_messages.push_back(Captured_Log_Message{
+                .location = Location{.file_offset = line_offset},
+                .message = fmt::format(
+                    "{}: malformed stack usage line; ignoring", path),
+            });
+          }
+        }
+        line_offset += line.size() + 1;
+      }
+    }
+  };
+
+  if (thread_count == 1) {
+    work(results[0]);
+  } else {
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count);
+    for (Worker_Result& result : results) {
+      threads.emplace_back(work, std::ref(result));
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  for (Worker_Result& result : results) {
+    out.merge(std::move(result.table));
+    for (const Captured_Log_Message& message : result.log_messages) {
+      logger.log(message.message, message.location);
+    }
+  }
+}
+
+namespace {
+// Number of bytes between the entry stack pointer (inclusive of the return
+// address) and the deepest byte touched by an instruction.
+U64 get_touched_stack_size(std::span<const Stack_Map_Touch> touches) {
+  static constexpr U64 return_address_size = 8;
+  U64 touched_stack_size = return_address_size;
+  for (const Stack_Map_Touch& touch : touches) {
+    if (touch.entry_rsp_relative_address < 0) {
+      touched_stack_size = std::max(
+          touched_stack_size,
+          static_cast<U64>(-touch.entry_rsp_relative_address) +
+              return_address_size);
+    }
+  }
+  return touched_stack_size;
+}
+}
+
+Stack_Usage_Check check_stack_usage(const Stack_Usage_Entry& entry,
+                                    std::span<const Stack_Map_Touch> touches) {
+  U64 touched_stack_size = get_touched_stack_size(touches);
+  return Stack_Usage_Check{
+      .reported_stack_size = entry.stack_size,
+      .touched_stack_size = touched_stack_size,
+      .is_consistent =
+          entry.is_dynamic || touched_stack_size <= entry.stack_size,
+  };
+}
+
+Stack_Usage_Check check_unwind_frame(const PE_Unwind_Frame& frame,
+                                     std::span<const Stack_Map_Touch> touches) {
+  U64 touched_stack_size = get_touched_stack_size(touches);
+  bool might_be_dynamic = frame.frame_register.has_value();
+  return Stack_Usage_Check{
+      .reported_stack_size = frame.stack_size(),
+      .touched_stack_size = touched_stack_size,
+      .is_consistent =
+          might_be_dynamic || touched_stack_size <= frame.stack_size(),
+  };
+}
+}
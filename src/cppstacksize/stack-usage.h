@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/logger.h>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Support for .su files created by GCC's and Clang's -fstack-usage option.
+//
+// Each line of a .su file describes one function:
+//
+//   example.cpp:11:16:int big_frame(int)<TAB>128<TAB>static
+//
+// GCC writes the function's human-readable signature. Clang writes the
+// function's mangled name and omits the column number.
+
+namespace cppstacksize {
+struct PE_Unwind_Frame;
+struct Stack_Map_Touch;
+
+struct Stack_Usage_Entry {
+  // The function's name exactly as written in the .su file.
+  std::string function_name;
+
+  // Empty if the .su file did not include a source location.
+  std::string source_path;
+  U32 line_number = 0;
+  U32 column_number = 0;
+
+  // Number of bytes used by the function, including the return address.
+  U64 stack_size;
+
+  // If true, the function allocates stack dynamically (e.g. with alloca or a
+  // variable-length array), and stack_size is a lower bound.
+  bool is_dynamic = false;
+  // If true, the function's dynamic allocations are bounded, and stack_size is
+  // an upper bound.
+  bool is_bounded = false;
+};
+
+// Returns null if the line is malformed.
+std::optional<Stack_Usage_Entry> parse_stack_usage_line(std::string_view line);
+
+// Converts a GCC-style function signature such as "int ns::f(int) const" into
+// a name such as "ns::f" suitable for matching with names from CodeView or
+// DWARF debug information.
+//
+// Names without a parameter list (such as mangled names or C function names)
+// are returned unchanged.
+std::string_view stack_usage_qualified_name(std::string_view function_name);
+
+// A collection of Stack_Usage_Entry-s with fast lookup by name.
+class Stack_Usage_Table {
+ public:
+  // If an entry for the same function already exists (e.g. an inline function
+  // emitted by several translation units), the entry with the larger stack
+  // size is kept.
+  void add_entry(Stack_Usage_Entry&&);
+
+  // Adds every entry from the other table. See add_entry.
+  void merge(Stack_Usage_Table&&);
+
+  // Parses the contents of a .su file and adds its entries.
+  //
+  // file_name is used for log messages only.
+  void add_file_data(std::string_view data, std::string_view file_name,
+                     Logger& logger = fallback_logger);
+
+  // Returns null if there is no entry with the given name as written in the
+  // .su file.
+  const Stack_Usage_Entry* find_by_name(std::string_view function_name) const;
+
+  // Looks up a function by its name from debug information (e.g.
+  // CodeView_Function::name) by first trying an exact match then trying
+  // stack_usage_qualified_name.
+  //
+  // If several overloads share a qualified name, the one with the largest
+  // stack size is returned.
+  //
+  // Returns null if there is no matching entry.
+  const Stack_Usage_Entry* find_function(std::string_view function_name) const;
+
+  std::span<const Stack_Usage_Entry> entries() const;
+  U64 size() const;
+  void clear();
+
+ private:
+  struct String_Hash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept {
+      return std::hash<std::string_view>()(s);
+    }
+  };
+  using Index = std::unordered_map<std::string, U64, String_Hash,
+                                   std::equal_to<>>;
+
+  void index_qualified_name(U64 entry_index);
+
+  std::vector<Stack_Usage_Entry> entries_;
+  // Value is an index into entries_.
+  Index index_by_name_;
+  // Value is an index into entries_.
+  Index index_by_qualified_name_;
+};
+
+// Reads and parses many .su files in parallel, adding their entries to out.
+//
+// Files are read line by line, so memory usage does not grow with the size of
+// the input files.
+//
+// If thread_count is 0, a thread count is picked automatically.
+void load_stack_usage_files(std::span<const std::string> paths,
+                            Stack_Usage_Table& out,
+                            Logger& logger = fallback_logger,
+                            unsigned thread_count = 0);
+
+// Compares a .su file's reported stack size against the stack memory touched
+// by a function's instructions (see analyze_x86_64_stack_map).
+struct Stack_Usage_Check {
+  // Stack_Usage_Entry::stack_size (or PE_Unwind_Frame::stack_size).
+  U64 reported_stack_size;
+  // Number of bytes between the entry stack pointer (inclusive of the return
+  // address) and the deepest byte touched by an instruction.
+  U64 touched_stack_size;
+  // If false, the function touches stack memory beyond what the .su file
+  // reported, which indicates a bug in the analysis or in the .su file.
+  bool is_consistent;
+};
+
+Stack_Usage_Check check_stack_usage(const Stack_Usage_Entry&,
+                                    std::span<const Stack_Map_Touch> touches);
+
+// Like check_stack_usage, but compares against the frame described by x64
+// unwind information (see PE_File::find_unwind_frame) instead of a .su file.
+//
+// Functions which set up a frame pointer (UWOP_SET_FPREG) might allocate stack
+// dynamically, so they are always considered consistent.
+Stack_Usage_Check check_unwind_frame(const PE_Unwind_Frame&,
+                                     std::span<const Stack_Map_Touch> touches);
+}
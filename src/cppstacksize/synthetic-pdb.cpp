@@ -0,0 +1,675 @@
+#include <algorithm>
+#include <cppstacksize/base.h>
+#include <cppstacksize/codeview-constants.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <cppstacksize/util.h>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+// Writes a CodeView record's kind. Returns the record's offset so that
+// end_codeview_record can fill in the record's size.
+U64 begin_codeview_record(Byte_Buffer& out, U16 kind) {
+  U64 record_offset = out.size();
+  out.append_u16(0);  // Size. Filled in by end_codeview_record.
+  out.append_u16(kind);
+  return record_offset;
+}
+
+void end_codeview_record(Byte_Buffer& out, U64 record_offset) {
+  out.pad_to_alignment(4);
+  out.set_u16(record_offset, narrow_cast<U16>(out.size() - record_offset - 2));
+}
+
+// Returns true if the given block is reserved for a free block map.
+bool is_free_block_map_block(U32 block_index, U32 block_size) {
+  U32 index_in_interval = block_index % block_size;
+  return index_in_interval == 1 || index_in_interval == 2;
+}
+
+std::vector<U8> make_synthetic_pdb_info_stream(U32 seed) {
+  Byte_Buffer out;
+  out.append_u32(20000404);  // Version (VC70).
+  out.append_u32(seed);      // Signature.
+  out.append_u32(1);         // Age.
+  for (U32 i = 0; i < 16; ++i) {
+    out.append_u8(narrow_cast<U8>(seed + i));  // GUID.
+  }
+  // Named stream map (empty):
+  out.append_u32(0);  // String buffer size.
+  out.append_u32(0);  // Hash table size.
+  out.append_u32(1);  // Hash table capacity.
+  out.append_u32(0);  // Present bit vector word count.
+  out.append_u32(0);  // Deleted bit vector word count.
+  out.append_u32(0);  // Unused.
+  out.append_u32(20140508);  // Feature code (VC140).
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_tpi_stream(std::span<const U8> type_records,
+                                          U32 type_count) {
+  constexpr U32 header_size = 56;
+  Byte_Buffer out;
+  out.append_u32(20040203);  // Version (V80).
+  out.append_u32(header_size);
+  out.append_u32(0x1000);               // First type ID.
+  out.append_u32(0x1000 + type_count);  // End type ID.
+  out.append_u32(narrow_cast<U32>(type_records.size()));
+  out.append_u16(0xffff);   // Hash stream index.
+  out.append_u16(0xffff);   // Auxiliary hash stream index.
+  out.append_u32(4);        // Hash key size.
+  out.append_u32(0x3ffff);  // Hash bucket count.
+  for (U32 i = 0; i < 6; ++i) {
+    out.append_u32(0);  // Hash buffer offsets and sizes.
+  }
+  CSS_ASSERT(out.size() == header_size);
+  out.append_bytes(type_records);
+  return std::move(out).data();
+}
+
+struct Synthetic_DBI_Module {
+  U16 symbol_stream_index;
+  U32 symbols_size;
+  U32 c13_lines_size;
+  U32 code_offset;
+  U32 code_size;
+};
+
+struct Synthetic_Procedure_Reference {
+  std::string name;
+  U16 module_index;
+  // Offset of the S_GPROC32_ID record in the module's symbol stream.
+  U32 symbol_offset;
+};
+
+// Adds a reference for every S_GPROC32_ID in the module's symbol stream.
+void find_synthetic_procedures(
+    std::span<const U8> symbols, U16 module_index,
+    std::vector<Synthetic_Procedure_Reference>& out) {
+  auto u16 = [&](U64 offset) -> U16 {
+    return narrow_cast<U16>(symbols[offset] | (symbols[offset + 1] << 8));
+  };
+  U64 offset = 4;  // Skip CV_SIGNATURE_C13.
+  while (offset < symbols.size()) {
+    U16 record_size = u16(offset + 0);
+    if (u16(offset + 2) == S_GPROC32_ID) {
+      const char* name = reinterpret_cast<const char*>(&symbols[offset + 39]);
+      out.push_back(Synthetic_Procedure_Reference{
+          .name = name,
+          .module_index = module_index,
+          .symbol_offset = narrow_cast<U32>(offset),
+      });
+    }
+    offset += U64{record_size} + 2;
+  }
+}
+
+// Hashes a symbol name for the global symbol hash table. Also known as
+// hashStringV1.
+U32 pdb_hash_string_v1(std::string_view s) {
+  U32 result = 0;
+  U64 i = 0;
+  for (; i + 4 <= s.size(); i += 4) {
+    result ^= U32{U8(s[i + 0])} | (U32{U8(s[i + 1])} << 8) |
+              (U32{U8(s[i + 2])} << 16) | (U32{U8(s[i + 3])} << 24);
+  }
+  if (i + 2 <= s.size()) {
+    result ^= U32{U8(s[i + 0])} | (U32{U8(s[i + 1])} << 8);
+    i += 2;
+  }
+  if (i < s.size()) {
+    result ^= U32{U8(s[i])};
+  }
+  result |= 0x20202020;
+  result ^= result >> 11;
+  return result ^ (result >> 16);
+}
+
+// Returns a symbol record stream containing one S_PROCREF per procedure.
+// Writes the offset of each S_PROCREF record into out_record_offsets.
+std::vector<U8> make_synthetic_symbol_record_stream(
+    std::span<const Synthetic_Procedure_Reference> procedures,
+    std::vector<U32>& out_record_offsets) {
+  Byte_Buffer out;
+  for (const Synthetic_Procedure_Reference& procedure : procedures) {
+    out_record_offsets.push_back(narrow_cast<U32>(out.size()));
+    U64 procref = begin_codeview_record(out, S_PROCREF);
+    out.append_u32(0);  // Checksum of name.
+    out.append_u32(procedure.symbol_offset);
+    out.append_u16(narrow_cast<U16>(procedure.module_index + 1));
+    out.append_c_string(procedure.name.c_str());
+    end_codeview_record(out, procref);
+  }
+  return std::move(out).data();
+}
+
+// Returns a global symbol hash stream (GSI) referencing the given records in
+// the symbol record stream.
+std::vector<U8> make_synthetic_global_symbol_stream(
+    std::span<const Synthetic_Procedure_Reference> procedures,
+    std::span<const U32> record_offsets) {
+  constexpr U32 bucket_count = 4096;
+  struct Hash_Record {
+    U32 bucket;
+    U32 record_offset;
+  };
+  std::vector<Hash_Record> hash_records;
+  for (U64 i = 0; i < procedures.size(); ++i) {
+    hash_records.push_back(Hash_Record{
+        .bucket = pdb_hash_string_v1(procedures[i].name) % bucket_count,
+        .record_offset = record_offsets[i],
+    });
+  }
+  std::stable_sort(hash_records.begin(), hash_records.end(),
+                   [](const Hash_Record& a, const Hash_Record& b) -> bool {
+                     return a.bucket < b.bucket;
+                   });
+
+  // The bitmap has one bit per bucket, plus one unused bit, rounded up to 32
+  // bits. Each non-empty bucket has an entry after the bitmap.
+  std::vector<U32> bitmap((bucket_count + 32) / 32, 0);
+  std::vector<U32> bucket_offsets;
+  for (U64 i = 0; i < hash_records.size(); ++i) {
+    U32 bucket = hash_records[i].bucket;
+    if (i == 0 || hash_records[i - 1].bucket != bucket) {
+      bitmap[bucket / 32] |= U32{1} << (bucket % 32);
+      // NOTE(strager): Offsets are in units of the 12-byte in-memory hash
+      // record, not the 8-byte on-disk hash record.
+      bucket_offsets.push_back(narrow_cast<U32>(i * 12));
+    }
+  }
+
+  Byte_Buffer out;
+  out.append_u32(0xffffffff);             // Signature.
+  out.append_u32(0xeffe0000 + 19990810);  // Version.
+  out.append_u32(narrow_cast<U32>(hash_records.size() * 8));
+  out.append_u32(narrow_cast<U32>((bitmap.size() + bucket_offsets.size()) * 4));
+  for (const Hash_Record& hash_record : hash_records) {
+    out.append_u32(hash_record.record_offset + 1);
+    out.append_u32(1);  // Reference count.
+  }
+  for (U32 word : bitmap) {
+    out.append_u32(word);
+  }
+  for (U32 bucket_offset : bucket_offsets) {
+    out.append_u32(bucket_offset);
+  }
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_dbi_stream(
+    std::span<const Synthetic_DBI_Module> modules,
+    U16 global_symbol_stream_index, U16 symbol_record_stream_index) {
+  Byte_Buffer module_infos;
+  std::string name;
+  for (U64 module_index = 0; module_index < modules.size(); ++module_index) {
+    const Synthetic_DBI_Module& module = modules[module_index];
+    module_infos.pad_to_alignment(4);
+    module_infos.append_u32(0);  // Unused.
+    // Section contribution:
+    module_infos.append_u16(1);  // Section.
+    module_infos.append_u16(0);  // Padding.
+    module_infos.append_u32(module.code_offset);
+    module_infos.append_u32(module.code_size);
+    module_infos.append_u32(0x60000020);  // Characteristics.
+    module_infos.append_u16(narrow_cast<U16>(module_index));
+    module_infos.append_u16(0);  // Padding.
+    module_infos.append_u32(0);  // Data CRC.
+    module_infos.append_u32(0);  // Relocations CRC.
+
+    module_infos.append_u16(0);  // Flags.
+    module_infos.append_u16(module.symbol_stream_index);
+    module_infos.append_u32(module.symbols_size);
+    module_infos.append_u32(0);  // C11 lines size.
+    module_infos.append_u32(module.c13_lines_size);
+    module_infos.append_u16(1);  // File count.
+    module_infos.append_u16(0);  // Padding.
+    module_infos.append_u32(0);  // Unused.
+    module_infos.append_u32(0);  // Source file name index.
+    module_infos.append_u32(0);  // PDB file path index.
+    name = "C:\\synthetic\\module_" + std::to_string(module_index) + ".obj";
+    module_infos.append_c_string(name.c_str());
+    module_infos.append_c_string(name.c_str());
+  }
+  module_infos.pad_to_alignment(4);
+
+  Byte_Buffer section_contributions;
+  section_contributions.append_u32(0xeffe0000 + 19970605);  // Version (V60).
+  U32 code_end_offset = 0;
+  for (U64 module_index = 0; module_index < modules.size(); ++module_index) {
+    const Synthetic_DBI_Module& module = modules[module_index];
+    section_contributions.append_u16(1);  // Section.
+    section_contributions.append_u16(0);  // Padding.
+    section_contributions.append_u32(module.code_offset);
+    section_contributions.append_u32(module.code_size);
+    section_contributions.append_u32(0x60000020);  // Characteristics.
+    section_contributions.append_u16(narrow_cast<U16>(module_index));
+    section_contributions.append_u16(0);  // Padding.
+    section_contributions.append_u32(0);  // Data CRC.
+    section_contributions.append_u32(0);  // Relocations CRC.
+    code_end_offset =
+        std::max(code_end_offset, module.code_offset + module.code_size);
+  }
+
+  Byte_Buffer section_map;
+  section_map.append_u16(1);       // Entry count.
+  section_map.append_u16(1);       // Logical entry count.
+  section_map.append_u16(0x010d);  // Flags: read, execute, 32-bit, selector.
+  section_map.append_u16(0);       // Overlay.
+  section_map.append_u16(0);       // Group.
+  section_map.append_u16(1);       // Frame.
+  section_map.append_u16(0xffff);  // Section name.
+  section_map.append_u16(0xffff);  // Class name.
+  section_map.append_u32(0);       // Offset.
+  section_map.append_u32(code_end_offset);
+
+  // One source file per module.
+  Byte_Buffer source_info;
+  source_info.append_u16(narrow_cast<U16>(modules.size()));
+  source_info.append_u16(narrow_cast<U16>(modules.size()));
+  for (U64 module_index = 0; module_index < modules.size(); ++module_index) {
+    source_info.append_u16(narrow_cast<U16>(module_index));  // File index.
+  }
+  for (U64 module_index = 0; module_index < modules.size(); ++module_index) {
+    source_info.append_u16(1);  // File count.
+  }
+  Byte_Buffer source_file_names;
+  for (U64 module_index = 0; module_index < modules.size(); ++module_index) {
+    source_info.append_u32(narrow_cast<U32>(source_file_names.size()));
+    name = "C:\\synthetic\\module_" + std::to_string(module_index) + ".cpp";
+    source_file_names.append_c_string(name.c_str());
+  }
+  source_info.append_bytes(source_file_names.data());
+  source_info.pad_to_alignment(4);
+
+  Byte_Buffer out;
+  out.append_u32(0xffffffff);  // Signature.
+  out.append_u32(19990903);    // Version (V70).
+  out.append_u32(1);           // Age.
+  out.append_u16(global_symbol_stream_index);
+  out.append_u16(0);       // Build number.
+  out.append_u16(0xffff);  // Public symbol stream index.
+  out.append_u16(0);       // PDB DLL version.
+  out.append_u16(symbol_record_stream_index);
+  out.append_u16(0);           // PDB DLL rebuild.
+  out.append_u32(narrow_cast<U32>(module_infos.size()));
+  out.append_u32(narrow_cast<U32>(section_contributions.size()));
+  out.append_u32(narrow_cast<U32>(section_map.size()));
+  out.append_u32(narrow_cast<U32>(source_info.size()));
+  out.append_u32(0);       // Type server map size.
+  out.append_u32(0);       // MFC type server index.
+  out.append_u32(0);       // Optional debug header size.
+  out.append_u32(0);       // EC substream size.
+  out.append_u16(0);       // Flags.
+  out.append_u16(0x8664);  // Machine.
+  out.append_u32(0);       // Padding.
+  out.append_bytes(module_infos.data());
+  out.append_bytes(section_contributions.data());
+  out.append_bytes(section_map.data());
+  out.append_bytes(source_info.data());
+  return std::move(out).data();
+}
+}
+
+void Byte_Buffer::append_c_string(const char* s) {
+  this->append_bytes(
+      std::span<const U8>(reinterpret_cast<const U8*>(s), std::strlen(s) + 1));
+}
+
+void Byte_Buffer::pad_to_alignment(U64 alignment) {
+  this->data_.resize(align_up(this->data_.size(), alignment));
+}
+
+std::vector<U8> make_synthetic_msf(std::span<const std::vector<U8>> streams,
+                                   U32 block_size,
+                                   Synthetic_MSF_Block_Layout layout,
+                                   U32 seed) {
+  U64 next_block = 0;
+  auto allocate_block = [&]() -> U32 {
+    while (next_block == 0 ||
+           is_free_block_map_block(narrow_cast<U32>(next_block), block_size)) {
+      next_block += 1;
+    }
+    if (next_block > 0xffffffff) {
+      throw std::runtime_error("too many blocks for MSF file");
+    }
+    return narrow_cast<U32>(next_block++);
+  };
+  auto block_count_for_size = [&](U64 size) -> U64 {
+    return (size + block_size - 1) / block_size;
+  };
+
+  std::vector<std::vector<U32>> stream_blocks(streams.size());
+  switch (layout) {
+    case Synthetic_MSF_Block_Layout::sequential:
+    case Synthetic_MSF_Block_Layout::shuffled:
+      for (U64 i = 0; i < streams.size(); ++i) {
+        for (U64 j = 0; j < block_count_for_size(streams[i].size()); ++j) {
+          stream_blocks[i].push_back(allocate_block());
+        }
+      }
+      break;
+
+    case Synthetic_MSF_Block_Layout::interleaved: {
+      bool allocated_any = true;
+      for (U64 round = 0; allocated_any; ++round) {
+        allocated_any = false;
+        for (U64 i = 0; i < streams.size(); ++i) {
+          if (round < block_count_for_size(streams[i].size())) {
+            stream_blocks[i].push_back(allocate_block());
+            allocated_any = true;
+          }
+        }
+      }
+      break;
+    }
+  }
+  if (layout == Synthetic_MSF_Block_Layout::shuffled) {
+    std::vector<U32> all_blocks;
+    for (const std::vector<U32>& blocks : stream_blocks) {
+      all_blocks.insert(all_blocks.end(), blocks.begin(), blocks.end());
+    }
+    std::mt19937 rng(seed);
+    std::shuffle(all_blocks.begin(), all_blocks.end(), rng);
+    const U32* next = all_blocks.data();
+    for (std::vector<U32>& blocks : stream_blocks) {
+      for (U32& block : blocks) {
+        block = *next++;
+      }
+    }
+  }
+
+  Byte_Buffer directory;
+  directory.append_u32(narrow_cast<U32>(streams.size()));
+  for (const std::vector<U8>& stream : streams) {
+    directory.append_u32(narrow_cast<U32>(stream.size()));
+  }
+  for (const std::vector<U32>& blocks : stream_blocks) {
+    for (U32 block : blocks) {
+      directory.append_u32(block);
+    }
+  }
+  std::vector<U32> directory_blocks;
+  for (U64 i = 0; i < block_count_for_size(directory.size()); ++i) {
+    directory_blocks.push_back(allocate_block());
+  }
+  if (directory_blocks.size() * 4 > block_size) {
+    throw std::runtime_error(
+        "stream directory is too big; try increasing the block size");
+  }
+  U32 directory_map_block = allocate_block();
+  U32 block_count = narrow_cast<U32>(next_block);
+
+  Byte_Buffer out;
+  out.data().resize(U64{block_count} * block_size);
+  for (U64 i = 0; i < std::size(pdb_magic); ++i) {
+    out.set_u32(i * 4, pdb_magic[i]);
+  }
+  out.set_u32(0x20, block_size);
+  out.set_u32(0x24, 1);  // Free block map block.
+  out.set_u32(0x28, block_count);
+  out.set_u32(0x2c, narrow_cast<U32>(directory.size()));
+  out.set_u32(0x34, directory_map_block);
+  // The free block maps are left zeroed, marking every block as in use.
+
+  auto write_blocks = [&](std::span<const U8> data,
+                          std::span<const U32> blocks) {
+    for (U64 i = 0; i < blocks.size(); ++i) {
+      U64 offset = i * block_size;
+      std::span<const U8> chunk =
+          data.subspan(offset, std::min<U64>(block_size, data.size() - offset));
+      std::copy(chunk.begin(), chunk.end(),
+                out.data().begin() + U64{blocks[i]} * block_size);
+    }
+  };
+  for (U64 i = 0; i < streams.size(); ++i) {
+    write_blocks(streams[i], stream_blocks[i]);
+  }
+  write_blocks(directory.data(), directory_blocks);
+  for (U64 i = 0; i < directory_blocks.size(); ++i) {
+    out.set_u32(U64{directory_map_block} * block_size + i * 4,
+                directory_blocks[i]);
+  }
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_codeview_symbols(U64 function_count,
+                                                U64 locals_per_function,
+                                                U32 first_func_id_type_id,
+                                                U32 first_code_offset,
+                                                U32 function_code_size) {
+  Byte_Buffer out;
+  out.append_u32(CV_SIGNATURE_C13);
+  std::string name;
+  for (U64 function_index = 0; function_index < function_count;
+       ++function_index) {
+    U32 func_id_type_id =
+        narrow_cast<U32>(first_func_id_type_id + function_index);
+    U64 proc = begin_codeview_record(out, S_GPROC32_ID);
+    out.append_u32(0);                   // Parent.
+    out.append_u32(0);                   // End.
+    out.append_u32(0);                   // Next.
+    out.append_u32(function_code_size);  // Code size.
+    out.append_u32(0);                   // Debug start.
+    out.append_u32(function_code_size);  // Debug end.
+    out.append_u32(func_id_type_id);
+    out.append_u32(
+        narrow_cast<U32>(first_code_offset + function_index * function_code_size));
+    out.append_u16(1);  // Section.
+    out.append_u8(0);   // Flags.
+    name = "synthetic_function_" + std::to_string(func_id_type_id);
+    out.append_c_string(name.c_str());
+    end_codeview_record(out, proc);
+
+    U64 frameproc = begin_codeview_record(out, S_FRAMEPROC);
+    out.append_u32(narrow_cast<U32>(0x20 + locals_per_function * 8));
+    out.append_u32(0);  // Padding size.
+    out.append_u32(0);  // Padding offset.
+    out.append_u32(0);  // Callee-saved register size.
+    out.append_u32(0);  // Exception handler offset.
+    out.append_u16(0);  // Exception handler section.
+    out.append_u32(0);  // Flags.
+    end_codeview_record(out, frameproc);
+
+    for (U64 local_index = 0; local_index < locals_per_function;
+         ++local_index) {
+      U64 regrel = begin_codeview_record(out, S_REGREL32);
+      out.append_u32(narrow_cast<U32>(0x20 + local_index * 8));  // Offset.
+      out.append_u32(T_INT4);                                    // Type.
+      out.append_u16(335);                                       // RSP.
+      name = "local_" + std::to_string(local_index);
+      out.append_c_string(name.c_str());
+      end_codeview_record(out, regrel);
+    }
+
+    U64 end = begin_codeview_record(out, S_PROC_ID_END);
+    end_codeview_record(out, end);
+  }
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_codeview_types(U64 type_count) {
+  Byte_Buffer out;
+  std::string name;
+  for (U64 type_index = 0; type_index < type_count; ++type_index) {
+    switch (type_index % 3) {
+      case 0: {
+        U64 record = begin_codeview_record(out, LF_POINTER);
+        out.append_u32(T_INT4);                      // Pointee type.
+        out.append_u32(CV_PTR_64 | (U32{8} << 13));  // Attributes.
+        end_codeview_record(out, record);
+        break;
+      }
+
+      case 1: {
+        U64 record = begin_codeview_record(out, LF_STRUCTURE);
+        out.append_u16(0);   // Member count.
+        out.append_u16(0);   // Properties.
+        out.append_u32(0);   // Field list type.
+        out.append_u32(0);   // Derived type.
+        out.append_u32(0);   // VShape type.
+        out.append_u16(16);  // Size.
+        name = "Synthetic_Struct_" + std::to_string(type_index);
+        out.append_c_string(name.c_str());
+        end_codeview_record(out, record);
+        break;
+      }
+
+      case 2: {
+        U64 record = begin_codeview_record(out, LF_ARRAY);
+        out.append_u32(T_INT4);   // Element type.
+        out.append_u32(T_UQUAD);  // Index type.
+        out.append_u16(64);       // Size.
+        out.append_c_string("");
+        end_codeview_record(out, record);
+        break;
+      }
+    }
+  }
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_c13_lines(U64 function_count,
+                                         U32 first_code_offset,
+                                         U32 function_code_size,
+                                         U32 line_count) {
+  Byte_Buffer out;
+  for (U64 function_index = 0; function_index < function_count;
+       ++function_index) {
+    out.append_u32(DEBUG_S_LINES);
+    U64 subsection_size_offset = out.size();
+    out.append_u32(0);  // Subsection size. Filled in below.
+    U64 subsection_begin = out.size();
+
+    out.append_u32(narrow_cast<U32>(first_code_offset +
+                                    function_index * function_code_size));
+    out.append_u16(1);  // Section.
+    out.append_u16(0);  // Flags.
+    out.append_u32(function_code_size);
+
+    out.append_u32(0);  // File ID.
+    out.append_u32(line_count);
+    out.append_u32(12 + line_count * 8);
+    for (U32 line_index = 0; line_index < line_count; ++line_index) {
+      out.append_u32(line_index * (function_code_size / line_count));
+      out.append_u32(0x80000000 | (line_index + 1));
+    }
+
+    out.set_u32(subsection_size_offset,
+                narrow_cast<U32>(out.size() - subsection_begin));
+  }
+  return std::move(out).data();
+}
+
+std::vector<U8> make_synthetic_pdb(const Synthetic_PDB_Options& options) {
+  constexpr U32 function_code_size = 0x40;
+  constexpr U16 first_module_stream_index = 5;
+  // Two streams follow the module streams.
+  if (options.module_count > 0xffff - first_module_stream_index - 2) {
+    throw std::runtime_error("too many modules for PDB file");
+  }
+  if (options.lines_per_function == 0 ||
+      options.lines_per_function > function_code_size) {
+    throw std::runtime_error("unsupported number of lines per function");
+  }
+  U64 function_count = options.module_count * options.functions_per_module;
+  if (function_count * function_code_size > 0xffffffff) {
+    throw std::runtime_error("too many functions for PDB file");
+  }
+
+  std::vector<std::vector<U8>> streams;
+  streams.emplace_back();  // #0: Old stream directory.
+  streams.push_back(make_synthetic_pdb_info_stream(options.seed));
+
+  // #2: TPI.
+  constexpr U32 arg_list_type_id = 0x1000;
+  constexpr U32 procedure_type_id = 0x1001;
+  {
+    Byte_Buffer types;
+    U64 arg_list = begin_codeview_record(types, LF_ARGLIST);
+    types.append_u32(0);  // Argument count.
+    end_codeview_record(types, arg_list);
+
+    U64 procedure = begin_codeview_record(types, LF_PROCEDURE);
+    types.append_u32(T_VOID);          // Return type.
+    types.append_u8(CV_CALL_NEAR_C);   // Calling convention.
+    types.append_u8(0);                // Attributes.
+    types.append_u16(0);               // Parameter count.
+    types.append_u32(arg_list_type_id);
+    end_codeview_record(types, procedure);
+
+    types.append_bytes(make_synthetic_codeview_types(options.extra_type_count));
+    streams.push_back(make_synthetic_tpi_stream(
+        types.data(), narrow_cast<U32>(2 + options.extra_type_count)));
+  }
+
+  streams.emplace_back();  // #3: DBI. Filled in below.
+
+  // #4: IPI.
+  constexpr U32 first_func_id_type_id = 0x1000;
+  {
+    Byte_Buffer ids;
+    std::string name;
+    for (U64 i = 0; i < function_count; ++i) {
+      U64 func_id = begin_codeview_record(ids, LF_FUNC_ID);
+      ids.append_u32(0);  // Parent scope.
+      ids.append_u32(procedure_type_id);
+      name = "synthetic_function_" + std::to_string(first_func_id_type_id + i);
+      ids.append_c_string(name.c_str());
+      end_codeview_record(ids, func_id);
+    }
+    streams.push_back(make_synthetic_tpi_stream(
+        ids.data(), narrow_cast<U32>(function_count)));
+  }
+
+  // #5 and onward: modules.
+  std::vector<Synthetic_DBI_Module> modules;
+  std::vector<Synthetic_Procedure_Reference> procedures;
+  for (U64 module_index = 0; module_index < options.module_count;
+       ++module_index) {
+    U64 first_function_index = module_index * options.functions_per_module;
+    U32 first_code_offset =
+        narrow_cast<U32>(first_function_index * function_code_size);
+    std::vector<U8> symbols = make_synthetic_codeview_symbols(
+        options.functions_per_module, options.locals_per_function,
+        narrow_cast<U32>(first_func_id_type_id + first_function_index),
+        first_code_offset, function_code_size);
+    std::vector<U8> lines = make_synthetic_c13_lines(
+        options.functions_per_module, first_code_offset, function_code_size,
+        options.lines_per_function);
+    modules.push_back(Synthetic_DBI_Module{
+        .symbol_stream_index = narrow_cast<U16>(streams.size()),
+        .symbols_size = narrow_cast<U32>(symbols.size()),
+        .c13_lines_size = narrow_cast<U32>(lines.size()),
+        .code_offset = first_code_offset,
+        .code_size =
+            narrow_cast<U32>(options.functions_per_module * function_code_size),
+    });
+    find_synthetic_procedures(symbols, narrow_cast<U16>(module_index),
+                              procedures);
+    std::vector<U8>& module_stream = streams.emplace_back(std::move(symbols));
+    module_stream.insert(module_stream.end(), lines.begin(), lines.end());
+  }
+
+  std::vector<U32> procedure_record_offsets;
+  std::vector<U8> symbol_records =
+      make_synthetic_symbol_record_stream(procedures, procedure_record_offsets);
+  U16 global_symbol_stream_index = narrow_cast<U16>(streams.size());
+  streams.push_back(make_synthetic_global_symbol_stream(
+      procedures, procedure_record_offsets));
+  U16 symbol_record_stream_index = narrow_cast<U16>(streams.size());
+  streams.push_back(std::move(symbol_records));
+
+  streams[3] = make_synthetic_dbi_stream(modules, global_symbol_stream_index,
+                                         symbol_record_stream_index);
+
+  return make_synthetic_msf(streams, options.block_size, options.block_layout,
+                            options.seed);
+}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <span>
+#include <vector>
+
+// Writers for synthetic (generated) PDB files. These files are used to test
+// and benchmark the PDB and CodeView parsers at scale without needing
+// proprietary binaries.
+
+namespace cppstacksize {
+// Appends little-endian integers to a byte vector.
+class Byte_Buffer {
+ public:
+  void append_u8(U8 value) { this->data_.push_back(value); }
+
+  void append_u16(U16 value) {
+    this->append_u8(static_cast<U8>(value >> (0 * 8)));
+    this->append_u8(static_cast<U8>(value >> (1 * 8)));
+  }
+
+  void append_u32(U32 value) {
+    this->append_u16(static_cast<U16>(value >> (0 * 8)));
+    this->append_u16(static_cast<U16>(value >> (2 * 8)));
+  }
+
+  void append_bytes(std::span<const U8> bytes) {
+    this->data_.insert(this->data_.end(), bytes.begin(), bytes.end());
+  }
+
+  void append_c_string(const char* s);
+
+  void pad_to_alignment(U64 alignment);
+
+  void set_u16(U64 offset, U16 value) {
+    this->data_[offset + 0] = static_cast<U8>(value >> (0 * 8));
+    this->data_[offset + 1] = static_cast<U8>(value >> (1 * 8));
+  }
+
+  void set_u32(U64 offset, U32 value) {
+    this->set_u16(offset + 0, static_cast<U16>(value >> (0 * 8)));
+    this->set_u16(offset + 2, static_cast<U16>(value >> (2 * 8)));
+  }
+
+  U64 size() const { return this->data_.size(); }
+
+  std::vector<U8>& data() & { return this->data_; }
+  std::vector<U8> data() && { return std::move(this->data_); }
+
+ private:
+  std::vector<U8> data_;
+};
+
+// How make_synthetic_msf places stream blocks in the file.
+enum class Synthetic_MSF_Block_Layout : U8 {
+  // Each stream's blocks are contiguous and in order.
+  sequential,
+  // Streams take turns allocating one block each, so every multi-block stream
+  // is fragmented.
+  interleaved,
+  // Blocks are placed in a pseudo-random order.
+  shuffled,
+};
+
+// Returns an MSF (PDB) file containing the given streams.
+//
+// seed is only used for Synthetic_MSF_Block_Layout::shuffled.
+std::vector<U8> make_synthetic_msf(std::span<const std::vector<U8>> streams,
+                                   U32 block_size,
+                                   Synthetic_MSF_Block_Layout layout,
+                                   U32 seed = 0);
+
+// Returns a CodeView symbol stream (with CV_SIGNATURE_C13 header) containing
+// function_count S_GPROC32_ID records, each followed by an S_FRAMEPROC,
+// locals_per_function S_REGREL32 records, and an S_PROC_ID_END.
+//
+// Function i has ID type first_func_id_type_id+i and code offset
+// first_code_offset+i*function_code_size.
+std::vector<U8> make_synthetic_codeview_symbols(U64 function_count,
+                                                U64 locals_per_function,
+                                                U32 first_func_id_type_id,
+                                                U32 first_code_offset,
+                                                U32 function_code_size);
+
+// Returns CodeView type records (without a header) containing type_count
+// LF_POINTER, LF_STRUCTURE, and LF_ARRAY records in rotation.
+std::vector<U8> make_synthetic_codeview_types(U64 type_count);
+
+// Returns C13 line information with one DEBUG_S_LINES subsection per function.
+// Each function is function_code_size bytes long and has line_count lines.
+std::vector<U8> make_synthetic_c13_lines(U64 function_count,
+                                         U32 first_code_offset,
+                                         U32 function_code_size,
+                                         U32 line_count);
+
+struct Synthetic_PDB_Options {
+  U32 block_size = 4096;
+  Synthetic_MSF_Block_Layout block_layout =
+      Synthetic_MSF_Block_Layout::sequential;
+  U32 seed = 0;
+
+  U64 module_count = 1;
+  U64 functions_per_module = 1;
+  U64 locals_per_function = 0;
+  U32 lines_per_function = 1;
+  // Number of types in the TPI stream in addition to the types needed by the
+  // generated functions.
+  U64 extra_type_count = 0;
+};
+
+// Returns a PDB file with the following streams:
+//
+// * #1: PDB info stream
+// * #2: TPI stream. The first two types are an LF_ARGLIST and an LF_PROCEDURE
+//   (void(void)) shared by all functions, followed by extra_type_count other
+//   types.
+// * #3: DBI stream with module_count modules.
+// * #4: IPI stream. Contains one LF_FUNC_ID per function.
+// * #5 and onward: one symbol stream per module, each with
+//   functions_per_module functions and line tables.
+// * After the module streams: a global symbol hash stream (GSI) followed by a
+//   symbol record stream, with one S_PROCREF per function.
+std::vector<U8> make_synthetic_pdb(const Synthetic_PDB_Options&);
+}
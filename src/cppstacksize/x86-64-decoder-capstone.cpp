@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <capstone/capstone.h>
+#include <cppstacksize/base.h>
+#include <cppstacksize/register.h>
+#include <cppstacksize/x86-64-decoder.h>
+#include <cstddef>
+#include <initializer_list>
+#include <span>
+#include <type_traits>
+
+namespace cppstacksize {
+namespace {
+static_assert(std::is_same_v<::csh, std::size_t>);
+
+constexpr std::array<Register_Name, ::X86_REG_ENDING>
+make_capstone_x86_reg_to_register_name() {
+  std::array<Register_Name, ::X86_REG_ENDING> names;
+  for (Register_Name& name : names) {
+    name = Register_Name::max_register_name;
+  }
+
+  auto set = [&names](Register_Name name,
+                      std::initializer_list<::x86_reg> registers) {
+    for (::x86_reg r : registers) names[r] = name;
+  };
+  // clang-format off
+  set(Register_Name::rax, {::X86_REG_RAX, ::X86_REG_EAX,  ::X86_REG_AX,   ::X86_REG_AL, ::X86_REG_AH});
+  set(Register_Name::rbx, {::X86_REG_RBX, ::X86_REG_EBX,  ::X86_REG_BX,   ::X86_REG_BL, ::X86_REG_BH});
+  set(Register_Name::rcx, {::X86_REG_RCX, ::X86_REG_ECX,  ::X86_REG_CX,   ::X86_REG_CL, ::X86_REG_CH});
+  set(Register_Name::rdx, {::X86_REG_RDX, ::X86_REG_EDX,  ::X86_REG_DX,   ::X86_REG_DL, ::X86_REG_DH});
+  set(Register_Name::rsi, {::X86_REG_RSI, ::X86_REG_ESI,  ::X86_REG_SI,   ::X86_REG_SIL});
+  set(Register_Name::rdi, {::X86_REG_RDI, ::X86_REG_EDI,  ::X86_REG_DI,   ::X86_REG_DIL});
+  set(Register_Name::rbp, {::X86_REG_RBP, ::X86_REG_EBP,  ::X86_REG_BP,   ::X86_REG_BPL});
+  set(Register_Name::rsp, {::X86_REG_RSP, ::X86_REG_ESP,  ::X86_REG_SP,   ::X86_REG_SPL});
+  set(Register_Name::r8,  {::X86_REG_R8,  ::X86_REG_R8D,  ::X86_REG_R8W,  ::X86_REG_R8B});
+  set(Register_Name::r9,  {::X86_REG_R9,  ::X86_REG_R9D,  ::X86_REG_R9W,  ::X86_REG_R9B});
+  set(Register_Name::r10, {::X86_REG_R10, ::X86_REG_R10D, ::X86_REG_R10W, ::X86_REG_R10B});
+  set(Register_Name::r11, {::X86_REG_R11, ::X86_REG_R11D, ::X86_REG_R11W, ::X86_REG_R11B});
+  set(Register_Name::r12, {::X86_REG_R12, ::X86_REG_R12D, ::X86_REG_R12W, ::X86_REG_R12B});
+  set(Register_Name::r13, {::X86_REG_R13, ::X86_REG_R13D, ::X86_REG_R13W, ::X86_REG_R13B});
+  set(Register_Name::r14, {::X86_REG_R14, ::X86_REG_R14D, ::X86_REG_R14W, ::X86_REG_R14B});
+  set(Register_Name::r15, {::X86_REG_R15, ::X86_REG_R15D, ::X86_REG_R15W, ::X86_REG_R15B});
+  // clang-format on
+
+  return names;
+}
+
+constexpr std::array<Register_Name, ::X86_REG_ENDING>
+    capstone_x86_reg_to_register_name =
+        make_capstone_x86_reg_to_register_name();
+
+constexpr std::array<Register_Piece, ::X86_REG_ENDING>
+make_capstone_x86_reg_to_register_piece() {
+  std::array<Register_Piece, ::X86_REG_ENDING> pieces;
+  for (Register_Piece& piece : pieces) {
+    piece = Register_Piece::low_64;
+  }
+
+  for (::x86_reg r :
+       {::X86_REG_RAX, ::X86_REG_RBX, ::X86_REG_RCX, ::X86_REG_RDX,  //
+        ::X86_REG_RSI, ::X86_REG_RDI, ::X86_REG_RBP, ::X86_REG_RSP,  //
+        ::X86_REG_R8, ::X86_REG_R9, ::X86_REG_R10, ::X86_REG_R11,    //
+        ::X86_REG_R12, ::X86_REG_R13, ::X86_REG_R14, ::X86_REG_R15}) {
+    pieces[r] = Register_Piece::low_64;
+  }
+
+  for (::x86_reg r :
+       {::X86_REG_EAX, ::X86_REG_EBX, ::X86_REG_ECX, ::X86_REG_EDX,    //
+        ::X86_REG_ESI, ::X86_REG_EDI, ::X86_REG_EBP, ::X86_REG_ESP,    //
+        ::X86_REG_R8D, ::X86_REG_R9D, ::X86_REG_R10D, ::X86_REG_R11D,  //
+        ::X86_REG_R12D, ::X86_REG_R13D, ::X86_REG_R14D, ::X86_REG_R15D}) {
+    pieces[r] = Register_Piece::low_32;
+  }
+
+  for (::x86_reg r :
+       {::X86_REG_AX, ::X86_REG_BX, ::X86_REG_CX, ::X86_REG_DX,        //
+        ::X86_REG_SI, ::X86_REG_DI, ::X86_REG_BP, ::X86_REG_SP,        //
+        ::X86_REG_R8W, ::X86_REG_R9W, ::X86_REG_R10W, ::X86_REG_R11W,  //
+        ::X86_REG_R12W, ::X86_REG_R13W, ::X86_REG_R14W, ::X86_REG_R15W}) {
+    pieces[r] = Register_Piece::low_16;
+  }
+
+  for (::x86_reg r :
+       {::X86_REG_AL, ::X86_REG_BL, ::X86_REG_CL, ::X86_REG_DL,        //
+        ::X86_REG_SIL, ::X86_REG_DIL, ::X86_REG_BPL, ::X86_REG_SPL,    //
+        ::X86_REG_R8B, ::X86_REG_R9B, ::X86_REG_R10B, ::X86_REG_R11B,  //
+        ::X86_REG_R12B, ::X86_REG_R13B, ::X86_REG_R14B, ::X86_REG_R15B}) {
+    pieces[r] = Register_Piece::low_8;
+  }
+
+  for (::x86_reg r : {::X86_REG_AH, ::X86_REG_BH, ::X86_REG_CH, ::X86_REG_DH}) {
+    pieces[r] = Register_Piece::low_16_high_8;
+  }
+
+  return pieces;
+}
+
+constexpr std::array<Register_Piece, ::X86_REG_ENDING>
+    capstone_x86_reg_to_register_piece =
+        make_capstone_x86_reg_to_register_piece();
+
+X86_64_Register register_from_capstone(/*::x86_reg*/ unsigned reg) {
+  return X86_64_Register{
+      .name = capstone_x86_reg_to_register_name[reg],
+      .piece = capstone_x86_reg_to_register_piece[reg],
+  };
+}
+
+X86_64_Mnemonic mnemonic_from_capstone(/*::x86_insn*/ unsigned id) {
+  switch (id) {
+    case ::X86_INS_ADD:
+      return X86_64_Mnemonic::add;
+    case ::X86_INS_AND:
+      return X86_64_Mnemonic::and_;
+    case ::X86_INS_CALL:
+      return X86_64_Mnemonic::call;
+    case ::X86_INS_LEA:
+      return X86_64_Mnemonic::lea;
+    case ::X86_INS_MOV:
+    case ::X86_INS_MOVABS:
+      return X86_64_Mnemonic::mov;
+    case ::X86_INS_MOVSB:
+    case ::X86_INS_MOVSD:
+    case ::X86_INS_MOVSQ:
+    case ::X86_INS_MOVSW:
+      return X86_64_Mnemonic::movs;
+    case ::X86_INS_MOVZX:
+      return X86_64_Mnemonic::movzx;
+    case ::X86_INS_NOP:
+      return X86_64_Mnemonic::nop;
+    case ::X86_INS_POP:
+      return X86_64_Mnemonic::pop;
+    case ::X86_INS_PUSH:
+      return X86_64_Mnemonic::push;
+    case ::X86_INS_RET:
+      return X86_64_Mnemonic::ret;
+    case ::X86_INS_STOSB:
+    case ::X86_INS_STOSD:
+    case ::X86_INS_STOSQ:
+    case ::X86_INS_STOSW:
+      return X86_64_Mnemonic::stos;
+    case ::X86_INS_SUB:
+      return X86_64_Mnemonic::sub;
+    default:
+      return X86_64_Mnemonic::other;
+  }
+}
+
+X86_64_Operand operand_from_capstone(const ::cs_x86_op& op) {
+  X86_64_Operand operand = {};
+  operand.byte_size = op.size;
+  operand.is_read = (op.access & ::CS_AC_READ) != 0;
+  operand.is_written = (op.access & ::CS_AC_WRITE) != 0;
+  switch (op.type) {
+    case ::X86_OP_REG:
+      operand.kind = X86_64_Operand_Kind::register_;
+      operand.reg = register_from_capstone(op.reg);
+      break;
+
+    case ::X86_OP_IMM:
+      operand.kind = X86_64_Operand_Kind::immediate;
+      operand.immediate = op.imm;
+      break;
+
+    case ::X86_OP_MEM:
+      operand.kind = X86_64_Operand_Kind::memory;
+      operand.memory = X86_64_Memory_Operand{
+          .base = register_from_capstone(op.mem.base),
+          .index = register_from_capstone(op.mem.index),
+          .scale = narrow_cast<U8>(op.mem.scale),
+          .displacement = op.mem.disp,
+      };
+      break;
+
+    case ::X86_OP_INVALID:
+      CSS_UNREACHABLE();
+      break;
+  }
+  return operand;
+}
+}
+
+X86_64_Decoder::~X86_64_Decoder() {
+  if (this->capstone_instruction_ != nullptr) {
+    ::cs_free(static_cast<::cs_insn*>(this->capstone_instruction_), 1);
+    ::cs_close(&this->capstone_handle_);
+  }
+}
+
+bool X86_64_Decoder::decode_with_capstone(std::span<const U8> code,
+                                          U64 address,
+                                          X86_64_Instruction& out) {
+  if (this->capstone_instruction_ == nullptr) {
+    if (this->capstone_failed_) {
+      return false;
+    }
+    if (::cs_open(::CS_ARCH_X86, ::CS_MODE_64, &this->capstone_handle_) !=
+        ::CS_ERR_OK) {
+      // TODO(strager): Log an error.
+      this->capstone_failed_ = true;
+      return false;
+    }
+    ::cs_option(this->capstone_handle_, ::CS_OPT_DETAIL, ::CS_OPT_ON);
+    this->capstone_instruction_ = ::cs_malloc(this->capstone_handle_);
+  }
+
+  ::cs_insn* capstone_instruction =
+      static_cast<::cs_insn*>(this->capstone_instruction_);
+  const U8* code_data = code.data();
+  std::size_t code_size = code.size();
+  U64 capstone_address = address;
+  if (!::cs_disasm_iter(this->capstone_handle_, &code_data, &code_size,
+                        &capstone_address, capstone_instruction)) {
+    return false;
+  }
+
+  const ::cs_x86& details = capstone_instruction->detail->x86;
+  out.mnemonic = mnemonic_from_capstone(capstone_instruction->id);
+  out.byte_size = narrow_cast<U8>(capstone_instruction->size);
+  out.has_rep_prefix = details.prefix[0] == ::X86_PREFIX_REP;
+  out.operand_count =
+      std::min(details.op_count, X86_64_Instruction::max_operand_count);
+  for (U8 i = 0; i < out.operand_count; ++i) {
+    out.operands[i] = operand_from_capstone(details.operands[i]);
+  }
+  return true;
+}
+}
@@ -0,0 +1,990 @@
+#include <algorithm>
+#include <array>
+#include <cppstacksize/base.h>
+#include <cppstacksize/register.h>
+#include <cppstacksize/x86-64-decoder.h>
+#include <initializer_list>
+#include <span>
+#include <utility>
+
+namespace cppstacksize {
+namespace {
+constexpr U64 max_instruction_byte_size = 15;
+
+constexpr U8 rex_b = 0x01;
+constexpr U8 rex_x = 0x02;
+constexpr U8 rex_r = 0x04;
+constexpr U8 rex_w = 0x08;
+
+// How an opcode's operands are encoded.
+enum class Operand_Form : U8 {
+  // The fast decoder does not support the opcode.
+  unsupported,
+
+  // No explicit operands. Example: ret
+  none,
+  // ModRM r/m, then ModRM reg. Example: mov %rax, 0x20(%rsp)
+  rm_reg,
+  // ModRM reg, then ModRM r/m. Example: mov 0x20(%rsp), %rax
+  reg_rm,
+  // Like reg_rm, but r/m must be memory. Example: lea 0x20(%rsp), %rax
+  reg_mem,
+  // ModRM r/m. Example: push (%rdi)
+  rm,
+  // ModRM r/m, then an immediate of the operand size (at most 32 bits,
+  // sign-extended). Example: movl $69, 0x20(%rsp)
+  rm_imm,
+  // ModRM r/m, then a sign-extended 8-bit immediate. Example: sub $0x28, %rsp
+  rm_imm8,
+  // %al/%ax/%eax/%rax, then an immediate of the operand size (at most 32
+  // bits, sign-extended). Example: sub $0x1000, %rax
+  accumulator_imm,
+  // Register in the low 3 bits of the opcode. Example: push %rbx
+  opcode_reg,
+  // Register in the low 3 bits of the opcode, then an immediate of the
+  // operand size (up to 64 bits). Example: mov $0x50, %eax
+  opcode_reg_imm,
+  // 16-bit immediate. Example: ret $8
+  imm16,
+  // Signed 8-bit displacement from the next instruction. Example: jne
+  rel8,
+  // Signed 32-bit displacement from the next instruction. Example: call
+  rel32,
+  // Implicit operands (%rdi, %rsi, and %rax). Example: rep stos
+  string,
+};
+
+constexpr bool form_has_modrm(Operand_Form form) {
+  switch (form) {
+    case Operand_Form::rm_reg:
+    case Operand_Form::reg_rm:
+    case Operand_Form::reg_mem:
+    case Operand_Form::rm:
+    case Operand_Form::rm_imm:
+    case Operand_Form::rm_imm8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// How the first operand is accessed. Other operands are only read.
+enum class Access : U8 {
+  read,
+  write,
+  read_write,
+};
+
+enum Opcode_Group : U8 {
+  group_1_byte,   // 0x80: add $imm8, %al
+  group_1,        // 0x81: add $imm32, %eax
+  group_1_imm8,   // 0x83: add $imm8, %eax
+  group_3_byte,   // 0xf6: testb $imm8, (%rax)
+  group_3,        // 0xf7: testl $imm32, (%rax)
+  group_5,        // 0xff: call *%rax
+  group_11_byte,  // 0xc6: movb $imm8, (%rax)
+  group_11,       // 0xc7: movl $imm32, (%rax)
+
+  group_count,
+  no_group = group_count,
+};
+
+struct Opcode_Info {
+  X86_64_Mnemonic mnemonic = X86_64_Mnemonic::other;
+  Operand_Form form = Operand_Form::unsupported;
+  Access access = Access::read;
+  // If true, operands are 8 bits regardless of prefixes.
+  bool byte_operands = false;
+  // If true, the operand size is 64 bits unless there is a 0x66 prefix.
+  bool default_64 = false;
+  // If not 0, the size of the r/m operand, regardless of prefixes. Example:
+  // movzbl (%rax), %eax has a 1-byte r/m operand.
+  U8 rm_byte_size = 0;
+  // If not no_group, ModRM.reg selects an entry in opcode_groups[group].
+  Opcode_Group group = no_group;
+};
+
+constexpr std::array<Opcode_Info, 256> make_one_byte_opcodes() {
+  using enum X86_64_Mnemonic;
+  std::array<Opcode_Info, 256> opcodes;
+
+  // add, or, adc, sbb, and, sub, xor, cmp
+  constexpr X86_64_Mnemonic alu_mnemonics[8] = {add,  other, other, other,
+                                                and_, sub,   other, other};
+  for (U8 alu = 0; alu < 8; ++alu) {
+    U8 base = alu * 8;
+    X86_64_Mnemonic mnemonic = alu_mnemonics[alu];
+    Access access = alu == 7 ? Access::read : Access::read_write;
+    opcodes[base + 0] = {mnemonic, Operand_Form::rm_reg, access, true};
+    opcodes[base + 1] = {mnemonic, Operand_Form::rm_reg, access};
+    opcodes[base + 2] = {mnemonic, Operand_Form::reg_rm, access, true};
+    opcodes[base + 3] = {mnemonic, Operand_Form::reg_rm, access};
+    opcodes[base + 4] = {mnemonic, Operand_Form::accumulator_imm, access,
+                         true};
+    opcodes[base + 5] = {mnemonic, Operand_Form::accumulator_imm, access};
+  }
+
+  for (U8 i = 0; i < 8; ++i) {
+    opcodes[0x50 + i] = {.mnemonic = push,
+                         .form = Operand_Form::opcode_reg,
+                         .access = Access::read,
+                         .default_64 = true};
+    opcodes[0x58 + i] = {.mnemonic = pop,
+                         .form = Operand_Form::opcode_reg,
+                         .access = Access::write,
+                         .default_64 = true};
+    opcodes[0xb0 + i] = {mov, Operand_Form::opcode_reg_imm, Access::write,
+                         true};
+    opcodes[0xb8 + i] = {mov, Operand_Form::opcode_reg_imm, Access::write};
+  }
+
+  // movsxd
+  opcodes[0x63] = {.form = Operand_Form::reg_rm,
+                   .access = Access::write,
+                   .rm_byte_size = 4};
+
+  for (U8 i = 0; i < 16; ++i) {
+    opcodes[0x70 + i] = {other, Operand_Form::rel8};  // jcc
+  }
+
+  opcodes[0x80] = {.group = group_1_byte};
+  opcodes[0x81] = {.group = group_1};
+  opcodes[0x83] = {.group = group_1_imm8};
+  // test
+  opcodes[0x84] = {other, Operand_Form::rm_reg, Access::read, true};
+  opcodes[0x85] = {other, Operand_Form::rm_reg, Access::read};
+  opcodes[0x88] = {mov, Operand_Form::rm_reg, Access::write, true};
+  opcodes[0x89] = {mov, Operand_Form::rm_reg, Access::write};
+  opcodes[0x8a] = {mov, Operand_Form::reg_rm, Access::write, true};
+  opcodes[0x8b] = {mov, Operand_Form::reg_rm, Access::write};
+  opcodes[0x8d] = {lea, Operand_Form::reg_mem, Access::write};
+  opcodes[0x90] = {nop, Operand_Form::none};
+  opcodes[0x98] = {other, Operand_Form::none};  // cbw, cwde, cdqe
+  opcodes[0x99] = {other, Operand_Form::none};  // cwd, cdq, cqo
+  opcodes[0xa4] = {movs, Operand_Form::string, Access::write, true};
+  opcodes[0xa5] = {movs, Operand_Form::string, Access::write};
+  // test
+  opcodes[0xa8] = {other, Operand_Form::accumulator_imm, Access::read, true};
+  opcodes[0xa9] = {other, Operand_Form::accumulator_imm, Access::read};
+  opcodes[0xaa] = {stos, Operand_Form::string, Access::write, true};
+  opcodes[0xab] = {stos, Operand_Form::string, Access::write};
+  opcodes[0xc2] = {ret, Operand_Form::imm16};
+  opcodes[0xc3] = {ret, Operand_Form::none};
+  opcodes[0xc6] = {.group = group_11_byte};
+  opcodes[0xc7] = {.group = group_11};
+  opcodes[0xc9] = {other, Operand_Form::none};  // leave
+  opcodes[0xcc] = {other, Operand_Form::none};  // int3
+  opcodes[0xe8] = {call, Operand_Form::rel32};
+  opcodes[0xe9] = {other, Operand_Form::rel32};  // jmp
+  opcodes[0xeb] = {other, Operand_Form::rel8};   // jmp
+  opcodes[0xf6] = {.group = group_3_byte};
+  opcodes[0xf7] = {.group = group_3};
+  opcodes[0xff] = {.group = group_5};
+  return opcodes;
+}
+
+// Opcodes after a 0x0f byte.
+constexpr std::array<Opcode_Info, 256> make_two_byte_opcodes() {
+  using enum X86_64_Mnemonic;
+  std::array<Opcode_Info, 256> opcodes;
+  opcodes[0x0b] = {other, Operand_Form::none};              // ud2
+  opcodes[0x1f] = {nop, Operand_Form::rm, Access::read};
+  // imul
+  opcodes[0xaf] = {other, Operand_Form::reg_rm, Access::read_write};
+  for (U8 i = 0; i < 16; ++i) {
+    // cmovcc
+    opcodes[0x40 + i] = {other, Operand_Form::reg_rm, Access::read_write};
+    // jcc
+    opcodes[0x80 + i] = {other, Operand_Form::rel32};
+    // setcc
+    opcodes[0x90 + i] = {other, Operand_Form::rm, Access::write, true};
+  }
+  // movzx, movsx
+  for (U8 opcode : {0xb6, 0xbe}) {
+    opcodes[opcode] = {.mnemonic = opcode == 0xb6 ? movzx : other,
+                       .form = Operand_Form::reg_rm,
+                       .access = Access::write,
+                       .rm_byte_size = 1};
+  }
+  for (U8 opcode : {0xb7, 0xbf}) {
+    opcodes[opcode] = {.mnemonic = opcode == 0xb7 ? movzx : other,
+                       .form = Operand_Form::reg_rm,
+                       .access = Access::write,
+                       .rm_byte_size = 2};
+  }
+  return opcodes;
+}
+
+constexpr std::array<std::array<Opcode_Info, 8>, group_count>
+make_opcode_groups() {
+  using enum X86_64_Mnemonic;
+  std::array<std::array<Opcode_Info, 8>, group_count> groups;
+
+  // add, or, adc, sbb, and, sub, xor, cmp
+  auto make_group_1 = [](Operand_Form form,
+                         bool byte_operands) -> std::array<Opcode_Info, 8> {
+    std::array<Opcode_Info, 8> group;
+    for (U8 i = 0; i < 8; ++i) {
+      group[i] = {other, form, i == 7 ? Access::read : Access::read_write,
+                  byte_operands};
+    }
+    group[0].mnemonic = add;
+    group[4].mnemonic = and_;
+    group[5].mnemonic = sub;
+    return group;
+  };
+  groups[group_1_byte] = make_group_1(Operand_Form::rm_imm, true);
+  groups[group_1] = make_group_1(Operand_Form::rm_imm, false);
+  groups[group_1_imm8] = make_group_1(Operand_Form::rm_imm8, false);
+
+  // test. (not, neg, mul, and div are unsupported.)
+  groups[group_3_byte][0] = {other, Operand_Form::rm_imm, Access::read, true};
+  groups[group_3][0] = {other, Operand_Form::rm_imm, Access::read};
+
+  groups[group_5][0] = {other, Operand_Form::rm, Access::read_write};  // inc
+  groups[group_5][1] = {other, Operand_Form::rm, Access::read_write};  // dec
+  groups[group_5][2] = {.mnemonic = call,
+                        .form = Operand_Form::rm,
+                        .access = Access::read,
+                        .default_64 = true};
+  groups[group_5][4] = {.mnemonic = other,  // jmp
+                        .form = Operand_Form::rm,
+                        .access = Access::read,
+                        .default_64 = true};
+  groups[group_5][6] = {.mnemonic = push,
+                        .form = Operand_Form::rm,
+                        .access = Access::read,
+                        .default_64 = true};
+
+  groups[group_11_byte][0] = {mov, Operand_Form::rm_imm, Access::write, true};
+  groups[group_11][0] = {mov, Operand_Form::rm_imm, Access::write};
+  return groups;
+}
+
+// How an SSE, AVX, or AVX-512 instruction's operands are encoded.
+enum class Vector_Form : U8 {
+  // The fast decoder does not support the opcode.
+  unsupported,
+
+  // ModRM reg, then ModRM r/m. Example: movups 0x20(%rsp), %xmm0
+  load,
+  // ModRM r/m, then ModRM reg. Example: movups %xmm0, 0x20(%rsp)
+  store,
+  // ModRM reg, then VEX.vvvv (VEX and EVEX only), then ModRM r/m. Example:
+  // vpxor 0x20(%rsp), %ymm1, %ymm0
+  arithmetic,
+};
+
+enum Vector_Encoding : U8 {
+  legacy_encoding = 1 << 0,  // SSE
+  vex_encoding = 1 << 1,     // AVX
+  evex_encoding = 1 << 2,    // AVX-512
+};
+constexpr U8 all_encodings = legacy_encoding | vex_encoding | evex_encoding;
+
+// The 0x66, 0xf3, or 0xf2 prefix which selects an SSE instruction. Numbered
+// like the pp field of VEX and EVEX prefixes.
+enum Mandatory_Prefix : U8 {
+  no_mandatory_prefix,
+  mandatory_prefix_66,
+  mandatory_prefix_f3,
+  mandatory_prefix_f2,
+
+  mandatory_prefix_count,
+};
+
+struct Vector_Opcode_Info {
+  Vector_Form form = Vector_Form::unsupported;
+  // Bitwise or of Vector_Encoding-s.
+  U8 encodings = 0;
+  // If not 0, the instruction operates on one element of this size, and
+  // memory operands have this size regardless of the vector length. Example:
+  // movss
+  U8 scalar_byte_size = 0;
+};
+
+// Opcodes after a 0x0f byte (or in VEX or EVEX map 1), indexed by
+// Mandatory_Prefix then by opcode.
+constexpr std::array<std::array<Vector_Opcode_Info, 256>,
+                     mandatory_prefix_count>
+make_vector_opcodes() {
+  std::array<std::array<Vector_Opcode_Info, 256>, mandatory_prefix_count>
+      opcodes;
+  auto set = [&opcodes](Mandatory_Prefix prefix,
+                        std::initializer_list<U8> opcode_list,
+                        Vector_Form form, U8 scalar_byte_size = 0,
+                        U8 encodings = all_encodings) -> void {
+    for (U8 opcode : opcode_list) {
+      opcodes[prefix][opcode] = {form, encodings, scalar_byte_size};
+    }
+  };
+
+  for (Mandatory_Prefix prefix : {no_mandatory_prefix, mandatory_prefix_66}) {
+    // movups, movaps (or movupd, movapd)
+    set(prefix, {0x10, 0x28}, Vector_Form::load);
+    // movups, movaps, movntps (or movupd, movapd, movntpd)
+    set(prefix, {0x11, 0x29, 0x2b}, Vector_Form::store);
+    // andps, andnps, orps, xorps, addps, mulps, subps, minps, divps, maxps (or
+    // *pd)
+    set(prefix, {0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5c, 0x5d, 0x5e, 0x5f},
+        Vector_Form::arithmetic);
+  }
+  for (auto [prefix, scalar_byte_size] :
+       {std::pair{mandatory_prefix_f3, U8(4)},
+        std::pair{mandatory_prefix_f2, U8(8)}}) {
+    // movss (or movsd)
+    set(prefix, {0x10}, Vector_Form::load, scalar_byte_size);
+    set(prefix, {0x11}, Vector_Form::store, scalar_byte_size);
+    // addss, mulss, subss, minss, divss, maxss (or *sd)
+    set(prefix, {0x58, 0x59, 0x5c, 0x5d, 0x5e, 0x5f}, Vector_Form::arithmetic,
+        scalar_byte_size);
+  }
+
+  // movdqa, movdqu
+  set(mandatory_prefix_66, {0x6f}, Vector_Form::load);
+  set(mandatory_prefix_f3, {0x6f}, Vector_Form::load);
+  // movdqa, movntdq, movdqu
+  set(mandatory_prefix_66, {0x7f, 0xe7}, Vector_Form::store);
+  set(mandatory_prefix_f3, {0x7f}, Vector_Form::store);
+  // vmovdqu8, vmovdqu16
+  set(mandatory_prefix_f2, {0x6f}, Vector_Form::load, 0, evex_encoding);
+  set(mandatory_prefix_f2, {0x7f}, Vector_Form::store, 0, evex_encoding);
+  // movq
+  set(mandatory_prefix_f3, {0x7e}, Vector_Form::load, 8);
+  set(mandatory_prefix_66, {0xd6}, Vector_Form::store, 8);
+  // paddq, pand, pandn, por, psubd, psubq, pxor, paddd
+  set(mandatory_prefix_66, {0xd4, 0xdb, 0xdf, 0xeb, 0xef, 0xfa, 0xfb, 0xfe},
+      Vector_Form::arithmetic);
+  return opcodes;
+}
+
+constexpr std::array<Opcode_Info, 256> one_byte_opcodes =
+    make_one_byte_opcodes();
+constexpr std::array<Opcode_Info, 256> two_byte_opcodes =
+    make_two_byte_opcodes();
+constexpr std::array<std::array<Opcode_Info, 8>, group_count> opcode_groups =
+    make_opcode_groups();
+constexpr std::array<std::array<Vector_Opcode_Info, 256>,
+                     mandatory_prefix_count>
+    vector_opcodes = make_vector_opcodes();
+
+// Register numbers as encoded in ModRM, SIB, and opcodes.
+constexpr Register_Name encoded_register_names[16] = {
+    Register_Name::rax, Register_Name::rcx, Register_Name::rdx,
+    Register_Name::rbx, Register_Name::rsp, Register_Name::rbp,
+    Register_Name::rsi, Register_Name::rdi, Register_Name::r8,
+    Register_Name::r9,  Register_Name::r10, Register_Name::r11,
+    Register_Name::r12, Register_Name::r13, Register_Name::r14,
+    Register_Name::r15,
+};
+
+X86_64_Register general_register(U8 number, U8 byte_size, bool has_rex) {
+  switch (byte_size) {
+    case 8:
+      return X86_64_Register{encoded_register_names[number],
+                             Register_Piece::low_64};
+    case 4:
+      return X86_64_Register{encoded_register_names[number],
+                             Register_Piece::low_32};
+    case 2:
+      return X86_64_Register{encoded_register_names[number],
+                             Register_Piece::low_16};
+    case 1:
+      // NOTE(strager): Without a REX prefix, 4 through 7 mean %ah, %ch, %dh,
+      // and %bh instead of %spl, %bpl, %sil, and %dil.
+      if (!has_rex && number >= 4 && number < 8) {
+        return X86_64_Register{encoded_register_names[number - 4],
+                               Register_Piece::low_16_high_8};
+      }
+      return X86_64_Register{encoded_register_names[number],
+                             Register_Piece::low_8};
+  }
+  CSS_UNREACHABLE();
+  return X86_64_Register::untracked();
+}
+
+// Truncates a sign-extended immediate to the operand size.
+S64 truncate_immediate(S64 value, U8 byte_size) {
+  if (byte_size >= 8) {
+    return value;
+  }
+  return static_cast<S64>(static_cast<U64>(value) &
+                          ((U64(1) << (byte_size * 8)) - 1));
+}
+
+class Byte_Cursor {
+ public:
+  explicit Byte_Cursor(std::span<const U8> code)
+      : code_(code.first(std::min(U64{code.size()},
+                                  max_instruction_byte_size))) {}
+
+  U64 offset() const { return this->offset_; }
+
+  bool has(U64 byte_count) const {
+    return this->code_.size() - this->offset_ >= byte_count;
+  }
+
+  // Precondition: this->has(1)
+  U8 peek() const { return this->code_[this->offset_]; }
+
+  // Precondition: this->has(1)
+  U8 next_u8() { return this->code_[this->offset_++]; }
+
+  // Precondition: this->has(byte_count)
+  U64 next_unsigned(U8 byte_count) {
+    U64 result = 0;
+    for (U8 i = 0; i < byte_count; ++i) {
+      result |= U64{this->code_[this->offset_ + i]} << (i * 8);
+    }
+    this->offset_ += byte_count;
+    return result;
+  }
+
+  // Precondition: this->has(byte_count)
+  S64 next_signed(U8 byte_count) {
+    U64 result = this->next_unsigned(byte_count);
+    if (byte_count < 8) {
+      U64 sign_bit = U64(1) << (byte_count * 8 - 1);
+      result = (result ^ sign_bit) - sign_bit;
+    }
+    return static_cast<S64>(result);
+  }
+
+ private:
+  std::span<const U8> code_;
+  U64 offset_ = 0;
+};
+
+// NOTE(strager): The set_*_operand functions write operands in place
+// instead of returning them. Copying freshly-written X86_64_Operand-s (and
+// X86_64_Instruction-s) measurably slows down decoding.
+
+void set_access(X86_64_Operand& operand, Access access) {
+  operand.is_read = access != Access::write;
+  operand.is_written = access != Access::read;
+}
+
+void set_register_operand(X86_64_Operand& operand, X86_64_Register reg,
+                          U8 byte_size, Access access) {
+  operand.kind = X86_64_Operand_Kind::register_;
+  operand.byte_size = byte_size;
+  set_access(operand, access);
+  operand.reg = reg;
+}
+
+void set_immediate_operand(X86_64_Operand& operand, S64 immediate,
+                           U8 byte_size) {
+  operand.kind = X86_64_Operand_Kind::immediate;
+  operand.byte_size = byte_size;
+  set_access(operand, Access::read);
+  operand.immediate = immediate;
+}
+
+void set_memory_operand(X86_64_Operand& operand, X86_64_Register base,
+                        U8 byte_size, Access access) {
+  operand.kind = X86_64_Operand_Kind::memory;
+  operand.byte_size = byte_size;
+  set_access(operand, access);
+  operand.memory.base = base;
+  operand.memory.index = X86_64_Register::untracked();
+  operand.memory.scale = 1;
+  operand.memory.displacement = 0;
+}
+
+// Decodes the r/m operand of a ModRM byte, reading the SIB byte and the
+// displacement (if any) from cursor.
+//
+// 8-bit displacements are multiplied by displacement_8_scale. (EVEX
+// instructions compress displacements this way.)
+//
+// Returns false if the code is truncated.
+bool decode_rm_operand(Byte_Cursor& cursor, U8 modrm, U8 rex, U8 byte_size,
+                       Access access, X86_64_Operand& operand,
+                       U8 displacement_8_scale = 1) {
+  U8 mod = modrm >> 6;
+  U8 rm = modrm & 7;
+  U8 rex_b_bit = (rex & rex_b) ? 8 : 0;
+  if (mod == 3) {
+    set_register_operand(operand,
+                         general_register(rm | rex_b_bit, byte_size, rex != 0),
+                         byte_size, access);
+    return true;
+  }
+
+  set_memory_operand(operand, X86_64_Register::untracked(), byte_size, access);
+  U8 displacement_size = mod == 1 ? 1 : mod == 2 ? 4 : 0;
+  if (rm == 4) {
+    if (!cursor.has(1)) return false;
+    U8 sib = cursor.next_u8();
+    U8 index = ((sib >> 3) & 7) | ((rex & rex_x) ? 8 : 0);
+    if (index != 4) {
+      operand.memory.index =
+          X86_64_Register::full(encoded_register_names[index]);
+    }
+    operand.memory.scale = U8(1) << (sib >> 6);
+    U8 base = sib & 7;
+    if (base == 5 && mod == 0) {
+      // No base register.
+      displacement_size = 4;
+    } else {
+      operand.memory.base =
+          X86_64_Register::full(encoded_register_names[base | rex_b_bit]);
+    }
+  } else if (rm == 5 && mod == 0) {
+    // %rip-relative.
+    displacement_size = 4;
+  } else {
+    operand.memory.base =
+        X86_64_Register::full(encoded_register_names[rm | rex_b_bit]);
+  }
+
+  if (displacement_size != 0) {
+    if (!cursor.has(displacement_size)) return false;
+    operand.memory.displacement = cursor.next_signed(displacement_size);
+    if (displacement_size == 1) {
+      operand.memory.displacement *= displacement_8_scale;
+    }
+  }
+  return true;
+}
+
+// Information from the prefixes of an SSE, AVX, or AVX-512 instruction.
+struct Vector_Prefix {
+  Vector_Encoding encoding;
+  Mandatory_Prefix mandatory_prefix;
+  // REX prefix, or REX bits from a VEX or EVEX prefix.
+  U8 rex;
+  // Size of a %xmm, %ymm, or %zmm register.
+  U8 vector_byte_size;
+  // If true, VEX.vvvv or EVEX.vvvv names a register.
+  bool has_vvvv;
+};
+
+// Decodes a VEX (0xc4 or 0xc5) or EVEX (0x62) prefix.
+//
+// Returns false if the code is truncated or if the prefix is not supported.
+bool decode_vector_prefix(Byte_Cursor& cursor, Vector_Prefix& out) {
+  U8 escape = cursor.next_u8();
+  U8 rex_bits = 0;
+  U8 map;
+  U8 inverted_vvvv;
+  U8 pp;
+  switch (escape) {
+    case 0xc5: {
+      if (!cursor.has(1)) return false;
+      U8 byte_1 = cursor.next_u8();
+      rex_bits = (byte_1 & 0x80) ? 0 : rex_r;
+      map = 1;
+      inverted_vvvv = (byte_1 >> 3) & 0xf;
+      out.vector_byte_size = (byte_1 & 0x04) ? 32 : 16;
+      pp = byte_1 & 3;
+      out.encoding = vex_encoding;
+      out.has_vvvv = inverted_vvvv != 0xf;
+      break;
+    }
+
+    case 0xc4: {
+      if (!cursor.has(2)) return false;
+      U8 byte_1 = cursor.next_u8();
+      U8 byte_2 = cursor.next_u8();
+      rex_bits = ((byte_1 & 0x80) ? 0 : rex_r) | ((byte_1 & 0x40) ? 0 : rex_x) |
+                 ((byte_1 & 0x20) ? 0 : rex_b) | ((byte_2 & 0x80) ? rex_w : 0);
+      map = byte_1 & 0x1f;
+      inverted_vvvv = (byte_2 >> 3) & 0xf;
+      out.vector_byte_size = (byte_2 & 0x04) ? 32 : 16;
+      pp = byte_2 & 3;
+      out.encoding = vex_encoding;
+      out.has_vvvv = inverted_vvvv != 0xf;
+      break;
+    }
+
+    case 0x62: {
+      if (!cursor.has(3)) return false;
+      U8 p0 = cursor.next_u8();
+      U8 p1 = cursor.next_u8();
+      U8 p2 = cursor.next_u8();
+      if ((p0 & 0x0c) != 0 || (p1 & 0x04) == 0) {
+        // Reserved bits. (Newer extensions such as APX use them.)
+        return false;
+      }
+      rex_bits = ((p0 & 0x80) ? 0 : rex_r) | ((p0 & 0x40) ? 0 : rex_x) |
+                 ((p0 & 0x20) ? 0 : rex_b) | ((p1 & 0x80) ? rex_w : 0);
+      map = p0 & 3;
+      inverted_vvvv = (p1 >> 3) & 0xf;
+      pp = p1 & 3;
+      bool has_broadcast_or_rounding = (p2 & 0x10) != 0;
+      if (has_broadcast_or_rounding) {
+        // NOTE(strager): Broadcasts change the size of memory operands and
+        // the scale of 8-bit displacements. Let the fallback decoder handle
+        // them.
+        return false;
+      }
+      U8 vector_length = (p2 >> 5) & 3;
+      if (vector_length == 3) return false;
+      out.vector_byte_size = U8(16) << vector_length;
+      out.encoding = evex_encoding;
+      bool inverted_v_prime = (p2 & 0x08) != 0;
+      out.has_vvvv = inverted_vvvv != 0xf || !inverted_v_prime;
+      break;
+    }
+
+    default:
+      CSS_UNREACHABLE();
+      return false;
+  }
+  if (map != 1) {
+    // Only opcodes following 0x0f are supported.
+    return false;
+  }
+  out.mandatory_prefix = static_cast<Mandatory_Prefix>(pp);
+  out.rex = 0x40 | rex_bits;
+  return true;
+}
+
+// Decodes the operands of an SSE, AVX, or AVX-512 instruction, starting after
+// the opcode.
+//
+// Returns false if the code is truncated or if the instruction is not
+// supported.
+bool decode_vector_operands(Byte_Cursor& cursor, const Vector_Prefix& prefix,
+                            U8 opcode, X86_64_Instruction& out) {
+  const Vector_Opcode_Info& info =
+      vector_opcodes[prefix.mandatory_prefix][opcode];
+  if ((info.encodings & prefix.encoding) == 0) return false;
+  if (!cursor.has(1)) return false;
+  U8 modrm = cursor.next_u8();
+  bool rm_is_register = (modrm >> 6) == 3;
+
+  bool is_legacy = prefix.encoding == legacy_encoding;
+  bool uses_vvvv = info.form == Vector_Form::arithmetic && !is_legacy;
+  if (prefix.has_vvvv && !uses_vvvv) {
+    // For example, vmovss %xmm2, %xmm1, %xmm0.
+    return false;
+  }
+  if (!is_legacy && info.scalar_byte_size != 0 &&
+      info.form != Vector_Form::arithmetic && rm_is_register) {
+    // NOTE(strager): Register-to-register vmovss and vmovsd have three
+    // operands. Let the fallback decoder handle them.
+    return false;
+  }
+
+  Access reg_access = Access::read;
+  Access rm_access = Access::read;
+  X86_64_Operand* reg_operand = nullptr;
+  X86_64_Operand* rm_operand = nullptr;
+  U8 operand_count = 0;
+  switch (info.form) {
+    case Vector_Form::unsupported:
+      CSS_UNREACHABLE();
+      return false;
+    case Vector_Form::load:
+      reg_access = Access::write;
+      reg_operand = &out.operands[0];
+      rm_operand = &out.operands[1];
+      operand_count = 2;
+      break;
+    case Vector_Form::store:
+      reg_access = Access::read;
+      rm_access = Access::write;
+      reg_operand = &out.operands[1];
+      rm_operand = &out.operands[0];
+      operand_count = 2;
+      break;
+    case Vector_Form::arithmetic:
+      reg_access = is_legacy ? Access::read_write : Access::write;
+      reg_operand = &out.operands[0];
+      if (uses_vvvv) {
+        set_register_operand(out.operands[1], X86_64_Register::untracked(),
+                             prefix.vector_byte_size, Access::read);
+        rm_operand = &out.operands[2];
+        operand_count = 3;
+      } else {
+        rm_operand = &out.operands[1];
+        operand_count = 2;
+      }
+      break;
+  }
+
+  // NOTE(strager): Vector registers are not tracked by Register_File.
+  set_register_operand(*reg_operand, X86_64_Register::untracked(),
+                       prefix.vector_byte_size, reg_access);
+  if (rm_is_register) {
+    set_register_operand(*rm_operand, X86_64_Register::untracked(),
+                         prefix.vector_byte_size, rm_access);
+  } else {
+    U8 memory_byte_size = info.scalar_byte_size != 0 ? info.scalar_byte_size
+                                                     : prefix.vector_byte_size;
+    // NOTE(strager): Without broadcasts, EVEX scales 8-bit displacements by
+    // the size of the memory operand.
+    U8 displacement_8_scale =
+        prefix.encoding == evex_encoding ? memory_byte_size : 1;
+    if (!decode_rm_operand(cursor, modrm, prefix.rex, memory_byte_size,
+                           rm_access, *rm_operand, displacement_8_scale)) {
+      return false;
+    }
+  }
+
+  out.mnemonic = X86_64_Mnemonic::other;
+  out.byte_size = narrow_cast<U8>(cursor.offset());
+  out.has_rep_prefix = false;
+  out.operand_count = operand_count;
+  return true;
+}
+}
+
+bool decode_x86_64_instruction_fast(std::span<const U8> code, U64 address,
+                                    X86_64_Instruction& out) {
+  Byte_Cursor cursor(code);
+
+  // NOTE(strager): Other legacy prefixes (lock, segment overrides, address
+  // size overrides, etc.) are rare in function bodies. Let the fallback
+  // decoder handle them.
+  bool has_operand_size_prefix = false;
+  bool has_rep_prefix = false;
+  bool has_repne_prefix = false;
+  for (;;) {
+    if (!cursor.has(1)) return false;
+    U8 prefix = cursor.peek();
+    if (prefix == 0x66) {
+      has_operand_size_prefix = true;
+    } else if (prefix == 0xf3) {
+      has_rep_prefix = true;
+    } else if (prefix == 0xf2) {
+      has_repne_prefix = true;
+    } else {
+      break;
+    }
+    cursor.next_u8();
+  }
+  if (has_rep_prefix && has_repne_prefix) return false;
+
+  if (cursor.peek() == 0xc4 || cursor.peek() == 0xc5 ||
+      cursor.peek() == 0x62) {
+    // NOTE(strager): In 64-bit mode, these bytes always begin a VEX or EVEX
+    // prefix, and legacy prefixes are not allowed before them.
+    if (has_operand_size_prefix || has_rep_prefix || has_repne_prefix) {
+      return false;
+    }
+    Vector_Prefix vector_prefix;
+    if (!decode_vector_prefix(cursor, vector_prefix)) return false;
+    if (!cursor.has(1)) return false;
+    U8 opcode = cursor.next_u8();
+    return decode_vector_operands(cursor, vector_prefix, opcode, out);
+  }
+
+  U8 rex = 0;
+  if ((cursor.peek() & 0xf0) == 0x40) {
+    rex = cursor.next_u8();
+    if (!cursor.has(1)) return false;
+  }
+
+  U8 opcode = cursor.next_u8();
+  const Opcode_Info* info = &one_byte_opcodes[opcode];
+  if (opcode == 0x0f) {
+    if (!cursor.has(1)) return false;
+    opcode = cursor.next_u8();
+    if (opcode == 0x1e && has_rep_prefix && cursor.has(1) &&
+        (cursor.peek() == 0xfa || cursor.peek() == 0xfb)) {
+      // endbr64 or endbr32.
+      cursor.next_u8();
+      out.mnemonic = X86_64_Mnemonic::other;
+      out.byte_size = narrow_cast<U8>(cursor.offset());
+      out.has_rep_prefix = false;
+      out.operand_count = 0;
+      return true;
+    }
+    Mandatory_Prefix mandatory_prefix =
+        has_repne_prefix          ? mandatory_prefix_f2
+        : has_rep_prefix          ? mandatory_prefix_f3
+        : has_operand_size_prefix ? mandatory_prefix_66
+                                  : no_mandatory_prefix;
+    if (vector_opcodes[mandatory_prefix][opcode].encodings & legacy_encoding) {
+      if (has_operand_size_prefix && mandatory_prefix != mandatory_prefix_66) {
+        return false;
+      }
+      return decode_vector_operands(cursor,
+                                    Vector_Prefix{
+                                        .encoding = legacy_encoding,
+                                        .mandatory_prefix = mandatory_prefix,
+                                        .rex = rex,
+                                        .vector_byte_size = 16,
+                                        .has_vvvv = false,
+                                    },
+                                    opcode, out);
+    }
+    info = &two_byte_opcodes[opcode];
+  } else if (opcode == 0x90 && (rex & rex_b)) {
+    // xchg %r8, %rax (not nop).
+    return false;
+  }
+
+  U8 modrm = 0;
+  if (info->group != no_group || form_has_modrm(info->form)) {
+    if (!cursor.has(1)) return false;
+    modrm = cursor.next_u8();
+    if (info->group != no_group) {
+      info = &opcode_groups[info->group][(modrm >> 3) & 7];
+    }
+  }
+  if (info->form == Operand_Form::unsupported) return false;
+  if (has_rep_prefix && info->form != Operand_Form::string) {
+    // For example, pause (f3 90) or repz ret.
+    return false;
+  }
+  if (has_repne_prefix) {
+    // For example, bnd jmp.
+    return false;
+  }
+
+  U8 operand_size = info->byte_operands      ? 1
+                    : (rex & rex_w)          ? 8
+                    : has_operand_size_prefix ? 2
+                    : info->default_64       ? 8
+                                             : 4;
+  U8 rex_r_bit = (rex & rex_r) ? 8 : 0;
+  X86_64_Register modrm_reg = general_register(
+      ((modrm >> 3) & 7) | rex_r_bit, operand_size, rex != 0);
+  U8 rm_size = info->rm_byte_size != 0 ? info->rm_byte_size : operand_size;
+  U8 max_32_bit_immediate_size = std::min(operand_size, U8(4));
+
+  X86_64_Operand* operands = out.operands;
+  U8 operand_count = 0;
+  // Reads an immediate of at most 32 bits which is sign-extended to
+  // operand_size.
+  auto decode_sign_extended_immediate =
+      [&](U8 immediate_size, X86_64_Operand& operand) -> bool {
+    if (!cursor.has(immediate_size)) return false;
+    set_immediate_operand(
+        operand,
+        truncate_immediate(cursor.next_signed(immediate_size), operand_size),
+        operand_size);
+    return true;
+  };
+
+  switch (info->form) {
+    case Operand_Form::unsupported:
+      CSS_UNREACHABLE();
+      break;
+
+    case Operand_Form::none:
+      break;
+
+    case Operand_Form::rm_reg:
+      if (!decode_rm_operand(cursor, modrm, rex, operand_size, info->access,
+                             operands[0])) {
+        return false;
+      }
+      set_register_operand(operands[1], modrm_reg, operand_size, Access::read);
+      operand_count = 2;
+      break;
+
+    case Operand_Form::reg_mem:
+      if ((modrm >> 6) == 3) return false;
+      [[fallthrough]];
+    case Operand_Form::reg_rm:
+      set_register_operand(operands[0], modrm_reg, operand_size, info->access);
+      if (!decode_rm_operand(cursor, modrm, rex, rm_size, Access::read,
+                             operands[1])) {
+        return false;
+      }
+      operand_count = 2;
+      break;
+
+    case Operand_Form::rm:
+      if (!decode_rm_operand(cursor, modrm, rex, operand_size, info->access,
+                             operands[0])) {
+        return false;
+      }
+      operand_count = 1;
+      break;
+
+    case Operand_Form::rm_imm:
+    case Operand_Form::rm_imm8:
+      if (!decode_rm_operand(cursor, modrm, rex, operand_size, info->access,
+                             operands[0])) {
+        return false;
+      }
+      if (!decode_sign_extended_immediate(
+              info->form == Operand_Form::rm_imm8 ? 1
+                                                  : max_32_bit_immediate_size,
+              operands[1])) {
+        return false;
+      }
+      operand_count = 2;
+      break;
+
+    case Operand_Form::accumulator_imm:
+      set_register_operand(operands[0],
+                           general_register(0, operand_size, rex != 0),
+                           operand_size, info->access);
+      if (!decode_sign_extended_immediate(max_32_bit_immediate_size,
+                                          operands[1])) {
+        return false;
+      }
+      operand_count = 2;
+      break;
+
+    case Operand_Form::opcode_reg:
+    case Operand_Form::opcode_reg_imm: {
+      U8 number = (opcode & 7) | ((rex & rex_b) ? 8 : 0);
+      set_register_operand(operands[0],
+                           general_register(number, operand_size, rex != 0),
+                           operand_size, info->access);
+      operand_count = 1;
+      if (info->form == Operand_Form::opcode_reg_imm) {
+        // NOTE(strager): Unlike most immediates, these are not sign-extended.
+        // mov $imm64, %rax has a full 64-bit immediate.
+        if (!cursor.has(operand_size)) return false;
+        set_immediate_operand(
+            operands[1], static_cast<S64>(cursor.next_unsigned(operand_size)),
+            operand_size);
+        operand_count = 2;
+      }
+      break;
+    }
+
+    case Operand_Form::imm16:
+      if (!cursor.has(2)) return false;
+      set_immediate_operand(operands[0],
+                            static_cast<S64>(cursor.next_unsigned(2)), 2);
+      operand_count = 1;
+      break;
+
+    case Operand_Form::rel8:
+    case Operand_Form::rel32: {
+      U8 displacement_size = info->form == Operand_Form::rel8 ? 1 : 4;
+      if (!cursor.has(displacement_size)) return false;
+      S64 displacement = cursor.next_signed(displacement_size);
+      set_immediate_operand(
+          operands[0],
+          static_cast<S64>(address + cursor.offset() +
+                           static_cast<U64>(displacement)),
+          8);
+      operand_count = 1;
+      break;
+    }
+
+    case Operand_Form::string:
+      set_memory_operand(operands[0],
+                         X86_64_Register::full(Register_Name::rdi),
+                         operand_size, Access::write);
+      if (info->mnemonic == X86_64_Mnemonic::movs) {
+        set_memory_operand(operands[1],
+                           X86_64_Register::full(Register_Name::rsi),
+                           operand_size, Access::read);
+      } else {
+        set_register_operand(operands[1],
+                             general_register(0, operand_size, rex != 0),
+                             operand_size, Access::read);
+      }
+      operand_count = 2;
+      break;
+  }
+
+  out.mnemonic = info->mnemonic;
+  out.byte_size = narrow_cast<U8>(cursor.offset());
+  out.has_rep_prefix = has_rep_prefix;
+  out.operand_count = operand_count;
+  return true;
+}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cppstacksize/base.h>
+#include <cppstacksize/register.h>
+#include <cstddef>
+#include <span>
+
+namespace cppstacksize {
+enum class X86_64_Mnemonic : U8 {
+  // An instruction which analyze_x86_64_stack_map does not treat specially.
+  other,
+
+  add,
+  and_,
+  call,
+  lea,
+  mov,  // Includes movabs.
+  movs,
+  movzx,  // Zero-extending mov, such as movzbl.
+  nop,  // Including multi-byte nops such as nopl 0x0(%rax).
+  pop,
+  push,
+  ret,
+  stos,
+  sub,
+};
+
+enum class X86_64_Operand_Kind : U8 {
+  register_,
+  immediate,
+  memory,
+};
+
+struct X86_64_Memory_Operand {
+  // Untracked if there is no base register or if the base register is %rip.
+  X86_64_Register base;
+  // Untracked if there is no index register.
+  X86_64_Register index;
+  U8 scale;
+  S64 displacement;
+};
+
+struct X86_64_Operand {
+  X86_64_Operand_Kind kind;
+  // Number of bytes read or written by the instruction. Up to 64 (for AVX-512
+  // %zmm registers).
+  U8 byte_size;
+  bool is_read;
+  bool is_written;
+
+  // If kind == X86_64_Operand_Kind::register_:
+  X86_64_Register reg;
+  // If kind == X86_64_Operand_Kind::immediate:
+  S64 immediate;
+  // If kind == X86_64_Operand_Kind::memory:
+  X86_64_Memory_Operand memory;
+};
+
+struct X86_64_Instruction {
+  static constexpr U8 max_operand_count = 4;
+
+  X86_64_Mnemonic mnemonic;
+  // Number of bytes of machine code.
+  U8 byte_size;
+  bool has_rep_prefix;
+  U8 operand_count;
+  // Destination first (Intel order).
+  X86_64_Operand operands[max_operand_count];
+};
+
+// Decodes the first instruction in code into out using lookup tables.
+//
+// Only instructions common in compiler-generated function bodies are
+// supported, including SSE, AVX, and AVX-512 moves and bitwise and arithmetic
+// operations. Returns false if the instruction is not supported (or if code is
+// truncated), in which case out's contents are unspecified.
+//
+// address is the address of the first byte of code. It is used to compute
+// the targets of relative calls and jumps.
+//
+// NOTE(strager): This function writes to out instead of returning
+// std::optional<X86_64_Instruction> because copying the instruction is a
+// significant part of the decoding time.
+bool decode_x86_64_instruction_fast(std::span<const U8> code, U64 address,
+                                    X86_64_Instruction& out);
+
+// Decodes instructions using decode_x86_64_instruction_fast, falling back to
+// Capstone for instructions decode_x86_64_instruction_fast does not support.
+//
+// Capstone is initialized the first time it is needed.
+class X86_64_Decoder {
+ public:
+  explicit X86_64_Decoder() = default;
+
+  X86_64_Decoder(const X86_64_Decoder&) = delete;
+  X86_64_Decoder& operator=(const X86_64_Decoder&) = delete;
+
+  ~X86_64_Decoder();
+
+  // Returns false if code does not start with a valid instruction.
+  bool decode(std::span<const U8> code, U64 address,
+              X86_64_Instruction& out) {
+    return decode_x86_64_instruction_fast(code, address, out) ||
+           this->decode_with_capstone(code, address, out);
+  }
+
+ private:
+  bool decode_with_capstone(std::span<const U8> code, U64 address,
+                            X86_64_Instruction& out);
+
+  // ::csh.
+  std::size_t capstone_handle_ = 0;
+  // ::cs_insn*, or nullptr if Capstone has not been initialized.
+  void* capstone_instruction_ = nullptr;
+  bool capstone_failed_ = false;
+};
+}
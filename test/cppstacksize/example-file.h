@@ -20,9 +20,11 @@ class Example_File {
 
   Loaded_File loaded_file() && { return std::move(this->file_); }
 
- private:
+  // 'relative_path' is relative to the test/ directory.
   static std::string full_path(const char* relative_path);
 
+ private:
+
   Loaded_File file_;
   Span_Reader reader_;
 };
@@ -0,0 +1,30 @@
+extern "C" void use_buffer(char*);
+extern "C" [[gnu::cold]] void report_error(int);
+
+// GCC moves the cold path into a separate function part (split_path.cold),
+// so this function has DW_AT_ranges instead of DW_AT_low_pc and DW_AT_high_pc.
+extern "C" int split_path(int x) {
+  if (__builtin_expect(x < 0, 0)) {
+    report_error(x);
+    return -1;
+  }
+  char buffer[16];
+  use_buffer(buffer);
+  return buffer[x & 15];
+}
+
+// The variable-length array forces a frame pointer.
+extern "C" int frame_pointer(int n) {
+  char buffer[n];
+  use_buffer(buffer);
+  return buffer[0];
+}
+
+// Call frame information describes the push of %rbp but not the locals.
+extern "C" [[gnu::optimize("no-omit-frame-pointer")]] int fixed_frame_pointer(
+    int x) {
+  volatile int buffer[8];
+  buffer[0] = x;
+  buffer[7] = x;
+  return buffer[x & 7];
+}
@@ -0,0 +1,27 @@
+extern "C" void use_buffer(char*);
+
+extern "C" int callee(int a, int b, int c, int d, int e) {
+  return a + b + c + d + e;
+}
+
+extern "C" int caller(int a) {
+  return a + callee(a + 1, a + 2, a + 3, a + 4, a + 5);
+}
+
+extern "C" int big_frame(int x) {
+  char buffer[100];
+  use_buffer(buffer);
+  return buffer[x];
+}
+
+namespace ns {
+struct Widget {
+  int method(int x);
+};
+
+int Widget::method(int x) {
+  char buffer[32];
+  use_buffer(buffer);
+  return buffer[x] + x;
+}
+}
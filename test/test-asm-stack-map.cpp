@@ -129,6 +129,52 @@ TEST(Test_ASM_Stack_Map, rsp_relative_mov_after_stack_adjustment) {
                 Stack_Map_Touch::write(4, +0x50 + 0x30, 8));
 }
 
+TEST(Test_ASM_Stack_Map, vector_register_spills_touch_whole_register) {
+  CHECK_TOUCHES(ASM_X86_64("movups %xmm0, 0x20(%rsp)"),
+                Stack_Map_Touch::write(0, 0x20, 16));
+  CHECK_TOUCHES(ASM_X86_64("movsd 0x8(%rsp), %xmm1"),
+                Stack_Map_Touch::read(0, 0x8, 8));
+  CHECK_TOUCHES(ASM_X86_64("sub $0x48, %rsp"
+                           "movaps %xmm6, 0x30(%rsp)"
+                           "vmovdqu %ymm0, (%rsp)"),
+                Stack_Map_Touch::write(4, -0x48 + 0x30, 16),
+                Stack_Map_Touch::write(9, -0x48, 32));
+}
+
+TEST(Test_ASM_Stack_Map, three_operand_instruction_touches) {
+  CHECK_TOUCHES(ASM_X86_64("vpxor 0x20(%rsp), %ymm1, %ymm0"),
+                Stack_Map_Touch::read(0, 0x20, 32));
+}
+
+TEST(Test_ASM_Stack_Map, index_register_with_known_value) {
+  CHECK_TOUCHES(ASM_X86_64("mov $2, %ecx"
+                           "mov %eax, 0x10(%rsp,%rcx,4)"),
+                Stack_Map_Touch::write(5, 0x10 + 2 * 4, 4));
+}
+
+TEST(Test_ASM_Stack_Map, index_register_with_bounded_value_touches_range) {
+  CHECK_TOUCHES(ASM_X86_64("mov (%rdi), %rcx"
+                           "and $7, %ecx"
+                           "movq $0, 0x20(%rsp,%rcx,8)"),
+                Stack_Map_Touch::write(6, 0x20, 8 * 8));
+  CHECK_TOUCHES(ASM_X86_64("movzbl (%rdi), %ecx"
+                           "mov 0x20(%rsp,%rcx,4), %eax"),
+                Stack_Map_Touch::read(3, 0x20, 0xff * 4 + 4));
+}
+
+TEST(Test_ASM_Stack_Map, lea_with_bounded_index_then_store) {
+  CHECK_TOUCHES(ASM_X86_64("mov (%rdi), %rcx"
+                           "and $3, %ecx"
+                           "lea 0x10(%rsp,%rcx,4), %rax"
+                           "movl $0, (%rax)"),
+                Stack_Map_Touch::write(11, 0x10, 4 * 4));
+}
+
+TEST(Test_ASM_Stack_Map, index_register_with_unknown_value) {
+  CHECK_TOUCHES(ASM_X86_64("mov (%rdi), %rcx"
+                           "mov %eax, 0x10(%rsp,%rcx,4)"));
+}
+
 TEST(Test_ASM_Stack_Map, push_after_stack_adjustment) {
   CHECK_TOUCHES(ASM_X86_64("sub $0x50, %rsp"
                            "pushq (%rdi)"),
@@ -200,6 +246,19 @@ TEST(Test_ASM_Stack_Map,
                 Stack_Map_Touch::read_or_write(13, 0x50, -1));
 }
 
+TEST(Test_ASM_Stack_Map, direct_calls_record_targets) {
+  static constexpr U8 code[] = {
+      // call +0x20
+      0xe8, 0x1b, 0x00, 0x00, 0x00,
+      // call *%rax
+      0xff, 0xd0,
+      // call -0x10
+      0xe8, 0xe4, 0xff, 0xff, 0xff,
+  };
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_THAT(sm.direct_call_targets, ElementsAreArray<S64>({0x20, -0x10}));
+}
+
 TEST(Test_ASM_Stack_Map, lea_then_store_attributes_stack_usage_to_store) {
   CHECK_TOUCHES(ASM_X86_64("lea 0x20(%rsp), %rax"
                            "mov %rbx, (%rax)"),
@@ -307,5 +366,130 @@ TEST(Test_ASM_Stack_Map, memcpy_with_rep_movs) {
                 Stack_Map_Touch::read(15, 0x20, 12345 * 4),
                 Stack_Map_Touch::write(15, 0x40, 12345 * 4));
 }
+TEST(Test_ASM_Stack_Map, fixed_size_frame_is_not_dynamic) {
+  Stack_Map sm = analyze_x86_64_stack_map(ASM_X86_64("sub $0x28, %rsp"
+                                                     "add $0x28, %rsp"
+                                                     "ret"));
+  EXPECT_FALSE(sm.is_dynamic());
+  EXPECT_EQ(sm.dynamic_allocation_bound(), 0);
+}
+
+TEST(Test_ASM_Stack_Map, large_frame_allocated_with_probe_is_not_dynamic) {
+  // MSVC allocates frames larger than a page with a call to __chkstk.
+  Stack_Map sm = analyze_x86_64_stack_map(ASM_X86_64("mov $0x2010, %eax"
+                                                     "call 0x1234"
+                                                     "sub %rax, %rsp"
+                                                     "mov %ecx, (%rsp)"));
+  EXPECT_FALSE(sm.is_dynamic());
+  EXPECT_THAT(sm.touches, ElementsAreArray<Stack_Map_Touch>({
+                              Stack_Map_Touch::write(13, -0x2010, 4),
+                          }));
+}
+
+TEST(Test_ASM_Stack_Map, alloca_with_constant_size_is_bounded) {
+  // Based on test/coff/alloca.obj.
+  std::span<const U8> code = ASM_X86_64(
+      "push %rbp"
+      "sub $0x10, %rsp"
+      "mov %rsp, %rbp"
+      "mov (%rsp), %eax"
+      "mov $0x50, %eax"
+      "sub %rax, %rsp"
+      "mov %rsp, %rax"
+      "mov (%rax), %ecx"
+      "mov %rax, 0x0(%rbp)"
+      "lea 0x10(%rbp), %rsp"
+      "pop %rbp"
+      "ret");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_THAT(sm.dynamic_allocations,
+              ElementsAreArray<Stack_Map_Dynamic_Allocation>({
+                  {.offset = 16,
+                   .min_byte_count = 0x50,
+                   .max_byte_count = 0x50,
+                   .is_probed = false},
+              }));
+  EXPECT_TRUE(sm.is_dynamic());
+  EXPECT_EQ(sm.dynamic_allocation_bound(), 0x50);
+  CHECK_TOUCHES(code,                                  //
+                Stack_Map_Touch::write(0, -0x08, 8),   //
+                Stack_Map_Touch::read(8, -0x18, 4),    //
+                Stack_Map_Touch::read(22, -0x68, 4),   //
+                Stack_Map_Touch::write(24, -0x18, 8),  //
+                Stack_Map_Touch::read(32, -0x08, 8),   //
+                Stack_Map_Touch::read(33, 0, 8));
+}
+
+TEST(Test_ASM_Stack_Map, probed_alloca_with_unknown_size_is_unbounded) {
+  // call 0x1234 stands in for call __chkstk.
+  std::span<const U8> code = ASM_X86_64(
+      "push %rbp"
+      "mov %rsp, %rbp"
+      "lea 0xf(%rcx), %rax"
+      "and $-0x10, %rax"
+      "call 0x1234"
+      "sub %rax, %rsp"
+      "mov %ecx, -0x4(%rbp)"
+      "mov %ecx, (%rsp)"
+      "mov %rbp, %rsp"
+      "pop %rbp"
+      "ret");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_THAT(sm.dynamic_allocations,
+              ElementsAreArray<Stack_Map_Dynamic_Allocation>({
+                  {.offset = 17,
+                   .min_byte_count = 0,
+                   .max_byte_count = (U64)-1,
+                   .is_probed = true},
+              }));
+  EXPECT_FALSE(sm.dynamic_allocations[0].is_bounded());
+  EXPECT_EQ(sm.dynamic_allocation_bound(), (U64)-1);
+  // NOTE(strager): mov %ecx, (%rsp) is not recorded because %rsp is unknown.
+  // TODO(strager): The call should not treat %rbp as a pointer argument.
+  CHECK_TOUCHES(code,                                               //
+                Stack_Map_Touch::write(0, -0x08, 8),                //
+                Stack_Map_Touch::read_or_write(1, -0x08, (U32)-1),  //
+                Stack_Map_Touch::write(20, -0x0c, 4),               //
+                Stack_Map_Touch::read(29, -0x08, 8),                //
+                Stack_Map_Touch::read(30, 0, 8));
+}
+
+TEST(Test_ASM_Stack_Map, variable_length_array_with_bounded_size) {
+  std::span<const U8> code = ASM_X86_64(
+      "movzbl %cl, %eax"
+      "sub %rax, %rsp"
+      "mov %edx, (%rsp)");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_THAT(sm.dynamic_allocations,
+              ElementsAreArray<Stack_Map_Dynamic_Allocation>({
+                  {.offset = 3,
+                   .min_byte_count = 0,
+                   .max_byte_count = 0xff,
+                   .is_probed = false},
+              }));
+  CHECK_TOUCHES(code, Stack_Map_Touch::write(6, -0xff, 0xff + 4));
+}
+
+TEST(Test_ASM_Stack_Map, dynamic_allocation_bound_adds_allocations) {
+  Stack_Map sm;
+  sm.dynamic_allocations.push_back(
+      Stack_Map_Dynamic_Allocation{.offset = 0,
+                                   .min_byte_count = 0,
+                                   .max_byte_count = 0x30,
+                                   .is_probed = false});
+  sm.dynamic_allocations.push_back(
+      Stack_Map_Dynamic_Allocation{.offset = 8,
+                                   .min_byte_count = 0x10,
+                                   .max_byte_count = 0x10,
+                                   .is_probed = false});
+  EXPECT_EQ(sm.dynamic_allocation_bound(), 0x40);
+
+  sm.dynamic_allocations.push_back(
+      Stack_Map_Dynamic_Allocation{.offset = 16,
+                                   .min_byte_count = 0,
+                                   .max_byte_count = (U64)-1,
+                                   .is_probed = false});
+  EXPECT_EQ(sm.dynamic_allocation_bound(), (U64)-1);
+}
 }
 }
@@ -0,0 +1,139 @@
+#include <cppstacksize/cache-budget.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <utility>
+#include <vector>
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace cppstacksize {
+namespace {
+TEST(Test_Cache_Budget, entries_within_budget_are_not_evicted) {
+  std::vector<U64> evicted;
+  Cache_Budget budget(300);
+  Cache_Budget::Cache_ID cache = budget.add_cache(
+      "test", [&](U64 key) -> void { evicted.push_back(key); });
+  budget.add_entry(cache, 1, 100);
+  budget.add_entry(cache, 2, 100);
+  budget.add_entry(cache, 3, 100);
+  EXPECT_THAT(evicted, IsEmpty());
+  EXPECT_EQ(budget.total_byte_size(), 300);
+  EXPECT_EQ(budget.cache_byte_size(cache), 300);
+}
+
+TEST(Test_Cache_Budget, least_recently_used_entries_are_evicted_first) {
+  std::vector<U64> evicted;
+  Cache_Budget budget(300);
+  Cache_Budget::Cache_ID cache = budget.add_cache(
+      "test", [&](U64 key) -> void { evicted.push_back(key); });
+  budget.add_entry(cache, 1, 100);
+  budget.add_entry(cache, 2, 100);
+  budget.add_entry(cache, 3, 100);
+  budget.touch_entry(cache, 1);
+  budget.add_entry(cache, 4, 150);
+  EXPECT_THAT(evicted, ElementsAre(2, 3));
+  EXPECT_TRUE(budget.contains_entry(cache, 1));
+  EXPECT_FALSE(budget.contains_entry(cache, 2));
+  EXPECT_FALSE(budget.contains_entry(cache, 3));
+  EXPECT_TRUE(budget.contains_entry(cache, 4));
+  EXPECT_EQ(budget.total_byte_size(), 250);
+}
+
+TEST(Test_Cache_Budget, entries_are_evicted_across_caches) {
+  std::vector<std::pair<int, U64>> evicted;
+  Cache_Budget budget(200);
+  Cache_Budget::Cache_ID cache_a = budget.add_cache(
+      "a", [&](U64 key) -> void { evicted.emplace_back(0, key); });
+  Cache_Budget::Cache_ID cache_b = budget.add_cache(
+      "b", [&](U64 key) -> void { evicted.emplace_back(1, key); });
+  budget.add_entry(cache_a, 1, 100);
+  budget.add_entry(cache_b, 1, 100);
+  budget.add_entry(cache_b, 2, 100);
+  EXPECT_THAT(evicted, ElementsAre(std::pair<int, U64>(0, 1)));
+  EXPECT_EQ(budget.cache_byte_size(cache_a), 0);
+  EXPECT_EQ(budget.cache_byte_size(cache_b), 200);
+
+  std::vector<Cache_Budget::Cache_Stats> stats = budget.get_stats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats[0].name, "a");
+  EXPECT_EQ(stats[0].entry_count, 0);
+  EXPECT_EQ(stats[0].eviction_count, 1);
+  EXPECT_EQ(stats[1].name, "b");
+  EXPECT_EQ(stats[1].entry_count, 2);
+  EXPECT_EQ(stats[1].byte_size, 200);
+  EXPECT_EQ(stats[1].eviction_count, 0);
+}
+
+TEST(Test_Cache_Budget, new_entry_is_kept_even_if_over_budget) {
+  std::vector<U64> evicted;
+  Cache_Budget budget(100);
+  Cache_Budget::Cache_ID cache = budget.add_cache(
+      "test", [&](U64 key) -> void { evicted.push_back(key); });
+  budget.add_entry(cache, 1, 50);
+  budget.add_entry(cache, 2, 500);
+  EXPECT_THAT(evicted, ElementsAre(1));
+  EXPECT_TRUE(budget.contains_entry(cache, 2));
+  EXPECT_EQ(budget.total_byte_size(), 500);
+}
+
+TEST(Test_Cache_Budget, shrinking_budget_evicts) {
+  std::vector<U64> evicted;
+  Cache_Budget budget;
+  Cache_Budget::Cache_ID cache = budget.add_cache(
+      "test", [&](U64 key) -> void { evicted.push_back(key); });
+  budget.add_entry(cache, 1, 100);
+  budget.add_entry(cache, 2, 100);
+  budget.add_entry(cache, 3, 100);
+  budget.set_max_bytes(150);
+  EXPECT_THAT(evicted, ElementsAre(1, 2));
+  budget.set_max_bytes(0);
+  EXPECT_THAT(evicted, ElementsAre(1, 2, 3));
+  EXPECT_EQ(budget.total_byte_size(), 0);
+}
+
+TEST(Test_Cache_Budget, removed_entries_are_not_evicted) {
+  std::vector<U64> evicted;
+  Cache_Budget budget(200);
+  Cache_Budget::Cache_ID cache = budget.add_cache(
+      "test", [&](U64 key) -> void { evicted.push_back(key); });
+  Cache_Budget::Cache_ID other_cache =
+      budget.add_cache("other", [&](U64) -> void { ADD_FAILURE(); });
+  budget.add_entry(other_cache, 1, 100);
+  budget.add_entry(cache, 1, 100);
+  budget.remove_all_entries(other_cache);
+  budget.add_entry(cache, 2, 100);
+  budget.remove_entry(cache, 1);
+  budget.remove_entry(cache, 1);  // Does nothing.
+  budget.add_entry(cache, 3, 100);
+  EXPECT_THAT(evicted, IsEmpty());
+  EXPECT_EQ(budget.total_byte_size(), 200);
+
+  budget.remove_cache(other_cache);
+  EXPECT_EQ(budget.get_stats().size(), 1);
+}
+
+TEST(Test_Cache_Budget, evict_function_may_remove_other_entries) {
+  Cache_Budget budget(200);
+  Cache_Budget::Cache_ID cache = 0;
+  std::vector<U64> evicted;
+  cache = budget.add_cache("test", [&](U64 key) -> void {
+    evicted.push_back(key);
+    // For example, evicting a parent entry could free its children.
+    budget.remove_entry(cache, key + 1);
+  });
+  budget.add_entry(cache, 1, 100);
+  budget.add_entry(cache, 2, 100);
+  budget.add_entry(cache, 10, 100);
+  EXPECT_THAT(evicted, ElementsAre(1));
+  EXPECT_FALSE(budget.contains_entry(cache, 2));
+  EXPECT_EQ(budget.total_byte_size(), 100);
+
+  // Freed entries are reused.
+  budget.add_entry(cache, 20, 50);
+  budget.add_entry(cache, 30, 50);
+  EXPECT_THAT(evicted, ElementsAre(1));
+  EXPECT_EQ(budget.total_byte_size(), 200);
+}
+}
+}
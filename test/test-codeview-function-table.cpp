@@ -0,0 +1,140 @@
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/extent-reader.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/reader.h>
+#include <gtest/gtest.h>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+class Test_CodeView_Function_Table : public ::testing::Test {
+ protected:
+  CodeView_Function make_function(std::u8string name, U64 module_index) {
+    U32 i = this->next_function_number_++;
+    return CodeView_Function{
+        .name = std::move(name),
+        .reader =
+            Sub_File_Reader<Span_Reader>(&this->reader_, module_index * 8, 8),
+        .byte_offset = i * 100,
+        .self_stack_size = i * 10 + 1,
+        .stack_size = i * 10 + 9,
+        .code_section_index = i + 2,
+        .code_offset = i * 0x40,
+        .code_size = i + 3,
+        .line_tables_handle =
+            Line_Tables::Handle{.module_index = module_index},
+        .has_func_id_type = i % 2 == 0,
+        .type_id = 0x1000 + i,
+    };
+  }
+
+  static U64 sub_file_offset(const Extent_Reader& reader) {
+    return reader.sub_file_offset();
+  }
+
+ private:
+  U8 bytes_[32] = {};
+  Span_Reader reader_ = Span_Reader(std::span<const U8>(bytes_));
+  U32 next_function_number_ = 0;
+};
+
+TEST_F(Test_CodeView_Function_Table, functions_round_trip) {
+  std::vector<CodeView_Function> functions = {
+      make_function(u8"first", 0),
+      make_function(u8"", 0),
+      make_function(u8"third", 1),
+  };
+  CodeView_Function_Table table;
+  EXPECT_TRUE(table.empty());
+  table.append(functions);
+  ASSERT_EQ(table.size(), 3);
+
+  for (U64 i = 0; i < functions.size(); ++i) {
+    SCOPED_TRACE(i);
+    const CodeView_Function& expected = functions[i];
+    EXPECT_EQ(table.name(i), expected.name);
+    EXPECT_EQ(table.self_stack_size(i), expected.self_stack_size);
+    EXPECT_EQ(table.stack_size(i), expected.stack_size);
+    EXPECT_EQ(table.code_size(i), expected.code_size);
+
+    CodeView_Function func = table[i];
+    EXPECT_EQ(func.name, expected.name);
+    EXPECT_EQ(func.byte_offset, expected.byte_offset);
+    EXPECT_EQ(func.self_stack_size, expected.self_stack_size);
+    EXPECT_EQ(func.stack_size, expected.stack_size);
+    EXPECT_EQ(func.code_section_index, expected.code_section_index);
+    EXPECT_EQ(func.code_offset, expected.code_offset);
+    EXPECT_EQ(func.code_size, expected.code_size);
+    EXPECT_EQ(func.has_func_id_type, expected.has_func_id_type);
+    EXPECT_EQ(func.type_id, expected.type_id);
+    EXPECT_EQ(func.pe_file, nullptr);
+    EXPECT_EQ(func.line_tables_handle.module_index,
+              expected.line_tables_handle.module_index);
+    EXPECT_EQ(sub_file_offset(func.reader), sub_file_offset(expected.reader));
+  }
+
+  std::vector<std::u8string> names;
+  for (CodeView_Function func : table) {
+    names.push_back(func.name);
+  }
+  EXPECT_EQ(names, (std::vector<std::u8string>{u8"first", u8"", u8"third"}));
+}
+
+TEST_F(Test_CodeView_Function_Table, functions_in_same_module_share_fields) {
+  CodeView_Function_Table table;
+  table.push_back(make_function(u8"a", 0));
+  table.push_back(make_function(u8"b", 0));
+  table.push_back(make_function(u8"c", 1));
+  EXPECT_EQ(&table.module_fields(0), &table.module_fields(1));
+  EXPECT_NE(&table.module_fields(0), &table.module_fields(2));
+}
+
+TEST_F(Test_CodeView_Function_Table, update_module_fields_changes_only_range) {
+  CodeView_Function_Table table;
+  table.push_back(make_function(u8"a", 0));
+  table.push_back(make_function(u8"b", 0));
+  table.push_back(make_function(u8"c", 0));
+
+  int update_count = 0;
+  table.update_module_fields(
+      1, 3, [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+        fields.line_tables_handle = Line_Tables::Handle{.module_index = 7};
+        update_count += 1;
+      });
+  EXPECT_EQ(update_count, 1) << "b and c share a module";
+  EXPECT_EQ(table[0].line_tables_handle.module_index, 0);
+  EXPECT_EQ(table[1].line_tables_handle.module_index, 7);
+  EXPECT_EQ(table[2].line_tables_handle.module_index, 7);
+  EXPECT_EQ(table.name(1), u8"b");
+}
+
+TEST_F(Test_CodeView_Function_Table, append_range_of_other_table) {
+  CodeView_Function_Table other;
+  other.push_back(make_function(u8"skipped", 0));
+  other.push_back(make_function(u8"second", 1));
+  other.push_back(make_function(u8"third", 2));
+  other.push_back(make_function(u8"skipped too", 2));
+
+  CodeView_Function_Table table;
+  table.push_back(make_function(u8"first", 1));
+  table.append(other, 1, 3);
+  ASSERT_EQ(table.size(), 3);
+  EXPECT_EQ(table.name(0), u8"first");
+  EXPECT_EQ(table.name(1), u8"second");
+  EXPECT_EQ(table.name(2), u8"third");
+  EXPECT_EQ(table.type_id(1), other.type_id(1));
+  EXPECT_EQ(table.code_offset(2), other.code_offset(2));
+  EXPECT_EQ(&table.module_fields(0), &table.module_fields(1));
+  EXPECT_EQ(sub_file_offset(table.module_fields(2).reader), 2 * 8);
+
+  table.clear();
+  EXPECT_TRUE(table.empty());
+  table.push_back(make_function(u8"after clear", 0));
+  EXPECT_EQ(table.name(0), u8"after clear");
+}
+}
+}
@@ -0,0 +1,107 @@
+#include <cppstacksize/codeview-record.h>
+#include <cppstacksize/extent-reader.h>
+#include <cppstacksize/pdb-reader.h>
+#include <cppstacksize/reader.h>
+#include <gtest/gtest.h>
+#include <optional>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+TEST(Test_CodeView_Record_Cursor, yields_each_record) {
+  static const U8 data[] = {
+      // Record 0:
+      0x04, 0x00,  // Length
+      0x34, 0x12,  // Kind
+      0xaa, 0xbb,  // Data
+
+      // Record 1:
+      0x02, 0x00,  // Length
+      0x78, 0x56,  // Kind
+  };
+  Span_Reader reader(data);
+  CodeView_Record_Cursor cursor(reader);
+
+  std::optional<CodeView_Record> record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->offset, 0);
+  EXPECT_EQ(record->length, 4);
+  EXPECT_EQ(record->kind(), 0x1234);
+  EXPECT_EQ(record->bytes.size(), 6);
+  EXPECT_EQ(record->bytes.u16(4), 0xbbaa);
+  EXPECT_EQ(cursor.offset(), 6);
+
+  record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->offset, 6);
+  EXPECT_EQ(record->kind(), 0x5678);
+  EXPECT_EQ(record->bytes.size(), 4);
+
+  EXPECT_FALSE(cursor.next().has_value());
+}
+
+TEST(Test_CodeView_Record_Cursor, starts_at_given_offset) {
+  static const U8 data[] = {
+      0x02, 0x00, 0x11, 0x11,  // Record 0
+      0x02, 0x00, 0x22, 0x22,  // Record 1
+  };
+  Span_Reader reader(data);
+  CodeView_Record_Cursor cursor(reader, 4);
+  std::optional<CodeView_Record> record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->offset, 4);
+  EXPECT_EQ(record->kind(), 0x2222);
+  EXPECT_FALSE(cursor.next().has_value());
+}
+
+TEST(Test_CodeView_Record_Cursor, truncated_record_has_fewer_bytes) {
+  static const U8 data[] = {
+      0x08, 0x00,  // Length
+      0x34, 0x12,  // Kind
+      0xaa,        // Data (truncated)
+  };
+  Span_Reader reader(data);
+  CodeView_Record_Cursor cursor(reader);
+  std::optional<CodeView_Record> record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->length, 8);
+  EXPECT_EQ(record->bytes.size(), 5);
+  EXPECT_EQ(record->bytes.u8(4), 0xaa);
+  EXPECT_THROW({ record->bytes.u8(5); }, Out_Of_Bounds_Read);
+  EXPECT_FALSE(cursor.next().has_value());
+}
+
+TEST(Test_CodeView_Record_Cursor, copies_record_straddling_pdb_blocks) {
+  static const U8 file_data[] = {
+      // Block 0 (stream bytes 4-7):
+      0x04, 0x00, 0x34, 0x12,
+      // Block 1 (stream bytes 0-3):
+      0x02, 0x00, 0x11, 0x11,
+      // Block 2 (unused):
+      0xcc, 0xcc, 0xcc, 0xcc,
+      // Block 3 (stream bytes 8-11):
+      0xaa, 0xbb, 0xcc, 0xcc,
+  };
+  Span_Reader base_reader(file_data);
+  PDB_Blocks_Reader<Span_Reader> stream(&base_reader, {1, 0, 3},
+                                        /*block_size=*/4, /*byte_size=*/10,
+                                        /*stream_index=*/0);
+  CodeView_Record_Cursor cursor(stream);
+
+  std::optional<CodeView_Record> record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->kind(), 0x1111);
+  EXPECT_EQ(record->bytes.data().data(), &file_data[4])
+      << "record in one block should not be copied";
+
+  record = cursor.next();
+  ASSERT_TRUE(record.has_value());
+  EXPECT_EQ(record->offset, 4);
+  EXPECT_EQ(record->length, 4);
+  EXPECT_EQ(record->kind(), 0x1234);
+  EXPECT_EQ(record->bytes.u16(4), 0xbbaa);
+
+  EXPECT_FALSE(cursor.next().has_value());
+}
+}
+}
@@ -1,3 +1,5 @@
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/codeview-inline-site.h>
 #include <cppstacksize/codeview.h>
 #include <cppstacksize/example-file.h>
 #include <cppstacksize/pdb.h>
@@ -5,6 +7,9 @@
 #include <cppstacksize/util.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <initializer_list>
+#include <utility>
+#include <vector>
 
 namespace cppstacksize {
 namespace {
@@ -20,15 +25,120 @@ TEST(Test_CodeView, primitives_obj_has_one_function) {
   EXPECT_EQ(functions[0].name, u8"primitives");
   EXPECT_EQ(functions[0].location().file_offset, 0x237);
   EXPECT_EQ(functions[0].self_stack_size, 88);
-  // TODO[coff-relocations]: Perform relocations to get the correct
-  // codeSectionIndex and codeOffset.
-  if (false) {
-    EXPECT_EQ(functions[0].code_section_index, 2);  // .text$mn
-    EXPECT_EQ(functions[0].code_offset, 0);
-  }
+  functions[0].pe_file = &pe;
+  std::optional<CodeView_Code_Location> code_location =
+      functions[0].get_code_location();
+  ASSERT_TRUE(code_location.has_value());
+  EXPECT_EQ(code_location->section_index, 2);  // .text$mn
+  EXPECT_EQ(code_location->offset, 0);
   EXPECT_EQ(functions[0].code_size, 124);
 }
 
+TEST(Test_CodeView, frame_proc_of_function_with_alloca) {
+  Example_File file("coff/alloca.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader section_reader = pe.find_sections_by_name(u8".debug$S").at(0);
+
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  ASSERT_EQ(functions.size(), 1);
+  std::optional<CodeView_Frame_Proc> frame_proc =
+      functions[0].get_frame_proc();
+  ASSERT_TRUE(frame_proc.has_value());
+  // push %rbp; sub $0x10, %rsp
+  EXPECT_EQ(frame_proc->frame_size, 0x10);
+  EXPECT_EQ(frame_proc->frame_size, functions[0].self_stack_size);
+  EXPECT_EQ(frame_proc->saved_registers_size, 8);
+  EXPECT_EQ(frame_proc->padding_size, 0);
+  EXPECT_EQ(frame_proc->exception_handler_offset, 0);
+  EXPECT_TRUE(frame_proc->has_alloca());
+  EXPECT_TRUE(frame_proc->has_security_checks());
+  EXPECT_FALSE(frame_proc->has_eh());
+  EXPECT_FALSE(frame_proc->has_seh());
+  EXPECT_EQ(frame_proc->local_base_pointer(), CV_FRAMEPROC_BASE_POINTER_RBP);
+  EXPECT_EQ(frame_proc->param_base_pointer(), CV_FRAMEPROC_BASE_POINTER_RBP);
+  EXPECT_EQ(frame_proc->stack_size(), 0x10 + 8 + 8);
+}
+
+TEST(Test_CodeView, frame_proc_of_function_without_alloca) {
+  Example_File file("coff/primitives.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader section_reader = pe.find_sections_by_name(u8".debug$S").at(0);
+
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  ASSERT_EQ(functions.size(), 1);
+  std::optional<CodeView_Frame_Proc> frame_proc =
+      functions[0].get_frame_proc();
+  ASSERT_TRUE(frame_proc.has_value());
+  EXPECT_EQ(frame_proc->frame_size, 88);
+  EXPECT_EQ(frame_proc->saved_registers_size, 0);
+  EXPECT_FALSE(frame_proc->has_alloca());
+  EXPECT_FALSE(frame_proc->has_security_checks());
+  EXPECT_EQ(frame_proc->local_base_pointer(), CV_FRAMEPROC_BASE_POINTER_RSP);
+  EXPECT_EQ(frame_proc->stack_size(), 88 + 8);
+  EXPECT_EQ(functions[0].stack_size, frame_proc->stack_size());
+}
+
+TEST(Test_CodeView, obj_function_code_locations_are_relocated) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader section_reader = pe.find_sections_by_name(u8".debug$S").at(0);
+
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  ASSERT_EQ(functions.size(), 4);
+  // Data according to: objdump -t
+  U32 expected_offsets[] = {0x00, 0x10, 0x20, 0x40};
+  for (U64 i = 0; i < functions.size(); ++i) {
+    SCOPED_TRACE(i);
+    functions[i].pe_file = &pe;
+    std::optional<CodeView_Code_Location> code_location =
+        functions[i].get_code_location();
+    ASSERT_TRUE(code_location.has_value());
+    EXPECT_EQ(code_location->section_index, 2);  // .text$mn
+    EXPECT_EQ(code_location->offset, expected_offsets[i]);
+
+    std::optional<Sub_File_Reader<Span_Reader>> instructions =
+        functions[i].get_instruction_bytes_reader();
+    ASSERT_TRUE(instructions.has_value());
+    EXPECT_EQ(instructions->sub_file_offset(),
+              pe.sections[2].data_file_offset + expected_offsets[i]);
+  }
+}
+
+TEST(Test_CodeView, obj_function_call_targets_are_resolved) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader section_reader = pe.find_sections_by_name(u8".debug$S").at(0);
+
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  CodeView_Function& c = functions.at(2);
+  ASSERT_EQ(c.name, u8"c");
+  c.pe_file = &pe;
+
+  // Data according to: objdump -d -r
+  // 24: e8 00 00 00 00   call 29   25: IMAGE_REL_AMD64_REL32 ?a@@YAXXZ
+  std::optional<COFF_Relocation_Target> target = c.get_relocation_target(0x5);
+  ASSERT_TRUE(target.has_value());
+  EXPECT_EQ(target->symbol.name, u8"?a@@YAXXZ");
+  EXPECT_EQ(target->relocation_type, IMAGE_REL_AMD64_REL32);
+  EXPECT_EQ(target->symbol.section_index, 2);
+  EXPECT_EQ(target->symbol.value, 0x00);
+
+  target = c.get_relocation_target(0xa);
+  ASSERT_TRUE(target.has_value());
+  EXPECT_EQ(target->symbol.name, u8"?b@@YAXXZ");
+  EXPECT_EQ(target->symbol.value, 0x10);
+
+  EXPECT_FALSE(c.get_relocation_target(0x6).has_value());
+}
+
 TEST(Test_CodeView, primitives_obj_function_has_local_variables) {
   Example_File file("coff/primitives.obj");
   PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
@@ -144,6 +254,248 @@ TEST(Test_CodeView, loads_all_variables_in_all_blocks) {
                            }));
 }
 
+TEST(Test_CodeView, s_local_parameters_duplicating_regrel_are_skipped) {
+  Example_File file("coff/parameters-int-6-callee.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader section_reader = pe.find_sections_by_name(u8".debug$S").at(1);
+
+  // Each parameter has an S_LOCAL record with S_DEFRANGE_* records and an
+  // S_REGREL32 record.
+  CodeView_Function func = find_all_codeview_functions(&section_reader).at(0);
+  std::vector<std::pair<std::u8string, U32>> locals;
+  for (const CodeView_Function_Local& local :
+       func.get_locals(func.byte_offset)) {
+    locals.emplace_back(local.name, local.sp_offset);
+    EXPECT_EQ(local.inline_site_index, CodeView_Inline_Site::no_parent);
+  }
+  EXPECT_THAT(locals, ::testing::UnorderedElementsAreArray({
+                          std::pair<std::u8string, U32>(u8"p0", 0x08),
+                          std::pair<std::u8string, U32>(u8"p1", 0x10),
+                          std::pair<std::u8string, U32>(u8"p2", 0x18),
+                          std::pair<std::u8string, U32>(u8"p3", 0x20),
+                          std::pair<std::u8string, U32>(u8"p4", 0x28),
+                          std::pair<std::u8string, U32>(u8"p5", 0x30),
+                      }));
+}
+
+void append_record(std::vector<U8>& out, U16 kind,
+                   std::initializer_list<U8> data) {
+  U16 length = narrow_cast<U16>(data.size() + 2);
+  out.insert(out.end(), {narrow_cast<U8>(length & 0xff),
+                         narrow_cast<U8>(length >> 8),
+                         narrow_cast<U8>(kind & 0xff),
+                         narrow_cast<U8>(kind >> 8)});
+  out.insert(out.end(), data);
+}
+
+TEST(Test_CodeView, stack_locals_from_s_local_records) {
+  std::vector<U8> data;
+  append_record(data, S_GPROC32_ID, {});
+  append_record(data, S_FRAMEPROC,
+                {
+                    0x40, 0x00, 0x00, 0x00,  // Frame size
+                    0x00, 0x00, 0x00, 0x00,  // Padding size
+                    0x00, 0x00, 0x00, 0x00,  // Padding offset
+                    0x08, 0x00, 0x00, 0x00,  // Saved registers size
+                    0x00, 0x00, 0x00, 0x00,  // Exception handler offset
+                    0x00, 0x00,              // Exception handler section
+                    0x00, 0x40, 0x01, 0x00,  // Flags (RSP base pointers)
+                });
+  append_record(data, S_LOCAL,
+                {
+                    0x74, 0x00, 0x00, 0x00,  // Type
+                    0x00, 0x00,              // Flags
+                    'x', 0x00,               // Name
+                });
+  append_record(data, S_DEFRANGE_FRAMEPOINTER_REL,
+                {
+                    0x20, 0x00, 0x00, 0x00,  // Offset
+                    0x00, 0x00, 0x00, 0x00,  // Range start
+                    0x01, 0x00,              // Range section
+                    0x10, 0x00,              // Range length
+                });
+  // Register-only locals are not on the stack.
+  append_record(data, S_LOCAL,
+                {
+                    0x74, 0x00, 0x00, 0x00,  // Type
+                    0x00, 0x00,              // Flags
+                    'r', 0x00,               // Name
+                });
+  append_record(data, S_DEFRANGE_REGISTER,
+                {
+                    0x12, 0x00,              // Register (ECX)
+                    0x00, 0x00,              // Attributes
+                    0x00, 0x00, 0x00, 0x00,  // Range start
+                    0x01, 0x00,              // Range section
+                    0x10, 0x00,              // Range length
+                });
+  append_record(data, S_INLINESITE,
+                {
+                    0x00, 0x00, 0x00, 0x00,  // Parent
+                    0x00, 0x00, 0x00, 0x00,  // End
+                    0x01, 0x10, 0x00, 0x00,  // Inlinee
+                    0x03, 0x04, 0x04, 0x08,  // Annotations
+                });
+  append_record(data, S_LOCAL,
+                {
+                    0x74, 0x00, 0x00, 0x00,  // Type
+                    0x00, 0x00,              // Flags
+                    'y', 0x00,               // Name
+                });
+  append_record(data, S_DEFRANGE_REGISTER_REL,
+                {
+                    0x4f, 0x01,              // Register (RSP)
+                    0x00, 0x00,              // Flags
+                    0x28, 0x00, 0x00, 0x00,  // Offset
+                    0x04, 0x00, 0x00, 0x00,  // Range start
+                    0x01, 0x00,              // Range section
+                    0x08, 0x00,              // Range length
+                });
+  append_record(data, S_INLINESITE_END, {});
+  append_record(data, S_PROC_ID_END, {});
+  Span_Reader reader(data);
+
+  std::vector<CodeView_Function_Local> locals;
+  get_codeview_function_locals(reader, 0, locals, fallback_logger);
+  ASSERT_EQ(locals.size(), 2);
+  EXPECT_EQ(locals[0].name, u8"x");
+  EXPECT_EQ(locals[0].sp_offset, 0x20);
+  EXPECT_EQ(locals[0].type_id, 0x74);
+  EXPECT_EQ(locals[0].inline_site_index, CodeView_Inline_Site::no_parent);
+  EXPECT_EQ(locals[1].name, u8"y");
+  EXPECT_EQ(locals[1].sp_offset, 0x28);
+  EXPECT_EQ(locals[1].inline_site_index, 0);
+}
+
+TEST(Test_CodeView, inline_site_code_ranges_follow_code_offset_changes) {
+  static const U8 annotations[] = {
+      0x03, 0x05,        // ChangeCodeOffset 5: [5, ...
+      0x0b, 0x24,        // ChangeCodeOffsetAndLineOffset 4, 2
+      0x06, 0x02,        // ChangeLineOffset 1
+      0x04, 0x03,        // ChangeCodeLength 3: ..., 12)
+      0x0c, 0x02, 0x08,  // ChangeCodeLengthAndCodeOffset 2, 8: [20, 22)
+      0x03, 0x00,        // ChangeCodeOffset 0: [22, ...
+      0x04, 0x03,        // ChangeCodeLength 3: ..., 25)
+      0x00, 0x00, 0x00,  // Padding
+  };
+  std::vector<CodeView_Code_Range> ranges;
+  EXPECT_TRUE(decode_codeview_inline_site_code_ranges(annotations, ranges));
+  EXPECT_THAT(ranges, ::testing::ElementsAreArray({
+                          CodeView_Code_Range{5, 12},
+                          // [20, 22) and [22, 25) are merged.
+                          CodeView_Code_Range{20, 25},
+                      }));
+}
+
+TEST(Test_CodeView, inline_site_code_ranges_with_compressed_operands) {
+  static const U8 annotations[] = {
+      0x03, 0x81, 0x00,              // ChangeCodeOffset 0x100
+      0x04, 0xc0, 0x01, 0x00, 0x00,  // ChangeCodeLength 0x10000
+  };
+  std::vector<CodeView_Code_Range> ranges;
+  EXPECT_TRUE(decode_codeview_inline_site_code_ranges(annotations, ranges));
+  EXPECT_THAT(ranges, ::testing::ElementsAreArray({
+                          CodeView_Code_Range{0x100, 0x10100},
+                      }));
+}
+
+TEST(Test_CodeView, malformed_inline_site_annotations_keep_decoded_ranges) {
+  {
+    static const U8 annotations[] = {
+        0x03, 0x05,  // ChangeCodeOffset 5
+        0x0b, 0x13,  // ChangeCodeOffsetAndLineOffset 3, 1
+        0x04,        // ChangeCodeLength (missing operand)
+    };
+    std::vector<CodeView_Code_Range> ranges;
+    EXPECT_FALSE(decode_codeview_inline_site_code_ranges(annotations, ranges));
+    EXPECT_THAT(ranges, ::testing::ElementsAreArray({
+                            CodeView_Code_Range{5, 8},
+                        }));
+  }
+
+  {
+    static const U8 annotations[] = {
+        0x03, 0x05,  // ChangeCodeOffset 5
+        0x04, 0x01,  // ChangeCodeLength 1
+        0x0e, 0x00,  // Unknown opcode
+    };
+    std::vector<CodeView_Code_Range> ranges;
+    EXPECT_FALSE(decode_codeview_inline_site_code_ranges(annotations, ranges));
+    EXPECT_THAT(ranges, ::testing::ElementsAreArray({
+                            CodeView_Code_Range{5, 6},
+                        }));
+  }
+}
+
+TEST(Test_CodeView, nested_inline_sites) {
+  std::vector<U8> data;
+  append_record(data, S_GPROC32_ID, {});
+  append_record(data, S_INLINESITE,
+                {
+                    0x00, 0x00, 0x00, 0x00,  // Parent
+                    0x00, 0x00, 0x00, 0x00,  // End
+                    0x01, 0x10, 0x00, 0x00,  // Inlinee
+                    0x03, 0x04, 0x04, 0x10,  // Annotations: [4, 20)
+                });
+  append_record(data, S_INLINESITE2,
+                {
+                    0x00, 0x00, 0x00, 0x00,  // Parent
+                    0x00, 0x00, 0x00, 0x00,  // End
+                    0x02, 0x10, 0x00, 0x00,  // Inlinee
+                    0x01, 0x00, 0x00, 0x00,  // Invocations
+                    0x03, 0x08, 0x04, 0x04,  // Annotations: [8, 12)
+                });
+  append_record(data, S_INLINESITE_END, {});
+  append_record(data, S_INLINESITE_END, {});
+  append_record(data, S_INLINESITE,
+                {
+                    0x00, 0x00, 0x00, 0x00,  // Parent
+                    0x00, 0x00, 0x00, 0x00,  // End
+                    0x03, 0x10, 0x00, 0x00,  // Inlinee
+                    0x0c, 0x02, 0x18, 0x00,  // Annotations: [24, 26)
+                });
+  append_record(data, S_INLINESITE_END, {});
+  append_record(data, S_PROC_ID_END, {});
+  // Belongs to another function.
+  append_record(data, S_INLINESITE,
+                {
+                    0x00, 0x00, 0x00, 0x00,  // Parent
+                    0x00, 0x00, 0x00, 0x00,  // End
+                    0x04, 0x10, 0x00, 0x00,  // Inlinee
+                });
+  Span_Reader reader(data);
+
+  CodeView_Inline_Site_Tree tree;
+  get_codeview_inline_sites(reader, 0, tree, fallback_logger);
+  ASSERT_EQ(tree.sites.size(), 3);
+  EXPECT_EQ(tree.sites[0].inlinee_id, 0x1001);
+  EXPECT_EQ(tree.sites[0].parent_index, CodeView_Inline_Site::no_parent);
+  EXPECT_THAT(tree.get_code_ranges(0), ::testing::ElementsAreArray({
+                                           CodeView_Code_Range{4, 20},
+                                       }));
+  EXPECT_EQ(tree.sites[1].inlinee_id, 0x1002);
+  EXPECT_EQ(tree.sites[1].parent_index, 0);
+  EXPECT_THAT(tree.get_code_ranges(1), ::testing::ElementsAreArray({
+                                           CodeView_Code_Range{8, 12},
+                                       }));
+  EXPECT_EQ(tree.sites[2].inlinee_id, 0x1003);
+  EXPECT_EQ(tree.sites[2].parent_index, CodeView_Inline_Site::no_parent);
+  EXPECT_THAT(tree.get_code_ranges(2), ::testing::ElementsAreArray({
+                                           CodeView_Code_Range{24, 26},
+                                       }));
+
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -8, 8),   Stack_Map_Touch::read(4, -8, 8),
+      Stack_Map_Touch::read(8, -8, 8),    Stack_Map_Touch::read(11, -8, 8),
+      Stack_Map_Touch::read(12, -8, 8),   Stack_Map_Touch::read(25, -8, 8),
+      Stack_Map_Touch::read(0x30, -8, 8),
+  };
+  constexpr U32 none = CodeView_Inline_Site::no_parent;
+  EXPECT_THAT(tree.attribute_touches(touches),
+              ::testing::ElementsAreArray({none, 0u, 1u, 1u, 0u, 2u, none}));
+}
+
 TEST(Test_CodeView, int_parameters) {
   struct Test_Case {
     const char* description;
@@ -508,6 +860,404 @@ TEST(Test_CodeView, codeview_types) {
   }
 }
 
+TEST(Test_CodeView, numeric_leaves) {
+  struct Test_Case {
+    std::vector<U8> data;
+    U64 expected_value;
+    bool expected_is_negative;
+    U64 expected_encoded_size;
+  };
+  const Test_Case test_cases[] = {
+      // Immediate:
+      {{0x34, 0x12}, 0x1234, false, 2},
+      // LF_CHAR:
+      {{0x00, 0x80, 0xfe}, static_cast<U64>(-2), true, 3},
+      // LF_SHORT:
+      {{0x01, 0x80, 0x00, 0x80}, static_cast<U64>(-0x8000), true, 4},
+      // LF_USHORT:
+      {{0x02, 0x80, 0x00, 0x80}, 0x8000, false, 4},
+      // LF_LONG:
+      {{0x03, 0x80, 0x00, 0x00, 0x01, 0x00}, 0x10000, false, 6},
+      {{0x03, 0x80, 0xff, 0xff, 0xff, 0xff}, static_cast<U64>(-1), true, 6},
+      // LF_ULONG:
+      {{0x04, 0x80, 0x00, 0x00, 0x00, 0x80}, 0x80000000, false, 6},
+      // LF_QUADWORD:
+      {{0x09, 0x80, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00},
+       0x100000000,
+       false,
+       10},
+      // LF_UQUADWORD:
+      {{0x0a, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80},
+       0x8000000000000000,
+       false,
+       10},
+  };
+  for (const Test_Case& test_case : test_cases) {
+    SCOPED_TRACE(test_case.expected_value);
+    Span_Reader reader(test_case.data);
+    std::optional<CodeView_Numeric_Leaf> leaf =
+        read_codeview_numeric_leaf(reader, 0);
+    ASSERT_TRUE(leaf.has_value());
+    EXPECT_EQ(leaf->value, test_case.expected_value);
+    EXPECT_EQ(leaf->is_negative, test_case.expected_is_negative);
+    EXPECT_EQ(leaf->encoded_size, test_case.expected_encoded_size);
+  }
+
+  static const U8 real32_data[] = {0x05, 0x80, 0x00, 0x00, 0x80, 0x3f};
+  EXPECT_FALSE(
+      read_codeview_numeric_leaf(Span_Reader(real32_data), 0).has_value());
+}
+
+TEST(Test_CodeView, large_types_have_numeric_leaf_sizes) {
+  std::vector<U8> data;
+  // 0x1000:
+  append_record(data, LF_STRUCTURE,
+                {
+                    0x00, 0x00,                          // Member count
+                    0x00, 0x00,                          // Properties
+                    0x00, 0x00, 0x00, 0x00,              // Field list type
+                    0x00, 0x00, 0x00, 0x00,              // Derived type
+                    0x00, 0x00, 0x00, 0x00,              // VShape type
+                    0x03, 0x80, 0x00, 0x00, 0x01, 0x00,  // Size (LF_LONG)
+                    'B', 'i', 'g', 0x00,                 // Name
+                });
+  // 0x1001:
+  append_record(data, LF_UNION,
+                {
+                    0x00, 0x00,                          // Member count
+                    0x00, 0x00,                          // Properties
+                    0x00, 0x00, 0x00, 0x00,              // Field list type
+                    0x04, 0x80, 0x00, 0x90, 0x00, 0x00,  // Size (LF_ULONG)
+                    'U', 0x00,                           // Name
+                });
+  // 0x1002:
+  append_record(data, LF_ARRAY,
+                {
+                    0x70, 0x00, 0x00, 0x00,  // Element type (T_RCHAR)
+                    0x23, 0x00, 0x00, 0x00,  // Index type (T_UQUAD)
+                    0x02, 0x80, 0x00, 0x80,  // Size (LF_USHORT)
+                    0x00,                    // Name
+                });
+  // 0x1003:
+  append_record(data, LF_STRUCTURE,
+                {
+                    0x00, 0x00,              // Member count
+                    0x00, 0x00,              // Properties
+                    0x00, 0x00, 0x00, 0x00,  // Field list type
+                    0x00, 0x00, 0x00, 0x00,  // Derived type
+                    0x00, 0x00, 0x00, 0x00,  // VShape type
+                    0x10, 0x00,              // Size
+                    'S', 0x00,               // Name
+                });
+  // 0x1004:
+  append_record(data, LF_ARRAY,
+                {
+                    0x10, 0x00, 0x00, 0x00,              // Element type
+                    0x23, 0x00, 0x00, 0x00,              // Index type
+                    0x05, 0x80, 0x00, 0x00, 0x80, 0x3f,  // Size (LF_REAL32)
+                    0x00,                                // Name
+                });
+  Span_Reader reader(data);
+  CodeView_Type_Table type_table =
+      parse_codeview_types_without_header(reader, 0, fallback_logger);
+
+  std::optional<CodeView_Type> type = type_table.get_type(0x1000);
+  ASSERT_TRUE(type.has_value());
+  EXPECT_EQ(type->byte_size, 0x10000);
+  EXPECT_EQ(type->name, u8"Big");
+
+  type = type_table.get_type(0x1001);
+  ASSERT_TRUE(type.has_value());
+  EXPECT_EQ(type->byte_size, 0x9000);
+  EXPECT_EQ(type->name, u8"U");
+
+  type = type_table.get_type(0x1002);
+  ASSERT_TRUE(type.has_value());
+  EXPECT_EQ(type->byte_size, 0x8000);
+  EXPECT_EQ(type->name, u8"char[]");
+
+  type = type_table.get_type(0x1003);
+  ASSERT_TRUE(type.has_value());
+  EXPECT_EQ(type->byte_size, 0x10);
+  EXPECT_EQ(type->name, u8"S");
+
+  Capturing_Logger logger(&fallback_logger);
+  EXPECT_FALSE(type_table.get_type(0x1004, logger).has_value());
+  EXPECT_TRUE(logger.did_log_message());
+}
+
+TEST(Test_CodeView, struct_members_from_field_list) {
+  Example_File file("coff/struct.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader types_section_reader = pe.find_sections_by_name(u8".debug$T").at(0);
+  CodeView_Type_Table type_table = parse_codeview_types(&types_section_reader);
+
+  // Struct_With_Two_Ints:
+  std::span<const CodeView_Type_Member> members =
+      type_table.get_members(0x1020);
+  ASSERT_EQ(members.size(), 2);
+  EXPECT_EQ(members[0].name, u8"a");
+  EXPECT_EQ(members[0].type_id, T_INT4);
+  EXPECT_EQ(members[0].byte_offset, 0);
+  EXPECT_EQ(members[0].byte_size, 4);
+  EXPECT_FALSE(members[0].is_base_class);
+  EXPECT_EQ(members[1].name, u8"b");
+  EXPECT_EQ(members[1].byte_offset, 4);
+  EXPECT_EQ(members[1].byte_size, 4);
+  EXPECT_EQ(type_table.get_members(0x1020).data(), members.data())
+      << "members should be cached";
+
+  // Struct_With_Bit_Field:
+  members = type_table.get_members(0x1025);
+  ASSERT_EQ(members.size(), 2);
+  EXPECT_EQ(members[0].name, u8"b0");
+  EXPECT_EQ(members[0].byte_offset, 0);
+  EXPECT_EQ(members[0].byte_size, 1);
+  EXPECT_EQ(type_table.get_type(members[0].type_id)->name,
+            u8"unsigned char : 1");
+  EXPECT_EQ(members[1].name, u8"b12");
+  EXPECT_EQ(members[1].byte_offset, 0);
+  EXPECT_EQ(type_table.get_type(members[1].type_id)->name,
+            u8"unsigned char : 2");
+
+  // Struct_With_Vtable (methods are skipped):
+  members = type_table.get_members(0x1015);
+  ASSERT_EQ(members.size(), 1);
+  EXPECT_EQ(members[0].name, u8"<vfptr>");
+  EXPECT_EQ(members[0].byte_offset, 0);
+  EXPECT_EQ(members[0].byte_size, 8);
+
+  // Empty_Struct:
+  EXPECT_THAT(type_table.get_members(0x101c), ::testing::IsEmpty());
+  // Forward_Declared_Struct:
+  EXPECT_THAT(type_table.get_members(0x1027), ::testing::IsEmpty());
+  // Struct_With_One_Int *:
+  EXPECT_THAT(type_table.get_members(0x102d), ::testing::IsEmpty());
+  EXPECT_THAT(type_table.get_members(T_INT4), ::testing::IsEmpty());
+}
+
+TEST(Test_CodeView, struct_members_are_accounted_in_cache_budget) {
+  Example_File file("coff/struct.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader types_section_reader = pe.find_sections_by_name(u8".debug$T").at(0);
+  CodeView_Type_Table type_table = parse_codeview_types(&types_section_reader);
+  Cache_Budget budget;
+  Cache_Budget::Cache_ID cache_id =
+      budget.add_cache("type members", [&](U64 key) -> void {
+        type_table.evict(key);
+      });
+  type_table.set_cache_budget(&budget, cache_id);
+
+  // Struct_With_Two_Ints and Struct_With_Bit_Field:
+  EXPECT_EQ(type_table.get_members(0x1020).size(), 2);
+  EXPECT_EQ(type_table.get_members(0x1025).size(), 2);
+  EXPECT_TRUE(budget.contains_entry(cache_id, 0x1020));
+  EXPECT_TRUE(budget.contains_entry(cache_id, 0x1025));
+  EXPECT_GE(budget.cache_byte_size(cache_id),
+            4 * sizeof(CodeView_Type_Member));
+
+  // Touch the type entry index and Struct_With_Two_Ints so
+  // Struct_With_Bit_Field is evicted first.
+  type_table.get_type(0x1020);
+  type_table.get_members(0x1020);
+  budget.set_max_bytes(budget.cache_byte_size(cache_id) - 1);
+  EXPECT_TRUE(budget.contains_entry(cache_id, 0x1020));
+  EXPECT_FALSE(budget.contains_entry(cache_id, 0x1025));
+
+  budget.set_max_bytes(Cache_Budget::unlimited);
+  std::span<const CodeView_Type_Member> members =
+      type_table.get_members(0x1025);
+  ASSERT_EQ(members.size(), 2);
+  EXPECT_EQ(members[0].name, u8"b0");
+  EXPECT_EQ(members[1].name, u8"b12");
+  EXPECT_TRUE(budget.contains_entry(cache_id, 0x1025));
+}
+
+TEST(Test_CodeView, type_entry_index_is_evicted_and_rebuilt) {
+  Example_File file("coff/struct.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader types_section_reader = pe.find_sections_by_name(u8".debug$T").at(0);
+  CodeView_Type_Table type_table = parse_codeview_types(&types_section_reader);
+  std::vector<U64> type_entry_offsets = type_table.type_entry_offsets_;
+  Cache_Budget budget;
+  Cache_Budget::Cache_ID cache_id =
+      budget.add_cache("type table", [&](U64 key) -> void {
+        type_table.evict(key);
+      });
+  type_table.set_cache_budget(&budget, cache_id);
+  EXPECT_TRUE(budget.contains_entry(
+      cache_id, CodeView_Type_Table::type_entry_index_cache_key));
+  EXPECT_GE(budget.cache_byte_size(cache_id),
+            type_entry_offsets.size() * sizeof(U64));
+
+  budget.set_max_bytes(0);
+  EXPECT_EQ(budget.cache_byte_size(cache_id), 0);
+  EXPECT_THAT(type_table.type_entry_offsets_, ::testing::IsEmpty());
+
+  budget.set_max_bytes(Cache_Budget::unlimited);
+  std::optional<CodeView_Type> type = type_table.get_type(0x1020);
+  ASSERT_TRUE(type.has_value());
+  EXPECT_EQ(type->name, u8"Struct_With_Two_Ints");
+  EXPECT_EQ(type_table.type_entry_offsets_, type_entry_offsets);
+  EXPECT_TRUE(budget.contains_entry(
+      cache_id, CodeView_Type_Table::type_entry_index_cache_key));
+}
+
+TEST(Test_CodeView, union_members_share_offset) {
+  Example_File file("coff/union.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  using Reader = Sub_File_Reader<Span_Reader>;
+  Reader types_section_reader = pe.find_sections_by_name(u8".debug$T").at(0);
+  CodeView_Type_Table type_table = parse_codeview_types(&types_section_reader);
+
+  // Union_With_Int_And_Double:
+  std::span<const CodeView_Type_Member> members =
+      type_table.get_members(0x1012);
+  ASSERT_EQ(members.size(), 2);
+  EXPECT_EQ(members[0].name, u8"a");
+  EXPECT_EQ(members[0].byte_offset, 0);
+  EXPECT_EQ(members[0].byte_size, 4);
+  EXPECT_EQ(members[1].name, u8"b");
+  EXPECT_EQ(members[1].byte_offset, 0);
+  EXPECT_EQ(members[1].byte_size, 8);
+}
+
+TEST(Test_CodeView, leaf_members_of_nested_structs_and_base_classes) {
+  std::vector<U8> data;
+  // 0x1000:
+  append_record(data, LF_FIELDLIST,
+                {
+                    0x0d, 0x15,              // LF_MEMBER
+                    0x03, 0x00,              // Attributes
+                    0x74, 0x00, 0x00, 0x00,  // Type (T_INT4)
+                    0x00, 0x00,              // Offset
+                    'x', 0x00,               // Name
+                    0xf1,                    // Padding
+                    0x0d, 0x15,              // LF_MEMBER
+                    0x03, 0x00,              // Attributes
+                    0x41, 0x00, 0x00, 0x00,  // Type (T_REAL64)
+                    0x08, 0x00,              // Offset
+                    'y', 0x00,               // Name
+                    0xf2, 0xf1,              // Padding
+                });
+  // 0x1001:
+  append_record(data, LF_STRUCTURE,
+                {
+                    0x02, 0x00,              // Member count
+                    0x00, 0x00,              // Properties
+                    0x00, 0x10, 0x00, 0x00,  // Field list type
+                    0x00, 0x00, 0x00, 0x00,  // Derived type
+                    0x00, 0x00, 0x00, 0x00,  // VShape type
+                    0x10, 0x00,              // Size
+                    'I', 0x00,               // Name
+                });
+  // 0x1002:
+  append_record(data, LF_FIELDLIST,
+                {
+                    0x0d, 0x15,                          // LF_MEMBER
+                    0x03, 0x00,                          // Attributes
+                    0x74, 0x00, 0x00, 0x00,              // Type (T_INT4)
+                    0x03, 0x80, 0x10, 0x00, 0x01, 0x00,  // Offset (LF_LONG)
+                    'f', 'a', 'r', 0x00,                 // Name
+                });
+  // 0x1003:
+  append_record(data, LF_FIELDLIST,
+                {
+                    0x00, 0x14,              // LF_BCLASS
+                    0x03, 0x00,              // Attributes
+                    0x01, 0x10, 0x00, 0x00,  // Type
+                    0x00, 0x00,              // Offset
+                    0x0d, 0x15,              // LF_MEMBER
+                    0x03, 0x00,              // Attributes
+                    0x01, 0x10, 0x00, 0x00,  // Type
+                    0x10, 0x00,              // Offset
+                    'i', 'n', 0x00,          // Name
+                    0xf1,                    // Padding
+                    0x04, 0x14,              // LF_INDEX
+                    0x00, 0x00,              // Padding
+                    0x02, 0x10, 0x00, 0x00,  // Continuation
+                });
+  // 0x1004:
+  append_record(data, LF_STRUCTURE,
+                {
+                    0x03, 0x00,                          // Member count
+                    0x00, 0x00,                          // Properties
+                    0x03, 0x10, 0x00, 0x00,              // Field list type
+                    0x00, 0x00, 0x00, 0x00,              // Derived type
+                    0x00, 0x00, 0x00, 0x00,              // VShape type
+                    0x03, 0x80, 0x14, 0x00, 0x01, 0x00,  // Size (LF_LONG)
+                    'O', 0x00,                           // Name
+                });
+  // 0x1005:
+  append_record(data, LF_MODIFIER,
+                {
+                    0x04, 0x10, 0x00, 0x00,  // Type
+                    0x01, 0x00,              // Modifiers (const)
+                });
+  Span_Reader reader(data);
+  CodeView_Type_Table type_table =
+      parse_codeview_types_without_header(reader, 0, fallback_logger);
+
+  std::span<const CodeView_Type_Member> members =
+      type_table.get_members(0x1004);
+  ASSERT_EQ(members.size(), 3);
+  EXPECT_EQ(members[0].name, u8"I");
+  EXPECT_TRUE(members[0].is_base_class);
+  EXPECT_EQ(members[0].byte_size, 0x10);
+  EXPECT_EQ(members[1].name, u8"in");
+  EXPECT_EQ(members[1].byte_offset, 0x10);
+  EXPECT_EQ(members[2].name, u8"far");
+  EXPECT_EQ(members[2].byte_offset, 0x10010);
+
+  struct Leaf {
+    std::u8string name;
+    U64 byte_offset;
+    U64 byte_size;
+
+    bool operator==(const Leaf&) const = default;
+  };
+  std::vector<Leaf> leaves;
+  std::vector<CodeView_Type_Member> leaf_members;
+  // The const modifier has the same members.
+  get_codeview_leaf_members(type_table, 0x1005, leaf_members);
+  for (const CodeView_Type_Member& member : leaf_members) {
+    leaves.push_back(Leaf{member.name, member.byte_offset, member.byte_size});
+  }
+  EXPECT_THAT(leaves, ::testing::ElementsAreArray({
+                          Leaf{u8"x", 0x00, 4},
+                          Leaf{u8"y", 0x08, 8},
+                          Leaf{u8"in.x", 0x10, 4},
+                          Leaf{u8"in.y", 0x18, 8},
+                          Leaf{u8"far", 0x10010, 4},
+                      }));
+
+  // Members evicted while their type is being flattened are decoded again.
+  type_table = parse_codeview_types_without_header(reader, 0, fallback_logger);
+  Cache_Budget budget(/*max_bytes=*/1);
+  Cache_Budget::Cache_ID cache_id =
+      budget.add_cache("type members", [&](U64 key) -> void {
+        type_table.evict(key);
+      });
+  type_table.set_cache_budget(&budget, cache_id);
+  leaves.clear();
+  leaf_members.clear();
+  get_codeview_leaf_members(type_table, 0x1005, leaf_members);
+  for (const CodeView_Type_Member& member : leaf_members) {
+    leaves.push_back(Leaf{member.name, member.byte_offset, member.byte_size});
+  }
+  EXPECT_THAT(leaves, ::testing::ElementsAreArray({
+                          Leaf{u8"x", 0x00, 4},
+                          Leaf{u8"y", 0x08, 8},
+                          Leaf{u8"in.x", 0x10, 4},
+                          Leaf{u8"in.y", 0x18, 8},
+                          Leaf{u8"far", 0x10010, 4},
+                      }));
+  EXPECT_GT(budget.get_stats().at(0).eviction_count, 0);
+}
+
 TEST(
     Test_CodeView,
     find_all_codeview_functions_doesnt_crash_if_byte_after_last_entry_is_not_4_byte_aligned) {
@@ -40,5 +40,51 @@ TEST(Test_COFF, small_obj_sections) {
   EXPECT_EQ(pe.sections[4].data_size, 0x28);
   EXPECT_EQ(pe.sections[4].data_file_offset, 0x386);
 }
+
+TEST(Test_COFF, multiple_functions_obj_relocations) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File pe = parse_pe_file(&file.reader());
+
+  // Data according to: objdump -r
+  std::span<const COFF_Relocation> text_relocations =
+      pe.get_section_relocations(2);  // .text$mn
+  ASSERT_EQ(text_relocations.size(), 3);
+  EXPECT_EQ(text_relocations[0].offset, 0x25);
+  EXPECT_EQ(text_relocations[0].type, IMAGE_REL_AMD64_REL32);
+  EXPECT_EQ(text_relocations[1].offset, 0x2a);
+  EXPECT_EQ(text_relocations[2].offset, 0x45);
+
+  EXPECT_EQ(pe.get_section_relocations(1).size(), 16);  // .debug$S
+  EXPECT_EQ(pe.get_section_relocations(3).size(), 0);   // .xdata
+  EXPECT_EQ(pe.get_section_relocations(99).size(), 0);
+
+  const COFF_Relocation* relocation = pe.find_relocation(1, 0x180);
+  ASSERT_NE(relocation, nullptr);
+  EXPECT_EQ(relocation->type, IMAGE_REL_AMD64_SECREL);
+  EXPECT_EQ(pe.find_relocation(1, 0x181), nullptr);
+
+  std::span<const COFF_Relocation> range =
+      pe.find_relocations_in_range(1, 0x180, 0x1b8);
+  ASSERT_EQ(range.size(), 3);
+  EXPECT_EQ(range[0].offset, 0x180);
+  EXPECT_EQ(range[2].offset, 0x1b4);
+}
+
+TEST(Test_COFF, multiple_functions_obj_symbols) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File pe = parse_pe_file(&file.reader());
+
+  // Data according to: objdump -t
+  EXPECT_EQ(pe.symbol_count, 27);
+  COFF_Symbol symbol = pe.get_symbol(10);
+  EXPECT_EQ(symbol.name, u8"?b@@YAXXZ");
+  EXPECT_EQ(symbol.value, 0x10);
+  EXPECT_EQ(symbol.section_index, 2);  // .text$mn
+  EXPECT_EQ(symbol.storage_class, 2);  // IMAGE_SYM_CLASS_EXTERNAL
+
+  symbol = pe.get_symbol(0);
+  EXPECT_EQ(symbol.name, u8"@comp.id");
+  EXPECT_EQ(symbol.section_index, static_cast<U32>(-1));
+}
 }
 }
@@ -0,0 +1,212 @@
+#include <cppstacksize/dwarf.h>
+#include <cppstacksize/elf.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/reader.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <vector>
+
+using ::testing::ElementsAre;
+
+namespace cppstacksize {
+namespace {
+const DWARF_Function* find_function(std::span<const DWARF_Function> functions,
+                                    std::u8string_view name) {
+  for (const DWARF_Function& func : functions) {
+    if (func.name == name) {
+      return &func;
+    }
+  }
+  return nullptr;
+}
+
+TEST(Test_DWARF, leb128) {
+  static constexpr U8 data[] = {
+      0x02,              // 2
+      0x7f,              // 127 or -1
+      0x80, 0x01,        // 128 or 128
+      0xe5, 0x8e, 0x26,  // 624485
+      0xc0, 0xbb, 0x78,  // -123456
+  };
+  Span_Reader reader(data);
+
+  U64 offset = 0;
+  EXPECT_EQ(read_uleb128(reader, &offset), 2);
+  EXPECT_EQ(offset, 1);
+  EXPECT_EQ(read_uleb128(reader, &offset), 127);
+  EXPECT_EQ(read_uleb128(reader, &offset), 128);
+  EXPECT_EQ(read_uleb128(reader, &offset), 624485);
+  EXPECT_EQ(offset, 7);
+
+  offset = 1;
+  EXPECT_EQ(read_sleb128(reader, &offset), -1);
+  EXPECT_EQ(read_sleb128(reader, &offset), 128);
+  offset = 7;
+  EXPECT_EQ(read_sleb128(reader, &offset), -123456);
+  EXPECT_EQ(offset, 10);
+}
+
+TEST(Test_DWARF, unit_headers_in_example_so) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+  DWARF_Sections sections = find_dwarf_sections(elf);
+  std::vector<DWARF_Unit> units =
+      parse_dwarf_unit_headers(sections.debug_info);
+  ASSERT_EQ(units.size(), 1);
+  EXPECT_EQ(units[0].header_offset, 0);
+  EXPECT_EQ(units[0].version, 5);
+  EXPECT_EQ(units[0].unit_type, DW_UT_compile);
+  EXPECT_EQ(units[0].address_size, 8);
+  EXPECT_EQ(units[0].offset_size, 4);
+  EXPECT_EQ(units[0].end_offset, sections.debug_info.size());
+}
+
+TEST(Test_DWARF, functions_in_example_so) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+  std::vector<DWARF_Function> functions;
+  find_all_dwarf_functions(elf, functions, /*line_tables=*/nullptr);
+
+  std::vector<std::u8string> names;
+  for (const DWARF_Function& func : functions) {
+    names.push_back(func.name);
+  }
+  // Data according to: llvm-dwarfdump --debug-info
+  EXPECT_THAT(names, ElementsAre(u8"method", u8"big_frame", u8"caller",
+                                 u8"callee"));
+
+  const DWARF_Function* callee = find_function(functions, u8"callee");
+  ASSERT_NE(callee, nullptr);
+  EXPECT_EQ(callee->code_address, 0x1120);
+  EXPECT_EQ(callee->code_size, 0xb);
+  const DWARF_Function* method = find_function(functions, u8"method");
+  ASSERT_NE(method, nullptr);
+  EXPECT_EQ(method->code_address, 0x1170);
+  EXPECT_EQ(method->code_size, 0x1e);
+}
+
+TEST(Test_DWARF, stack_sizes_from_debug_frame_and_eh_frame) {
+  for (const char* path : {"elf/example.so", "elf/example-eh-frame.so"}) {
+    SCOPED_TRACE(path);
+    Example_File file(path);
+    ELF_File elf = parse_elf_file(&file.reader());
+    std::vector<DWARF_Function> functions;
+    find_all_dwarf_functions(elf, functions, /*line_tables=*/nullptr);
+
+    // Data according to: objdump -d
+    const DWARF_Function* callee = find_function(functions, u8"callee");
+    ASSERT_NE(callee, nullptr);
+    EXPECT_EQ(callee->self_stack_size, 0);
+    const DWARF_Function* caller = find_function(functions, u8"caller");
+    ASSERT_NE(caller, nullptr);
+    EXPECT_EQ(caller->self_stack_size, 8) << "push %rbx";
+    const DWARF_Function* big_frame = find_function(functions, u8"big_frame");
+    ASSERT_NE(big_frame, nullptr);
+    EXPECT_EQ(big_frame->self_stack_size, 8 + 0x70)
+        << "push %rbx; sub $0x70, %rsp";
+    const DWARF_Function* method = find_function(functions, u8"method");
+    ASSERT_NE(method, nullptr);
+    EXPECT_EQ(method->self_stack_size, 8 + 0x20)
+        << "push %rbx; sub $0x20, %rsp";
+  }
+}
+
+TEST(Test_DWARF, function_with_ranges_uses_entry_range) {
+  for (const char* path :
+       {"elf/example-ranges.so", "elf/example-ranges-dwarf-4.so"}) {
+    SCOPED_TRACE(path);
+    Example_File file(path);
+    ELF_File elf = parse_elf_file(&file.reader());
+    std::vector<DWARF_Function> functions;
+    Capturing_Logger logger(&fallback_logger);
+    find_all_dwarf_functions(elf, functions, /*line_tables=*/nullptr, logger);
+    EXPECT_FALSE(logger.did_log_message());
+
+    // Data according to: llvm-dwarfdump --debug-info
+    const DWARF_Function* split_path = find_function(functions, u8"split_path");
+    ASSERT_NE(split_path, nullptr);
+    EXPECT_EQ(split_path->code_address, 0x1130)
+        << "split_path, not split_path.cold";
+    EXPECT_EQ(split_path->code_size, 0x24);
+    // Data according to: objdump -d
+    EXPECT_EQ(split_path->self_stack_size, 8 + 0x10)
+        << "push %rbx; sub $0x10, %rsp";
+  }
+}
+
+TEST(Test_DWARF, stack_size_of_function_with_frame_pointer) {
+  Example_File file("elf/example-ranges.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+  std::vector<DWARF_Function> functions;
+  find_all_dwarf_functions(elf, functions, /*line_tables=*/nullptr);
+  for (DWARF_Function& func : functions) {
+    func.elf_file = &elf;
+  }
+
+  // Data according to: objdump -d
+  const DWARF_Function* fixed_frame_pointer =
+      find_function(functions, u8"fixed_frame_pointer");
+  ASSERT_NE(fixed_frame_pointer, nullptr);
+  EXPECT_TRUE(fixed_frame_pointer->uses_frame_pointer);
+  EXPECT_EQ(fixed_frame_pointer->self_stack_size, 8)
+      << "push %rbp (call frame information only)";
+  EXPECT_EQ(fixed_frame_pointer->get_self_stack_size(), 8 + 0x20)
+      << "push %rbp; mov %edi, -0x20(%rbp)";
+  const DWARF_Function* frame_pointer =
+      find_function(functions, u8"frame_pointer");
+  ASSERT_NE(frame_pointer, nullptr);
+  EXPECT_TRUE(frame_pointer->uses_frame_pointer);
+  EXPECT_EQ(frame_pointer->get_self_stack_size(), 8)
+      << "push %rbp (the VLA's size is unknown)";
+  const DWARF_Function* split_path = find_function(functions, u8"split_path");
+  ASSERT_NE(split_path, nullptr);
+  EXPECT_FALSE(split_path->uses_frame_pointer);
+  EXPECT_EQ(split_path->get_self_stack_size(), split_path->self_stack_size);
+}
+
+TEST(Test_DWARF, line_numbers_in_example_so) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+  std::vector<DWARF_Function> functions;
+  DWARF_Line_Tables line_tables;
+  find_all_dwarf_functions(elf, functions, &line_tables);
+
+  const DWARF_Function* big_frame = find_function(functions, u8"big_frame");
+  ASSERT_NE(big_frame, nullptr);
+  ASSERT_FALSE(big_frame->line_tables_handle.is_null());
+  auto line_at = [&](U64 address) -> Line_Source_Info {
+    return line_tables.source_info_for_address(big_frame->line_tables_handle,
+                                               address);
+  };
+  // Data according to: objdump -dl
+  EXPECT_EQ(line_at(0x1150), Line_Source_Info{.line_number = 11});
+  EXPECT_EQ(line_at(0x115b), Line_Source_Info{.line_number = 13})
+      << "call use_buffer";
+  EXPECT_EQ(line_at(0x1169), Line_Source_Info{.line_number = 15});
+  EXPECT_EQ(line_at(0x1060 + 0x12e), Line_Source_Info::out_of_bounds());
+}
+
+TEST(Test_DWARF, function_instruction_bytes) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+  std::vector<DWARF_Function> functions;
+  find_all_dwarf_functions(elf, functions, /*line_tables=*/nullptr);
+  DWARF_Function* callee = nullptr;
+  for (DWARF_Function& func : functions) {
+    if (func.name == u8"callee") callee = &func;
+  }
+  ASSERT_NE(callee, nullptr);
+
+  EXPECT_FALSE(callee->get_instruction_bytes_reader().has_value())
+      << "no ELF file associated";
+  callee->elf_file = &elf;
+  std::optional<Sub_File_Reader<Span_Reader>> reader =
+      callee->get_instruction_bytes_reader();
+  ASSERT_TRUE(reader.has_value());
+  EXPECT_EQ(reader->size(), 0xb);
+  EXPECT_EQ(reader->u8(0xa), 0xc3) << "ret";
+}
+}
+}
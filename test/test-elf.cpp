@@ -0,0 +1,62 @@
+#include <cppstacksize/elf.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/reader.h>
+#include <gtest/gtest.h>
+
+namespace cppstacksize {
+namespace {
+TEST(Test_ELF, elf_file_sections_in_example_so) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+
+  // Data according to: readelf -S
+  ASSERT_EQ(elf.sections.size(), 32);
+  EXPECT_EQ(elf.sections[0].name, u8"");
+  EXPECT_EQ(elf.sections[10].name, u8".text");
+  EXPECT_EQ(elf.sections[10].address, 0x1060);
+  EXPECT_EQ(elf.sections[10].data_file_offset, 0x1060);
+  EXPECT_EQ(elf.sections[10].data_size, 0x12e);
+  EXPECT_EQ(elf.sections[22].name, u8".debug_info");
+  EXPECT_EQ(elf.sections[22].address, 0);
+  EXPECT_EQ(elf.sections[22].data_file_offset, 0x306f);
+  EXPECT_EQ(elf.sections[22].data_size, 0x22a);
+}
+
+TEST(Test_ELF, find_section) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+
+  const ELF_Section* text = elf.find_section_by_name(u8".text");
+  ASSERT_NE(text, nullptr);
+  EXPECT_EQ(text->address, 0x1060);
+  EXPECT_EQ(elf.find_section_by_name(u8".text.bogus"), nullptr);
+
+  EXPECT_EQ(elf.find_section_by_address(0x1120), text);
+  EXPECT_EQ(elf.find_section_by_address(0x1060 + 0x12e - 1), text);
+  EXPECT_NE(elf.find_section_by_address(0x1060 + 0x12e), text);
+}
+
+TEST(Test_ELF, reader_for_address_reads_machine_code) {
+  Example_File file("elf/example.so");
+  ELF_File elf = parse_elf_file(&file.reader());
+
+  // callee: add %esi, %edi (01 f7)
+  std::optional<Sub_File_Reader<Span_Reader>> reader =
+      elf.reader_for_address(0x1120, 0xb);
+  ASSERT_TRUE(reader.has_value());
+  EXPECT_EQ(reader->size(), 0xb);
+  EXPECT_EQ(reader->u8(0), 0x01);
+  EXPECT_EQ(reader->u8(1), 0xf7);
+  EXPECT_EQ(reader->u8(0xa), 0xc3) << "ret";
+
+  EXPECT_FALSE(elf.reader_for_address(0x1120, 0x1000).has_value())
+      << "range should extend beyond .text";
+}
+
+TEST(Test_ELF, pe_file_is_not_elf) {
+  Example_File file("pdb/example.dll");
+  EXPECT_FALSE(is_elf_file(file.reader()));
+  EXPECT_THROW(parse_elf_file(&file.reader()), ELF_Magic_Mismatch_Error);
+}
+}
+}
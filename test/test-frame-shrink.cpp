@@ -0,0 +1,304 @@
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/frame-shrink.h>
+#include <cppstacksize/project.h>
+#include <cstddef>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using namespace std::literals::string_view_literals;
+
+namespace cppstacksize {
+namespace {
+TEST(Test_Frame_Shrink, empty_function_has_no_untouched_bytes) {
+  Frame_Shrink_Report report = analyze_frame_shrink({}, {}, 0);
+  EXPECT_THAT(report.untouched_ranges, IsEmpty());
+  EXPECT_EQ(report.untouched_byte_count, 0);
+  EXPECT_EQ(report.reclaimable_byte_count, 0);
+}
+
+TEST(Test_Frame_Shrink, bytes_without_touches_are_untouched) {
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -0x10, 8),
+      Stack_Map_Touch::read(4, -0x10, 4),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, {}, 0x20);
+  EXPECT_EQ(report.frame_size, 0x20);
+  EXPECT_THAT(report.untouched_ranges,
+              ElementsAre(Stack_Byte_Range{-0x20, -0x10},
+                          Stack_Byte_Range{-0x08, 0}));
+  EXPECT_EQ(report.untouched_byte_count, 0x18);
+  EXPECT_EQ(report.reclaimable_byte_count, 0x18);
+}
+
+TEST(Test_Frame_Shrink, touches_outside_frame_are_ignored) {
+  Stack_Map_Touch touches[] = {
+      // Return address and the caller's home space.
+      Stack_Map_Touch::read(0, 0, 8),
+      Stack_Map_Touch::write(4, 0x08, 4),
+      // Straddles the frame's start.
+      Stack_Map_Touch::write(8, -0x14, 8),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, {}, 0x10);
+  EXPECT_THAT(report.untouched_ranges,
+              ElementsAre(Stack_Byte_Range{-0x0c, 0}));
+}
+
+TEST(Test_Frame_Shrink, partially_touched_slot) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x40, .byte_size = 0x40},
+  };
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -0x40, 8),
+      Stack_Map_Touch::read(10, -0x38, 8),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x40);
+  ASSERT_EQ(report.slots.size(), 1);
+  EXPECT_EQ(report.slots[0].touched_byte_count, 0x10);
+  EXPECT_EQ(report.slots[0].first_touch_offset, 0);
+  EXPECT_EQ(report.slots[0].last_touch_offset, 10);
+  EXPECT_EQ(report.untouched_byte_count, 0x30);
+}
+
+TEST(Test_Frame_Shrink, untouched_slot_is_not_live) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x20, .byte_size = 0x10},
+      {.entry_rsp_relative_address = -0x10, .byte_size = 0x10},
+  };
+  Stack_Map_Touch touches[] = {Stack_Map_Touch::write(0, -0x10, 0x10)};
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x20);
+  EXPECT_FALSE(report.slots[0].is_touched());
+  EXPECT_TRUE(report.slots[1].is_touched());
+  EXPECT_THAT(report.shareable_slot_pairs, IsEmpty());
+  EXPECT_EQ(report.reclaimable_byte_count, 0x10);
+}
+
+TEST(Test_Frame_Shrink, slots_with_disjoint_live_ranges_can_share_storage) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x30, .byte_size = 0x10},
+      {.entry_rsp_relative_address = -0x20, .byte_size = 0x10},
+      {.entry_rsp_relative_address = -0x10, .byte_size = 0x10},
+  };
+  Stack_Map_Touch touches[] = {
+      // Slot 0 is live during [0, 10].
+      Stack_Map_Touch::write(0, -0x30, 0x10),
+      Stack_Map_Touch::read(10, -0x30, 0x10),
+      // Slot 1 is live during [20, 30].
+      Stack_Map_Touch::write(20, -0x20, 0x10),
+      Stack_Map_Touch::read(30, -0x20, 0x10),
+      // Slot 2 is live during [5, 25].
+      Stack_Map_Touch::write(5, -0x10, 0x10),
+      Stack_Map_Touch::read(25, -0x10, 0x10),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x30);
+  EXPECT_THAT(report.shareable_slot_pairs, ElementsAre(std::pair(0u, 1u)));
+  EXPECT_EQ(report.untouched_byte_count, 0);
+  EXPECT_EQ(report.reclaimable_byte_count, 0x10)
+      << "slots 0 and 1 can share 0x10 bytes";
+}
+
+TEST(Test_Frame_Shrink, sharing_savings_are_limited_by_largest_slot) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x48, .byte_size = 0x40},
+      {.entry_rsp_relative_address = -0x08, .byte_size = 0x08},
+  };
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -0x48, 0x40),
+      Stack_Map_Touch::write(10, -0x08, 0x08),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x48);
+  EXPECT_THAT(report.shareable_slot_pairs, ElementsAre(std::pair(0u, 1u)));
+  EXPECT_EQ(report.reclaimable_byte_count, 0x08);
+}
+
+TEST(Test_Frame_Shrink, overlapping_slots_already_share_storage) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x10, .byte_size = 0x10},
+      {.entry_rsp_relative_address = -0x10, .byte_size = 0x08},
+  };
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -0x10, 0x10),
+      Stack_Map_Touch::write(10, -0x10, 0x08),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x10);
+  EXPECT_THAT(report.shareable_slot_pairs, IsEmpty());
+  EXPECT_EQ(report.reclaimable_byte_count, 0);
+}
+
+TEST(Test_Frame_Shrink, unknown_size_touch_covers_rest_of_slot) {
+  Stack_Slot slots[] = {
+      {.entry_rsp_relative_address = -0x30, .byte_size = 0x10},
+  };
+  Stack_Map_Touch touches[] = {
+      // lea -0x2c(%rsp), %rcx; call f
+      Stack_Map_Touch::read_or_write(0, -0x2c, static_cast<U32>(-1)),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, slots, 0x30);
+  EXPECT_EQ(report.slots[0].touched_byte_count, 0x0c);
+  EXPECT_THAT(report.untouched_ranges,
+              ElementsAre(Stack_Byte_Range{-0x30, -0x2c},
+                          Stack_Byte_Range{-0x20, 0}));
+}
+
+TEST(Test_Frame_Shrink, unknown_size_touch_outside_slot_covers_rest_of_frame) {
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::read_or_write(0, -0x18, static_cast<U32>(-1)),
+  };
+  Frame_Shrink_Report report = analyze_frame_shrink(touches, {}, 0x20);
+  EXPECT_THAT(report.untouched_ranges,
+              ElementsAre(Stack_Byte_Range{-0x20, -0x18}));
+}
+
+TEST(Test_Frame_Shrink, slot_fields_with_padding_and_unused_field) {
+  // struct { int a; double b; char c; }
+  Stack_Slot slot = {.entry_rsp_relative_address = -0x20, .byte_size = 0x18};
+  Stack_Field fields[] = {
+      {.byte_offset = 0x00, .byte_size = 4},
+      {.byte_offset = 0x08, .byte_size = 8},
+      {.byte_offset = 0x10, .byte_size = 1},
+  };
+  Stack_Map_Touch touches[] = {
+      Stack_Map_Touch::write(0, -0x20, 4),
+      Stack_Map_Touch::read(5, -0x20, 4),
+      Stack_Map_Touch::write(7, -0x10, 1),
+      // Outside the slot.
+      Stack_Map_Touch::write(9, -0x08, 8),
+  };
+  Stack_Slot_Field_Report report = analyze_slot_fields(touches, slot, fields);
+  ASSERT_EQ(report.fields.size(), 3);
+  EXPECT_EQ(report.fields[0].touched_byte_count, 4);
+  EXPECT_EQ(report.fields[0].first_touch_offset, 0);
+  EXPECT_EQ(report.fields[0].last_touch_offset, 5);
+  EXPECT_FALSE(report.fields[1].is_touched());
+  EXPECT_EQ(report.fields[2].touched_byte_count, 1);
+  EXPECT_EQ(report.fields[2].first_touch_offset, 7);
+  EXPECT_THAT(report.padding_ranges,
+              ElementsAre(Stack_Byte_Range{-0x1c, -0x18},
+                          Stack_Byte_Range{-0x0f, -0x08}));
+  EXPECT_EQ(report.padding_byte_count, 11);
+}
+
+TEST(Test_Frame_Shrink, unknown_size_touch_covers_rest_of_slot_fields) {
+  Stack_Slot slot = {.entry_rsp_relative_address = -0x20, .byte_size = 0x10};
+  Stack_Field fields[] = {
+      {.byte_offset = 0x00, .byte_size = 8},
+      {.byte_offset = 0x08, .byte_size = 8},
+  };
+  Stack_Map_Touch touches[] = {
+      // lea -0x1c(%rsp), %rcx; call f
+      Stack_Map_Touch::read_or_write(3, -0x1c, static_cast<U32>(-1)),
+  };
+  Stack_Slot_Field_Report report = analyze_slot_fields(touches, slot, fields);
+  EXPECT_EQ(report.fields[0].touched_byte_count, 4);
+  EXPECT_EQ(report.fields[1].touched_byte_count, 8);
+  EXPECT_THAT(report.padding_ranges, IsEmpty());
+}
+
+const Frame_Shrink_Function_Report* find_report(
+    const std::vector<Frame_Shrink_Function_Report>& reports,
+    const CodeView_Function_Table& functions, std::u8string_view name) {
+  for (const Frame_Shrink_Function_Report& report : reports) {
+    if (functions.name(report.function_index) == name) {
+      return &report;
+    }
+  }
+  return nullptr;
+}
+
+TEST(Test_Frame_Shrink, dll_function_with_large_local) {
+  for (unsigned thread_count : {1u, 4u}) {
+    SCOPED_TRACE(thread_count);
+    Project project;
+    project.add_file("temporary.pdb",
+                     Example_File("pdb-pe/temporary.pdb").loaded_file());
+    project.add_file("temporary.dll",
+                     Example_File("pdb-pe/temporary.dll").loaded_file());
+    const CodeView_Function_Table& functions = project.get_all_functions();
+    std::vector<Frame_Shrink_Function_Report> reports =
+        rank_frame_shrink_opportunities(functions, project.get_type_table(),
+                                        fallback_logger, thread_count);
+
+    const Frame_Shrink_Function_Report* report =
+        find_report(reports, functions, u8"local_variable"sv);
+    ASSERT_NE(report, nullptr);
+    // push %rdi; sub $0x430, %rsp
+    EXPECT_EQ(report->report.frame_size, 0x438);
+    // The local (char s[0x424]) is fully initialized, but the compiler
+    // padded it to keep the stack aligned.
+    EXPECT_THAT(report->report.untouched_ranges,
+                ElementsAre(Stack_Byte_Range{-0x14, -0x08}));
+    ASSERT_EQ(report->report.slots.size(), 1);
+    EXPECT_EQ(report->report.slots[0].touched_byte_count, 0x424);
+    EXPECT_EQ(report->report.reclaimable_byte_count, 12);
+    EXPECT_EQ(report->call_depth, 1);
+    EXPECT_EQ(report->weighted_reclaimable_byte_count, 12);
+    EXPECT_FALSE(report->is_dynamic);
+    EXPECT_EQ(report->dynamic_allocation_bound, 0);
+  }
+}
+
+TEST(Test_Frame_Shrink, obj_function_uses_frame_proc_frame_size) {
+  Project project;
+  project.add_file("temporary.obj",
+                   Example_File("pdb-pe/temporary.obj").loaded_file());
+  const CodeView_Function_Table& functions = project.get_all_functions();
+  std::vector<Frame_Shrink_Function_Report> reports =
+      rank_frame_shrink_opportunities(functions, project.get_type_table());
+
+  const Frame_Shrink_Function_Report* report =
+      find_report(reports, functions, u8"local_variable"sv);
+  ASSERT_NE(report, nullptr);
+  // push %rdi; sub $0x430, %rsp
+  EXPECT_EQ(report->report.frame_size, 0x438);
+  EXPECT_EQ(report->report.slots.size(), 1)
+      << "the local should not be mistaken for a parameter";
+}
+
+TEST(Test_Frame_Shrink, elf_function_uses_call_frame_information_frame_size) {
+  Project project;
+  project.add_file("example.so", Example_File("elf/example.so").loaded_file());
+  const CodeView_Function_Table& functions = project.get_all_functions();
+  std::vector<Frame_Shrink_Function_Report> reports =
+      rank_frame_shrink_opportunities(functions, project.get_type_table());
+
+  const Frame_Shrink_Function_Report* report =
+      find_report(reports, functions, u8"big_frame"sv);
+  ASSERT_NE(report, nullptr);
+  // push %rbx; sub $0x70, %rsp
+  EXPECT_EQ(report->report.frame_size, 0x78);
+  EXPECT_TRUE(report->report.slots.empty());
+}
+
+TEST(Test_Frame_Shrink, callees_are_deeper_than_callers) {
+  Project project;
+  project.add_file("example.pdb",
+                   Example_File("pdb/example.pdb").loaded_file());
+  project.add_file("example.dll",
+                   Example_File("pdb/example.dll").loaded_file());
+  const CodeView_Function_Table& functions = project.get_all_functions();
+  std::vector<Frame_Shrink_Function_Report> reports =
+      rank_frame_shrink_opportunities(functions, project.get_type_table());
+
+  const Frame_Shrink_Function_Report* caller =
+      find_report(reports, functions, u8"caller"sv);
+  const Frame_Shrink_Function_Report* callee =
+      find_report(reports, functions, u8"callee"sv);
+  ASSERT_NE(caller, nullptr);
+  ASSERT_NE(callee, nullptr);
+  EXPECT_EQ(caller->report.frame_size, 0x48);
+  EXPECT_EQ(caller->call_depth, 1);
+  EXPECT_EQ(callee->call_depth, 2);
+
+  for (std::size_t i = 1; i < reports.size(); ++i) {
+    EXPECT_GE(reports[i - 1].weighted_reclaimable_byte_count,
+              reports[i].weighted_reclaimable_byte_count);
+  }
+}
+}
+}
@@ -0,0 +1,236 @@
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/file.h>
+#include <cppstacksize/function-address-index.h>
+#include <cppstacksize/pe.h>
+#include <cppstacksize/project.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <gtest/gtest.h>
+#include <optional>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+class Test_Function_Address_Index : public ::testing::Test {
+ protected:
+  CodeView_Function make_function(U32 section_index, U32 code_offset,
+                                  U32 code_size) {
+    return this->make_function_in_file(&this->empty_reader_, section_index,
+                                       code_offset, code_size);
+  }
+
+  CodeView_Function make_function_in_file(const Span_Reader* file,
+                                          U32 section_index, U32 code_offset,
+                                          U32 code_size) {
+    return CodeView_Function{
+        .name = u8"",
+        .reader = Sub_File_Reader<Span_Reader>(file, 0, 0),
+        .byte_offset = 0,
+        .code_section_index = section_index,
+        .code_offset = code_offset,
+        .code_size = code_size,
+        .has_func_id_type = false,
+        .type_id = 0,
+    };
+  }
+
+  // The file of functions made by make_function.
+  const void* code_file() const { return this->file_bytes_; }
+
+ private:
+  U8 file_bytes_[1] = {};
+  Span_Reader empty_reader_ = Span_Reader(std::span<const U8>(file_bytes_));
+};
+
+TEST_F(Test_Function_Address_Index, find_function_containing_address) {
+  std::vector<CodeView_Function> functions = {
+      make_function(0, 0x20, 0x10),  // #0
+      make_function(0, 0x00, 0x10),  // #1
+      make_function(1, 0x00, 0x08),  // #2
+      make_function(0, 0x10, 0x08),  // #3
+  };
+  Function_Address_Index index;
+  index.build(functions);
+  ASSERT_EQ(index.entries().size(), 4);
+
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x00), 1);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x0f), 1);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x10), 3);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x17), 3);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x18),
+            std::nullopt);  // Gap.
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x2f), 0);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x30), std::nullopt);
+  EXPECT_EQ(index.find_function_index(code_file(), 1, 0x00), 2);
+  EXPECT_EQ(index.find_function_index(code_file(), 1, 0x08), std::nullopt);
+  EXPECT_EQ(index.find_function_index(code_file(), 2, 0x00), std::nullopt);
+}
+
+TEST_F(Test_Function_Address_Index, folded_functions_prefer_lowest_index) {
+  std::vector<CodeView_Function> functions = {
+      make_function(0, 0x40, 0x10),  // #0
+      make_function(0, 0x00, 0x10),  // #1
+      make_function(0, 0x00, 0x10),  // #2
+  };
+  Function_Address_Index index;
+  index.build(functions);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x08), 1);
+}
+
+TEST_F(Test_Function_Address_Index, files_do_not_share_addresses) {
+  U8 other_file_bytes[1] = {};
+  Span_Reader other_file = Span_Reader(std::span<const U8>(other_file_bytes));
+  std::vector<CodeView_Function> functions = {
+      make_function(0, 0x00, 0x10),                       // #0
+      make_function_in_file(&other_file, 0, 0x00, 0x20),  // #1
+      make_function(0, 0x10, 0x10),                       // #2
+  };
+  Function_Address_Index index;
+  index.build(functions);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x08), 0);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x18), 2);
+  EXPECT_EQ(index.find_function_index(other_file_bytes, 0, 0x08), 1);
+  EXPECT_EQ(index.find_function_index(other_file_bytes, 0, 0x18), 1);
+  EXPECT_EQ(index.find_function_index(nullptr, 0, 0x08), std::nullopt);
+
+  std::span<const Function_Address_Index::Entry> entries =
+      index.find_functions_in_range(other_file_bytes, 0, 0x00, 0x100);
+  ASSERT_EQ(entries.size(), 1);
+  EXPECT_EQ(entries[0].function_index, 1);
+}
+
+TEST_F(Test_Function_Address_Index, functions_without_code_are_not_indexed) {
+  std::vector<CodeView_Function> functions = {
+      make_function(0, 0x00, static_cast<U32>(-1)),
+      make_function(static_cast<U32>(-1), 0x00, 0x10),
+  };
+  Function_Address_Index index;
+  index.build(functions);
+  EXPECT_EQ(index.entries().size(), 0);
+  EXPECT_EQ(index.find_function_index(code_file(), 0, 0x00), std::nullopt);
+}
+
+TEST_F(Test_Function_Address_Index, range_query) {
+  std::vector<CodeView_Function> functions = {
+      make_function(0, 0x00, 0x10),  // #0
+      make_function(0, 0x10, 0x10),  // #1
+      make_function(0, 0x20, 0x10),  // #2
+      make_function(0, 0x40, 0x10),  // #3
+      make_function(1, 0x00, 0x10),  // #4
+  };
+  Function_Address_Index index;
+  index.build(functions);
+
+  auto function_indexes = [&](U32 section_index, U32 begin,
+                              U32 end) -> std::vector<U32> {
+    std::vector<U32> result;
+    for (const Function_Address_Index::Entry& entry :
+         index.find_functions_in_range(code_file(), section_index, begin,
+                                       end)) {
+      result.push_back(entry.function_index);
+    }
+    return result;
+  };
+  EXPECT_EQ(function_indexes(0, 0x00, 0x50), (std::vector<U32>{0, 1, 2, 3}));
+  EXPECT_EQ(function_indexes(0, 0x18, 0x21), (std::vector<U32>{1, 2}));
+  EXPECT_EQ(function_indexes(0, 0x30, 0x40), (std::vector<U32>{}));
+  EXPECT_EQ(function_indexes(0, 0x3f, 0x41), (std::vector<U32>{3}));
+  EXPECT_EQ(function_indexes(0, 0x08, 0x08), (std::vector<U32>{}));
+  EXPECT_EQ(function_indexes(1, 0x00, 0x100), (std::vector<U32>{4}));
+}
+
+TEST_F(Test_Function_Address_Index, obj_functions_use_relocated_addresses) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  Sub_File_Reader<Span_Reader> section_reader =
+      pe.find_sections_by_name(u8".debug$S").at(0);
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  for (CodeView_Function& func : functions) {
+    func.pe_file = &pe;
+  }
+
+  Function_Address_Index index;
+  index.build(functions);
+  // Data according to: objdump -t
+  std::optional<U32> function_index =
+      index.find_function_index(file.data().data(), 2, 0x25);
+  ASSERT_TRUE(function_index.has_value());
+  EXPECT_EQ(functions[*function_index].name, u8"c");
+  function_index = index.find_function_index(file.data().data(), 2, 0x40);
+  ASSERT_TRUE(function_index.has_value());
+  EXPECT_EQ(functions[*function_index].name, u8"d");
+}
+
+TEST_F(Test_Function_Address_Index, table_uses_relocated_addresses) {
+  Example_File file("coff/multiple-functions.obj");
+  PE_File<Span_Reader> pe = parse_pe_file(&file.reader());
+  Sub_File_Reader<Span_Reader> section_reader =
+      pe.find_sections_by_name(u8".debug$S").at(0);
+  std::vector<CodeView_Function> functions;
+  find_all_codeview_functions(&section_reader, functions);
+  CodeView_Function_Table table;
+  table.append(functions);
+  table.update_module_fields(
+      0, table.size(),
+      [&](CodeView_Function_Table::Module_Fields& fields) -> void {
+        fields.pe_file = &pe;
+      });
+
+  Function_Address_Index index;
+  index.build(table);
+  // Data according to: objdump -t
+  std::optional<U32> function_index =
+      index.find_function_index(file.data().data(), 2, 0x25);
+  ASSERT_TRUE(function_index.has_value());
+  EXPECT_EQ(table.name(*function_index), u8"c");
+  function_index = index.find_function_index(file.data().data(), 2, 0x40);
+  ASSERT_TRUE(function_index.has_value());
+  EXPECT_EQ(table.name(*function_index), u8"d");
+}
+
+TEST(Test_Function_Address_Index_Project, find_function_by_address) {
+  Synthetic_PDB_Options options = {
+      .module_count = 4,
+      .functions_per_module = 100,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+
+  // See make_synthetic_pdb: functions are laid out back-to-back, 0x40 bytes
+  // each.
+  std::optional<CodeView_Function> func =
+      project.find_function_by_address("synthetic.pdb", 0, 123 * 0x40 + 0x3f);
+  ASSERT_TRUE(func.has_value());
+  EXPECT_EQ(func->name, u8"synthetic_function_4219");
+  EXPECT_FALSE(project.find_function_by_address("synthetic.pdb", 0, 400 * 0x40)
+                   .has_value());
+  EXPECT_FALSE(project.find_function_by_address("other.pdb", 0, 123 * 0x40)
+                   .has_value());
+  EXPECT_EQ(project.get_function_address_index().entries().size(), 400);
+}
+
+TEST(Test_Function_Address_Index_Project, pdb_files_do_not_share_addresses) {
+  std::vector<U8> first_pdb = make_synthetic_pdb(Synthetic_PDB_Options{});
+  std::vector<U8> second_pdb = make_synthetic_pdb(Synthetic_PDB_Options{});
+  Project project;
+  project.add_file("first.pdb", Loaded_File::from_bytes(first_pdb));
+  project.add_file("second.pdb", Loaded_File::from_bytes(second_pdb));
+  const CodeView_Function_Table& functions = project.get_all_functions();
+  ASSERT_EQ(functions.size(), 2);
+  ASSERT_NE(functions.code_file(0), functions.code_file(1));
+
+  // Both PDB files have a function at section 1, offset 0.
+  std::optional<CodeView_Function> first_func =
+      project.find_function_by_address("first.pdb", 0, 0);
+  ASSERT_TRUE(first_func.has_value());
+  EXPECT_EQ(first_func->code_file(), functions.code_file(0));
+  std::optional<CodeView_Function> second_func =
+      project.find_function_by_address("second.pdb", 0, 0);
+  ASSERT_TRUE(second_func.has_value());
+  EXPECT_EQ(second_func->code_file(), functions.code_file(1));
+}
+}
+}
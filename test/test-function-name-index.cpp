@@ -0,0 +1,152 @@
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/file.h>
+#include <cppstacksize/function-name-index.h>
+#include <cppstacksize/project.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <gtest/gtest.h>
+#include <initializer_list>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+Function_Name_Index make_index(
+    std::initializer_list<std::u8string_view> names) {
+  Function_Name_Index index;
+  for (std::u8string_view name : names) {
+    index.add_name(name);
+  }
+  index.build();
+  return index;
+}
+
+std::vector<U32> find_matching(const Function_Name_Index& index,
+                               std::u8string_view pattern) {
+  std::vector<U32> result;
+  index.find_matching(pattern, result);
+  return result;
+}
+
+TEST(Test_Function_Name_Index, find_exact_name) {
+  Function_Name_Index index = make_index({
+      u8"main",         // #0
+      u8"helper",       // #1
+      u8"main",         // #2
+      u8"Helper",       // #3
+      u8"helper_impl",  // #4
+  });
+  EXPECT_EQ(index.size(), 5);
+
+  std::span<const U32> matches = index.find_exact(u8"main");
+  EXPECT_EQ(std::vector<U32>(matches.begin(), matches.end()),
+            (std::vector<U32>{0, 2}));
+  matches = index.find_exact(u8"helper");
+  EXPECT_EQ(std::vector<U32>(matches.begin(), matches.end()),
+            (std::vector<U32>{1}));
+  EXPECT_TRUE(index.find_exact(u8"HELPER").empty());
+  EXPECT_TRUE(index.find_exact(u8"help").empty());
+  EXPECT_TRUE(index.find_exact(u8"").empty());
+}
+
+TEST(Test_Function_Name_Index, find_substring_ignores_ascii_case) {
+  Function_Name_Index index = make_index({
+      u8"ns::Widget::draw",    // #0
+      u8"ns::widget_factory",  // #1
+      u8"ns::Gadget::draw",    // #2
+      u8"draw_WIDGETS",        // #3
+      u8"unrelated",           // #4
+  });
+  EXPECT_EQ(find_matching(index, u8"widget"), (std::vector<U32>{0, 1, 3}));
+  EXPECT_EQ(find_matching(index, u8"WIDGET"), (std::vector<U32>{0, 1, 3}));
+  EXPECT_EQ(find_matching(index, u8"::draw"), (std::vector<U32>{0, 2}));
+  EXPECT_EQ(find_matching(index, u8"gadget::draw"), (std::vector<U32>{2}));
+  EXPECT_EQ(find_matching(index, u8"nothing"), (std::vector<U32>{}));
+}
+
+TEST(Test_Function_Name_Index, find_short_substring) {
+  Function_Name_Index index = make_index({
+      u8"ab",   // #0
+      u8"xAy",  // #1
+      u8"",     // #2
+      u8"b",    // #3
+      u8"aa",   // #4
+  });
+  EXPECT_EQ(find_matching(index, u8"a"), (std::vector<U32>{0, 1, 4}));
+  EXPECT_EQ(find_matching(index, u8"AB"), (std::vector<U32>{0}));
+  EXPECT_EQ(find_matching(index, u8"b"), (std::vector<U32>{0, 3}));
+  // Matches must not span two names.
+  EXPECT_EQ(find_matching(index, u8"ya"), (std::vector<U32>{}));
+}
+
+TEST(Test_Function_Name_Index, empty_pattern_matches_everything) {
+  Function_Name_Index index = make_index({u8"a", u8"b", u8"c"});
+  EXPECT_EQ(find_matching(index, u8""), (std::vector<U32>{0, 1, 2}));
+}
+
+TEST(Test_Function_Name_Index, glob_must_match_entire_name) {
+  Function_Name_Index index = make_index({
+      u8"get_size",          // #0
+      u8"get_size_slowly",   // #1
+      u8"set_size",          // #2
+      u8"Widget::get_Size",  // #3
+      u8"get_x",             // #4
+  });
+  EXPECT_EQ(find_matching(index, u8"get_*"), (std::vector<U32>{0, 1, 4}));
+  EXPECT_EQ(find_matching(index, u8"*_size"), (std::vector<U32>{0, 2, 3}));
+  EXPECT_EQ(find_matching(index, u8"?et_size"), (std::vector<U32>{0, 2}));
+  EXPECT_EQ(find_matching(index, u8"*get_size*"),
+            (std::vector<U32>{0, 1, 3}));
+  EXPECT_EQ(find_matching(index, u8"get_?"), (std::vector<U32>{4}));
+  EXPECT_EQ(find_matching(index, u8"*"), (std::vector<U32>{0, 1, 2, 3, 4}));
+  EXPECT_EQ(find_matching(index, u8"g*t*z*"), (std::vector<U32>{0, 1}));
+}
+
+TEST(Test_Function_Name_Index, trigram_collisions_are_filtered) {
+  // '%' and '^' are not identifier characters, so they might share a trigram
+  // symbol with each other. Whether they do or not, only exact matches should
+  // be returned.
+  Function_Name_Index index = make_index({
+      u8"operator%=",  // #0
+      u8"operator^=",  // #1
+      u8"operator|=",  // #2
+  });
+  EXPECT_EQ(find_matching(index, u8"or%="), (std::vector<U32>{0}));
+  EXPECT_EQ(find_matching(index, u8"or^="), (std::vector<U32>{1}));
+  EXPECT_EQ(find_matching(index, u8"or|="), (std::vector<U32>{2}));
+  EXPECT_EQ(find_matching(index, u8"%"), (std::vector<U32>{0}));
+  EXPECT_EQ(find_matching(index, u8"^="), (std::vector<U32>{1}));
+}
+
+TEST(Test_Function_Name_Index, non_ascii_names) {
+  Function_Name_Index index = make_index({
+      u8"café",  // #0
+      u8"CAFÉ",  // #1
+  });
+  EXPECT_EQ(find_matching(index, u8"fé"), (std::vector<U32>{0}));
+  EXPECT_EQ(find_matching(index, u8"caf"), (std::vector<U32>{0, 1}));
+}
+
+TEST(Test_Function_Name_Index_Project, find_functions_by_name) {
+  Synthetic_PDB_Options options = {
+      .module_count = 4,
+      .functions_per_module = 100,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  const CodeView_Function_Table& functions = project.get_all_functions();
+
+  std::vector<U32> function_indexes;
+  project.find_functions_by_name(u8"function_4219", function_indexes);
+  ASSERT_EQ(function_indexes.size(), 1);
+  EXPECT_EQ(functions.name(function_indexes[0]), u8"synthetic_function_4219");
+  EXPECT_TRUE(project.is_function_name_index_ready());
+
+  std::span<const U32> exact =
+      project.get_function_name_index().find_exact(u8"synthetic_function_4219");
+  EXPECT_EQ(std::vector<U32>(exact.begin(), exact.end()), function_indexes);
+
+  project.find_functions_by_name(u8"SYNTHETIC_*", function_indexes);
+  EXPECT_EQ(function_indexes.size(), 400);
+}
+}
+}
@@ -344,6 +344,84 @@ TEST(Test_PDB, read_dbi_stream) {
   EXPECT_EQ(dbi.modules[28].segments[0].pe_section_index, std::nullopt);
   EXPECT_EQ(dbi.modules[28].segments[0].offset, 0x0000);
   EXPECT_EQ(dbi.modules[28].segments[0].size, 0xffff);
+
+  EXPECT_EQ(dbi.global_symbol_stream_index, 40);
+  EXPECT_EQ(dbi.public_symbol_stream_index, 41);
+  EXPECT_EQ(dbi.symbol_record_stream_index, 42);
+}
+
+TEST(Test_PDB, read_dbi_substreams) {
+  Example_File file("pdb/example.pdb");
+  using Reader = PDB_Blocks_Reader<Span_Reader>;
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<Reader> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+  PDB_DBI dbi = parse_pdb_dbi_stream(streams[3]);
+
+  // Data according to: llvm-pdbutil dump -section-contribs
+  ASSERT_EQ(dbi.section_contributions.size(), 201);
+  const PDB_DBI_Section_Contribution& first = dbi.section_contributions[0];
+  EXPECT_EQ(first.pe_section_index, 0);
+  EXPECT_EQ(first.offset, 0);
+  EXPECT_EQ(first.size, 160);
+  EXPECT_EQ(first.module_index, 0);
+  EXPECT_EQ(first.characteristics, 0x60502020);
+
+  EXPECT_EQ(dbi.find_module_index(0, 0), 0);
+  EXPECT_EQ(dbi.find_module_index(0, 159), 0);
+  EXPECT_EQ(dbi.find_module_index(0, 160), 1);
+  EXPECT_EQ(dbi.find_module_index(0, 1024 + 171), 2);
+  EXPECT_EQ(dbi.find_module_index(0, 1230), 3);
+  EXPECT_EQ(dbi.find_module_index(0, 1231), std::nullopt);  // Padding.
+  EXPECT_EQ(dbi.find_module_index(2, 192), 28);
+  EXPECT_EQ(dbi.find_module_index(2, 200), std::nullopt);
+  EXPECT_EQ(dbi.find_module_index(99, 0), std::nullopt);
+
+  // Data according to: llvm-pdbutil dump -section-map
+  ASSERT_EQ(dbi.section_map.size(), 6);
+  EXPECT_EQ(dbi.section_map[0].frame, 1);
+  EXPECT_EQ(dbi.section_map[0].offset, 0);
+  EXPECT_EQ(dbi.section_map[0].size, 3336);
+  EXPECT_EQ(dbi.section_map[1].frame, 2);
+  EXPECT_EQ(dbi.section_map[1].size, 3106);
+
+  ASSERT_EQ(dbi.source_file_count(0), 1);
+  EXPECT_EQ(dbi.source_file_path(0, 0),
+            u8"C:\\Users\\strager\\Documents\\Projects\\cppstacksize\\"
+            u8"test\\pdb\\example.cpp");
+  ASSERT_EQ(dbi.source_file_count(1), 135);
+  EXPECT_EQ(dbi.source_file_path(1, 0),
+            u8"d:\\a01\\_work\\43\\s\\src\\ExternalAPIs\\UnifiedCRT\\inc\\"
+            u8"math.h");
+  EXPECT_EQ(dbi.source_file_count(28), 0);
+  EXPECT_EQ(dbi.source_file_count(29), 0) << "out of bounds module";
+
+  // Data according to: llvm-pdbutil dump -streams
+  EXPECT_EQ(dbi.section_header_stream_index, 14);
+}
+
+TEST(Test_PDB, read_global_procedure_references) {
+  Example_File file("pdb/example.pdb");
+  using Reader = PDB_Blocks_Reader<Span_Reader>;
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<Reader> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+
+  std::vector<PDB_Procedure_Reference> references =
+      parse_pdb_global_procedure_references(streams[40], streams[42]);
+  // Data according to: llvm-pdbutil dump -globals
+  ASSERT_EQ(references.size(), 40);
+  // callee:
+  EXPECT_EQ(references[0].module_index, 0);
+  EXPECT_EQ(references[0].symbol_offset, 204);
+  // caller:
+  EXPECT_EQ(references[1].module_index, 0);
+  EXPECT_EQ(references[1].symbol_offset, 368);
+
+  for (U64 i = 1; i < references.size(); ++i) {
+    EXPECT_LE(references[i - 1].module_index, references[i].module_index)
+        << "references should be sorted by module";
+  }
 }
 
 TEST(Test_PDB, read_tpi_stream) {
@@ -379,6 +457,45 @@ TEST(Test_PDB, example_pdb_has_example_cpp_caller_and_callee_functions) {
                                   {u8"callee"sv, u8"caller"sv}));
 }
 
+TEST(Test_PDB, module_without_symbols_has_no_functions) {
+  Example_File file("pdb/example.pdb");
+  using Reader = PDB_Blocks_Reader<Span_Reader>;
+  PDB_Super_Block super_block = parse_pdb_header(file.reader());
+  std::vector<Reader> streams =
+      parse_pdb_stream_directory(&file.reader(), super_block);
+
+  for (U64 symbols_size : {0, 2, 4}) {
+    SCOPED_TRACE(symbols_size);
+    std::vector<CodeView_Function> functions;
+    find_all_codeview_functions_2(&streams[15], symbols_size, functions);
+    EXPECT_THAT(functions, ::testing::IsEmpty());
+  }
+}
+
+TEST(Test_PDB, example_pdb_functions_have_unwind_frames_from_example_dll) {
+  Example_File pdb_file("pdb/example.pdb");
+  Example_File dll_file("pdb/example.dll");
+  using Reader = PDB_Blocks_Reader<Span_Reader>;
+  PDB_Super_Block super_block = parse_pdb_header(pdb_file.reader());
+  std::vector<Reader> streams =
+      parse_pdb_stream_directory(&pdb_file.reader(), super_block);
+  PE_File pe = parse_pe_file(&dll_file.reader());
+
+  std::vector<CodeView_Function> functions =
+      find_all_codeview_functions_2(&streams[15]);
+  for (CodeView_Function& function : functions) {
+    function.pe_file = &pe;
+    const PE_Unwind_Frame* frame = function.get_unwind_frame();
+    if (function.name == u8"callee"sv) {
+      EXPECT_EQ(frame, nullptr) << "callee is a leaf function";
+    } else {
+      ASSERT_NE(frame, nullptr);
+      EXPECT_GE(frame->allocation_size, function.self_stack_size);
+      EXPECT_EQ(frame->stack_size(), 0x50);
+    }
+  }
+}
+
 TEST(Test_PDB, example_pdb_has_example_cpp_caller_variables) {
   Example_File file("pdb/example.pdb");
   using Reader = PDB_Blocks_Reader<Span_Reader>;
@@ -1,10 +1,60 @@
+#include <algorithm>
 #include <cppstacksize/example-file.h>
+#include <cppstacksize/logger.h>
 #include <cppstacksize/pe.h>
 #include <cppstacksize/reader.h>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <span>
+#include <vector>
 
 namespace cppstacksize {
 namespace {
+// Creates a minimal PE image with a .pdata section (RVA 0x1000) containing
+// pdata and an .xdata section (RVA 0x2000) containing xdata.
+std::vector<U8> make_pe_with_unwind_info(std::span<const U8> pdata,
+                                         std::span<const U8> xdata) {
+  std::vector<U8> file(0x600);
+  auto set_u16 = [&file](U64 offset, U16 value) -> void {
+    file[offset + 0] = static_cast<U8>(value >> 0);
+    file[offset + 1] = static_cast<U8>(value >> 8);
+  };
+  auto set_u32 = [&set_u16](U64 offset, U32 value) -> void {
+    set_u16(offset + 0, static_cast<U16>(value >> 0));
+    set_u16(offset + 2, static_cast<U16>(value >> 16));
+  };
+
+  set_u16(0x00, 0x5a4d);      // "MZ"
+  set_u32(0x3c, 0x40);        // PE signature offset
+  set_u32(0x40, 0x00004550);  // "PE\0\0"
+
+  U64 coff_header_offset = 0x44;
+  set_u16(coff_header_offset + 0, 0x8664);
+  set_u16(coff_header_offset + 2, 2);  // Section count.
+  // Optional header with only the first four data directories.
+  U64 optional_header_size = 112 + 4 * 8;
+  set_u16(coff_header_offset + 16, static_cast<U16>(optional_header_size));
+
+  U64 optional_header_offset = coff_header_offset + 20;
+  set_u16(optional_header_offset + 0, 0x20b);  // PE32+
+  set_u32(optional_header_offset + 112 + 24, 0x1000);
+  set_u32(optional_header_offset + 112 + 28, static_cast<U32>(pdata.size()));
+
+  auto add_section = [&](U64 index, const char* name, U32 rva,
+                         U32 file_offset, std::span<const U8> data) -> void {
+    U64 offset = optional_header_offset + optional_header_size + index * 40;
+    std::copy_n(name, std::strlen(name), &file[offset]);
+    set_u32(offset + 8, static_cast<U32>(data.size()));
+    set_u32(offset + 12, rva);
+    set_u32(offset + 16, 0x200);
+    set_u32(offset + 20, file_offset);
+    std::copy(data.begin(), data.end(), &file[file_offset]);
+  };
+  add_section(0, ".pdata", 0x1000, 0x200, pdata);
+  add_section(1, ".xdata", 0x2000, 0x400, xdata);
+  return file;
+}
+
 TEST(Test_PE, pe_file_sections_in_pdb_example_dll) {
   Example_File file("pdb/example.dll");
   PE_File pe = parse_pe_file(&file.reader());
@@ -84,5 +134,129 @@ TEST(Test_PE, corrupted_pdb_example_dll_with_invalid_pe_signature) {
     EXPECT_THROW({ parse_pe_file(&file); }, PE_Magic_Mismatch_Error);
   }
 }
+
+TEST(Test_PE, unwind_frames_in_pdb_example_dll) {
+  Example_File file("pdb/example.dll");
+  PE_File pe = parse_pe_file(&file.reader());
+  EXPECT_EQ(pe.exception_directory_rva, 0x4000);
+  EXPECT_EQ(pe.exception_directory_size, 0x18c);
+
+  // Data according to: dumpbin.exe /UNWINDINFO
+  std::span<const PE_Unwind_Frame> frames = pe.get_unwind_frames();
+  ASSERT_EQ(frames.size(), 0x18c / 12);
+
+  // caller: sub $0x48, %rsp
+  EXPECT_EQ(frames[0].begin_rva, 0x1040);
+  EXPECT_EQ(frames[0].end_rva, 0x10a0);
+  EXPECT_EQ(frames[0].unwind_info_rva, 0x2698);
+  EXPECT_EQ(frames[0].prologue_size, 8);
+  EXPECT_EQ(frames[0].allocation_size, 0x48);
+  EXPECT_EQ(frames[0].pushed_register_count, 0);
+  EXPECT_EQ(frames[0].saved_register_mask, 0);
+  EXPECT_EQ(frames[0].stack_size(), 0x50);
+
+  // push %r14; sub $0x20, %rsp; mov %rbx/%rsi/%rdi, N(%rsp)
+  EXPECT_EQ(frames[2].begin_rva, 0x10f0);
+  EXPECT_EQ(frames[2].allocation_size, 0x20);
+  EXPECT_EQ(frames[2].pushed_register_count, 1);
+  EXPECT_EQ(frames[2].saved_register_mask,
+            (1 << 3) | (1 << 6) | (1 << 7) | (1 << 14));
+  EXPECT_EQ(frames[2].stack_size(), 0x30);
+
+  // push %rbp; sub $0x5c0, %rsp; mov %rbx, 0x5d0(%rsp)
+  const PE_Unwind_Frame* large_frame = pe.find_unwind_frame(0x1900);
+  ASSERT_NE(large_frame, nullptr);
+  EXPECT_EQ(large_frame->begin_rva, 0x1854);
+  EXPECT_EQ(large_frame->allocation_size, 0x5c0);
+  EXPECT_EQ(large_frame->stack_size(), 0x5d0);
+
+  EXPECT_EQ(pe.find_unwind_frame(0x1000), nullptr) << "leaf function";
+  EXPECT_EQ(pe.find_unwind_frame(0x10a0)->begin_rva, 0x10a0);
+  EXPECT_EQ(pe.find_unwind_frame(0x109f)->begin_rva, 0x1040);
+  EXPECT_EQ(pe.find_unwind_frame(0x1206), nullptr) << "padding";
+  EXPECT_EQ(pe.find_unwind_frame(0x9000), nullptr);
+}
+
+TEST(Test_PE, unwind_frame_with_large_allocation) {
+  Example_File file("pdb-pe/temporary.dll");
+  PE_File pe = parse_pe_file(&file.reader());
+  std::span<const PE_Unwind_Frame> frames = pe.get_unwind_frames();
+  ASSERT_EQ(frames.size(), 2);
+  // push %rdi; sub $0x430, %rsp
+  EXPECT_EQ(frames[0].allocation_size, 0x430);
+  EXPECT_EQ(frames[0].pushed_register_count, 1);
+  EXPECT_EQ(frames[0].saved_register_mask, 1 << 7);
+  EXPECT_EQ(frames[0].stack_size(), 0x440);
+}
+
+TEST(Test_PE, pe_without_exception_directory_has_no_unwind_frames) {
+  Example_File file("pdb-pe/multi-obj.dll");
+  PE_File pe = parse_pe_file(&file.reader());
+  EXPECT_EQ(pe.exception_directory_size, 0);
+  EXPECT_TRUE(pe.get_unwind_frames().empty());
+}
+
+TEST(Test_PE, chained_unwind_info_includes_primary_prologue) {
+  // clang-format off
+  static constexpr U8 pdata[] = {
+      // Primary function.
+      0x00, 0x10, 0x00, 0x00,  0x10, 0x10, 0x00, 0x00,  0x00, 0x20, 0x00, 0x00,
+      // Fragment chained to the primary function.
+      0x10, 0x10, 0x00, 0x00,  0x20, 0x10, 0x00, 0x00,  0x10, 0x20, 0x00, 0x00,
+      // Chained to itself.
+      0x20, 0x10, 0x00, 0x00,  0x30, 0x10, 0x00, 0x00,  0x30, 0x20, 0x00, 0x00,
+      // Function with a frame pointer.
+      0x30, 0x10, 0x00, 0x00,  0x40, 0x10, 0x00, 0x00,  0x40, 0x20, 0x00, 0x00,
+  };
+  static constexpr U8 xdata[] = {
+      // 0x2000: push %rbp; push %rbx
+      0x01, 0x02, 0x02, 0x00,
+      0x02, 0x30,  // UWOP_PUSH_NONVOL rbx
+      0x01, 0x50,  // UWOP_PUSH_NONVOL rbp
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+      // 0x2010: sub $0x12345, %rsp
+      0x21, 0x07, 0x03, 0x00,
+      0x07, 0x11, 0x45, 0x23, 0x01, 0x00,  // UWOP_ALLOC_LARGE 0x12345
+      0x00, 0x00,
+      0x00, 0x10, 0x00, 0x00,  0x10, 0x10, 0x00, 0x00,  0x00, 0x20, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+      // 0x2030: Chained to itself.
+      0x21, 0x00, 0x00, 0x00,
+      0x20, 0x10, 0x00, 0x00,  0x30, 0x10, 0x00, 0x00,  0x30, 0x20, 0x00, 0x00,
+
+      // 0x2040: push %rbp; lea 0x20(%rsp), %rbp
+      0x01, 0x08, 0x02, 0x25,
+      0x08, 0x03,  // UWOP_SET_FPREG
+      0x01, 0x50,  // UWOP_PUSH_NONVOL rbp
+  };
+  // clang-format on
+  std::vector<U8> file_data = make_pe_with_unwind_info(pdata, xdata);
+  Span_Reader file(file_data);
+  PE_File pe = parse_pe_file(&file);
+
+  Capturing_Logger logger(&fallback_logger);
+  std::span<const PE_Unwind_Frame> frames = pe.get_unwind_frames(logger);
+  ASSERT_EQ(frames.size(), 3) << "self-chained unwind info should be skipped";
+  EXPECT_EQ(logger.logged_messages().size(), 1);
+
+  EXPECT_EQ(frames[0].begin_rva, 0x1000);
+  EXPECT_EQ(frames[0].chain_length, 0);
+  EXPECT_EQ(frames[0].stack_size(), 2 * 8 + 8);
+
+  EXPECT_EQ(frames[1].begin_rva, 0x1010);
+  EXPECT_EQ(frames[1].chain_length, 1);
+  EXPECT_EQ(frames[1].prologue_size, 7);
+  EXPECT_EQ(frames[1].allocation_size, 0x12345);
+  EXPECT_EQ(frames[1].pushed_register_count, 2);
+  EXPECT_EQ(frames[1].saved_register_mask, (1 << 3) | (1 << 5));
+  EXPECT_EQ(frames[1].stack_size(), 0x12345 + 2 * 8 + 8);
+  EXPECT_FALSE(frames[1].frame_register.has_value());
+
+  EXPECT_EQ(frames[2].begin_rva, 0x1030);
+  EXPECT_EQ(frames[2].frame_register, 5);
+  EXPECT_EQ(frames[2].stack_size(), 8 + 8);
+}
 }
 }
@@ -1,10 +1,20 @@
+#include <cppstacksize/codeview-function-table.h>
 #include <cppstacksize/codeview.h>
+#include <cppstacksize/dwarf.h>
+#include <cppstacksize/elf.h>
 #include <cppstacksize/example-file.h>
+#include <cppstacksize/file.h>
 #include <cppstacksize/line-tables.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/pdb.h>
 #include <cppstacksize/project.h>
+#include <cppstacksize/stack-usage.h>
+#include <cppstacksize/synthetic-pdb.h>
 #include <cppstacksize/util.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace cppstacksize {
@@ -16,7 +26,7 @@ TEST(Test_Project, loads_complete_obj_file) {
                    std::move(obj_file).loaded_file());
 
   // Function table should load.
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
   ASSERT_GT(funcs.size(), 0);
   EXPECT_EQ(funcs[0].name, u8"callee");
   // Type table should load.
@@ -33,7 +43,7 @@ TEST(Test_Project, loads_complete_pdb_file) {
   project.add_file("example.pdb", std::move(pdb_file).loaded_file());
 
   // Function table should load.
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
   ASSERT_GT(funcs.size(), 0);
   EXPECT_EQ(funcs[0].name, u8"callee");
   // Type tables should load.
@@ -44,6 +54,512 @@ TEST(Test_Project, loads_complete_pdb_file) {
   EXPECT_EQ(funcs[0].get_caller_stack_size(*type_table, *type_index_table), 40);
 }
 
+TEST(Test_Project, static_function_frame_does_not_change_prior_function) {
+  Example_File pdb_file("pdb/example.pdb");
+  Project project;
+  project.add_file("example.pdb", std::move(pdb_file).loaded_file());
+
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  ASSERT_GE(funcs.size(), 2);
+  // The next module's first procedure is an S_LPROC32 with its own
+  // S_FRAMEPROC. That S_FRAMEPROC should not be confused for caller's.
+  EXPECT_EQ(funcs[1].name, u8"caller");
+  // Data according to: llvm-pdbutil dump -symbols -modi=0
+  EXPECT_EQ(funcs[1].self_stack_size, 72);
+}
+
+TEST(Test_Project, pdb_global_symbols_skip_module_without_symbols) {
+  Example_File file("pdb/example.pdb");
+  std::vector<U8> bytes(file.data().begin(), file.data().end());
+  {
+    Span_Reader reader(bytes);
+    PDB_Super_Block super_block = parse_pdb_header(reader);
+    std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+        parse_pdb_stream_directory(&reader, super_block);
+    PDB_DBI dbi = parse_pdb_dbi_stream(streams[3]);
+    ASSERT_GE(dbi.modules.size(), 1);
+    // Set the first module's symbols_size to 2, which is too small for the
+    // CodeView signature.
+    U64 symbols_size_offset = dbi.modules[0].header_offset + 0x24;
+    for (U64 i = 0; i < 4; ++i) {
+      bytes[streams[3].locate(symbols_size_offset + i).file_offset] =
+          i == 0 ? 2 : 0;
+    }
+  }
+
+  Project module_project;
+  module_project.add_file("example.pdb", Loaded_File::from_bytes(bytes));
+  Project global_project;
+  global_project.set_use_pdb_global_symbols(true);
+  global_project.add_file("example.pdb", Loaded_File::from_bytes(bytes));
+
+  Capturing_Logger logger(&fallback_logger);
+  const CodeView_Function_Table& funcs =
+      global_project.get_all_functions(logger);
+  EXPECT_TRUE(logger.did_log_message());
+  EXPECT_EQ(funcs.size(), module_project.get_all_functions().size());
+}
+
+TEST(Test_Project, pdb_global_symbols_find_same_functions_as_modules) {
+  for (const char* path : {"pdb/example.pdb", "pdb-pe/multi-obj.pdb",
+                           "pdb-pe/line-numbers.pdb"}) {
+    SCOPED_TRACE(path);
+    Project module_project;
+    module_project.add_file(path, Example_File(path).loaded_file());
+    Project global_project;
+    global_project.set_use_pdb_global_symbols(true);
+    global_project.add_file(path, Example_File(path).loaded_file());
+
+    const CodeView_Function_Table& expected_funcs =
+        module_project.get_all_functions();
+    const CodeView_Function_Table& funcs = global_project.get_all_functions();
+    ASSERT_GT(expected_funcs.size(), 0);
+    ASSERT_EQ(funcs.size(), expected_funcs.size());
+    for (U64 i = 0; i < funcs.size(); ++i) {
+      SCOPED_TRACE(i);
+      EXPECT_EQ(funcs[i].name, expected_funcs[i].name);
+      EXPECT_EQ(funcs[i].byte_offset, expected_funcs[i].byte_offset);
+      EXPECT_EQ(funcs[i].code_section_index,
+                expected_funcs[i].code_section_index);
+      EXPECT_EQ(funcs[i].code_offset, expected_funcs[i].code_offset);
+      EXPECT_EQ(funcs[i].code_size, expected_funcs[i].code_size);
+      EXPECT_EQ(funcs[i].self_stack_size, expected_funcs[i].self_stack_size);
+      EXPECT_EQ(funcs[i].type_id, expected_funcs[i].type_id);
+      EXPECT_EQ(funcs[i].location().file_offset,
+                expected_funcs[i].location().file_offset);
+      EXPECT_EQ(
+          global_project.get_line_tables()->source_info_for_offset(
+              funcs[i].line_tables_handle, funcs[i].code_section_index,
+              funcs[i].code_offset),
+          module_project.get_line_tables()->source_info_for_offset(
+              expected_funcs[i].line_tables_handle,
+              expected_funcs[i].code_section_index,
+              expected_funcs[i].code_offset));
+    }
+  }
+}
+
+TEST(Test_Project, lazy_pdb_modules_find_same_functions_as_get_all_functions) {
+  for (const char* path : {"pdb/example.pdb", "pdb-pe/multi-obj.pdb",
+                           "pdb-pe/line-numbers.pdb"}) {
+    SCOPED_TRACE(path);
+    Project project;
+    project.add_file(path, Example_File(path).loaded_file());
+
+    std::vector<CodeView_Function> funcs;
+    U32 module_count = project.get_pdb_module_count();
+    ASSERT_GT(module_count, 0);
+    for (U32 i = 0; i < module_count; ++i) {
+      EXPECT_FALSE(project.is_pdb_module_loaded(i));
+    }
+    for (U32 i = 0; i < module_count; ++i) {
+      const CodeView_Function_Table& module_funcs =
+          project.get_pdb_module_functions(i);
+      EXPECT_TRUE(project.is_pdb_module_loaded(i));
+      funcs.insert(funcs.end(), module_funcs.begin(), module_funcs.end());
+    }
+
+    const CodeView_Function_Table& expected_funcs =
+        project.get_all_functions();
+    ASSERT_EQ(funcs.size(), expected_funcs.size());
+    for (U64 i = 0; i < funcs.size(); ++i) {
+      SCOPED_TRACE(i);
+      EXPECT_EQ(funcs[i].name, expected_funcs[i].name);
+      EXPECT_EQ(funcs[i].code_section_index,
+                expected_funcs[i].code_section_index);
+      EXPECT_EQ(funcs[i].code_offset, expected_funcs[i].code_offset);
+      EXPECT_EQ(funcs[i].self_stack_size, expected_funcs[i].self_stack_size);
+      EXPECT_EQ(
+          project.get_pdb_module_line_tables()->source_info_for_offset(
+              funcs[i].line_tables_handle, funcs[i].code_section_index,
+              funcs[i].code_offset),
+          project.get_line_tables()->source_info_for_offset(
+              expected_funcs[i].line_tables_handle,
+              expected_funcs[i].code_section_index,
+              expected_funcs[i].code_offset));
+    }
+  }
+}
+
+TEST(Test_Project, find_pdb_function_by_address_loads_only_one_module) {
+  Synthetic_PDB_Options options = {
+      .module_count = 4,
+      .functions_per_module = 100,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  ASSERT_EQ(project.get_pdb_module_count(), 4);
+
+  // See make_synthetic_pdb: functions are laid out back-to-back, 0x40 bytes
+  // each.
+  EXPECT_EQ(project.find_pdb_module_by_address(0, 123 * 0x40 + 0x3f), 1);
+  EXPECT_FALSE(project.is_pdb_module_loaded(1));
+  std::optional<CodeView_Function> func =
+      project.find_pdb_function_by_address(0, 123 * 0x40 + 0x3f);
+  ASSERT_TRUE(func.has_value());
+  EXPECT_EQ(func->name, u8"synthetic_function_4219");
+  EXPECT_FALSE(project.is_pdb_module_loaded(0));
+  EXPECT_TRUE(project.is_pdb_module_loaded(1));
+  EXPECT_FALSE(project.is_pdb_module_loaded(2));
+  EXPECT_FALSE(project.is_pdb_module_loaded(3));
+
+  EXPECT_EQ(project.find_pdb_module_by_address(0, 400 * 0x40), std::nullopt);
+  EXPECT_FALSE(
+      project.find_pdb_function_by_address(0, 400 * 0x40).has_value());
+  EXPECT_FALSE(project.find_pdb_function_by_address(1, 0).has_value());
+}
+
+TEST(Test_Project, pdb_module_cache_evicts_least_recently_used_modules) {
+  Synthetic_PDB_Options options = {
+      .module_count = 3,
+      .functions_per_module = 10,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+
+  std::u8string module_0_first_name =
+      project.get_pdb_module_functions(0)[0].name;
+  U64 one_module_size = project.get_pdb_module_cache_size();
+  EXPECT_GT(one_module_size, 0);
+  project.get_pdb_module_functions(1);
+  EXPECT_EQ(project.get_pdb_module_cache_size(), one_module_size * 2);
+
+  // Fits two modules but not three.
+  project.get_cache_budget().set_max_bytes(one_module_size * 2 +
+                                           one_module_size / 2);
+  project.get_pdb_module_functions(0);
+  project.get_pdb_module_functions(2);
+  EXPECT_TRUE(project.is_pdb_module_loaded(0));
+  EXPECT_FALSE(project.is_pdb_module_loaded(1)) << "least recently used";
+  EXPECT_TRUE(project.is_pdb_module_loaded(2));
+
+  project.get_cache_budget().set_max_bytes(1);
+  EXPECT_FALSE(project.is_pdb_module_loaded(0));
+  EXPECT_FALSE(project.is_pdb_module_loaded(1));
+  EXPECT_FALSE(project.is_pdb_module_loaded(2));
+  EXPECT_EQ(project.get_pdb_module_cache_size(), 0);
+
+  // Evicted modules are reloaded on demand. The requested module is kept even
+  // if it exceeds the budget.
+  const CodeView_Function_Table& funcs = project.get_pdb_module_functions(0);
+  ASSERT_EQ(funcs.size(), 10);
+  EXPECT_EQ(funcs.name(0), module_0_first_name);
+  EXPECT_TRUE(project.is_pdb_module_loaded(0));
+  EXPECT_EQ(project.get_pdb_module_cache_size(), one_module_size);
+}
+
+TEST(Test_Project, line_table_indexes_are_evicted_and_rebuilt) {
+  Example_File file("pdb-pe/line-numbers.pdb");
+  Project project;
+  project.add_file("line-numbers.pdb", std::move(file).loaded_file());
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  ASSERT_GT(funcs.size(), 0);
+  const CodeView_Function& func = funcs[0];
+  Line_Tables* line_tables = project.get_line_tables();
+  Line_Source_Info info = line_tables->source_info_for_offset(
+      func.line_tables_handle, func.code_section_index, func.code_offset);
+  EXPECT_FALSE(info.is_out_of_bounds());
+
+  Cache_Budget& budget = project.get_cache_budget();
+  U64 byte_size = budget.total_byte_size();
+  EXPECT_GT(byte_size, 0);
+  budget.set_max_bytes(0);
+  EXPECT_EQ(budget.total_byte_size(), 0);
+  EXPECT_EQ(line_tables->source_info_for_offset(func.line_tables_handle,
+                                                func.code_section_index,
+                                                func.code_offset),
+            info);
+  EXPECT_EQ(budget.total_byte_size(), byte_size);
+}
+
+TEST(Test_Project, type_members_are_evicted_and_decoded_again) {
+  Project project;
+  project.add_file("struct.obj",
+                   Example_File("coff/struct.obj").loaded_file());
+  project.get_all_functions();
+  CodeView_Type_Table* type_table = project.get_type_table();
+  ASSERT_NE(type_table, nullptr);
+  Cache_Budget& budget = project.get_cache_budget();
+  U64 byte_size_before_members = budget.total_byte_size();
+
+  // Struct_With_Two_Ints:
+  EXPECT_EQ(type_table->get_members(0x1020).size(), 2);
+  U64 byte_size = budget.total_byte_size();
+  EXPECT_GT(byte_size, byte_size_before_members);
+  budget.set_max_bytes(0);
+  EXPECT_EQ(budget.total_byte_size(), 0);
+  budget.set_max_bytes(Cache_Budget::unlimited);
+  EXPECT_EQ(type_table->get_members(0x1020).size(), 2);
+  EXPECT_EQ(budget.total_byte_size(), byte_size);
+
+  project.clear();
+  EXPECT_EQ(budget.total_byte_size(), 0);
+}
+
+TEST(Test_Project, clear_keeps_external_caches) {
+  Project project;
+  Cache_Budget& budget = project.get_cache_budget();
+  Cache_Budget::Cache_ID cache_id =
+      budget.add_cache("test", [](U64) -> void {});
+  budget.add_entry(cache_id, 1, 100);
+  project.add_file("line-numbers.pdb",
+                   Example_File("pdb-pe/line-numbers.pdb").loaded_file());
+  project.get_pdb_module_functions(0);
+  EXPECT_GT(budget.total_byte_size(), 100);
+
+  project.clear();
+  EXPECT_EQ(budget.total_byte_size(), 100);
+  EXPECT_TRUE(budget.contains_entry(cache_id, 1));
+  EXPECT_EQ(project.get_pdb_module_count(), 0);
+}
+
+// Changes the name of a function in the given module's symbol stream without
+// changing other streams.
+std::vector<U8> rename_synthetic_function_in_module(std::vector<U8> pdb,
+                                                    std::string_view name,
+                                                    char new_first_char) {
+  // NOTE(strager): The name appears in the IPI stream, then in the module's
+  // symbol stream, then in the symbol record stream. See make_synthetic_pdb.
+  std::string_view pdb_chars(reinterpret_cast<const char*>(pdb.data()),
+                             pdb.size());
+  std::size_t ipi_offset = pdb_chars.find(name);
+  EXPECT_NE(ipi_offset, pdb_chars.npos);
+  std::size_t module_offset = pdb_chars.find(name, ipi_offset + 1);
+  EXPECT_NE(module_offset, pdb_chars.npos);
+  pdb.at(module_offset) = static_cast<U8>(new_first_char);
+  return pdb;
+}
+
+TEST(Test_Project, reload_file_scans_only_changed_pdb_modules) {
+  Synthetic_PDB_Options options = {
+      .module_count = 3,
+      .functions_per_module = 5,
+      .locals_per_function = 2,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  ASSERT_EQ(project.get_all_functions().size(), 15);
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 3);
+
+  // Function #5 is the first function in module #1.
+  std::vector<U8> changed_pdb = rename_synthetic_function_in_module(
+      pdb, "synthetic_function_4101", 'X');
+  project.reload_file("synthetic.pdb", Loaded_File::from_bytes(changed_pdb));
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 3 + 1);
+  ASSERT_EQ(funcs.size(), 15);
+  EXPECT_EQ(funcs[4].name, u8"synthetic_function_4100");
+  EXPECT_EQ(funcs[5].name, u8"Xynthetic_function_4101");
+  EXPECT_EQ(funcs[10].name, u8"synthetic_function_4106");
+
+  // Reused functions should read from the new file.
+  CodeView_Type_Table* type_table = project.get_type_table();
+  ASSERT_NE(type_table, nullptr);
+  CodeView_Type_Table* type_index_table = project.get_type_index_table();
+  ASSERT_NE(type_index_table, nullptr);
+  Line_Tables* line_tables = project.get_line_tables();
+  for (U64 i : {0, 5, 14}) {
+    SCOPED_TRACE(i);
+    const CodeView_Function& func = funcs[i];
+    EXPECT_EQ(func.get_caller_stack_size(*type_table, *type_index_table), 32);
+    EXPECT_FALSE(line_tables
+                     ->source_info_for_offset(func.line_tables_handle,
+                                              func.code_section_index,
+                                              func.code_offset)
+                     .is_out_of_bounds());
+  }
+
+  project.reload_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  const CodeView_Function_Table& reloaded_funcs = project.get_all_functions();
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 3 + 1 + 1);
+  ASSERT_EQ(reloaded_funcs.size(), 15);
+  EXPECT_EQ(reloaded_funcs.name(5), u8"synthetic_function_4101");
+}
+
+TEST(Test_Project, reload_file_keeps_unchanged_lazy_pdb_modules_loaded) {
+  Synthetic_PDB_Options options = {
+      .module_count = 3,
+      .functions_per_module = 5,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+  project.get_pdb_module_functions(0);
+  project.get_pdb_module_functions(1);
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 2);
+  U64 cache_size = project.get_pdb_module_cache_size();
+
+  std::vector<U8> changed_pdb = rename_synthetic_function_in_module(
+      pdb, "synthetic_function_4101", 'X');
+  project.reload_file("synthetic.pdb", Loaded_File::from_bytes(changed_pdb));
+  ASSERT_EQ(project.get_pdb_module_count(), 3);
+  EXPECT_TRUE(project.is_pdb_module_loaded(0));
+  EXPECT_FALSE(project.is_pdb_module_loaded(1)) << "module #1 changed";
+  EXPECT_FALSE(project.is_pdb_module_loaded(2));
+  EXPECT_EQ(project.get_pdb_module_cache_size(), cache_size / 2);
+
+  const CodeView_Function_Table& funcs = project.get_pdb_module_functions(0);
+  ASSERT_EQ(funcs.size(), 5);
+  EXPECT_EQ(funcs[0].name, u8"synthetic_function_4096");
+  EXPECT_FALSE(project.get_pdb_module_line_tables()
+                   ->source_info_for_offset(funcs[0].line_tables_handle,
+                                            funcs[0].code_section_index,
+                                            funcs[0].code_offset)
+                   .is_out_of_bounds());
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 2);
+
+  const CodeView_Function_Table& module_1_funcs =
+      project.get_pdb_module_functions(1);
+  ASSERT_EQ(module_1_funcs.size(), 5);
+  EXPECT_EQ(module_1_funcs.name(0), u8"Xynthetic_function_4101");
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 3);
+}
+
+TEST(Test_Project, add_and_remove_file_keep_functions_of_other_files) {
+  Synthetic_PDB_Options options = {
+      .module_count = 2,
+      .functions_per_module = 5,
+  };
+  Project project;
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  project.add_file("a.pdb", Loaded_File::from_bytes(pdb));
+  ASSERT_EQ(project.get_all_functions().size(), 10);
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 2);
+
+  project.add_file("b.pdb", Loaded_File::from_bytes(pdb));
+  EXPECT_EQ(project.get_all_functions().size(), 20);
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 2 + 2);
+
+  EXPECT_TRUE(project.remove_file("a.pdb"));
+  EXPECT_FALSE(project.remove_file("a.pdb"));
+  EXPECT_EQ(project.get_all_functions().size(), 10);
+  EXPECT_EQ(project.get_pdb_module_scan_count(), 2 + 2);
+  EXPECT_THAT(project.get_file_names(), ::testing::ElementsAre("b.pdb"));
+}
+
+TEST(Test_Project, loads_elf_file_with_dwarf) {
+  Example_File elf_file("elf/example.so");
+  Project project;
+  project.add_file("example.so", std::move(elf_file).loaded_file());
+
+  std::span<const DWARF_Function> funcs = project.get_all_dwarf_functions();
+  ASSERT_EQ(funcs.size(), 4);
+  const DWARF_Function& big_frame = funcs[1];
+  EXPECT_EQ(big_frame.name, u8"big_frame");
+  EXPECT_EQ(big_frame.self_stack_size, 0x78);
+
+  std::optional<Sub_File_Reader<Span_Reader>> instructions =
+      big_frame.get_instruction_bytes_reader();
+  ASSERT_TRUE(instructions.has_value());
+  EXPECT_EQ(instructions->size(), big_frame.code_size);
+
+  DWARF_Line_Tables* line_tables = project.get_dwarf_line_tables();
+  EXPECT_EQ(line_tables->source_info_for_address(big_frame.line_tables_handle,
+                                                 big_frame.code_address),
+            Line_Source_Info{.line_number = 11});
+}
+
+TEST(Test_Project, lists_dwarf_functions_with_codeview_functions) {
+  Example_File pdb_file("pdb/example.pdb");
+  Example_File elf_file("elf/example.so");
+  Project project;
+  project.add_file("example.pdb", std::move(pdb_file).loaded_file());
+  project.add_file("example.so", std::move(elf_file).loaded_file());
+
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  std::span<const DWARF_Function> dwarf_funcs =
+      project.get_all_dwarf_functions();
+  ASSERT_GE(funcs.size(), dwarf_funcs.size());
+  U64 first_dwarf_index = funcs.size() - dwarf_funcs.size();
+  for (U64 i = 0; i < dwarf_funcs.size(); ++i) {
+    SCOPED_TRACE(i);
+    const DWARF_Function& dwarf_func = dwarf_funcs[i];
+    CodeView_Function func = funcs[first_dwarf_index + i];
+    EXPECT_EQ(func.name, dwarf_func.name);
+    EXPECT_EQ(func.self_stack_size, dwarf_func.self_stack_size);
+    EXPECT_EQ(func.stack_size, dwarf_func.self_stack_size + 8)
+        << "DWARF self_stack_size excludes the return address";
+    EXPECT_EQ(func.code_size, dwarf_func.code_size);
+    EXPECT_EQ(func.location().file_offset, dwarf_func.location.file_offset);
+    EXPECT_FALSE(func.get_frame_proc().has_value());
+    EXPECT_TRUE(func.get_locals(func.byte_offset).empty());
+  }
+
+  // Data according to: readelf --sections
+  CodeView_Function big_frame = funcs[first_dwarf_index + 1];
+  EXPECT_EQ(big_frame.name, u8"big_frame");
+  EXPECT_EQ(big_frame.self_stack_size, 0x78);
+  Example_File sections_file("elf/example.so");
+  ELF_File elf = parse_elf_file(&sections_file.reader());
+  ASSERT_LT(big_frame.code_section_index, elf.sections.size());
+  EXPECT_EQ(elf.sections[big_frame.code_section_index].name, u8".text");
+  EXPECT_EQ(elf.sections[big_frame.code_section_index].address +
+                big_frame.code_offset,
+            dwarf_funcs[1].code_address);
+
+  std::optional<Sub_File_Reader<Span_Reader>> instructions =
+      big_frame.get_instruction_bytes_reader();
+  std::optional<Sub_File_Reader<Span_Reader>> dwarf_instructions =
+      dwarf_funcs[1].get_instruction_bytes_reader();
+  ASSERT_TRUE(instructions.has_value());
+  ASSERT_TRUE(dwarf_instructions.has_value());
+  EXPECT_EQ(instructions->base_reader(), dwarf_instructions->base_reader());
+  EXPECT_EQ(instructions->sub_file_offset(),
+            dwarf_instructions->sub_file_offset());
+  EXPECT_EQ(instructions->size(), dwarf_instructions->size());
+}
+
+TEST(Test_Project, checks_stack_usage_file_against_machine_code) {
+  Example_File elf_file("elf/example.so");
+  Project project;
+  project.add_file("example.so", std::move(elf_file).loaded_file());
+  std::vector<std::string> su_paths = {
+      Example_File::full_path("elf/example.su")};
+  project.add_stack_usage_files(su_paths);
+
+  std::span<const DWARF_Function> dwarf_funcs =
+      project.get_all_dwarf_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  ASSERT_EQ(funcs.size(), dwarf_funcs.size());
+  CodeView_Function big_frame = funcs[1];
+  ASSERT_EQ(big_frame.name, u8"big_frame");
+
+  std::optional<Stack_Usage_Check> check =
+      project.get_stack_usage_check(big_frame);
+  ASSERT_TRUE(check.has_value());
+  EXPECT_EQ(check->reported_stack_size, 128);
+  EXPECT_GT(check->touched_stack_size, 8);
+  EXPECT_TRUE(check->is_consistent);
+
+  big_frame.name = u8"not_in_su_file";
+  EXPECT_FALSE(project.get_stack_usage_check(big_frame).has_value());
+
+  project.clear_stack_usage_files();
+  EXPECT_FALSE(project.get_stack_usage_check(funcs[1]).has_value());
+}
+
+TEST(Test_Project, dwarf_function_stack_size_with_frame_pointer_is_lazy) {
+  Example_File elf_file("elf/example-ranges.so");
+  Project project;
+  project.add_file("example-ranges.so", std::move(elf_file).loaded_file());
+
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  std::optional<CodeView_Function> fixed_frame_pointer;
+  for (CodeView_Function func : funcs) {
+    if (func.name == u8"fixed_frame_pointer") fixed_frame_pointer = func;
+  }
+  ASSERT_TRUE(fixed_frame_pointer.has_value());
+  EXPECT_TRUE(fixed_frame_pointer->uses_frame_pointer);
+  // Data according to: objdump -d
+  EXPECT_EQ(fixed_frame_pointer->stack_size, 8 + 8)
+      << "return address; push %rbp";
+  EXPECT_EQ(fixed_frame_pointer->get_stack_size(), 8 + 8 + 0x20)
+      << "return address; push %rbp; mov %edi, -0x20(%rbp)";
+}
+
 TEST(Test_Project, loads_unlinked_pdb_and_obj) {
   Example_File pdb_file("coff-pdb/example.pdb");
   Example_File obj_file("coff-pdb/example.obj");
@@ -52,7 +568,7 @@ TEST(Test_Project, loads_unlinked_pdb_and_obj) {
   project.add_file("example.obj", std::move(obj_file).loaded_file());
 
   // Function table should load from .obj.
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
   ASSERT_GT(funcs.size(), 0);
   EXPECT_EQ(funcs[0].name, u8"callee");
   // Type tables should load from .pdb.
@@ -71,7 +587,7 @@ TEST(Test_Project, loads_unlinked_obj_and_pdb) {
   project.add_file("example.pdb", std::move(pdb_file).loaded_file());
 
   // Function table should load from .obj.
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
   ASSERT_GT(funcs.size(), 0);
   EXPECT_EQ(funcs[0].name, u8"callee");
   // Type tables should load from .pdb.
@@ -89,12 +605,11 @@ TEST(Test_Project, loads_functions_from_obj_after_loading_functionless_pdb) {
   project.add_file("example.pdb", std::move(pdb_file).loaded_file());
 
   // This .pdb file has no functions, only types.
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
+  const CodeView_Function_Table& funcs = project.get_all_functions();
   EXPECT_THAT(funcs, ::testing::IsEmpty());
 
   project.add_file("example.obj", std::move(obj_file).loaded_file());
-  funcs = project.get_all_functions();
-  EXPECT_GT(funcs.size(), 0)
+  EXPECT_GT(project.get_all_functions().size(), 0)
       << "loading example.obj should have added functions";
 }
 
@@ -127,14 +642,14 @@ TEST(Test_Project, pdb_functions_link_to_loaded_dll) {
     }
 
     // Function table should load from .pdb.
-    std::span<const CodeView_Function> funcs = project.get_all_functions();
-    std::map<std::u8string, const CodeView_Function*> funcs_by_name;
-    for (const CodeView_Function& func : funcs) {
-      funcs_by_name[func.name] = &func;
+    const CodeView_Function_Table& funcs = project.get_all_functions();
+    std::map<std::u8string, CodeView_Function> funcs_by_name;
+    for (CodeView_Function func : funcs) {
+      funcs_by_name.emplace(func.name, func);
     }
 
     std::optional local_variable_bytes_reader =
-        funcs_by_name[u8"local_variable"]->get_instruction_bytes_reader();
+        funcs_by_name.at(u8"local_variable").get_instruction_bytes_reader();
     ASSERT_TRUE(local_variable_bytes_reader.has_value());
     // TODO(strager): Assert that the reader is for the .dll file, not the .pdb
     // file or an unrelated file.
@@ -142,7 +657,7 @@ TEST(Test_Project, pdb_functions_link_to_loaded_dll) {
     EXPECT_EQ(local_variable_bytes_reader->size(), 0x39);
 
     std::optional temporary_reader =
-        funcs_by_name[u8"temporary"]->get_instruction_bytes_reader();
+        funcs_by_name.at(u8"temporary").get_instruction_bytes_reader();
     ASSERT_TRUE(temporary_reader.has_value());
     // TODO(strager): Assert that the reader is for the .dll file, not the .pdb
     // file or an unrelated file.
@@ -151,15 +666,42 @@ TEST(Test_Project, pdb_functions_link_to_loaded_dll) {
   }
 }
 
+TEST(Test_Project, pdb_frame_proc_stack_size_matches_dll_unwind_frame) {
+  Example_File pdb_file("pdb-pe/temporary.pdb");
+  Example_File dll_file("pdb-pe/temporary.dll");
+  Project project;
+  project.add_file("temporary.pdb", std::move(pdb_file).loaded_file());
+  project.add_file("temporary.dll", std::move(dll_file).loaded_file());
+
+  U64 checked_function_count = 0;
+  for (CodeView_Function function : project.get_all_functions()) {
+    SCOPED_TRACE(u8string_to_string(function.name));
+    std::optional<CodeView_Frame_Proc> frame_proc = function.get_frame_proc();
+    ASSERT_TRUE(frame_proc.has_value());
+    EXPECT_EQ(frame_proc->frame_size, function.self_stack_size);
+    EXPECT_EQ(frame_proc->stack_size(), function.stack_size);
+    const PE_Unwind_Frame* frame = function.get_unwind_frame();
+    if (frame == nullptr) {
+      continue;
+    }
+    EXPECT_EQ(frame_proc->frame_size, frame->allocation_size);
+    EXPECT_EQ(frame_proc->saved_registers_size,
+              frame->pushed_register_count * 8);
+    EXPECT_EQ(frame_proc->stack_size(), frame->stack_size());
+    checked_function_count += 1;
+  }
+  EXPECT_GT(checked_function_count, 0);
+}
+
 TEST(Test_Project, map_function_bytes_to_source_lines) {
   Example_File pdb_reader("pdb-pe/line-numbers.pdb");
   Project project;
   project.add_file("line-numbers.pdb", std::move(pdb_reader).loaded_file());
 
-  std::span<const CodeView_Function> funcs = project.get_all_functions();
-  std::map<std::u8string, const CodeView_Function*> funcs_by_name;
-  for (const CodeView_Function& func : funcs) {
-    funcs_by_name[func.name] = &func;
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  std::map<std::u8string, CodeView_Function> funcs_by_name;
+  for (CodeView_Function func : funcs) {
+    funcs_by_name.emplace(func.name, func);
   }
 
   Line_Tables* line_tables = project.get_line_tables();
@@ -188,12 +730,13 @@ TEST(Test_Project, map_function_bytes_to_source_lines) {
                              u8string_to_string(test_case.function_name)));
     SCOPED_TRACE(
         fmt::format("instruction offset: {:#x}", test_case.instruction_offset));
-    const CodeView_Function* func = funcs_by_name[test_case.function_name];
-    ASSERT_NE(func, nullptr);
-    ASSERT_FALSE(func->line_tables_handle.is_null());
+    auto func_it = funcs_by_name.find(test_case.function_name);
+    ASSERT_NE(func_it, funcs_by_name.end());
+    const CodeView_Function& func = func_it->second;
+    ASSERT_FALSE(func.line_tables_handle.is_null());
     Line_Source_Info info = line_tables->source_info_for_offset(
-        func->line_tables_handle, func->code_section_index,
-        func->code_offset + test_case.instruction_offset);
+        func.line_tables_handle, func.code_section_index,
+        func.code_offset + test_case.instruction_offset);
     EXPECT_EQ(info.line_number, test_case.line_number);
   }
 }
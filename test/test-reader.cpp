@@ -1,4 +1,5 @@
 #include <cppstacksize/base.h>
+#include <cppstacksize/extent-reader.h>
 #include <cppstacksize/pdb-reader.h>
 #include <cppstacksize/reader.h>
 #include <deque>
@@ -6,6 +7,7 @@
 #include <gtest/gtest.h>
 #include <limits>
 #include <type_traits>
+#include <vector>
 
 using ::testing::ElementsAreArray;
 
@@ -158,6 +160,42 @@ struct PDB_Blocks_Reader_With_Block_Size_4_With_Subset_Of_Span_Reader {
   std::deque<Span_Reader> base_readers_;
 };
 
+struct Extent_Reader_With_Partial_Span_Reader {
+  Extent_Reader make_reader(std::span<const U8> data) {
+    return Extent_Reader(this->sub_file_reader_factory_.make_reader(data));
+  }
+  Sub_File_Reader_With_Partial_Span_Reader sub_file_reader_factory_;
+};
+
+// Blocks are stored in reverse order so that neighboring blocks in the stream
+// are not neighbors in the file.
+template <U32 block_size>
+struct Extent_Reader_With_Reversed_PDB_Blocks {
+  Extent_Reader make_reader(std::span<const U8> data) {
+    U32 block_count = narrow_cast<U32>((data.size() + block_size - 1) /
+                                       block_size);
+    std::vector<U8>& all_bytes = this->datas_.emplace_back(
+        (block_count + 1) * block_size, U8{0xcc});
+    std::vector<U32> block_indexes;
+    for (U32 i = 0; i < block_count; ++i) {
+      U32 block_index = block_count - i;
+      block_indexes.push_back(block_index);
+      for (U32 j = 0; j < block_size && i * block_size + j < data.size();
+           ++j) {
+        all_bytes[block_index * block_size + j] = data[i * block_size + j];
+      }
+    }
+    Span_Reader* base_reader = &this->base_readers_.emplace_back(all_bytes);
+    PDB_Blocks_Reader<Span_Reader>* stream = &this->streams_.emplace_back(
+        base_reader, std::move(block_indexes), block_size,
+        narrow_cast<U32>(data.size()), /*stream_index=*/0);
+    return Extent_Reader(*stream);
+  }
+  std::deque<std::vector<U8>> datas_;
+  std::deque<Span_Reader> base_readers_;
+  std::deque<PDB_Blocks_Reader<Span_Reader>> streams_;
+};
+
 using Reader_Factories = ::testing::Types<
     Span_Reader_Factory, Sub_File_Reader_With_Full_Span_Reader,
     Sub_File_Reader_With_Full_Span_Reader_And_Implicit_Size,
@@ -166,7 +204,10 @@ using Reader_Factories = ::testing::Types<
     Sub_File_Reader_Inside_Sub_File_Reader_With_Span_Reader,
     Sub_File_Reader_With_Partial_Span_Reader_And_Implicit_Size,
     PDB_Blocks_Reader_With_Block_Size_4_With_Span_Reader,
-    PDB_Blocks_Reader_With_Block_Size_4_With_Subset_Of_Span_Reader>;
+    PDB_Blocks_Reader_With_Block_Size_4_With_Subset_Of_Span_Reader,
+    Extent_Reader_With_Partial_Span_Reader,
+    Extent_Reader_With_Reversed_PDB_Blocks<4>,
+    Extent_Reader_With_Reversed_PDB_Blocks<3>>;
 TYPED_TEST_SUITE(Test_Reader, Reader_Factories);
 
 TYPED_TEST(Test_Reader, has_correct_size) {
@@ -363,6 +404,34 @@ TYPED_TEST(Test_Reader, out_of_bounds_copy_bytes_into_fails) {
       Out_Of_Bounds_Read);
 }
 
+TYPED_TEST(Test_Reader, same_bytes_compares_contents) {
+  static const U8 data[] = {0x6c, 0x6f, 0x6c};
+  static const U8 same_data[] = {0x6c, 0x6f, 0x6c};
+  static const U8 different_data[] = {0x6c, 0x6f, 0x6f};
+  auto r = this->make_reader(data);
+  EXPECT_TRUE(readers_have_same_bytes(r, this->make_reader(same_data)));
+  EXPECT_FALSE(readers_have_same_bytes(r, this->make_reader(different_data)));
+}
+
+TEST(Test_Readers_Have_Same_Bytes, compares_every_chunk_and_size) {
+  std::vector<U8> data(10000);
+  for (U64 i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<U8>(i * 7);
+  }
+  std::vector<U8> same_data = data;
+  EXPECT_TRUE(
+      readers_have_same_bytes(Span_Reader(data), Span_Reader(same_data)));
+
+  std::vector<U8> different_data = data;
+  different_data[9000] += 1;
+  EXPECT_FALSE(
+      readers_have_same_bytes(Span_Reader(data), Span_Reader(different_data)));
+
+  std::vector<U8> shorter_data(data.begin(), data.end() - 1);
+  EXPECT_FALSE(
+      readers_have_same_bytes(Span_Reader(data), Span_Reader(shorter_data)));
+}
+
 TEST(Test_Sub_File_Reader, combine_nested_readers) {
   static const U8 data[] = {10, 20, 30, 40, 50, 60};
   Span_Reader base_reader(data);
@@ -382,5 +451,67 @@ TEST(Test_Sub_File_Reader, combine_nested_readers_with_outer_size) {
   EXPECT_EQ(outer_reader.sub_file_offset(), 1 + 1);
   EXPECT_EQ(outer_reader.size(), 3);
 }
+
+TEST(Test_Extent_Reader, reads_integers_straddling_blocks) {
+  Extent_Reader_With_Reversed_PDB_Blocks<4> factory;
+  static const U8 data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  Extent_Reader r = factory.make_reader(data);
+  EXPECT_EQ(r.u16(3), 0x0504);
+  EXPECT_EQ(r.u32(2), 0x06050403);
+  EXPECT_EQ(r.u64(1), 0x0908070605040302);
+  EXPECT_EQ(r.utf_8_string(2, 5), u8"\x03\x04\x05\x06\x07");
+}
+
+TEST(Test_Extent_Reader, locate_in_blocks_reports_stream_offset) {
+  static const U8 file_data[16] = {};
+  Span_Reader base_reader(file_data);
+  PDB_Blocks_Reader<Span_Reader> stream(&base_reader, {3, 1}, /*block_size=*/4,
+                                        /*byte_size=*/8, /*stream_index=*/7);
+  Extent_Reader r = Sub_File_Reader<PDB_Blocks_Reader<Span_Reader>>(&stream, 2);
+  EXPECT_EQ(r.base_reader(), &stream);
+  EXPECT_EQ(r.sub_file_offset(), 2);
+  EXPECT_FALSE(r.is_contiguous());
+
+  Location location = r.locate(3);
+  EXPECT_EQ(location.file_offset, 1 * 4 + 1);
+  EXPECT_EQ(location.stream_index, 7);
+  EXPECT_EQ(location.stream_offset, 5);
+}
+
+TEST(Test_Extent_Reader, locate_in_span_reports_file_offset) {
+  static const U8 file_data[16] = {};
+  Span_Reader base_reader(file_data);
+  Extent_Reader r = Sub_File_Reader<Span_Reader>(&base_reader, 4, 8);
+  EXPECT_EQ(r.base_reader(), &base_reader);
+  EXPECT_TRUE(r.is_contiguous());
+
+  Location location = r.locate(3);
+  EXPECT_EQ(location.file_offset, 4 + 3);
+  EXPECT_EQ(location.stream_index, std::nullopt);
+}
+
+TEST(Test_Extent_Reader, sub_reader_is_limited_to_reader) {
+  static const U8 data[] = {10, 20, 30, 40, 50, 60};
+  Span_Reader base_reader(data);
+  Extent_Reader r = Sub_File_Reader<Span_Reader>(&base_reader, 1, 4);
+  Extent_Reader sub = r.sub_reader(1, 100);
+  EXPECT_EQ(sub.sub_file_offset(), 1 + 1);
+  EXPECT_EQ(sub.size(), 3);
+  EXPECT_EQ(sub.u8(0), 30);
+  EXPECT_THROW({ sub.u8(3); }, Out_Of_Bounds_Read);
+  EXPECT_EQ(r.sub_reader(5).size(), 0);
+}
+
+TEST(Test_Extent_Reader, reading_past_last_block_fails) {
+  static const U8 file_data[8] = {};
+  Span_Reader base_reader(file_data);
+  // NOTE(strager): The stream claims to be bigger than its blocks.
+  PDB_Blocks_Reader<Span_Reader> stream(&base_reader, {1}, /*block_size=*/4,
+                                        /*byte_size=*/100, /*stream_index=*/0);
+  Extent_Reader r = stream;
+  EXPECT_EQ(r.u32(0), 0);
+  EXPECT_THROW({ r.u8(4); }, Out_Of_Bounds_Read);
+  EXPECT_THROW({ r.u32(2); }, Out_Of_Bounds_Read);
+}
 }
 }
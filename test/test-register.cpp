@@ -247,5 +247,95 @@ TEST(Test_Register, rename_64_bit_register_with_mov) {
               Literal_Register_Value(0x69));
   }
 }
+TEST(Test_Register, and_immediate_bounds_unknown_register) {
+  std::span<const U8> code = ASM_X86_64(
+      "mov (%rdi), %rcx"
+      "and $0xf, %ecx");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rcx],
+            Register_Value::make_literal_range(0, 0xf, 3));
+}
+
+TEST(Test_Register, and_immediate_with_literal_is_literal) {
+  std::span<const U8> code = ASM_X86_64(
+      "mov $0x1234, %eax"
+      "and $0xff, %eax");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rax],
+            Literal_Register_Value(0x34));
+}
+
+TEST(Test_Register, movzx_bounds_register) {
+  {
+    std::span<const U8> code = ASM_X86_64("movzbl (%rdi), %eax");
+    Stack_Map sm = analyze_x86_64_stack_map(code);
+    EXPECT_EQ(sm.registers.values[Register_Name::rax],
+              Register_Value::make_literal_range(0, 0xff, 0));
+  }
+
+  {
+    std::span<const U8> code = ASM_X86_64("movzwl (%rdi), %eax");
+    Stack_Map sm = analyze_x86_64_stack_map(code);
+    EXPECT_EQ(sm.registers.values[Register_Name::rax],
+              Register_Value::make_literal_range(0, 0xffff, 0));
+  }
+}
+
+TEST(Test_Register, lea_with_bounded_index_is_range) {
+  std::span<const U8> code = ASM_X86_64(
+      "movzbl (%rdi), %ecx"
+      "lea 0x10(%rsp,%rcx,8), %rax");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rax],
+            Register_Value::make_entry_rsp_relative_range(
+                0x10, 0x10 + 0xff * 8, 3));
+}
+
+TEST(Test_Register, lea_with_literal_index_is_exact) {
+  std::span<const U8> code = ASM_X86_64(
+      "mov $3, %ecx"
+      "lea 0x10(%rsp,%rcx,8), %rax");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rax],
+            Register_Value::make_entry_rsp_relative(0x10 + 3 * 8, 5));
+}
+
+TEST(Test_Register, load_from_memory_forgets_old_value) {
+  std::span<const U8> code = ASM_X86_64(
+      "mov $3, %rcx"
+      "mov (%rdi), %rcx");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rcx],
+            Register_Value::make_unknown(7));
+}
+TEST(Test_Register, sub_bounded_register_from_rsp_is_range) {
+  std::span<const U8> code = ASM_X86_64(
+      "movzbl (%rdi), %eax"
+      "sub %rax, %rsp");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rsp],
+            Register_Value::make_entry_rsp_relative_range(-0xff, 0, 3));
+}
+
+TEST(Test_Register, sub_unknown_register_from_rsp_is_unknown) {
+  std::span<const U8> code = ASM_X86_64(
+      "mov (%rdi), %rax"
+      "sub %rax, %rsp");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rsp],
+            Register_Value::make_unknown(3));
+}
+
+TEST(Test_Register, restoring_rsp_from_frame_pointer_after_alloca) {
+  std::span<const U8> code = ASM_X86_64(
+      "push %rbp"
+      "mov %rsp, %rbp"
+      "mov (%rdi), %rax"
+      "sub %rax, %rsp"
+      "mov %rbp, %rsp");
+  Stack_Map sm = analyze_x86_64_stack_map(code);
+  EXPECT_EQ(sm.registers.values[Register_Name::rsp],
+            Register_Value::make_entry_rsp_relative(-8, 10));
+}
 }
 }
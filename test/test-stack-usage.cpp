@@ -0,0 +1,213 @@
+#include <cppstacksize/asm-stack-map.h>
+#include <cppstacksize/example-file.h>
+#include <cppstacksize/logger.h>
+#include <cppstacksize/pe.h>
+#include <cppstacksize/stack-usage.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+std::string_view example_su_data(Example_File& file) {
+  return std::string_view(reinterpret_cast<const char*>(file.data().data()),
+                          file.data().size());
+}
+
+TEST(Test_Stack_Usage, parse_gcc_line) {
+  std::optional<Stack_Usage_Entry> entry = parse_stack_usage_line(
+      "example.cpp:22:5:int ns::Widget::method(int)\t48\tstatic");
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->source_path, "example.cpp");
+  EXPECT_EQ(entry->line_number, 22);
+  EXPECT_EQ(entry->column_number, 5);
+  EXPECT_EQ(entry->function_name, "int ns::Widget::method(int)");
+  EXPECT_EQ(entry->stack_size, 48);
+  EXPECT_FALSE(entry->is_dynamic);
+  EXPECT_FALSE(entry->is_bounded);
+}
+
+TEST(Test_Stack_Usage, parse_clang_line_without_column) {
+  std::optional<Stack_Usage_Entry> entry =
+      parse_stack_usage_line("C:\\src\\example.cpp:7:_Z6calleri\t16\tstatic\r");
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->source_path, "C:\\src\\example.cpp");
+  EXPECT_EQ(entry->line_number, 7);
+  EXPECT_EQ(entry->column_number, 0);
+  EXPECT_EQ(entry->function_name, "_Z6calleri");
+  EXPECT_EQ(entry->stack_size, 16);
+}
+
+TEST(Test_Stack_Usage, parse_line_without_location) {
+  std::optional<Stack_Usage_Entry> entry =
+      parse_stack_usage_line("ns::f()\t32\tdynamic,bounded");
+  ASSERT_TRUE(entry.has_value());
+  EXPECT_EQ(entry->source_path, "");
+  EXPECT_EQ(entry->function_name, "ns::f()");
+  EXPECT_EQ(entry->stack_size, 32);
+  EXPECT_TRUE(entry->is_dynamic);
+  EXPECT_TRUE(entry->is_bounded);
+}
+
+TEST(Test_Stack_Usage, parse_malformed_lines) {
+  EXPECT_FALSE(parse_stack_usage_line("").has_value());
+  EXPECT_FALSE(parse_stack_usage_line("f\t32").has_value());
+  EXPECT_FALSE(parse_stack_usage_line("f\tbig\tstatic").has_value());
+  EXPECT_FALSE(parse_stack_usage_line("f\t32\tweird").has_value());
+  EXPECT_FALSE(parse_stack_usage_line("\t32\tstatic").has_value());
+}
+
+TEST(Test_Stack_Usage, qualified_name) {
+  EXPECT_EQ(stack_usage_qualified_name("int ns::Widget::method(int)"),
+            "ns::Widget::method");
+  EXPECT_EQ(stack_usage_qualified_name("void f()"), "f");
+  EXPECT_EQ(stack_usage_qualified_name("f"), "f");
+  EXPECT_EQ(stack_usage_qualified_name("_Z6calleri"), "_Z6calleri");
+  EXPECT_EQ(stack_usage_qualified_name("int C::get() const"), "C::get");
+  EXPECT_EQ(
+      stack_usage_qualified_name("std::pair<int, int> g(T) [with T = int]"),
+      "g");
+  EXPECT_EQ(stack_usage_qualified_name(
+                "void h<std::pair<int, int> >(void (*)(int))"),
+            "h<std::pair<int, int> >");
+  EXPECT_EQ(stack_usage_qualified_name("C::operator int()"),
+            "C::operator int");
+}
+
+TEST(Test_Stack_Usage, find_functions_in_gcc_su_file) {
+  Example_File file("elf/example.su");
+  Stack_Usage_Table table;
+  table.add_file_data(example_su_data(file), "elf/example.su");
+  EXPECT_EQ(table.size(), 4);
+
+  const Stack_Usage_Entry* entry = table.find_function("big_frame");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->stack_size, 128);
+  EXPECT_EQ(entry->line_number, 11);
+
+  entry = table.find_function("ns::Widget::method");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->stack_size, 48);
+
+  entry = table.find_function("int caller(int)");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->stack_size, 16);
+
+  EXPECT_EQ(table.find_function("method"), nullptr);
+  EXPECT_EQ(table.find_function("nonexistent"), nullptr);
+}
+
+TEST(Test_Stack_Usage, duplicate_functions_keep_largest_stack_size) {
+  Stack_Usage_Table table;
+  table.add_file_data("a.h:1:1:int f()\t16\tstatic\n", "a.su");
+  table.add_file_data("a.h:1:1:int f()\t32\tstatic\n", "b.su");
+  table.add_file_data("a.h:1:1:int f()\t24\tstatic\n", "c.su");
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(table.find_by_name("int f()")->stack_size, 32);
+  EXPECT_EQ(table.find_function("f")->stack_size, 32);
+}
+
+TEST(Test_Stack_Usage, overloads_share_qualified_name) {
+  Stack_Usage_Table table;
+  table.add_file_data(
+      "x.cpp:1:1:void f(int)\t16\tstatic\n"
+      "x.cpp:2:1:void f(double)\t48\tstatic\n"
+      "x.cpp:3:1:void f(char)\t32\tstatic\n",
+      "x.su");
+  EXPECT_EQ(table.size(), 3);
+  EXPECT_EQ(table.find_function("f")->stack_size, 48);
+  EXPECT_EQ(table.find_function("void f(char)")->stack_size, 32);
+}
+
+TEST(Test_Stack_Usage, malformed_lines_are_logged_and_skipped) {
+  Capturing_Logger logger(&fallback_logger);
+  Stack_Usage_Table table;
+  table.add_file_data(
+      "x.cpp:1:1:f\t16\tstatic\n"
+      "garbage\n"
+      "\n"
+      "x.cpp:2:1:g\t8\tstatic\n",
+      "x.su", logger);
+  EXPECT_EQ(table.size(), 2);
+  ASSERT_EQ(logger.logged_messages().size(), 1);
+  EXPECT_EQ(logger.logged_messages()[0].location.file_offset, 22);
+}
+
+TEST(Test_Stack_Usage, load_many_files_in_parallel) {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 20; ++i) {
+    paths.push_back(Example_File::full_path("elf/example.su"));
+  }
+  paths.push_back(Example_File::full_path("elf/does-not-exist.su"));
+
+  for (unsigned thread_count : {1u, 4u}) {
+    SCOPED_TRACE(thread_count);
+    Capturing_Logger logger(&fallback_logger);
+    Stack_Usage_Table table;
+    load_stack_usage_files(paths, table, logger, thread_count);
+    EXPECT_EQ(table.size(), 4);
+    ASSERT_NE(table.find_function("big_frame"), nullptr);
+    EXPECT_EQ(table.find_function("big_frame")->stack_size, 128);
+    EXPECT_EQ(logger.logged_messages().size(), 1);
+  }
+}
+
+TEST(Test_Stack_Usage, check_against_stack_map) {
+  Stack_Usage_Entry entry;
+  entry.function_name = "big_frame";
+  entry.stack_size = 128;
+
+  static constexpr Stack_Map_Touch inside_frame[] = {
+      Stack_Map_Touch::write(0, -0x78, 8),
+      Stack_Map_Touch::read(4, -0x10, 4),
+      // Caller's frame (e.g. stack-passed arguments):
+      Stack_Map_Touch::read(8, 0x10, 8),
+  };
+  Stack_Usage_Check check = check_stack_usage(entry, inside_frame);
+  EXPECT_EQ(check.reported_stack_size, 128);
+  EXPECT_EQ(check.touched_stack_size, 0x78 + 8);
+  EXPECT_TRUE(check.is_consistent);
+
+  static constexpr Stack_Map_Touch outside_frame[] = {
+      Stack_Map_Touch::write(0, -0x88, 8),
+  };
+  check = check_stack_usage(entry, outside_frame);
+  EXPECT_EQ(check.touched_stack_size, 0x88 + 8);
+  EXPECT_FALSE(check.is_consistent);
+
+  entry.is_dynamic = true;
+  EXPECT_TRUE(check_stack_usage(entry, outside_frame).is_consistent);
+
+  EXPECT_EQ(check_stack_usage(entry, {}).touched_stack_size, 8);
+}
+
+TEST(Test_Stack_Usage, check_unwind_frame_against_stack_map) {
+  // push %rbx; sub $0x20, %rsp
+  PE_Unwind_Frame frame = {
+      .begin_rva = 0x1000,
+      .end_rva = 0x1040,
+      .unwind_info_rva = 0x2000,
+      .allocation_size = 0x20,
+      .pushed_register_count = 1,
+  };
+
+  static constexpr Stack_Map_Touch inside_frame[] = {
+      Stack_Map_Touch::write(0, -0x8, 8),
+      Stack_Map_Touch::write(4, -0x28, 8),
+  };
+  Stack_Usage_Check check = check_unwind_frame(frame, inside_frame);
+  EXPECT_EQ(check.reported_stack_size, 0x30);
+  EXPECT_EQ(check.touched_stack_size, 0x30);
+  EXPECT_TRUE(check.is_consistent);
+
+  static constexpr Stack_Map_Touch outside_frame[] = {
+      Stack_Map_Touch::write(0, -0x30, 8),
+  };
+  EXPECT_FALSE(check_unwind_frame(frame, outside_frame).is_consistent);
+
+  frame.frame_register = 5;  // rbp
+  EXPECT_TRUE(check_unwind_frame(frame, outside_frame).is_consistent);
+}
+}
+}
@@ -0,0 +1,165 @@
+#include <cppstacksize/codeview-function-table.h>
+#include <cppstacksize/codeview.h>
+#include <cppstacksize/file.h>
+#include <cppstacksize/line-tables.h>
+#include <cppstacksize/pdb.h>
+#include <cppstacksize/project.h>
+#include <cppstacksize/synthetic-pdb.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace cppstacksize {
+namespace {
+class Test_Synthetic_PDB
+    : public ::testing::TestWithParam<
+          std::tuple<U32, Synthetic_MSF_Block_Layout>> {};
+
+TEST_P(Test_Synthetic_PDB, streams_round_trip) {
+  auto [block_size, block_layout] = this->GetParam();
+  std::vector<std::vector<U8>> streams;
+  for (U64 i = 0; i < 10; ++i) {
+    std::vector<U8>& stream = streams.emplace_back(i * 1000);
+    for (U64 j = 0; j < stream.size(); ++j) {
+      stream[j] = static_cast<U8>(i + j);
+    }
+  }
+  std::vector<U8> pdb =
+      make_synthetic_msf(streams, block_size, block_layout, /*seed=*/1234);
+
+  Span_Reader reader(pdb);
+  PDB_Super_Block super_block = parse_pdb_header(reader);
+  EXPECT_EQ(super_block.block_size, block_size);
+  std::vector<PDB_Blocks_Reader<Span_Reader>> parsed_streams =
+      parse_pdb_stream_directory(&reader, super_block);
+  ASSERT_EQ(parsed_streams.size(), streams.size());
+  for (U64 i = 0; i < streams.size(); ++i) {
+    ASSERT_EQ(parsed_streams[i].size(), streams[i].size()) << "stream #" << i;
+    if (streams[i].empty()) continue;
+    std::vector<U8> data(parsed_streams[i].size());
+    parsed_streams[i].copy_bytes_into(data, 0);
+    EXPECT_EQ(data, streams[i]) << "stream #" << i;
+  }
+}
+
+TEST_P(Test_Synthetic_PDB, project_loads_generated_pdb) {
+  auto [block_size, block_layout] = this->GetParam();
+  Synthetic_PDB_Options options = {
+      .block_size = block_size,
+      .block_layout = block_layout,
+      .seed = 1234,
+      .module_count = 3,
+      .functions_per_module = 5,
+      .locals_per_function = 2,
+      .lines_per_function = 4,
+      .extra_type_count = 100,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  ASSERT_EQ(funcs.size(), 15);
+  CodeView_Type_Table* type_table = project.get_type_table();
+  ASSERT_NE(type_table, nullptr);
+  CodeView_Type_Table* type_index_table = project.get_type_index_table();
+  ASSERT_NE(type_index_table, nullptr);
+  Line_Tables* line_tables = project.get_line_tables();
+
+  for (U64 i = 0; i < funcs.size(); ++i) {
+    const CodeView_Function& func = funcs[i];
+    SCOPED_TRACE(i);
+    std::string expected_name =
+        "synthetic_function_" + std::to_string(0x1000 + i);
+    EXPECT_EQ(func.name,
+              std::u8string(expected_name.begin(), expected_name.end()));
+    EXPECT_EQ(func.code_section_index, 0);
+    EXPECT_EQ(func.code_offset, i * 0x40);
+    EXPECT_EQ(func.get_caller_stack_size(*type_table, *type_index_table), 32);
+
+    std::vector<CodeView_Function_Local> locals =
+        func.get_locals(func.byte_offset);
+    ASSERT_EQ(locals.size(), 2);
+    EXPECT_EQ(locals[0].name, u8"local_0");
+    EXPECT_EQ(locals[1].name, u8"local_1");
+
+    ASSERT_FALSE(func.line_tables_handle.is_null());
+    EXPECT_EQ(line_tables->source_info_for_offset(func.line_tables_handle,
+                                                  func.code_section_index,
+                                                  func.code_offset + 0x00),
+              Line_Source_Info{.line_number = 1});
+    EXPECT_EQ(line_tables->source_info_for_offset(func.line_tables_handle,
+                                                  func.code_section_index,
+                                                  func.code_offset + 0x3f),
+              Line_Source_Info{.line_number = 4});
+  }
+}
+
+TEST(Test_Synthetic_PDB_DBI, dbi_describes_modules) {
+  Synthetic_PDB_Options options = {
+      .module_count = 3,
+      .functions_per_module = 5,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Span_Reader reader(pdb);
+  PDB_Super_Block super_block = parse_pdb_header(reader);
+  std::vector<PDB_Blocks_Reader<Span_Reader>> streams =
+      parse_pdb_stream_directory(&reader, super_block);
+  PDB_DBI dbi = parse_pdb_dbi_stream(streams.at(3));
+
+  ASSERT_EQ(dbi.modules.size(), 3);
+  ASSERT_EQ(dbi.section_contributions.size(), 3);
+  for (U16 module_index = 0; module_index < 3; ++module_index) {
+    SCOPED_TRACE(module_index);
+    U32 code_offset = module_index * 5 * 0x40;
+    EXPECT_EQ(dbi.find_module_index(0, code_offset), module_index);
+    EXPECT_EQ(dbi.find_module_index(0, code_offset + 5 * 0x40 - 1),
+              module_index);
+    ASSERT_EQ(dbi.source_file_count(module_index), 1);
+    std::string expected_path =
+        "C:\\synthetic\\module_" + std::to_string(module_index) + ".cpp";
+    EXPECT_EQ(dbi.source_file_path(module_index, 0),
+              std::u8string(expected_path.begin(), expected_path.end()));
+  }
+  EXPECT_EQ(dbi.find_module_index(0, 3 * 5 * 0x40), std::nullopt);
+  ASSERT_EQ(dbi.section_map.size(), 1);
+  EXPECT_EQ(dbi.section_map[0].size, 3 * 5 * 0x40);
+}
+
+TEST(Test_Synthetic_PDB_Global_Symbols, global_symbols_reference_functions) {
+  Synthetic_PDB_Options options = {
+      .module_count = 3,
+      .functions_per_module = 5,
+      .locals_per_function = 2,
+  };
+  std::vector<U8> pdb = make_synthetic_pdb(options);
+  Project project;
+  project.set_use_pdb_global_symbols(true);
+  project.add_file("synthetic.pdb", Loaded_File::from_bytes(pdb));
+
+  const CodeView_Function_Table& funcs = project.get_all_functions();
+  ASSERT_EQ(funcs.size(), 15);
+  for (U64 i = 0; i < funcs.size(); ++i) {
+    const CodeView_Function& func = funcs[i];
+    SCOPED_TRACE(i);
+    std::string expected_name =
+        "synthetic_function_" + std::to_string(0x1000 + i);
+    EXPECT_EQ(func.name,
+              std::u8string(expected_name.begin(), expected_name.end()));
+    EXPECT_EQ(func.code_offset, i * 0x40);
+    EXPECT_EQ(func.self_stack_size, 0x20 + 2 * 8);
+    EXPECT_EQ(func.get_locals(func.byte_offset).size(), 2);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    , Test_Synthetic_PDB,
+    ::testing::Combine(
+        ::testing::Values(512, 4096),
+        ::testing::Values(Synthetic_MSF_Block_Layout::sequential,
+                          Synthetic_MSF_Block_Layout::interleaved,
+                          Synthetic_MSF_Block_Layout::shuffled)));
+}
+}
@@ -0,0 +1,384 @@
+#include <cppstacksize/asm.h>
+#include <cppstacksize/register.h>
+#include <cppstacksize/x86-64-decoder.h>
+#include <gtest/gtest.h>
+#include <span>
+
+namespace cppstacksize {
+namespace {
+X86_64_Instruction decode_only_instruction(std::span<const U8> code) {
+  X86_64_Instruction instruction = {};
+  bool ok = decode_x86_64_instruction_fast(code, 0, instruction);
+  EXPECT_TRUE(ok);
+  if (!ok) {
+    return X86_64_Instruction{};
+  }
+  EXPECT_EQ(instruction.byte_size, code.size());
+  return instruction;
+}
+
+bool can_decode_fast(std::span<const U8> code) {
+  X86_64_Instruction instruction;
+  return decode_x86_64_instruction_fast(code, 0, instruction);
+}
+
+TEST(Test_X86_64_Decoder, register_to_memory_mov) {
+  X86_64_Instruction instruction =
+      decode_only_instruction(ASM_X86_64("mov %rax, 0x30(%rsp)"));
+  EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::mov);
+  ASSERT_EQ(instruction.operand_count, 2);
+
+  const X86_64_Operand& dest = instruction.operands[0];
+  EXPECT_EQ(dest.kind, X86_64_Operand_Kind::memory);
+  EXPECT_EQ(dest.byte_size, 8);
+  EXPECT_FALSE(dest.is_read);
+  EXPECT_TRUE(dest.is_written);
+  EXPECT_EQ(dest.memory.base, X86_64_Register::full(Register_Name::rsp));
+  EXPECT_EQ(dest.memory.index, X86_64_Register::untracked());
+  EXPECT_EQ(dest.memory.displacement, 0x30);
+
+  const X86_64_Operand& src = instruction.operands[1];
+  EXPECT_EQ(src.kind, X86_64_Operand_Kind::register_);
+  EXPECT_EQ(src.reg, X86_64_Register::full(Register_Name::rax));
+  EXPECT_TRUE(src.is_read);
+  EXPECT_FALSE(src.is_written);
+}
+
+TEST(Test_X86_64_Decoder, memory_access_kind) {
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("addq $69, 0x28(%rsp)"));
+    EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::add);
+    EXPECT_TRUE(instruction.operands[0].is_read);
+    EXPECT_TRUE(instruction.operands[0].is_written);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("cmp 0x20(%rsp), %rbx"));
+    EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::other);
+    EXPECT_TRUE(instruction.operands[1].is_read);
+    EXPECT_FALSE(instruction.operands[1].is_written);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("movzbl 0x20(%rsp), %eax"));
+    EXPECT_EQ(instruction.operands[0].byte_size, 4);
+    EXPECT_EQ(instruction.operands[1].byte_size, 1);
+  }
+}
+
+TEST(Test_X86_64_Decoder, immediates) {
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("sub $0x28, %rsp"))
+                .operands[1]
+                .immediate,
+            0x28);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("sub $0x1000, %rsp"))
+                .operands[1]
+                .immediate,
+            0x1000);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("add $-8, %rsp"))
+                .operands[1]
+                .immediate,
+            -8);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("mov $0xffffffff, %eax"))
+                .operands[1]
+                .immediate,
+            0xffffffff)
+      << "32-bit immediates should not be sign-extended";
+  EXPECT_EQ(
+      decode_only_instruction(ASM_X86_64("mov $0x123456789abcdef0, %rax"))
+          .operands[1]
+          .immediate,
+      0x123456789abcdef0);
+}
+
+TEST(Test_X86_64_Decoder, byte_registers) {
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("mov %ah, 0x20(%rsp)"))
+                .operands[1]
+                .reg,
+            (X86_64_Register{Register_Name::rax,
+                             Register_Piece::low_16_high_8}));
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("mov %sil, 0x20(%rsp)"))
+                .operands[1]
+                .reg,
+            (X86_64_Register{Register_Name::rsi, Register_Piece::low_8}));
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("mov %r9w, 0x20(%rsp)"))
+                .operands[1]
+                .reg,
+            (X86_64_Register{Register_Name::r9, Register_Piece::low_16}));
+}
+
+TEST(Test_X86_64_Decoder, memory_addressing) {
+  {
+    X86_64_Operand operand =
+        decode_only_instruction(ASM_X86_64("mov 0x10(%rsp,%rcx,8), %rax"))
+            .operands[1];
+    EXPECT_EQ(operand.memory.base, X86_64_Register::full(Register_Name::rsp));
+    EXPECT_EQ(operand.memory.index, X86_64_Register::full(Register_Name::rcx));
+    EXPECT_EQ(operand.memory.scale, 8);
+    EXPECT_EQ(operand.memory.displacement, 0x10);
+  }
+
+  {
+    X86_64_Operand operand =
+        decode_only_instruction(ASM_X86_64("mov -0x400(%r12), %rax"))
+            .operands[1];
+    EXPECT_EQ(operand.memory.base, X86_64_Register::full(Register_Name::r12));
+    EXPECT_EQ(operand.memory.displacement, -0x400);
+  }
+
+  {
+    X86_64_Operand operand =
+        decode_only_instruction(ASM_X86_64("mov (%r13), %rax")).operands[1];
+    EXPECT_EQ(operand.memory.base, X86_64_Register::full(Register_Name::r13));
+    EXPECT_EQ(operand.memory.displacement, 0);
+  }
+
+  {
+    X86_64_Operand operand =
+        decode_only_instruction(ASM_X86_64("mov 0x10(%rip), %rax"))
+            .operands[1];
+    EXPECT_FALSE(operand.memory.base.is_tracked());
+    EXPECT_EQ(operand.memory.displacement, 0x10);
+  }
+}
+
+TEST(Test_X86_64_Decoder, push_and_pop_sizes) {
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("pushq %r15"))
+                .operands[0]
+                .byte_size,
+            8);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("pushw %bx"))
+                .operands[0]
+                .byte_size,
+            2);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("pushq (%rdi)"))
+                .operands[0]
+                .byte_size,
+            8);
+  EXPECT_EQ(
+      decode_only_instruction(ASM_X86_64("pop %di")).operands[0].byte_size, 2);
+}
+
+TEST(Test_X86_64_Decoder, string_instructions) {
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("rep; stosq"));
+    EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::stos);
+    EXPECT_TRUE(instruction.has_rep_prefix);
+    EXPECT_EQ(instruction.operands[1].byte_size, 8);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("rep; stosw"));
+    EXPECT_TRUE(instruction.has_rep_prefix);
+    EXPECT_EQ(instruction.operands[1].byte_size, 2);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("movsq"));
+    EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::movs);
+    EXPECT_FALSE(instruction.has_rep_prefix);
+    EXPECT_EQ(instruction.operands[1].memory.base,
+              X86_64_Register::full(Register_Name::rsi));
+  }
+}
+
+TEST(Test_X86_64_Decoder, relative_call_target_is_absolute) {
+  // call +0x10
+  static constexpr U8 code[] = {0xe8, 0x10, 0x00, 0x00, 0x00};
+  X86_64_Instruction instruction;
+  ASSERT_TRUE(decode_x86_64_instruction_fast(code, 0x100, instruction));
+  EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::call);
+  EXPECT_EQ(instruction.byte_size, 5);
+  EXPECT_EQ(instruction.operands[0].immediate, 0x100 + 5 + 0x10);
+}
+
+TEST(Test_X86_64_Decoder, endbr64) {
+  static constexpr U8 code[] = {0xf3, 0x0f, 0x1e, 0xfa};
+  X86_64_Instruction instruction;
+  ASSERT_TRUE(decode_x86_64_instruction_fast(code, 0, instruction));
+  EXPECT_EQ(instruction.mnemonic, X86_64_Mnemonic::other);
+  EXPECT_EQ(instruction.byte_size, 4);
+  EXPECT_FALSE(instruction.has_rep_prefix);
+}
+
+TEST(Test_X86_64_Decoder, decodes_every_instruction_of_typical_function) {
+  std::span<const U8> code = ASM_X86_64(
+      "push %rbp"
+      "push %rbx"
+      "sub $0x28, %rsp"
+      "mov %rdi, %rbx"
+      "lea 0x10(%rsp), %rdi"
+      "xor %esi, %esi"
+      "movl $0, 0x8(%rsp)"
+      "call 0x1234"
+      "test %eax, %eax"
+      "jne 0x40"
+      "movslq 0x8(%rsp), %rax"
+      "cmovge %rbx, %rax"
+      "nopl 0x0(%rax)"
+      "add $0x28, %rsp"
+      "pop %rbx"
+      "pop %rbp"
+      "ret");
+  X86_64_Instruction instruction;
+  U64 offset = 0;
+  int instruction_count = 0;
+  while (offset < code.size()) {
+    ASSERT_TRUE(decode_x86_64_instruction_fast(code.subspan(offset), offset,
+                                               instruction))
+        << "offset " << offset;
+    offset += instruction.byte_size;
+    instruction_count += 1;
+  }
+  EXPECT_EQ(offset, code.size());
+  EXPECT_EQ(instruction_count, 17);
+}
+
+TEST(Test_X86_64_Decoder, nops) {
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("nop")).mnemonic,
+            X86_64_Mnemonic::nop);
+  EXPECT_EQ(decode_only_instruction(ASM_X86_64("nopl 0x0(%rax)")).mnemonic,
+            X86_64_Mnemonic::nop);
+  EXPECT_EQ(
+      decode_only_instruction(ASM_X86_64("nopw 0x0(%rax,%rax,1)")).mnemonic,
+      X86_64_Mnemonic::nop);
+}
+
+TEST(Test_X86_64_Decoder, sse_memory_operands) {
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("movups %xmm0, 0x20(%rsp)"));
+    ASSERT_EQ(instruction.operand_count, 2);
+    const X86_64_Operand& dest = instruction.operands[0];
+    EXPECT_EQ(dest.kind, X86_64_Operand_Kind::memory);
+    EXPECT_EQ(dest.byte_size, 16);
+    EXPECT_FALSE(dest.is_read);
+    EXPECT_TRUE(dest.is_written);
+    EXPECT_EQ(dest.memory.base, X86_64_Register::full(Register_Name::rsp));
+    EXPECT_EQ(dest.memory.displacement, 0x20);
+    EXPECT_EQ(instruction.operands[1].kind, X86_64_Operand_Kind::register_);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("movdqa 0x30(%rbp), %xmm9"));
+    ASSERT_EQ(instruction.operand_count, 2);
+    const X86_64_Operand& src = instruction.operands[1];
+    EXPECT_EQ(src.byte_size, 16);
+    EXPECT_TRUE(src.is_read);
+    EXPECT_FALSE(src.is_written);
+    EXPECT_EQ(src.memory.base, X86_64_Register::full(Register_Name::rbp));
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("movsd %xmm1, 0x8(%rsp)"));
+    EXPECT_EQ(instruction.operands[0].byte_size, 8);
+    EXPECT_TRUE(instruction.operands[0].is_written);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("addss 0x4(%rsp), %xmm0"));
+    ASSERT_EQ(instruction.operand_count, 2);
+    EXPECT_TRUE(instruction.operands[0].is_read);
+    EXPECT_TRUE(instruction.operands[0].is_written);
+    EXPECT_EQ(instruction.operands[1].byte_size, 4);
+  }
+}
+
+TEST(Test_X86_64_Decoder, avx_memory_operands) {
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("vmovdqu %ymm0, 0x40(%rsp)"));
+    ASSERT_EQ(instruction.operand_count, 2);
+    const X86_64_Operand& dest = instruction.operands[0];
+    EXPECT_EQ(dest.kind, X86_64_Operand_Kind::memory);
+    EXPECT_EQ(dest.byte_size, 32);
+    EXPECT_TRUE(dest.is_written);
+    EXPECT_EQ(dest.memory.displacement, 0x40);
+  }
+
+  {
+    X86_64_Instruction instruction = decode_only_instruction(
+        ASM_X86_64("vpxor 0x20(%rsp,%rcx,8), %ymm1, %ymm0"));
+    ASSERT_EQ(instruction.operand_count, 3);
+    EXPECT_TRUE(instruction.operands[0].is_written);
+    EXPECT_FALSE(instruction.operands[0].is_read);
+    EXPECT_EQ(instruction.operands[1].kind, X86_64_Operand_Kind::register_);
+    const X86_64_Operand& src = instruction.operands[2];
+    EXPECT_EQ(src.kind, X86_64_Operand_Kind::memory);
+    EXPECT_EQ(src.byte_size, 32);
+    EXPECT_TRUE(src.is_read);
+    EXPECT_EQ(src.memory.base, X86_64_Register::full(Register_Name::rsp));
+    EXPECT_EQ(src.memory.index, X86_64_Register::full(Register_Name::rcx));
+    EXPECT_EQ(src.memory.scale, 8);
+    EXPECT_EQ(src.memory.displacement, 0x20);
+  }
+
+  {
+    X86_64_Instruction instruction =
+        decode_only_instruction(ASM_X86_64("vmovss 0x10(%r12), %xmm3"));
+    ASSERT_EQ(instruction.operand_count, 2);
+    EXPECT_EQ(instruction.operands[1].byte_size, 4);
+    EXPECT_EQ(instruction.operands[1].memory.base,
+              X86_64_Register::full(Register_Name::r12));
+  }
+}
+
+TEST(Test_X86_64_Decoder, avx_512_memory_operands) {
+  // NOTE(strager): Some assemblers do not support AVX-512.
+  {
+    // vmovdqu64 %zmm0, 0x40(%rsp)
+    static constexpr U8 code[] = {0x62, 0xf1, 0xfe, 0x48,
+                                  0x7f, 0x44, 0x24, 0x01};
+    X86_64_Instruction instruction = decode_only_instruction(code);
+    ASSERT_EQ(instruction.operand_count, 2);
+    const X86_64_Operand& dest = instruction.operands[0];
+    EXPECT_EQ(dest.kind, X86_64_Operand_Kind::memory);
+    EXPECT_EQ(dest.byte_size, 64);
+    EXPECT_TRUE(dest.is_written);
+    EXPECT_EQ(dest.memory.base, X86_64_Register::full(Register_Name::rsp));
+    EXPECT_EQ(dest.memory.displacement, 0x40)
+        << "8-bit displacement should be scaled by the operand size";
+  }
+
+  {
+    // vaddps 0x80(%rsp), %zmm1, %zmm2
+    static constexpr U8 code[] = {0x62, 0xf1, 0x74, 0x48,
+                                  0x58, 0x54, 0x24, 0x02};
+    X86_64_Instruction instruction = decode_only_instruction(code);
+    ASSERT_EQ(instruction.operand_count, 3);
+    const X86_64_Operand& src = instruction.operands[2];
+    EXPECT_EQ(src.byte_size, 64);
+    EXPECT_TRUE(src.is_read);
+    EXPECT_EQ(src.memory.displacement, 0x80);
+  }
+
+  {
+    // vpxorq (%rsp){1to8}, %zmm1, %zmm2
+    static constexpr U8 code[] = {0x62, 0xf1, 0xf5, 0x58, 0xef, 0x14, 0x24};
+    EXPECT_FALSE(can_decode_fast(code)) << "broadcasts are not supported";
+  }
+}
+
+TEST(Test_X86_64_Decoder, unsupported_instructions_are_left_for_fallback) {
+  EXPECT_FALSE(can_decode_fast(ASM_X86_64("lock addl $1, (%rax)")));
+  EXPECT_FALSE(can_decode_fast(ASM_X86_64("cvtsi2sd %eax, %xmm0")));
+  EXPECT_FALSE(can_decode_fast(ASM_X86_64("pause")));
+}
+
+TEST(Test_X86_64_Decoder, truncated_instruction_is_not_decoded) {
+  std::span<const U8> code = ASM_X86_64("mov 0x12345678(%rsp), %rax");
+  for (U64 size = 0; size < code.size(); ++size) {
+    EXPECT_FALSE(can_decode_fast(code.first(size))) << "size " << size;
+  }
+}
+}
+}